@@ -30,6 +30,7 @@
 
 #include <ariel/config.h>
 #include <gslib/rtree.h>
+#include <gslib/thdpool.h>
 #include <ariel/loopblinn.h>
 
 __ariel_begin__
@@ -197,6 +198,35 @@ public:
     virtual ~bat_stroke_host_batch();
 };
 
+/* the triangles were recorded first, then assigned to the batches in one sweep at the end. */
+struct bat_record
+{
+    bat_triangle*       triangle;
+    rectf               bound;
+    bat_type            type;
+    int                 group;              /* index of the tex group, -1 for the non-tex triangles */
+};
+
+struct bat_tex_group
+{
+    bat_fill_batch*     batch;              /* might be merged into a former batch in the sweep */
+    bat_stroke_batch*   host;
+    int                 first;              /* range in the records */
+    int                 last;
+};
+
+typedef vector<bat_record> bat_records;
+typedef vector<bat_tex_group> bat_tex_groups;
+
+struct bat_stats
+{
+    int                 triangles;
+    int                 pairs;              /* overlapped pairs found */
+    int                 tiles;
+    int                 batches;
+    float               sweep_time;         /* in milliseconds */
+};
+
 class batch_processor
 {
 public:
@@ -216,13 +246,20 @@ public:
     bat_line* add_aa_border(lb_joint* i, lb_joint* j, float z, uint pen_tag);
     void finish_batching();
     bat_batches& get_batches() { return _batches; }
+    const bat_stats& get_stats() const { return _stats; }
     void clear_batches();
+    void set_workers(int workers);      /* the pool for the sweeps was kept across the frames, 0 for the hardware concurrency */
 
 protected:
     bat_triangles       _triangles;
     bat_lines           _lines;
     bat_batches         _batches;
+    bat_records         _records;
+    bat_tex_groups      _tex_groups;
+    bat_stats           _stats;
     bool                _antialias;
+    thread_pool*        _pool = nullptr;
+    int                 _workers = 0;
 
 protected:
     template<class _batch>
@@ -231,10 +268,12 @@ protected:
     bat_line* create_line(lb_joint* i, lb_joint* j, float w, float z, uint t, bool half);
     bat_line* create_half_line(lb_joint* i, lb_joint* j, const vec2& p1, const vec2& p2, float w, float z, uint t);
     void add_triangle(lb_joint* i, lb_joint* j, lb_joint* k, float z, uint brush_tag);
+    void record_triangle(bat_triangle* triangle, bat_type t, int group);
+    void sweep_batches();
     void collect_aa_borders(bat_triangle* triangle, bool b[3], uint pen_tag);
     void proceed_line_batch();
     void gather_tex_triangles(bat_triangles& triangles, lb_polygon* poly, float z);
-    bat_batch* find_containable_tex_batch(const bat_triangles& triangles);
+    int find_containable_tex_batch(const vector<int>& stamps, int stamp) const;
     bat_stroke_batch* find_associated_tex_stroke_batch(const bat_batch* bat);
 };
 
@@ -31,6 +31,7 @@
 #include <ariel/widget.h>
 #include <ariel/style.h>
 #include <ariel/painterport.h>
+#include <ariel/itemmodel.h>
 #include <ariel/classicstyle/slider_service.h>
 
 /*
@@ -50,7 +51,7 @@ class widget_style_sheet:
 public:
     widget_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _fill_color;
@@ -65,7 +66,7 @@ class root_widget_style_sheet:
 public:
     root_widget_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _bkground_color;
@@ -78,7 +79,7 @@ class placeholder_style_sheet:
 public:
     placeholder_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _fill_color;
@@ -95,7 +96,7 @@ class button_style_sheet:
 public:
     button_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _normal_fill_color;
@@ -118,7 +119,7 @@ class edit_line_style_sheet:
 public:
     edit_line_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _normal_fill_color;
@@ -138,7 +139,7 @@ class combo_box_style_sheet:
 public:
     combo_box_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _normal_fill_color;
@@ -171,7 +172,7 @@ class menu_style_sheet:
 public:
     menu_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _normal_fill_color;
@@ -201,7 +202,7 @@ class menu_cmd_style_sheet:
 public:
     menu_cmd_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     string              _caption;
@@ -214,7 +215,7 @@ class menu_sub_style_sheet:
 public:
     menu_sub_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     string              _caption;
@@ -233,7 +234,7 @@ class menubar_button_style_sheet:
 public:
     menubar_button_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     string              _caption;
@@ -245,7 +246,7 @@ class table_view_style_sheet:
 public:
     table_view_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _view_fill_color;
@@ -265,7 +266,7 @@ class tree_view_style_sheet:
 public:
     tree_view_style_sheet();
     virtual bool get_value(const string& name, string& value) override;
-    virtual void set_value(const string& name, const string& value) override;
+    virtual void set_typed_value(int index, const style_value& value) override;
 
 protected:
     color               _view_fill_color;
@@ -275,6 +276,9 @@ protected:
     int                 _item_indent;
     int                 _item_spacing;
     color               _connect_line_color;
+    string              _item_font_name;
+    int                 _item_font_size;
+    color               _item_font_color;
 };
 
 class widget:
@@ -701,6 +705,8 @@ public:
     virtual bool create(widget* ptr, const gchar* name, const rect& rc, uint style) override;
     virtual void move(const rect& rc) override;
     virtual void draw(painter* paint) override;
+    virtual void on_click(uint um, unikey uk, const point& pt) override;
+    virtual void flush_style() override;
     virtual void refresh_tree_view();
     virtual void on_adjust_horizontal_scrollbar();
     virtual void on_adjust_vertical_scrollbar();
@@ -712,10 +718,22 @@ protected:
     painter_brush       _view_brush;
     painter_pen         _view_pen;
     int                 _scrollbar_width;
+    item_rows           _item_rows;     /* drawn instead of the port if a model was set */
+    item_visual_pool    _item_visuals;
+    font                _item_font;
 
 public:
     void set_scrollbar_width(int w) { _scrollbar_width = w; }
     int get_scrollbar_width() const { return _scrollbar_width; }
+    void set_item_model(item_model* model);
+    item_model* get_item_model() const { return _item_rows.get_model(); }
+    item_rows& get_item_rows() { return _item_rows; }
+    void reload_items();
+    void expand_item(int row, bool b);
+
+protected:
+    void draw_items(painter* paint, int w, int h);
+    int calc_items_offset(int h) const;
 };
 
 class menu;
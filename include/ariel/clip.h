@@ -69,6 +69,13 @@ ariel_export extern void clip_substract(clip_result& output, const painter_path&
 ariel_export extern void clip_exclude(clip_result& output, const painter_path& subjects, const painter_path& clips);
 ariel_export extern void clip_convert(painter_path& path, const clip_result& result);
 
+/*
+ * Intersect a batch of subjects with the clips in tiles, every tile was clipped independently on the worker threads
+ * and then stitched at the tile borders. The subjects were taken as a whole under the fill type, same as the clips.
+ * Curves would be flattened, workers <= 0 means to use all the hardware threads.
+ */
+ariel_export extern void clip_intersect_tiled(painter_linestrips& output, const painter_paths& subjects, const painter_path& clips, clip_fill_type ft = cft_even_odd, float tile_size = 256.f, int workers = 0);
+
 __ariel_end__
 
 #endif
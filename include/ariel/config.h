@@ -41,21 +41,27 @@
 #define ariel_export __declspec(dllimport)
 #endif
 
-enum
-{
-    render_platform_gl_20,
-    render_platform_gl_30,
-    render_platform_d3d_9,
-    render_platform_d3d_11,
-};
+/* macros rather than an enum, so that the selection could be tested by the preprocessor. */
+#define render_platform_gl_20       0
+#define render_platform_gl_30       1
+#define render_platform_d3d_9       2
+#define render_platform_d3d_11      3
+#define render_platform_software    4
 
-/* select render system here. */
+/*
+ * select render system here, or define it in the build, e.g. select_render_platform=render_platform_software.
+ * no premake configuration defined the software one yet, and ariel still went through windows for the fonts
+ * and the frame system, so it was only compiled by hand with the define on windows.
+ */
+#ifndef select_render_platform
 #define select_render_platform  render_platform_d3d_11
+#endif
 
 #define use_rendersys_d3d_9     (select_render_platform == render_platform_d3d_9)
 #define use_rendersys_d3d_11    (select_render_platform == render_platform_d3d_11)
 #define use_rendersys_gl_20     (select_render_platform == render_platform_gl_20)
 #define use_rendersys_gl_30     (select_render_platform == render_platform_gl_30)
+#define use_rendersys_software  (select_render_platform == render_platform_software)
 
 #if use_rendersys_d3d_11
 #include <d3d11.h>
@@ -66,6 +72,7 @@ __ariel_begin__
 
 define_select_type(render_device);
 define_select_type(render_context);
+define_select_type(render_command_list);
 define_select_type(render_resource);
 define_select_type(render_swap_chain);
 define_select_type(render_target_view);
@@ -93,8 +100,10 @@ define_select_type(render_blend_state);
 define_select_type(render_raster_state);
 define_select_type(render_depth_state);
 
+#if use_rendersys_d3d_11
 install_select_type(render_platform_d3d_11, render_device, ID3D11Device);
 install_select_type(render_platform_d3d_11, render_context, ID3D11DeviceContext);
+install_select_type(render_platform_d3d_11, render_command_list, ID3D11CommandList);
 install_select_type(render_platform_d3d_11, render_resource, ID3D11Resource);
 install_select_type(render_platform_d3d_11, render_swap_chain, IDXGISwapChain);
 install_select_type(render_platform_d3d_11, render_target_view, ID3D11RenderTargetView);
@@ -123,9 +132,57 @@ install_select_type(render_platform_d3d_11, render_sampler_state, ID3D11SamplerS
 install_select_type(render_platform_d3d_11, render_blend_state, ID3D11BlendState);
 install_select_type(render_platform_d3d_11, render_raster_state, ID3D11RasterizerState);
 install_select_type(render_platform_d3d_11, render_depth_state, ID3D11DepthStencilState);
+#endif
+
+/* the software render system, see rendersyssw.h */
+class rendersys_sw;
+class sw_object;
+class sw_resource;
+class sw_buffer;
+class sw_texture2d;
+class sw_shader_resource_view;
+class sw_sampler_state;
+class sw_vertex_format;
+class sw_vertex_shader;
+class sw_pixel_shader;
+class sw_blob;
+struct sw_vertex_element;
+
+install_select_type(render_platform_software, render_device, rendersys_sw);
+install_select_type(render_platform_software, render_context, rendersys_sw);
+install_select_type(render_platform_software, render_command_list, sw_object);
+install_select_type(render_platform_software, render_resource, sw_resource);
+install_select_type(render_platform_software, render_swap_chain, sw_object);
+install_select_type(render_platform_software, render_target_view, sw_object);
+install_select_type(render_platform_software, shader_resource_view, sw_shader_resource_view);
+install_select_type(render_platform_software, depth_stencil_view, sw_object);
+install_select_type(render_platform_software, unordered_access_view, sw_object);
+install_select_type(render_platform_software, render_blob, sw_blob);
+install_select_type(render_platform_software, vertex_shader, sw_vertex_shader);
+install_select_type(render_platform_software, pixel_shader, sw_pixel_shader);
+install_select_type(render_platform_software, geometry_shader, sw_object);
+install_select_type(render_platform_software, compute_shader, sw_object);
+install_select_type(render_platform_software, hull_shader, sw_object);
+install_select_type(render_platform_software, domain_shader, sw_object);
+
+install_select_type(render_platform_software, render_include, sw_object);
+install_select_type(render_platform_software, vertex_format, sw_vertex_format);
+install_select_type(render_platform_software, vertex_format_desc, sw_vertex_element);
+install_select_type(render_platform_software, render_vertex_buffer, sw_buffer);
+install_select_type(render_platform_software, render_index_buffer, sw_buffer);
+install_select_type(render_platform_software, render_constant_buffer, sw_buffer);
+
+install_select_type(render_platform_software, render_texture1d, sw_object);
+install_select_type(render_platform_software, render_texture2d, sw_texture2d);
+install_select_type(render_platform_software, render_texture3d, sw_object);
+install_select_type(render_platform_software, render_sampler_state, sw_sampler_state);
+install_select_type(render_platform_software, render_blend_state, sw_object);
+install_select_type(render_platform_software, render_raster_state, sw_object);
+install_select_type(render_platform_software, render_depth_state, sw_object);
 
 config_select_type(select_render_platform, render_device);
 config_select_type(select_render_platform, render_context);
+config_select_type(select_render_platform, render_command_list);
 config_select_type(select_render_platform, render_resource);
 config_select_type(select_render_platform, render_swap_chain);
 config_select_type(select_render_platform, render_target_view);
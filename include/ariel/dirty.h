@@ -33,35 +33,101 @@
 
 __ariel_begin__
 
-class dirty_list
+/*
+ * The region in y-bands, every band held the sorted spans disjointed in x, the adjacent bands of the same spans
+ * were coalesced, so that a region had the only representation.
+ */
+class dirty_region
 {
 public:
+    struct span
+    {
+        int             left;
+        int             right;
+    };
+    typedef vector<span> span_list;
+    struct band
+    {
+        int             top;
+        int             bottom;
+        int             first;      /* the first span of the band */
+        int             count;
+    };
+    typedef vector<band> band_list;
     typedef list<rect> rect_list;
-    typedef rect_list::iterator iterator;
-    typedef rect_list::const_iterator const_iterator;
+
+public:
+    dirty_region() {}
+    dirty_region(const rect& rc) { set_rect(rc); }
+    bool is_empty() const { return _bands.empty(); }
+    void clear();
+    void set_rect(const rect& rc);
+    const rect& get_bound() const { return _bound; }
+    int get_rect_count() const { return (int)_spans.size(); }
+    int get_area() const;
+    void unite(const rect& rc) { unite(dirty_region(rc)); }
+    void unite(const dirty_region& rgn);
+    void intersect(const rect& rc) { intersect(dirty_region(rc)); }
+    void intersect(const dirty_region& rgn);
+    void subtract(const rect& rc) { subtract(dirty_region(rc)); }
+    void subtract(const dirty_region& rgn);
+    bool is_intersected(const rect& rc) const;
+    bool get_row_spans(int y, const span*& spans, int& count) const;
+    void get_rects(rect_list& rcs) const;
+    template<class _fn>
+    void for_each_rect(_fn fn) const
+    {
+        for(const band& b : _bands) {
+            for(int i = b.first; i < b.first + b.count; i ++) {
+                const span& s = _spans.at(i);
+                fn(rect(s.left, b.top, s.right - s.left, b.bottom - b.top));
+            }
+        }
+    }
+
+protected:
+    band_list           _bands;
+    span_list           _spans;
+    rect                _bound;
+
+protected:
+    void combine(const dirty_region& rgn, int op);
+    void append_band(int top, int bottom, const span_list& spans);
+    void update_bound();
+};
+
+/*
+ * The dirty rects were kept in a region. A rect would be merged with the one nearby into their bound, if the overdraw
+ * was cheaper than the cost of drawing one more rect, which was measured in pixels.
+ */
+class dirty_list
+{
+public:
+    typedef dirty_region::rect_list rect_list;
 
 protected:
     int         _width, _height;
     int         _cap;
+    int         _draw_cost;
     bool        _whole;
 
 private:
-    rect_list   _rclist;
+    dirty_region _region;
 
 public:
     dirty_list();
     dirty_list(int w, int h);
-    int size() const { return (int)_rclist.size(); }
+    int size() const { return _region.get_rect_count(); }
     void clear();
     void set_dimension(int w, int h);
+    void set_draw_cost(int c) { _draw_cost = c; }
     void add(rect rc);
     void set_whole() { _whole = true;}
     bool is_whole() const { return _whole; }
     bool is_dirty(const rect& rc) const;
-    iterator begin() { return _rclist.begin(); }
-    const_iterator begin() const { return _rclist.begin(); }
-    iterator end() { return _rclist.end(); }
-    const_iterator end() const { return _rclist.end(); }
+    const dirty_region& get_region() const { return _region; }
+    const dirty_region* get_clip() const { return _whole || _region.is_empty() ? nullptr : &_region; }   /* nullptr for no clipping */
+    void get_rects(rect_list& rcs) const;
 };
 
 __ariel_end__
@@ -28,6 +28,10 @@
 #ifndef framesys_300a49a6_c103_4a1f_8166_358e823a432b_h
 #define framesys_300a49a6_c103_4a1f_8166_358e823a432b_h
 
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <gslib/type.h>
 #include <ariel/sysop.h>
 #include <ariel/config.h>
@@ -39,6 +43,7 @@ enum frame_strategy
 {
     fs_busy_loop,
     fs_lazy_passive,
+    fs_pipelined,           /* recorded into the command lists, submitted on the render thread */
 };
 
 struct app_config;
@@ -47,6 +52,7 @@ class framesys;
 struct frame_event;
 class frame_listener;
 class rose;
+class rendersys_d3d11;
 
 enum frame_event_id
 {
@@ -251,6 +257,44 @@ register_frame_event(feid_halt, frame_halt_event);
 register_frame_event(feid_resume, frame_resume_event);
 #undef register_frame_event
 
+/*
+ * The events in a tagged union, so that they were queued by value and delivered in batches, switched on the id
+ * rather than the virtual calls per event.
+ */
+struct frame_message
+{
+    uint                id;                     /* frame_event_id */
+    int64               time;                   /* when posted, by the profiler clock */
+    union
+    {
+        struct { uint modifier; unikey key; int x, y; } mouse;
+        struct { uint modifier; unikey key; } keyboard;
+        struct { uint modifier; uint charactor; } input;
+        struct { uint timerid; } timer;
+        struct { bool show; } visibility;
+        struct { int left, top, right, bottom; } boundary;
+        struct { int left, top, right, bottom; system_driver* driver; } create;
+    };
+
+public:
+    point get_position() const { return point(mouse.x, mouse.y); }
+    void set_position(const point& pt) { mouse.x = pt.x, mouse.y = pt.y; }
+    rect get_boundary() const
+    {
+        rect rc;
+        rc.set_ltrb(boundary.left, boundary.top, boundary.right, boundary.bottom);
+        return rc;
+    }
+    void set_boundary(const rect& rc)
+    {
+        boundary.left = rc.left;
+        boundary.top = rc.top;
+        boundary.right = rc.right;
+        boundary.bottom = rc.bottom;
+    }
+    bool from_event(const frame_event& event);
+};
+
 class __gs_novtable frame_listener abstract
 {
 public:
@@ -258,6 +302,34 @@ public:
     virtual void on_frame_start() = 0;
     virtual void on_frame_end() = 0;
     virtual bool on_frame_event(const frame_event& event) = 0;
+    virtual bool on_frame_message(const frame_message& msg);                    /* through on_frame_event unless overridden */
+    virtual void on_frame_messages(const frame_message msgs[], int count);
+};
+
+/*
+ * The consecutive mouse moves of the same modifier were coalesced into the last one, so were the paints by the
+ * union of the boundaries. The messages being delivered were sealed against the coalescing.
+ */
+class frame_message_queue
+{
+public:
+    enum { capacity = 256 };
+
+public:
+    bool is_empty() const { return _head == _tail; }
+    bool is_full() const { return _tail - _head >= capacity; }
+    int get_size() const { return (int)(_tail - _head); }
+    int get_dropped() const { return _dropped; }
+    bool post(const frame_message& msg);        /* false if coalesced or dropped */
+    void deliver(frame_listener* listener);
+
+protected:
+    frame_message       _messages[capacity];
+    uint                _head = 0;
+    uint                _tail = 0;
+    uint                _sealed = 0;
+    int                 _dropped = 0;           /* posted by the handlers with the queue full */
+    bool                _delivering = false;
 };
 
 class frame_dispatcher:
@@ -281,15 +353,149 @@ public:
 
 protected:
     frame_listener*     _listener;
+    frame_message_queue _queue;
+
+protected:
+    void post(frame_message& msg);
+    void post_immediately(frame_message& msg);
 
 public:
     frame_dispatcher() { _listener = 0; }
     void set_listener(frame_listener* listenter) { _listener = listenter; }
     void do_draw();
+    void deliver();
+    void fire_timer(uint tid);
+    bool has_pending() const { return !_queue.is_empty(); }
     void on_frame_start();
     void on_frame_end();
 };
 
+/*
+ * The timers in a hierarchical wheel of 4 levels by 64 slots, ticked in ms. The deadlines were rounded up within
+ * the slack, so that the timers close to each other landed in the same tick and were fired together.
+ */
+class frame_timer_wheel
+{
+public:
+    enum
+    {
+        slot_bits = 6,
+        slot_count = 1 << slot_bits,
+        slot_mask = slot_count - 1,
+        level_count = 4,
+    };
+    struct entry
+    {
+        uint            id;
+        int             elapse;
+        int64           deadline;
+        int             prev;
+        int             next;
+        int             slot;                   /* level * slot_count + index, -1 if unlinked */
+    };
+    typedef vector<entry> entries;
+    typedef unordered_map<uint, int> entry_map;
+    typedef vector<uint> fired_list;
+
+public:
+    frame_timer_wheel();
+    void set_slack(int ms) { _slack = gs_max(ms, 0); }
+    int get_slack() const { return _slack; }
+    void set_timer(uint tid, int elapse, int64 now);
+    void kill_timer(uint tid);
+    bool is_alive(uint tid) const { return _map.find(tid) != _map.end(); }
+    bool is_empty() const { return _map.empty(); }
+    int64 get_next_deadline() const;            /* -1 if none */
+    const fired_list& advance(int64 now);       /* the ones due, rescheduled by their elapses */
+
+protected:
+    entries             _entries;
+    entry_map           _map;
+    int                 _free = -1;
+    int                 _slots[level_count * slot_count];
+    int64               _current = 0;           /* the next tick to process */
+    int                 _slack = 16;            /* in ms, at most 1/4 of the elapse was taken */
+    fired_list          _fired;
+
+protected:
+    int64 get_deadline(int64 now, int elapse) const;
+    int64 get_next_tick() const;                /* -1 if no slot occupied */
+    void link(int i);
+    void unlink(int i);
+    int cascade(int level);
+};
+
+/* the times in ms were counted in the log2 buckets, from below 0.25ms to beyond 4s. */
+struct frame_histogram
+{
+    enum { bucket_count = 16 };
+
+    int                 buckets[bucket_count];
+    int                 count;
+    double              total;
+    double              peak;
+
+public:
+    frame_histogram() { reset(); }
+    void reset();
+    void add(double ms);
+    double get_average() const { return count ? total / count : 0.0; }
+    double get_percentile(float p) const;       /* the upper bound of the bucket it fell in */
+    void tracing(const gchar* name) const;
+
+public:
+    static double get_bucket_bound(int i) { return 0.25 * (double)(1 << i); }
+};
+
+struct frame_stats
+{
+    frame_histogram     record;                 /* events, painting, tessellation & batching, the submission too unless pipelined */
+    frame_histogram     submit;                 /* the execution & the present on the render thread */
+    frame_histogram     stall;                  /* waited for the frames in flight under the latency limit */
+    frame_histogram     interval;               /* between the starts of the frames, tells the throughput */
+};
+
+/*
+ * The frames recorded on the main thread were submitted in order on the render thread, so that the events & the
+ * painting of the next frame overlapped the execution & the present of the last one. At most max_latency frames
+ * were in flight, 2 by default, the recording waited for a slot beyond that. Only the submission was moved off the
+ * main thread, the painting, the tessellation & the batching stayed in the recording.
+ */
+class frame_pipeline
+{
+public:
+    typedef deque<render_command_list*> command_lists;
+
+public:
+    frame_pipeline() {}
+    ~frame_pipeline() { stop(); }
+    bool start(rendersys_d3d11* rsys);
+    void stop();
+    void flush();
+    double acquire();                           /* returns the ms stalled */
+    void submit(render_command_list* cl);
+    void set_max_latency(int frames);
+    int get_max_latency() const { return _max_latency; }
+    bool is_running() const { return _thread.joinable(); }
+    void get_submit_histogram(frame_histogram& hist);
+    void reset_submit_histogram();
+
+protected:
+    rendersys_d3d11*    _rsys = nullptr;
+    std::thread         _thread;
+    std::mutex          _mtx;
+    std::condition_variable _cv_submit;
+    std::condition_variable _cv_done;
+    command_lists       _lists;
+    int                 _in_flight = 0;         /* the queued ones & the one executing */
+    int                 _max_latency = 2;
+    bool                _stop = false;
+    frame_histogram     _submit;
+
+protected:
+    void run();
+};
+
 struct frame_configs
 {
     uint                handles;
@@ -315,6 +521,14 @@ public:
     const frame_configs& get_configs() const { return _configs; }
     void initialize(const rect& rc);
     void refresh();
+    void set_max_latency(int frames) { _pipeline.set_max_latency(frames); }
+    void set_timer_slack(int ms) { _timers.set_slack(ms); }
+    int get_idle_timeout() const;               /* in ms, -1 to wait for the messages only */
+    void on_system_timer();                     /* the fallback in the modal loops of the system */
+    void flush_frames() { _pipeline.flush(); }
+    void get_frame_stats(frame_stats& st);
+    void reset_frame_stats();
+    void tracing_frame_stats();
 
 public:
     virtual ~framesys();
@@ -345,14 +559,25 @@ public:
     static void on_app_windowed(HWND);
 #endif
 
+public:
+    static int64 get_ticks()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
 protected:
     void idle()
     {
         assert(_empty_frame_proc);
         (this->*_empty_frame_proc)();
     }
+    void dispatch_messages();
+    void fire_timers();
+    void arm_system_timer();
     void empty_frame_lazy();
     void empty_frame_busy();
+    void empty_frame_pipelined();
+    void on_frame_started();
 
 protected:
     frame_strategy      _strategy;
@@ -362,6 +587,12 @@ protected:
     rendersys*          _rendersys;
     rose*               _rose;
     fn_empty_frame      _empty_frame_proc;
+    frame_pipeline      _pipeline;
+    frame_timer_wheel   _timers;
+    int64               _system_deadline = -1;  /* of the fallback timer armed, -1 if none */
+    frame_stats         _stats;
+    std::chrono::steady_clock::time_point _last_frame;
+    bool                _last_frame_valid = false;
 };
 
 __ariel_end__
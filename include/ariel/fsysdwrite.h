@@ -49,14 +49,17 @@ public:
     virtual ~fsys_dwrite();
     virtual void initialize() override;
     virtual void set_font(const font& f) override;
+    virtual const font& get_font() const override { return _font; }
     virtual bool query_size(const gchar* str, int& w, int& h, int len = -1) override;
     virtual bool create_text_image(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) override;
     virtual bool create_text_texture(texture2d** tex, const gchar* str, int margin, const color& cr, int len = -1) override;
     virtual void draw(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) override;
+    virtual bool query_advances(vector<float>& xs, const gchar* str, int len = -1) override;
 
 protected:
     dwrite_font_map                     _font_map;
     IDWriteTextFormat*                  _current_font;
+    font                                _font;
     com_ptr<ID3D11Device>               _dev11;
     com_ptr<ID3D10Device1>              _dev101;
     com_ptr<IDWriteFactory>             _dwfactory;
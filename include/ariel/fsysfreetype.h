@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef fsysfreetype_7bf66d1b_c66a_4bb9_8e5e_cb350878f3ad_h
+#define fsysfreetype_7bf66d1b_c66a_4bb9_8e5e_cb350878f3ad_h
+
+#include <gslib/std.h>
+#include <gslib/string.h>
+#include <ariel/sysop.h>
+#include <ariel/rendersys.h>
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+__ariel_begin__
+
+/* the glyphs too large for a page of the atlas, their coverage was kept aside. */
+static const int ft_page_oversized = -2;
+
+struct ft_glyph
+{
+    int                 page;       /* -1 for the blanks, or ft_page_oversized */
+    rect                slot;       /* in the page, the gap excluded */
+    int                 left;       /* the bearing from the pen */
+    int                 top;        /* the bearing above the baseline */
+    float               advance;
+    int                 oversized;  /* the index of the coverage kept aside */
+};
+
+/*
+ * The glyph atlas of the freetype font system, the glyphs were kept in the pages across the frames, a page was
+ * allocated in shelves. The coverage was written into the copy of the page on cpu side, and only the dirty rect of
+ * each page was uploaded on the commit, so nothing would be uploaded unless there were glyphs missing.
+ */
+class ft_glyph_atlas
+{
+public:
+    struct shelf
+    {
+        int             top;
+        int             height;
+        int             cursor;
+    };
+    typedef vector<shelf> shelf_list;
+    struct page
+    {
+        image           pixels;     /* white, the coverage in the alpha */
+        texture2d*      tex;
+        shelf_list      shelves;
+        rect            dirty;      /* empty if nothing to upload */
+    };
+    typedef vector<page> page_list;
+    struct stats
+    {
+        int             pages;
+        int             glyphs;
+        int             uploads;
+        int64           uploaded_bytes;
+    };
+
+public:
+    ft_glyph_atlas();
+    ~ft_glyph_atlas() { destroy(); }
+    void setup(rendersys* rsys, int page_size = 1024);
+    void destroy();
+    bool allocate(int w, int h, int& index, rect& slot);
+    bool can_hold(int w, int h) const { return w + _gap * 2 <= _page_size && h + _gap * 2 <= _page_size; }
+    void write(int index, const rect& slot, const byte* coverage, int pitch);
+    void commit();
+    int get_page_size() const { return _page_size; }
+    texture2d* get_page_texture(int index) const;
+    const page& get_page(int index) const { return _pages.at(index); }
+    const stats& get_stats() const { return _stats; }
+
+protected:
+    rendersys*          _rsys;
+    page_list           _pages;
+    stats               _stats;
+    int                 _page_size;
+    int                 _gap;
+
+protected:
+    bool create_page();
+};
+
+/*
+ * The font system on the freetype, the glyphs were rasterized once into the atlas for each face & size, then the
+ * texts were laid out into the quads of the glyphs, for the painters to draw them in batches.
+ * The faces were resolved by the names registered, or by the fonts installed on the system.
+ */
+class fsys_freetype:
+    public fontsys
+{
+public:
+    struct face_entry
+    {
+        FT_FaceRec_*    face;
+        int             pixel_size;     /* currently selected */
+    };
+    typedef unordered_map<string, face_entry> face_map;
+    struct font_entry
+    {
+        face_entry*     face;
+        uint            id;
+        int             pixel_size;
+        int             ascender;
+        int             height;
+        bool            embolden;
+        bool            oblique;
+    };
+    typedef unordered_map<font, font_entry*> ft_font_map;
+    typedef unordered_map<uint64, ft_glyph> glyph_map;
+    typedef unordered_map<string, string> font_file_map;
+    typedef vector<image> oversized_glyphs;
+
+public:
+    fsys_freetype();
+    virtual ~fsys_freetype();
+    virtual void initialize() override;
+    virtual void set_font(const font& f) override;
+    virtual const font& get_font() const override { return _font; }
+    virtual bool query_size(const gchar* str, int& w, int& h, int len = -1) override;
+    virtual bool create_text_image(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) override;
+    virtual bool create_text_texture(texture2d** tex, const gchar* str, int margin, const color& cr, int len = -1) override;
+    virtual void draw(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) override;
+    virtual bool query_glyphs(fontsys_glyph_quads& quads, const gchar* str, int len = -1) override;
+    virtual texture2d* get_glyph_page(int page) const override { return _atlas.get_page_texture(page); }
+    virtual void commit_glyphs() override { _atlas.commit(); }
+    virtual bool query_advances(vector<float>& xs, const gchar* str, int len = -1) override;
+
+public:
+    void register_font_file(const gchar* name, const gchar* path);
+    const ft_glyph_atlas& get_atlas() const { return _atlas; }
+
+protected:
+    FT_LibraryRec_*     _library;
+    face_map            _faces;
+    ft_font_map         _font_map;
+    font_file_map       _font_files;
+    font_entry*         _current_font;
+    font                _font;
+    uint                _next_font_id;
+    glyph_map           _glyphs;
+    ft_glyph_atlas      _atlas;
+    oversized_glyphs    _oversized;
+    string              _system_font_dir;
+
+protected:
+    face_entry* open_face(const string& name, bool bold, bool italic, bool& embolden, bool& oblique);
+    bool find_font_file(const string& name, string& path);
+    void select_size(font_entry* ft);
+    const ft_glyph* acquire_glyph(font_entry* ft, uint index);
+    template<class _fn>
+    void layout_text(const gchar* str, int len, _fn fn);
+    void blend_text(image& img, const gchar* str, int x, int y, const color& cr, int len);
+    void destroy_fonts();
+};
+
+__ariel_end__
+
+#endif
@@ -44,15 +44,18 @@ public:
     virtual ~fsys_win32();
     virtual void initialize() override;
     virtual void set_font(const font& f) override;
+    virtual const font& get_font() const override { return _font; }
     virtual bool query_size(const gchar* str, int& w, int& h, int len = -1) override;
     virtual bool create_text_image(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) override;
     virtual bool create_text_texture(texture2d** tex, const gchar* str, int margin, const color& cr, int len = -1) override;
     virtual void draw(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) override;
+    virtual bool query_advances(vector<float>& xs, const gchar* str, int len = -1) override;
 
 protected:
     HDC         _container_dc;
     HFONT       _old_font;
     font_map    _font_map;
+    font        _font;
 };
 
 __ariel_end__
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef itemmodel_820d85f6_f920_42ad_9547_709ae4dade5d_h
+#define itemmodel_820d85f6_f920_42ad_9547_709ae4dade5d_h
+
+#include <gslib/std.h>
+#include <ariel/type.h>
+
+__ariel_begin__
+
+struct item_data
+{
+    string              text;
+    bool                branch = false;     /* had the children, could be expanded or collapsed */
+};
+
+/*
+ * The lazy model of the items, the rows were the nodes of a tree in the preorder, the descendants of a row were
+ * the following rows in the greater depths. The data was only asked for the rows to be drawn.
+ */
+class __gs_novtable item_model abstract
+{
+public:
+    virtual ~item_model() {}
+    virtual int get_row_count() const = 0;
+    virtual int get_row_height(int row) const = 0;
+    virtual int get_row_depth(int row) const { return 0; }
+    virtual void get_row_data(int row, item_data& data) const = 0;
+    virtual int get_column_count() const { return 1; }
+    virtual void get_cell_data(int row, int col, item_data& data) const { get_row_data(row, data); }
+};
+
+/*
+ * The segment tree over the row heights. The hidden rows were covered by the ranges counted on the nodes, a node
+ * covered summed to zero, so that hiding or showing a subtree was a single range operation, and a height changed,
+ * the top of a row & the row at an offset were all in O(log n) as well.
+ */
+class row_height_index
+{
+public:
+    void reset(int count);
+    int size() const { return (int)_heights.size(); }
+    void set_height(int row, int h);
+    int get_height(int row) const;      /* zero if hidden */
+    int get_top(int row) const;         /* sum of the heights before the row */
+    int get_total() const { return _sums.at(1); }
+    int find_row(int y) const;          /* the row covering y, size() if beyond */
+    void hide_rows(int begin, int end) { cover(1, 0, _base, begin, end, 1); }
+    void show_rows(int begin, int end) { cover(1, 0, _base, begin, end, -1); }
+
+protected:
+    vector<int>         _heights;
+    vector<int>         _sums;          /* 1 based, the children of i at 2i & 2i + 1, the leaves from _base */
+    vector<int>         _covers;        /* the hidden ranges covering the node entirely */
+    int                 _base = 1;
+
+protected:
+    void cover(int node, int lo, int span, int begin, int end, int d);
+    void pull(int node);
+
+public:
+    template<class _fn>
+    void build(int count, _fn height_of)
+    {
+        reset(count);
+        for(int i = 0; i < count; i ++)
+            _sums.at(_base + i) = _heights.at(i) = height_of(i);
+        for(int i = _base - 1; i > 0; i --)
+            _sums.at(i) = _sums.at(i * 2) + _sums.at(i * 2 + 1);
+    }
+};
+
+/* the visual of a row to draw, the data was kept while the row stayed visible. */
+struct item_visual
+{
+    int                 row;
+    item_data           data;
+    bool                used;
+};
+
+/*
+ * The visuals were recycled between the frames, the ones left out of a frame were rebound to the rows newly
+ * exposed, so that the memory was bound by the visible rows rather than the rows of the model.
+ */
+class item_visual_pool
+{
+public:
+    typedef vector<item_visual> visual_list;
+    typedef unordered_map<int, int> row_map;
+
+public:
+    void begin_frame();
+    item_visual& acquire(const item_model* model, int row);
+    void end_frame();
+    void clear();
+    void invalidate(int row);
+    int get_fetches() const { return _fetches; }
+
+protected:
+    visual_list         _visuals;
+    row_map             _rows;          /* row to the index of the visual */
+    vector<int>         _free;
+    int                 _fetches = 0;   /* the data asked from the model */
+};
+
+/*
+ * The rows of a model with the collapsed branches, the descendants of a collapsed row were hidden as a range. The end
+ * of the subtree of each row was found once on reloading.
+ */
+class item_rows
+{
+public:
+    item_rows() {}
+    void set_model(item_model* model);
+    item_model* get_model() const { return _model; }
+    void reload();
+    int get_row_count() const { return _index.size(); }
+    int get_total_height() const { return _index.get_total(); }
+    int get_row_top(int row) const { return _index.get_top(row); }
+    int get_row_height(int row) const { return _index.get_height(row); }
+    int find_row(int y) const { return _index.find_row(y); }
+    int next_row(int row) const;        /* the next visible row */
+    bool is_expanded(int row) const { return !_collapsed.at(row); }
+    void expand(int row, bool b);
+    void toggle(int row) { expand(row, !is_expanded(row)); }
+    void update_row_height(int row);
+
+protected:
+    item_model*         _model = nullptr;
+    row_height_index    _index;
+    vector<bool>        _collapsed;
+    vector<int>         _ends;          /* the row after the subtree */
+
+protected:
+    int end_of_subtree(int row) const { return _ends.at(row); }
+};
+
+__ariel_end__
+
+#endif
@@ -133,6 +133,15 @@ struct painter_context
 
 class painter_path;
 
+/* the handle of a path registered to draw repeatedly, 0 for invalid. */
+typedef int painter_symbol;
+
+struct painter_symbol_instance
+{
+    mat3                transform;          /* from the symbol space to the current painter space */
+    color               cr;                 /* the solid fill color */
+};
+
 class __gs_novtable painter abstract
 {
 public:
@@ -143,6 +152,7 @@ public:
     typedef vector<texture2d*> text_image_cache;
     typedef painter_context context;
     typedef list<context> context_stack;
+    typedef unordered_map<painter_symbol, painter_path> symbol_paths;
 
 public:
     virtual ~painter();
@@ -152,13 +162,14 @@ public:
 public:
     virtual int get_width() const { return _width; }
     virtual int get_height() const { return _height; }
-    virtual void set_dirty(dirty_list* dirty) {}
-    virtual dirty_list* get_dirty() const { return nullptr; }
+    virtual void set_dirty(dirty_list* dirty) { _dirty = dirty; }      /* the painters might clip to it */
+    virtual dirty_list* get_dirty() const { return _dirty; }
     virtual void set_hints(uint hints, bool enable);
     virtual void set_brush(const painter_brush& b) { _context.set_brush(b); }
     virtual void set_pen(const painter_pen& p) { _context.set_pen(p); }
     virtual void set_tranform(const mat3& m) { _context.set_transform(m); }
     virtual void set_font(const font& ft);
+    virtual const font& get_font() const { return _font; }
     virtual void save();
     virtual void restore();
     virtual bool query_hints(uint hints) const { return (_hints & hints) == hints; }
@@ -171,6 +182,9 @@ public:
     virtual void draw_line(const vec2& p1, const vec2& p2, const color& cr);
     virtual void draw_rect(const rectf& rc, const color& cr);
     virtual void draw_text(const gchar* str, float x, float y, const color& cr, int length = -1);
+    virtual painter_symbol register_symbol(const painter_path& path);
+    virtual void unregister_symbol(painter_symbol sym);
+    virtual void draw_symbol(painter_symbol sym, const painter_symbol_instance instances[], int count);
 
 public:
     virtual void draw_line(const vec2& p1, const vec2& p2)
@@ -223,6 +237,10 @@ protected:
     int                 _height = 0;
     uint                _hints = 0;
     text_image_cache    _text_image_cache;
+    font                _font;
+    dirty_list*         _dirty = nullptr;
+    symbol_paths        _symbol_paths;
+    painter_symbol      _next_symbol = 1;
 
 public:
     painter() {}
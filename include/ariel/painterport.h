@@ -62,9 +62,18 @@ public:
 
 protected:
     painter_context         _ctx;
+    int                     _order = 0;     /* the order of recording, which was also the order to draw */
+    rectf                   _bound;         /* the rect in the rtree */
 
 public:
     const painter_context& get_context() const { return _ctx; }
+    void set_order(int order) { _order = order; }
+    int get_order() const { return _order; }
+    void set_bound(const rectf& rc) { _bound = rc; }
+    const rectf& get_bound() const { return _bound; }
+
+protected:
+    void setup_context(painter* paint, const rectf& vp) const;
 };
 
 class painter_line_obj:
@@ -88,44 +97,58 @@ public:
     painter_rect_obj(const painter_context& ctx,  const rectf& rc): painter_obj(ctx), _rc(rc) {}
     virtual type get_type() const override { return po_rect; }
     virtual rectf& get_rect(rectf& rc) const override { return rc = _rc; }
-    virtual void draw_to(painter* paint, const rectf& vp) const override {}
+    virtual void draw_to(painter* paint, const rectf& vp) const override;
 
 private:
     rectf                   _rc;
 };
 
+/*
+ * The path was recorded with the transform baked in, so the solid fills were registered once as the symbols of the
+ * painter drawn to and drawn as instances by the viewport offsets across the frames, the tessellation was kept.
+ * The symbols went without the anti-aliasing borders, the painter should outlive the object.
+ */
 class painter_path_obj:
     public painter_obj
 {
 public:
     painter_path_obj(const painter_context& ctx, painter_path& take_me): painter_obj(ctx) { _path.swap(take_me); }
     painter_path_obj(const painter_context& ctx, const painter_path& path): painter_obj(ctx), _path(path) {}
+    virtual ~painter_path_obj() { release_symbol(); }
     virtual type get_type() const override { return po_path; }
     virtual rectf& get_rect(rectf& rc) const override;
-    virtual void draw_to(painter* paint, const rectf& vp) const override {}
+    virtual void draw_to(painter* paint, const rectf& vp) const override;
     rectf& rebuild_rect(rectf& rc) const;
+    void release_symbol() const;
 
 private:
     painter_path            _path;
     mutable bool            _rc_valid = false;
     mutable rectf           _rc;
+    mutable painter*        _sym_owner = nullptr;
+    mutable painter_symbol  _sym = 0;
 };
 
 class painter_text_obj:
     public painter_obj
 {
 public:
-    painter_text_obj(const painter_context& ctx, const string& txt, const pointf& p, const color& cr): painter_obj(ctx), _text(txt), _pos(p), _cr(cr) {}
+    painter_text_obj(const painter_context& ctx, const string& txt, const pointf& p, const color& cr, const font& ft): painter_obj(ctx), _text(txt), _pos(p), _cr(cr), _font(ft) {}
     virtual type get_type() const override { return po_text; }
     virtual rectf& get_rect(rectf& rc) const override;
-    virtual void draw_to(painter* paint, const rectf& vp) const override {}
+    virtual void draw_to(painter* paint, const rectf& vp) const override;
 
 private:
     string                  _text;
     pointf                  _pos;
     color                   _cr;
+    font                    _font;
 };
 
+/*
+ * Record the drawings into an rtree, then flush the ones visible in a viewport. The transforms were baked into the
+ * geometry on recording. The visible objects were kept from the last flush, a scroll would only query the exposed strips.
+ */
 class painterport:
     public painter
 {
@@ -141,14 +164,21 @@ public:
 
 protected:
     painter_obj_rtree       _rtree;
+    int                     _next_order = 0;
+    mutable painter_objs    _visible;           /* of the last viewport, in the order to draw */
+    mutable painter_objs    _exposed;
+    mutable rectf           _visible_rect;
+    mutable bool            _visible_valid = false;
 
 public:
     rectf& get_area_rect(rectf& rc) const;
     void query_objs(painter_objs& objs, const rectf& rc) const;
+    const painter_objs& get_visible_objs(const rectf& vp) const;
 
 protected:
     void add_obj(painter_obj* obj);
     void clear_objs();
+    void update_visible(const rectf& vp) const;
 };
 
 __ariel_end__
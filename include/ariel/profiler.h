@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef profiler_a7c0a722_3f93_4137_bb24_fd447ef00aa3_h
+#define profiler_a7c0a722_3f93_4137_bb24_fd447ef00aa3_h
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <gslib/type.h>
+#include <gslib/string.h>
+#include <ariel/config.h>
+
+/* define it as 0 in the build to compile the scopes & the counters out. */
+#ifndef use_ariel_profiler
+#define use_ariel_profiler  1
+#endif
+
+__ariel_begin__
+
+enum profile_counter_id
+{
+    pci_paths,
+    pci_triangles,
+    pci_batches,
+    pci_bytes_uploaded,
+    pci_vertices,                               /* written after the shared ones were merged */
+    pci_vertices_saved,                         /* by the indices, against one vertex a corner */
+    pci_events,                                 /* the messages delivered */
+    pci_events_coalesced,
+    pci_event_latency,                          /* in ns summed, from the posts to the deliveries */
+    pci_event_cost,                             /* in ns, spent in the deliveries */
+    pci_count,
+};
+
+struct profile_event
+{
+    const char*         name;                   /* static strings only, kept by the pointers */
+    int64               start;                  /* in ns since the profiler was created */
+    int64               duration;
+    int                 depth;
+};
+
+struct profile_frame
+{
+    int64               start;
+    int64               end;
+    int64               counters[pci_count];
+};
+
+/*
+ * The events of a thread, written by the thread only. The readers copied them and dropped the ones overwritten in
+ * the meantime, so that the writer never waited.
+ */
+class profile_ring
+{
+public:
+    enum { capacity = 1 << 16 };
+    typedef vector<profile_event> events;
+
+public:
+    profile_ring(uint tid);
+    uint get_thread_id() const { return _tid; }
+    int enter() { return _depth ++; }
+    void leave(const char* name, int64 start, int64 end, int depth)
+    {
+        record(name, start, end, depth);
+        _depth = depth;
+    }
+    void record(const char* name, int64 start, int64 end, int depth)
+    {
+        uint head = _head.load(std::memory_order_relaxed);
+        profile_event& e = _events[head & (capacity - 1)];
+        e.name = name;
+        e.start = start;
+        e.duration = end - start;
+        e.depth = depth;
+        _head.store(head + 1, std::memory_order_release);
+    }
+    void collect(events& output, int64 from, int64 to) const;
+
+protected:
+    uint                _tid;
+    int                 _depth = 0;
+    std::atomic<uint>   _head;
+    events              _events;
+};
+
+/*
+ * The scopes were recorded only while enabled, the frames were marked by the frame system, the counters were
+ * accumulated in the frames.
+ */
+class ariel_export profiler
+{
+public:
+    typedef vector<profile_ring*> rings;
+    typedef deque<profile_frame> frames;
+    enum { max_frames = 600 };
+
+public:
+    static profiler* get_singleton_ptr()
+    {
+        static profiler inst;
+        return &inst;
+    }
+
+public:
+    ~profiler();
+    void set_enabled(bool b) { _enabled.store(b, std::memory_order_relaxed); }
+    bool is_enabled() const { return _enabled.load(std::memory_order_relaxed); }
+    profile_ring* get_ring();                   /* of the calling thread */
+    int64 get_time() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count(); }
+    void add_counter(profile_counter_id id, int64 n)
+    {
+        if(is_enabled())
+            _counters[id].fetch_add(n, std::memory_order_relaxed);
+    }
+    void begin_frame();
+    void end_frame();
+    void reset();
+    const frames& get_frames() const { return _frames; }
+    void get_summary(string& str);              /* of the last frame */
+    void tracing();
+    bool export_chrome_trace(const gchar* path);
+
+public:
+    static const gchar* get_counter_name(profile_counter_id id);
+
+protected:
+    std::atomic<bool>   _enabled;
+    std::chrono::steady_clock::time_point _epoch;
+    std::mutex          _mtx;
+    rings               _rings;
+    std::atomic<int64>  _counters[pci_count];
+    frames              _frames;
+    int64               _frame_start = -1;
+
+private:
+    profiler();
+    void collect(profile_ring::events& output, int64 from, int64 to);
+};
+
+class profile_scope
+{
+public:
+    profile_scope(const char* name)
+    {
+        auto* prof = profiler::get_singleton_ptr();
+        if(!prof->is_enabled())
+            return;
+        _name = name;
+        _ring = prof->get_ring();
+        _depth = _ring->enter();
+        _start = prof->get_time();
+    }
+    ~profile_scope()
+    {
+        if(_ring)
+            _ring->leave(_name, _start, profiler::get_singleton_ptr()->get_time(), _depth);
+    }
+
+protected:
+    profile_ring*       _ring = nullptr;
+    const char*         _name = nullptr;
+    int64               _start = 0;
+    int                 _depth = 0;
+};
+
+#if use_ariel_profiler
+#define ariel_profile_scope(name)       profile_scope __profile_scope_guard(name)
+#define ariel_profile_counter(id, n)    profiler::get_singleton_ptr()->add_counter(id, (int64)(n))
+#else
+#define ariel_profile_scope(name)
+#define ariel_profile_counter(id, n)
+#endif
+
+__ariel_end__
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef raster_59f8128d_6894_4456_969c_5716082eb85c_h
+#define raster_59f8128d_6894_4456_969c_5716082eb85c_h
+
+#include <gslib/thdpool.h>
+#include <ariel/painter.h>
+#include <ariel/painterpath.h>
+#include <ariel/stroker.h>
+#include <ariel/image.h>
+
+__ariel_begin__
+
+enum raster_fill_rule
+{
+    rfr_non_zero,
+    rfr_even_odd,
+};
+
+static const int raster_band_height = 32;
+
+struct raster_edge
+{
+    vec2                from;                   /* in pixels, the direction decides the winding */
+    vec2                to;
+};
+
+/* signed cover & area of the edges crossing a single pixel, cover was the height, area was the height weighted by the part right of the edges. */
+struct raster_cell
+{
+    int                 x;
+    int                 y;
+    float               cover;
+    float               area;
+};
+
+/* a triangle of the anti-aliasing fringe of a stroke, the coverage was interpolated over it. */
+struct raster_fringe
+{
+    vec2                points[3];
+    float               coverage[3];
+};
+
+/*
+ * The scanline coverage rasterizer, the edges were accumulated into the sparse cells with the exact area coverage,
+ * then the cells of a row were swept from left to right, the runs between the cells had a constant coverage and
+ * were composited 4 pixels a time. The rows were split into bands which were rendered on the worker threads.
+ */
+class ariel_export raster_coverage
+{
+public:
+    typedef vector<raster_edge> edges;
+    typedef vector<raster_cell> cells;
+    typedef vector<int> edge_indices;
+    typedef vector<raster_fringe> fringes;
+    typedef vector<float> fringe_coverages;
+
+    struct band
+    {
+        edge_indices    indices;
+        cells           accum;
+        fringe_coverages fringe;                /* max coverage of the fringes over the pixels of the band */
+    };
+    typedef vector<band> bands;
+
+public:
+    raster_coverage() {}
+    void reset(int w, int h);
+    void clear() { _edges.clear(); _fringes.clear(); }
+    bool is_empty() const { return _edges.empty() && _fringes.empty(); }
+    void add_line(const vec2& p1, const vec2& p2);
+    void add_polygon(const painter_linestrip& ls);
+    void add_polygons(const painter_linestrips& lss);
+    void add_triangle(const vec2& p1, const vec2& p2, const vec2& p3);
+    void add_strip(const stroke_strip& strip);
+    void render(image& img, const color& cr, raster_fill_rule rule, bool antialias, thread_pool* pool, const dirty_region* clip = nullptr);
+
+protected:
+    int                 _width = 0;
+    int                 _height = 0;
+    edges               _edges;
+    fringes             _fringes;
+    bands               _bands;
+
+protected:
+    void add_clipped_line(const vec2& p1, const vec2& p2);
+    void bucket_edges();
+    void accumulate_band(int i);
+    void render_band(int i, image& img, const color& cr, raster_fill_rule rule, bool antialias, const dirty_region* clip);
+    void render_fringes(int i, image& img, const color& cr, bool antialias, const dirty_region* clip);
+};
+
+/*
+ * Paint the paths into an image on the cpu, the solid brushes & pens were supported, the pictures were textures
+ * of the render system and could not be sampled here. Without the strict mode the pictures were skipped and counted,
+ * so that the callers could tell if the output was incomplete.
+ */
+class ariel_export raster_painter:
+    public painter
+{
+public:
+    raster_painter();
+    virtual ~raster_painter();
+    virtual void resize(int w, int h) override;
+    virtual void draw_path(const painter_path& path) override;
+    virtual void draw_text(const gchar* str, float x, float y, const color& cr, int length = -1) override;
+    void set_fill_rule(raster_fill_rule rule) { _fill_rule = rule; }
+    raster_fill_rule get_fill_rule() const { return _fill_rule; }
+    void set_stroke_style(const stroke_style& st) { _stroker.set_style(st); }
+    const stroke_style& get_stroke_style() const { return _stroker.get_style(); }
+    void set_workers(int workers);
+    void clear(const color& cr) { _image.clear(cr); }
+    image& get_image() { return _image; }
+    const image& get_image() const { return _image; }
+    void set_strict(bool b) { _strict = b; }
+    int get_unsupported_draws() const { return _unsupported; }
+    void reset_unsupported_draws() { _unsupported = 0; }
+
+protected:
+    image               _image;
+    raster_fill_rule    _fill_rule = rfr_non_zero;
+    raster_coverage     _coverage;
+    polyline_stroker    _stroker;
+    stroke_strip        _strip;
+    thread_pool*        _pool = nullptr;
+    bool                _strict = true;
+    int                 _unsupported = 0;
+
+protected:
+    const dirty_region* get_clip() const { return _dirty ? _dirty->get_clip() : nullptr; }
+    void fill_path(const painter_path& path, const color& cr);
+    void stroke_path(const painter_path& path, const color& cr);
+    void on_unsupported();
+};
+
+__ariel_end__
+
+#endif
@@ -113,6 +113,80 @@ typedef list<rp_input> rp_input_list;
 extern void rp_global_location(rp_const_iterator i, rp_rect& rc);
 extern bool rp_is_node_transposed(rp_const_iterator i);
 
+struct rp_placement:
+    public rp_rect
+{
+    bool                transposed;
+};
+
+typedef unordered_map<void*, rp_placement> rp_placement_map;
+
+/*
+ * The skyline bottom-left allocator, the area left under the skyline was kept in a waste list and reused first,
+ * the released rects were merged with the wastes nearby, then went back to the skyline if they were on the top of it.
+ * The lookups scanned the segments & the wastes linearly, which were far fewer than the rects placed.
+ */
+class rp_skyline
+{
+public:
+    struct segment
+    {
+        float           x, y;       /* y was the top of the free space */
+        float           width;
+    };
+    typedef vector<segment> segment_list;
+    typedef vector<rp_rect> waste_list;
+
+public:
+    void reset(float w, float h);
+    bool find(float w, float h, rp_rect& rc, bool& transposed) const;
+    void occupy(const rp_rect& rc);
+    void release(const rp_rect& rc);
+    int get_free_count() const { return (int)(_segments.size() + _wastes.size()); }
+
+protected:
+    segment_list        _segments;
+    waste_list          _wastes;
+    float               _width;
+    float               _height;
+
+protected:
+    bool fit_segment(int i, float w, float h, float& y) const;
+    int find_waste(float w, float h, bool& transposed) const;
+    bool is_on_top(const rp_rect& rc) const;
+    void lower_skyline(const rp_rect& rc);
+    void merge_segments();
+};
+
+/*
+ * The maxrects allocator with best short side fit, the free rects were indexed by the short side,
+ * so that the lookup starts from the ones just big enough and stops once no better fit could be found.
+ * A released rect was given back by splitting the bin with the placed rects again, only the pieces across it were kept,
+ * so that the free rects were still the maximal ones. So a release cost O(placed * free) rather than O(log n).
+ */
+class rp_maxrects
+{
+public:
+    typedef multimap<float, rp_rect> free_index;
+    typedef free_index::iterator free_iterator;
+    typedef free_index::const_iterator free_const_iterator;
+
+public:
+    void reset(float w, float h);
+    bool find(float w, float h, rp_rect& rc, bool& transposed) const;
+    void occupy(const rp_rect& rc);
+    void release(const rp_rect& rc, const rp_placement_map& placed);     /* placed rects excluding the released one */
+    int get_free_count() const { return (int)_free.size(); }
+
+protected:
+    free_index          _free;
+    rp_rect             _bin;
+
+protected:
+    void add_free(const rp_rect& rc) { _free.emplace(gs_min(rc.width, rc.height), rc); }
+    void prune(vector<rp_rect>& rcs);
+};
+
 class rect_packer
 {
 public:
@@ -121,17 +195,33 @@ public:
         ps_unknown,
         ps_compactly,
         ps_dynamically,
+        ps_skyline,
+        ps_maxrects,
     };
 
 public:
     rect_packer();
     ~rect_packer();
     const rp_node& get_root_node() const { return *_tree.const_root(); }
-    bool is_empty() const { return !_tree.is_valid(); }
-    float get_width() const { return _tree.const_root()->width; }
-    float get_height() const { return _tree.const_root()->height; }
+    packing_strategy get_strategy() const { return _strategy; }
+    bool is_empty() const { return is_online() ? _placements.empty() : !_tree.is_valid(); }
+    float get_width() const { return is_online() ? _extent_width : _tree.const_root()->width; }
+    float get_height() const { return is_online() ? _extent_height : _tree.const_root()->height; }
     int get_pack_times() const { return _pack_times; }
     void pack_automatically(rp_input_list& inputs);
+    void pack_automatically(rp_input_list& inputs, packing_strategy strategy);
+
+public:
+    /* online packing into a fixed bin, only for the skyline and the maxrects strategy */
+    void reset(packing_strategy strategy, float w, float h);
+    bool insert(float w, float h, void* binding);
+    bool remove(void* binding);
+    float get_bin_width() const { return _bin_width; }
+    float get_bin_height() const { return _bin_height; }
+    float get_used_area() const { return _used_area; }
+    float get_occupancy() const;
+    int get_rect_count() const { return (int)_placements.size(); }
+    int get_free_rect_count() const;
     void tracing() const;
     void trace_total() const;
     void trace_blank() const;
@@ -156,6 +246,11 @@ public:
     template<class _lamb>
     void for_each(_lamb fn)
     {
+        if(is_online()) {
+            for(const auto& p : _placements)
+                fn(p.first, p.second, p.second.transposed);
+            return;
+        }
         if(!_tree.is_valid())
             return;
         for_each(_tree.get_root(), fn);
@@ -165,6 +260,14 @@ protected:
     rp_tree             _tree;
     packing_strategy    _strategy;
     int                 _pack_times;
+    rp_skyline          _skyline;
+    rp_maxrects         _maxrects;
+    rp_placement_map    _placements;
+    float               _bin_width;
+    float               _bin_height;
+    float               _extent_width;
+    float               _extent_height;
+    float               _used_area;
 
 protected:
     void initialize_compactly(float w, float h);
@@ -181,6 +284,10 @@ protected:
     void proc_combine_non_root(rp_iterator p, rp_iterator i, rp_tree& t);
     void proc_replace(rp_iterator p, rp_tree& t, rp_tree& xchg);
     void trace_dynamically() const;
+    bool is_online() const { return _strategy == ps_skyline || _strategy == ps_maxrects; }
+    bool pack_online(const rp_input_list& inputs);
+    void update_extent();
+    void trace_online() const;
 };
 
 __ariel_end__
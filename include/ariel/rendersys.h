@@ -54,6 +54,26 @@ enum sampler_state_filter
     ssf_anisotropic,
 };
 
+enum buffer_map_mode
+{
+    bmm_write_discard,              /* the previous contents were abandoned */
+    bmm_write_no_overwrite,         /* the caller promised not to touch the parts in use by the pending draws */
+};
+
+enum render_index_format
+{
+    rif_uint32,
+    rif_uint16,
+};
+
+inline uint get_index_size(render_index_format fmt) { return fmt == rif_uint16 ? 2 : 4; }
+
+enum render_ring_target
+{
+    rrt_vertex_buffer,
+    rrt_index_buffer,
+};
+
 struct render_device_info
 {
     uint            vendor_id;
@@ -89,7 +109,7 @@ public:
     virtual domain_shader* create_domain_shader(const void* ptr, size_t len) = 0;
     virtual vertex_format* create_vertex_format(const void* ptr, size_t len, vertex_format_desc desc[], uint n) = 0;
     virtual vertex_buffer* create_vertex_buffer(uint stride, uint count, bool read, bool write, uint usage, const void* ptr = 0) = 0;
-    virtual index_buffer* create_index_buffer(uint count, bool read, bool write, uint usage, const void* ptr = 0) = 0;
+    virtual index_buffer* create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr = 0) = 0;
     virtual constant_buffer* create_constant_buffer(uint stride, bool read, bool write, const void* ptr = 0) = 0;
     virtual shader_resource_view* create_shader_resource_view(render_resource* res) = 0;    /* texture view in GL */
     virtual depth_stencil_view* create_depth_stencil_view(render_resource* res) = 0;
@@ -99,9 +119,13 @@ public:
     virtual texture2d* create_texture2d(int width, int height, uint format, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags) = 0;
     virtual void load_with_mips(texture2d* tex, const image& img) = 0;
     virtual void update_buffer(void* buf, int size, const void* ptr) = 0;
+    virtual void update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch) = 0;   /* rgba8 texels of the rect, no mips */
+    virtual void* map_buffer(void* buf, buffer_map_mode mode) = 0;              /* the whole buffer was mapped for write */
+    virtual void unmap_buffer(void* buf, uint offset, uint size) = 0;           /* offset & size tell the range written */
     virtual void set_vertex_format(vertex_format* vfmt) = 0;
     virtual void set_vertex_buffer(vertex_buffer* vb, uint stride, uint offset) = 0;
-    virtual void set_index_buffer(index_buffer* ib, uint offset) = 0;
+    virtual void set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt = rif_uint32) = 0;
+    virtual void set_instance_buffer(vertex_buffer* vb, uint stride, uint offset) = 0;    /* the per instance data in the slot 1 */
     virtual void begin_render() = 0;
     virtual void end_render() = 0;
     virtual void set_render_option(render_option opt, uint val) = 0;
@@ -114,6 +138,7 @@ public:
     virtual void set_shader_resource(uint slot, shader_resource_view* srv, shader_type st) = 0;
     virtual void draw(uint count, uint start) = 0;
     virtual void draw_indexed(uint count, uint start, int base = 0) = 0;
+    virtual void draw_indexed_instanced(uint count, uint instances, uint start, int base = 0, uint start_instance = 0) = 0;
     virtual void capture_screen(image& img, const rectf& rc, int buff_id) = 0;      /* before present, buff_id = 0; after present, buff_id = 1 */
     virtual void enable_alpha_blend(bool b) = 0;
     virtual void enable_depth(bool b) = 0;
@@ -134,6 +159,8 @@ protected:
 public:
     const render_device_info& get_device_info() const { return _device_info; }
     void set_background_color(const color& cr);
+    texture2d* create_rgba_texture2d(const image& img);                        /* a shader resource with no mips */
+    texture2d* create_rgba_texture2d(int width, int height, bool writable);    /* also an unordered access target if writable */
 
 private:
     static rsys_map         _dev_indexing;
@@ -147,6 +174,121 @@ extern void release_texture2d(render_texture2d* tex);
 template<class res_class>
 render_resource* convert_to_resource(res_class*);
 
+struct render_ring_stats
+{
+    int64           bytes_written = 0;      /* streamed into the mapped memory directly */
+    int64           bytes_copied = 0;       /* went through a staging copy */
+    int             buffers_created = 0;
+    int             maps = 0;
+    int             wraps = 0;
+};
+
+/*
+ * The persistent ring of a dynamic vertex buffer, the allocations were appended behind the head and mapped without
+ * overwriting, so they could be streamed every frame with neither copies nor creations. When the ring wraps around
+ * it was mapped with a discard, the device renames the buffer and keeps the memory of the frames in flight, so nothing
+ * they use could be overwritten whatever the gpu lags. A frame could not discard what it had written itself before
+ * drawing it, so a frame wraps at its beginning if the space left could not hold as much as the last frame used.
+ * The ring grows only if a single frame was over the capacity, and halves back after a while of frames using less
+ * than a quarter of it, the former buffer was released in the next frame.
+ * The ring of the indices works the same, the index buffers were of the same type as the vertex buffers.
+ */
+class ariel_export render_ring_buffer
+{
+public:
+    typedef render_vertex_buffer vertex_buffer;
+    struct retired_buffer
+    {
+        vertex_buffer* buffer;
+        uint        frame;
+    };
+    typedef vector<retired_buffer> retired_buffers;
+
+public:
+    render_ring_buffer() {}
+    ~render_ring_buffer() { destroy(); }
+    bool create(rendersys* rsys, render_ring_target target, uint capacity, uint usage);
+    void destroy();
+    void begin_frame();
+    void end_frame();
+    byte* allocate(uint size, uint align, vertex_buffer*& vb, uint& offset);
+    void shrink(uint size);                 /* give back the tail of the last allocation */
+    void flush();                           /* unmap before drawing */
+    void add_copied_bytes(uint size) { _stats.bytes_copied += size; }
+    uint get_capacity() const { return _capacity; }
+    vertex_buffer* get_buffer() const { return _buffer; }
+    const render_ring_stats& get_stats() const { return _stats; }
+
+protected:
+    rendersys*      _rsys = nullptr;
+    vertex_buffer*  _buffer = nullptr;
+    byte*           _mapped = nullptr;
+    render_ring_target _target = rrt_vertex_buffer;
+    uint            _usage = 0;
+    uint            _capacity = 0;
+    uint            _min_capacity = 0;      /* as created, the ring never shrinks below */
+    uint            _head = 0;
+    uint            _dirty = 0;             /* where the writes of the current mapping began */
+    uint            _frame = 0;
+    bool            _frame_written = false;
+    uint            _frame_start = 0;       /* offset of the first allocation in the frame */
+    uint            _frame_carried = 0;     /* bytes the frame wrote into the buffers renewed */
+    uint            _last_used = 0;         /* bytes the last frame used */
+    int             _idle_frames = 0;       /* successive frames under a quarter of the capacity */
+    bool            _discard = false;       /* created or wrapped around, the next map discards */
+    uint            _last_size = 0;         /* to undo the last allocation */
+    uint            _last_head = 0;
+    bool            _last_written = false;
+    retired_buffers _retired;
+    render_ring_stats _stats;
+
+protected:
+    bool create_buffer(uint capacity);
+    bool renew_buffer(uint capacity);
+    void release_buffer(vertex_buffer* buf);
+    bool fit(uint size, uint align, uint& offset) const;
+    uint get_frame_used() const { return _frame_carried + (_frame_written ? _head - _frame_start : 0); }
+    byte* map();
+};
+
+/* write the vertices of a type straight into the ring, the unused part would be given back on commit. */
+template<class _vertex>
+class render_ring_writer
+{
+public:
+    typedef render_vertex_buffer vertex_buffer;
+
+public:
+    render_ring_writer(render_ring_buffer& ring, int capacity): _ring(ring)
+    {
+        assert(capacity >= 0);
+        _capacity = capacity;
+        _size = 0;
+        _buffer = nullptr;
+        _offset = 0;
+        _data = !capacity ? nullptr : reinterpret_cast<_vertex*>(ring.allocate(capacity * sizeof(_vertex), sizeof(_vertex), _buffer, _offset));
+        assert(!capacity || _data);
+    }
+    void push_back(const _vertex& v)
+    {
+        assert(_size < _capacity);
+        _data[_size ++] = v;
+    }
+    void commit() { _ring.shrink((_capacity - _size) * sizeof(_vertex)); _capacity = _size; }
+    int size() const { return _size; }
+    vertex_buffer* get_buffer() const { return _buffer; }
+    int get_start() const { return (int)(_offset / sizeof(_vertex)); }
+    const _vertex* get_data() const { return _data; }
+
+protected:
+    render_ring_buffer& _ring;
+    _vertex*        _data;
+    int             _size;
+    int             _capacity;
+    vertex_buffer*  _buffer;
+    uint            _offset;
+};
+
 template<class _pack>
 inline uint pack_cb_size()
 {
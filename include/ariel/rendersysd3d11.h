@@ -28,6 +28,8 @@
 #ifndef rendersysd3d11_8555fd57_19e9_4747_97b5_8d3bfb0fb50f_h
 #define rendersysd3d11_8555fd57_19e9_4747_97b5_8d3bfb0fb50f_h
 
+#include <mutex>
+#include <condition_variable>
 #include <gslib/type.h>
 #include <ariel/rendersys.h>
 
@@ -52,7 +54,7 @@ public:
     virtual domain_shader* create_domain_shader(const void* ptr, size_t len) override;
     virtual vertex_format* create_vertex_format(const void* ptr, size_t len, vertex_format_desc vfdesc[], uint n) override;
     virtual vertex_buffer* create_vertex_buffer(uint stride, uint count, bool read, bool write, uint usage, const void* ptr) override;
-    virtual index_buffer* create_index_buffer(uint count, bool read, bool write, uint usage, const void* ptr) override;
+    virtual index_buffer* create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr) override;
     virtual constant_buffer* create_constant_buffer(uint stride, bool read, bool write, const void* ptr) override;
     virtual shader_resource_view* create_shader_resource_view(render_resource* res) override;
     virtual depth_stencil_view* create_depth_stencil_view(render_resource* res) override;
@@ -62,9 +64,13 @@ public:
     virtual texture2d* create_texture2d(int width, int height, uint format, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags) override;
     virtual void load_with_mips(texture2d* tex, const image& img) override;
     virtual void update_buffer(void* buf, int size, const void* ptr) override;
+    virtual void update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch) override;
+    virtual void* map_buffer(void* buf, buffer_map_mode mode) override;
+    virtual void unmap_buffer(void* buf, uint offset, uint size) override;
     virtual void set_vertex_format(vertex_format* vfmt) override;
     virtual void set_vertex_buffer(vertex_buffer* vb, uint stride, uint offset) override;
-    virtual void set_index_buffer(index_buffer* ib, uint offset) override;
+    virtual void set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt) override;
+    virtual void set_instance_buffer(vertex_buffer* vb, uint stride, uint offset) override;
     virtual void begin_render() override;
     virtual void end_render() override;
     virtual void set_render_option(render_option opt, uint val) override;
@@ -77,6 +83,7 @@ public:
     virtual void set_shader_resource(uint slot, shader_resource_view* srv, shader_type st) override;
     virtual void draw(uint count, uint start) override;
     virtual void draw_indexed(uint count, uint start, int base) override;
+    virtual void draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance) override;
     virtual void capture_screen(image& img, const rectf& rc, int buff_id) override;
     virtual void enable_alpha_blend(bool b) override;
     virtual void enable_depth(bool b) override;
@@ -85,7 +92,9 @@ protected:
     D3D_DRIVER_TYPE         _drvtype        = D3D_DRIVER_TYPE_NULL;
     D3D_FEATURE_LEVEL       _level          = D3D_FEATURE_LEVEL_11_0;
     render_device*          _device         = nullptr;
-    render_context*         _context        = nullptr;
+    render_context*         _context        = nullptr;      /* the deferred one while recording a command list */
+    render_context*         _immediate      = nullptr;
+    render_context*         _deferred       = nullptr;
     render_swap_chain*      _swapchain      = nullptr;
     render_target_view*     _rtview         = nullptr;
     render_blend_state*     _blendstate     = nullptr;
@@ -96,13 +105,23 @@ protected:
     bool                    _vsync          = false;
     bool                    _fullscreen     = false;
     bool                    _msaa           = false;
+    unordered_set<void*>    _discarded;                     /* the buffers mapped in the command list */
+    int                     _pending        = 0;            /* the command lists ended but not executed yet */
+    std::mutex              _pending_lock;
+    std::condition_variable _pending_cond;
 
 protected:
     void install_configs(const configs& cfg);
 
 public:
     render_device* get_device() const { return _device; }
-    render_context* get_immediate_context() const { return _context; }
+    render_context* get_context() const { return _context; }
+    render_context* get_immediate_context() const { return _immediate; }
+    bool is_recording() const { return _context != _immediate; }
+    bool begin_command_list();
+    render_command_list* end_command_list();
+    void execute_command_list(render_command_list* cl, bool present);
+    void sync_immediate_context();
 };
 
 template<class res_class>
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef rendersysrec_c6356f4d_7837_48a3_b5cc_38e32719d02c_h
+#define rendersysrec_c6356f4d_7837_48a3_b5cc_38e32719d02c_h
+
+#include <gslib/type.h>
+#include <gslib/string.h>
+#include <ariel/rendersys.h>
+
+__ariel_begin__
+
+enum render_command_id
+{
+    rci_create_vertex_shader,
+    rci_create_pixel_shader,
+    rci_create_compute_shader,
+    rci_create_geometry_shader,
+    rci_create_hull_shader,
+    rci_create_domain_shader,
+    rci_create_vertex_format,
+    rci_create_vertex_buffer,
+    rci_create_index_buffer,
+    rci_create_constant_buffer,
+    rci_create_shader_resource_view,
+    rci_create_depth_stencil_view,
+    rci_create_unordered_access_view,
+    rci_create_sampler_state,
+    rci_create_texture2d_from_image,
+    rci_create_texture2d,
+    rci_load_with_mips,
+    rci_update_buffer,
+    rci_update_texture2d,
+    rci_map_buffer,
+    rci_unmap_buffer,
+    rci_set_vertex_format,
+    rci_set_vertex_buffer,
+    rci_set_index_buffer,
+    rci_set_instance_buffer,
+    rci_begin_render,
+    rci_end_render,
+    rci_setup_pipeline_state,
+    rci_set_render_option,
+    rci_set_vertex_shader,
+    rci_set_pixel_shader,
+    rci_set_geometry_shader,
+    rci_set_viewport,
+    rci_set_constant_buffer,
+    rci_set_sampler_state,
+    rci_set_shader_resource,
+    rci_draw,
+    rci_draw_indexed,
+    rci_draw_indexed_instanced,
+    rci_enable_alpha_blend,
+    rci_enable_depth,
+    rci_count,
+};
+
+/*
+ * The binary command stream, a command was a byte of its id followed by the arguments, the objects were referred
+ * by the ids in the order of their creations, 0 for null or the objects unknown to the recorder.
+ */
+class ariel_export render_command_stream
+{
+public:
+    typedef vector<byte> buffer;
+
+public:
+    void clear() { _data.clear(), _cursor = 0; }
+    void rewind() { _cursor = 0; }
+    bool is_end() const { return _cursor >= (int)_data.size(); }
+    int get_size() const { return (int)_data.size(); }
+    const byte* get_data() const { return _data.empty() ? nullptr : &_data.front(); }
+    void write_bytes(const void* ptr, int len);
+    void write_blob(const void* ptr, int len);
+    bool read_bytes(void* ptr, int len);
+    const byte* read_blob(int& len);
+    bool save(const gchar* path) const;
+    bool load(const gchar* path);
+
+public:
+    template<class _ty>
+    void write(const _ty& v) { write_bytes(&v, sizeof(_ty)); }
+    template<class _ty>
+    _ty read()
+    {
+        _ty v = _ty();
+        read_bytes(&v, sizeof(_ty));
+        return v;
+    }
+
+protected:
+    buffer              _data;
+    int                 _cursor = 0;
+};
+
+struct render_frame_stats
+{
+    int                 draw_calls = 0;
+    int                 vertices = 0;
+    int                 state_changes = 0;
+    int                 redundant_states = 0;       /* the states set again with the same values */
+    int                 buffer_updates = 0;
+    int                 creations = 0;
+    int64               bytes_uploaded = 0;         /* by the updates and the initial data of the creations */
+};
+
+struct render_call_stats
+{
+    int                 calls = 0;
+    int64               bytes = 0;
+    double              time = 0.0;                 /* in ms, spent in the target */
+};
+
+/*
+ * Decorate a render system to record every call it received into a command stream, the calls were forwarded to
+ * the target unchanged, so it could be installed in front of the real one to profile what the rose submitted.
+ */
+class ariel_export rendersys_recorder:
+    public rendersys
+{
+public:
+    typedef vector<render_frame_stats> frame_stats;
+    typedef unordered_map<const void*, uint> object_ids;
+    typedef unordered_map<uint, const void*> slot_bindings;
+    typedef unordered_map<uint, uint> option_values;
+    typedef unordered_map<const void*, const byte*> mapped_buffers;
+
+public:
+    rendersys_recorder(rendersys* target);
+    virtual ~rendersys_recorder() {}
+    virtual bool setup(uint hwnd, const configs& cfg) override;
+    virtual void destroy() override;
+    virtual void setup_pipeline_state() override;
+    virtual render_blob* compile_shader_from_file(const gchar* file, const gchar* entry, const gchar* sm, render_include* inc) override;
+    virtual render_blob* compile_shader_from_memory(const char* src, int len, const gchar* name, const gchar* entry, const gchar* sm, render_include* inc) override;
+    virtual vertex_shader* create_vertex_shader(const void* ptr, size_t len) override;
+    virtual pixel_shader* create_pixel_shader(const void* ptr, size_t len) override;
+    virtual compute_shader* create_compute_shader(const void* ptr, size_t len) override;
+    virtual geometry_shader* create_geometry_shader(const void* ptr, size_t len) override;
+    virtual hull_shader* create_hull_shader(const void* ptr, size_t len) override;
+    virtual domain_shader* create_domain_shader(const void* ptr, size_t len) override;
+    virtual vertex_format* create_vertex_format(const void* ptr, size_t len, vertex_format_desc desc[], uint n) override;
+    virtual vertex_buffer* create_vertex_buffer(uint stride, uint count, bool read, bool write, uint usage, const void* ptr) override;
+    virtual index_buffer* create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr) override;
+    virtual constant_buffer* create_constant_buffer(uint stride, bool read, bool write, const void* ptr) override;
+    virtual shader_resource_view* create_shader_resource_view(render_resource* res) override;
+    virtual depth_stencil_view* create_depth_stencil_view(render_resource* res) override;
+    virtual unordered_access_view* create_unordered_access_view(render_resource* res) override;
+    virtual sampler_state* create_sampler_state(sampler_state_filter filter) override;
+    virtual texture2d* create_texture2d(const image& img, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags) override;
+    virtual texture2d* create_texture2d(int width, int height, uint format, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags) override;
+    virtual void load_with_mips(texture2d* tex, const image& img) override;
+    virtual void update_buffer(void* buf, int size, const void* ptr) override;
+    virtual void update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch) override;
+    virtual void* map_buffer(void* buf, buffer_map_mode mode) override;
+    virtual void unmap_buffer(void* buf, uint offset, uint size) override;
+    virtual void set_vertex_format(vertex_format* vfmt) override;
+    virtual void set_vertex_buffer(vertex_buffer* vb, uint stride, uint offset) override;
+    virtual void set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt) override;
+    virtual void set_instance_buffer(vertex_buffer* vb, uint stride, uint offset) override;
+    virtual void begin_render() override;
+    virtual void end_render() override;
+    virtual void set_render_option(render_option opt, uint val) override;
+    virtual void set_vertex_shader(vertex_shader* vs) override;
+    virtual void set_pixel_shader(pixel_shader* ps) override;
+    virtual void set_geometry_shader(geometry_shader* gs) override;
+    virtual void set_viewport(const viewport& vp) override;
+    virtual void set_constant_buffer(uint slot, constant_buffer* cb, shader_type st) override;
+    virtual void set_sampler_state(uint slot, sampler_state* sstate, shader_type st) override;
+    virtual void set_shader_resource(uint slot, shader_resource_view* srv, shader_type st) override;
+    virtual void draw(uint count, uint start) override;
+    virtual void draw_indexed(uint count, uint start, int base = 0) override;
+    virtual void draw_indexed_instanced(uint count, uint instances, uint start, int base = 0, uint start_instance = 0) override;
+    virtual void capture_screen(image& img, const rectf& rc, int buff_id) override;
+    virtual void enable_alpha_blend(bool b) override;
+    virtual void enable_depth(bool b) override;
+
+protected:
+    rendersys*          _target;
+    render_command_stream _stream;
+    object_ids          _ids;
+    uint                _next_id = 1;
+    frame_stats         _frames;
+    render_frame_stats  _current;
+    render_call_stats   _calls[rci_count];
+    float               _last_bkcr[4];              /* the background color was not virtual, sync it on begin_render */
+    /* states cached to find the redundant ones */
+    const void*         _vertex_format = nullptr;
+    const void*         _vertex_buffer = nullptr;
+    uint                _vertex_stride = 0;
+    uint                _vertex_offset = 0;
+    const void*         _index_buffer = nullptr;
+    uint                _index_offset = 0;
+    render_index_format _index_format = rif_uint32;
+    const void*         _instance_buffer = nullptr;
+    uint                _instance_stride = 0;
+    uint                _instance_offset = 0;
+    const void*         _vertex_shader = nullptr;
+    const void*         _pixel_shader = nullptr;
+    const void*         _geometry_shader = nullptr;
+    viewport            _viewport;
+    bool                _viewport_valid = false;
+    int                 _alpha_blend = -1;
+    int                 _depth = -1;
+    option_values       _options;
+    slot_bindings       _constant_buffers;
+    slot_bindings       _sampler_states;
+    slot_bindings       _shader_resources;
+    mapped_buffers      _mapped;                    /* read back the range written on unmap */
+
+protected:
+    uint register_object(const void* p);
+    uint find_object(const void* p) const;
+    void write_command(render_command_id id) { _stream.write((byte)id); }
+    void write_image(const image& img);
+    void add_upload(render_command_id id, int64 bytes);
+    void add_state(bool changed);
+    bool update_binding(slot_bindings& bindings, uint slot, shader_type st, const void* p);
+    void clear_states();
+
+public:
+    rendersys* get_target() const { return _target; }
+    render_command_stream& get_stream() { return _stream; }
+    const render_command_stream& get_stream() const { return _stream; }
+    const frame_stats& get_frame_stats() const { return _frames; }
+    const render_call_stats& get_call_stats(render_command_id id) const { return _calls[id]; }
+    void reset();
+    void get_report(string& str) const;
+
+public:
+    static const gchar* get_command_name(render_command_id id);
+};
+
+/*
+ * Replay a recorded command stream against another render system, which should be of the same platform as the
+ * shaders & the vertex formats were recorded as they were. The objects created were released by the replayer.
+ */
+class ariel_export render_command_replayer
+{
+public:
+    struct object
+    {
+        render_command_id   kind;
+        void*               ptr;
+        render_resource*    resource;
+    };
+    typedef vector<object> objects;
+    typedef list<_string<char>> semantic_names;
+    typedef unordered_map<void*, byte*> mapped_buffers;
+
+public:
+    render_command_replayer(rendersys* rsys): _rsys(rsys) { assert(rsys); }
+    ~render_command_replayer() { release_objects(); }
+    int replay(render_command_stream& stm);
+    void release_objects();
+
+protected:
+    rendersys*          _rsys;
+    objects             _objects;
+    semantic_names      _semantic_names;
+    mapped_buffers      _mapped;
+
+protected:
+    void add_object(render_command_id kind, void* ptr, render_resource* res = nullptr);
+    void* get_object(uint id) const;
+    render_resource* get_resource(uint id) const;
+    bool replay_command(render_command_stream& stm, render_command_id id);
+    void read_image(render_command_stream& stm, image& img);
+};
+
+__ariel_end__
+
+#endif
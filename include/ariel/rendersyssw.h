@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef rendersyssw_7036f64a_20ca_44c0_9d0f_523d64a3eeee_h
+#define rendersyssw_7036f64a_20ca_44c0_9d0f_523d64a3eeee_h
+
+#include <atomic>
+#include <gslib/type.h>
+#include <gslib/thdpool.h>
+#include <ariel/rendersys.h>
+
+__ariel_begin__
+
+/*
+ * The software render system, it runs headless on the cpu so that the rose pipeline could be run and benchmarked
+ * without a gpu. The programs were c++ functions instead of the compiled shaders, vertices were shaded in parallel,
+ * the triangles were binned into tiles and the tiles were rasterized & shaded in parallel.
+ */
+enum sw_format
+{
+    sw_format_unknown,
+    sw_format_r32_float,
+    sw_format_r32g32_float,
+    sw_format_r32g32b32_float,
+    sw_format_r32g32b32a32_float,
+    sw_format_r8g8b8a8_unorm,
+    sw_format_r32_uint,
+    sw_format_r16g16_float,
+    sw_format_r16g16b16a16_float,
+};
+
+enum sw_topology
+{
+    sw_topology_triangle_list,
+    sw_topology_triangle_strip,
+};
+
+enum sw_bind_flag
+{
+    sw_bind_vertex_buffer = 0x01,
+    sw_bind_index_buffer = 0x02,
+    sw_bind_constant_buffer = 0x04,
+    sw_bind_shader_resource = 0x08,
+};
+
+static const uint sw_append_aligned_element = 0xffffffff;
+static const int sw_max_varyings = 12;
+static const int sw_max_slots = 4;
+static const int sw_tile_size = 64;
+
+class rendersys_sw;
+
+/* the resources were reference counted like the com objects, so that they could be held the same way. */
+class sw_object
+{
+public:
+    sw_object(): _refcount(1) {}
+    virtual ~sw_object() {}
+    uint AddRef() { return ++ _refcount; }
+    uint Release()
+    {
+        uint c = -- _refcount;
+        if(!c)
+            delete this;
+        return c;
+    }
+
+protected:
+    std::atomic<uint>   _refcount;
+};
+
+class sw_resource:
+    public sw_object
+{
+public:
+    virtual bool is_texture() const = 0;
+};
+
+class sw_buffer:
+    public sw_resource
+{
+public:
+    sw_buffer(uint bindflags, uint size, const void* ptr);
+    virtual bool is_texture() const override { return false; }
+    uint get_bind_flags() const { return _bindflags; }
+    uint get_size() const { return (uint)_data.size(); }
+    byte* get_data() { return _data.empty() ? nullptr : &_data.front(); }
+    const byte* get_data() const { return _data.empty() ? nullptr : &_data.front(); }
+
+protected:
+    uint                _bindflags;
+    vector<byte>        _data;
+};
+
+class sw_texture2d:
+    public sw_resource
+{
+public:
+    sw_texture2d(int w, int h);
+    sw_texture2d(const image& img);
+    virtual bool is_texture() const override { return true; }
+    int get_width() const { return _image.get_width(); }
+    int get_height() const { return _image.get_height(); }
+    image& get_image() { return _image; }
+    const image& get_image() const { return _image; }
+
+protected:
+    image               _image;             /* always rgba8 */
+};
+
+class sw_shader_resource_view:
+    public sw_object
+{
+public:
+    sw_shader_resource_view(sw_texture2d* tex);
+    virtual ~sw_shader_resource_view();
+    const sw_texture2d* get_texture() const { return _texture; }
+
+protected:
+    sw_texture2d*       _texture;
+};
+
+class sw_sampler_state:
+    public sw_object
+{
+public:
+    sw_sampler_state(sampler_state_filter filter): _filter(filter) {}
+    sampler_state_filter get_filter() const { return _filter; }
+
+protected:
+    sampler_state_filter _filter;
+};
+
+/* the same layout as the input element desc in d3d. */
+struct sw_vertex_element
+{
+    const char*         semantic_name;
+    uint                semantic_index;
+    uint                format;
+    uint                input_slot;
+    uint                aligned_byte_offset;
+    uint                input_slot_class;
+    uint                instance_data_step_rate;
+};
+
+class sw_vertex_format:
+    public sw_object
+{
+public:
+    sw_vertex_format(const sw_vertex_element desc[], uint n);
+    uint get_stride() const { return _stride; }     /* of the slot 0 */
+
+protected:
+    vector<sw_vertex_element> _elements;
+    uint                _stride;
+};
+
+class sw_blob:
+    public sw_object
+{
+public:
+    sw_blob(const void* ptr, size_t len): _ptr(ptr), _len(len) {}
+    const void* GetBufferPointer() const { return _ptr; }
+    size_t GetBufferSize() const { return _len; }
+
+protected:
+    const void*         _ptr;
+    size_t              _len;
+};
+
+/* the resources bound to the pipeline, the programs access the constants, textures & samplers through it. */
+struct sw_shading_context
+{
+    const sw_buffer*        constants[sw_max_slots];
+    const sw_texture2d*     textures[sw_max_slots];
+    const sw_sampler_state* samplers[sw_max_slots];
+    const byte*             instance;       /* the per instance data of the instance being drawn, in the vertex stage only */
+
+public:
+    template<class _pack>
+    const _pack& get_constants(int slot) const
+    {
+        assert(constants[slot] && constants[slot]->get_size() >= sizeof(_pack));
+        return *reinterpret_cast<const _pack*>(constants[slot]->get_data());
+    }
+    vec4 sample(int tex, int sampler, const vec2& uv) const;
+};
+
+struct sw_vs_output
+{
+    vec4                position;
+    float               varyings[sw_max_varyings];
+};
+
+struct sw_ps_input
+{
+    vec4                position;           /* pixel center in screen space */
+    const float*        varyings;
+    const float*        ddx;                /* the derivatives of the varyings, constant over a triangle */
+    const float*        ddy;
+};
+
+typedef void (*sw_vertex_function)(sw_vs_output& output, const byte* input, const sw_shading_context& ctx);
+typedef bool (*sw_pixel_function)(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx);    /* return false to discard */
+
+/* the "bytecode" of the software programs, pass its address & size to create the shader. */
+struct sw_vertex_program
+{
+    const char*         name;
+    sw_vertex_function  func;
+    int                 varyings;
+};
+
+struct sw_pixel_program
+{
+    const char*         name;
+    sw_pixel_function   func;
+};
+
+class sw_vertex_shader:
+    public sw_object
+{
+public:
+    sw_vertex_shader(const sw_vertex_program* prog): _program(*prog) {}
+    const sw_vertex_program& get_program() const { return _program; }
+
+protected:
+    sw_vertex_program   _program;
+};
+
+class sw_pixel_shader:
+    public sw_object
+{
+public:
+    sw_pixel_shader(const sw_pixel_program* prog): _program(*prog) {}
+    const sw_pixel_program& get_program() const { return _program; }
+
+protected:
+    sw_pixel_program    _program;
+};
+
+/* a triangle ready for the rasterization, the edges were in the form of a * x + b * y + c. */
+struct sw_setup_triangle
+{
+    float               edge_a[3];
+    float               edge_b[3];
+    float               edge_c[3];
+    bool                top_left[3];
+    float               z, dzdx, dzdy;
+    float               x0, y0;
+    rect                bound;
+    int                 varyings;
+    float               attr[sw_max_varyings];
+    float               ddx[sw_max_varyings];
+    float               ddy[sw_max_varyings];
+};
+
+typedef vector<sw_vs_output> sw_vs_outputs;
+typedef vector<sw_setup_triangle> sw_setup_triangles;
+typedef vector<int> sw_tile_bin;
+typedef vector<sw_tile_bin> sw_tile_bins;
+
+struct sw_render_stats
+{
+    int                 draw_calls;
+    int                 vertices;
+    int                 triangles;
+    int                 culled;
+    int                 tiles_shaded;
+    int64               pixels_shaded;
+    float               raster_time;        /* in milliseconds */
+};
+
+class rendersys_sw:
+    public rendersys
+{
+public:
+    rendersys_sw();
+    virtual ~rendersys_sw();
+    virtual bool setup(uint hwnd, const configs& cfg) override;
+    virtual void destroy() override;
+    virtual void setup_pipeline_state() override;
+    virtual render_blob* compile_shader_from_file(const gchar* file, const gchar* entry, const gchar* sm, render_include* inc) override;
+    virtual render_blob* compile_shader_from_memory(const char* src, int len, const gchar* name, const gchar* entry, const gchar* sm, render_include* inc) override;
+    virtual vertex_shader* create_vertex_shader(const void* ptr, size_t len) override;
+    virtual pixel_shader* create_pixel_shader(const void* ptr, size_t len) override;
+    virtual compute_shader* create_compute_shader(const void* ptr, size_t len) override;
+    virtual geometry_shader* create_geometry_shader(const void* ptr, size_t len) override;
+    virtual hull_shader* create_hull_shader(const void* ptr, size_t len) override;
+    virtual domain_shader* create_domain_shader(const void* ptr, size_t len) override;
+    virtual vertex_format* create_vertex_format(const void* ptr, size_t len, vertex_format_desc vfdesc[], uint n) override;
+    virtual vertex_buffer* create_vertex_buffer(uint stride, uint count, bool read, bool write, uint usage, const void* ptr) override;
+    virtual index_buffer* create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr) override;
+    virtual constant_buffer* create_constant_buffer(uint stride, bool read, bool write, const void* ptr) override;
+    virtual shader_resource_view* create_shader_resource_view(render_resource* res) override;
+    virtual depth_stencil_view* create_depth_stencil_view(render_resource* res) override;
+    virtual unordered_access_view* create_unordered_access_view(render_resource* res) override;
+    virtual sampler_state* create_sampler_state(sampler_state_filter filter) override;
+    virtual texture2d* create_texture2d(const image& img, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags) override;
+    virtual texture2d* create_texture2d(int width, int height, uint format, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags) override;
+    virtual void load_with_mips(texture2d* tex, const image& img) override;
+    virtual void update_buffer(void* buf, int size, const void* ptr) override;
+    virtual void update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch) override;
+    virtual void* map_buffer(void* buf, buffer_map_mode mode) override;
+    virtual void unmap_buffer(void* buf, uint offset, uint size) override;
+    virtual void set_vertex_format(vertex_format* vfmt) override;
+    virtual void set_vertex_buffer(vertex_buffer* vb, uint stride, uint offset) override;
+    virtual void set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt) override;
+    virtual void set_instance_buffer(vertex_buffer* vb, uint stride, uint offset) override;
+    virtual void begin_render() override;
+    virtual void end_render() override;
+    virtual void set_render_option(render_option opt, uint val) override;
+    virtual void set_vertex_shader(vertex_shader* vs) override;
+    virtual void set_pixel_shader(pixel_shader* ps) override;
+    virtual void set_geometry_shader(geometry_shader* gs) override;
+    virtual void set_viewport(const viewport& vp) override;
+    virtual void set_constant_buffer(uint slot, constant_buffer* cb, shader_type st) override;
+    virtual void set_sampler_state(uint slot, sampler_state* sstate, shader_type st) override;
+    virtual void set_shader_resource(uint slot, shader_resource_view* srv, shader_type st) override;
+    virtual void draw(uint count, uint start) override;
+    virtual void draw_indexed(uint count, uint start, int base) override;
+    virtual void draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance) override;
+    virtual void capture_screen(image& img, const rectf& rc, int buff_id) override;
+    virtual void enable_alpha_blend(bool b) override;
+    virtual void enable_depth(bool b) override;
+
+protected:
+    int                     _width          = 0;
+    int                     _height         = 0;
+    int                     _workers        = 0;
+    thread_pool*            _pool           = nullptr;
+    image                   _backbuffer;
+    image                   _frontbuffer;
+    vector<float>           _depthbuffer;
+    viewport                _viewport;
+    sw_vertex_format*       _vertex_format  = nullptr;
+    sw_buffer*              _vertex_buffer  = nullptr;
+    uint                    _vertex_stride  = 0;
+    uint                    _vertex_offset  = 0;
+    sw_buffer*              _index_buffer   = nullptr;
+    uint                    _index_offset   = 0;
+    render_index_format     _index_format   = rif_uint32;
+    sw_buffer*              _instance_buffer = nullptr;
+    uint                    _instance_stride = 0;
+    uint                    _instance_offset = 0;
+    sw_vertex_shader*       _vertex_shader  = nullptr;
+    sw_pixel_shader*        _pixel_shader   = nullptr;
+    sw_shading_context      _vs_context;
+    sw_shading_context      _ps_context;
+    uint                    _topology       = sw_topology_triangle_list;
+    bool                    _alpha_blend    = false;
+    bool                    _depth          = false;
+    sw_render_stats         _stats;
+    /* scratch for draw */
+    sw_vs_outputs           _vs_outputs;
+    sw_setup_triangles      _triangles;
+    sw_tile_bins            _bins;
+    vector<uint>            _widened;       /* the 16 bits indices */
+
+protected:
+    void install_configs(const configs& cfg);
+    void run_parallel(int count, const std::function<void(int)>& fn);
+    void shade_vertices(const byte* vertices, uint stride, uint count);
+    void setup_triangles(const uint* indices, uint count, int bias);
+    void bin_triangles();
+    int64 rasterize_tile(int tile);
+    int64 rasterize_triangle(const sw_setup_triangle& tri, const rect& rc);
+    void draw_primitives(const uint* indices, uint count, uint start, int base);
+
+public:
+    int get_width() const { return _width; }
+    int get_height() const { return _height; }
+    const sw_render_stats& get_stats() const { return _stats; }
+    void reset_stats();
+};
+
+template<class res_class>
+inline render_resource* convert_to_resource(res_class* p)
+{ return static_cast<render_resource*>(p); }
+
+__ariel_end__
+
+#endif
@@ -92,18 +92,352 @@ struct vertex_info_coef_tex
     vec2                tex;
 };
 
+/* the vertex of a symbol, in the space of its own. */
+struct vertex_info_klm
+{
+    vec2                pos;
+    vec3                klm;
+};
+
+/* the per instance data of a symbol, the rows of the affine transform & the solid color. */
+struct rose_instance_info
+{
+    vec2                ex;
+    vec2                ey;
+    vec2                origin;
+    vec4                cr;
+};
+
+/* the corner of a glyph quad, the color was always rgba8. */
+struct vertex_info_glyph
+{
+    vec2                pos;
+    vec2                tex;
+    uint                cr;
+};
+
+enum rose_vertex_layout
+{
+    rvl_full,           /* float colors & coefficients */
+    rvl_compact,        /* rgba8 colors, half klm & the distances to the line instead of the coefficients */
+    rvl_palette,        /* compact, but the colors were indexed into the palette of the constant buffer */
+};
+
+/* the compact layouts, cr was the rgba8 color or the palette index. */
+struct vertex_info_cr_c
+{
+    vec2                pos;
+    uint                cr;
+};
+
+struct vertex_info_klm_cr_c
+{
+    vec2                pos;
+    uint16              klm[4];
+    uint                cr;
+};
+
+struct vertex_info_dist_cr_c
+{
+    vec2                pos;
+    uint16              dist[2];    /* signed distance & tune */
+    uint                cr;
+};
+
+struct vertex_info_klm_tex_c
+{
+    vec2                pos;
+    uint16              klm[4];
+    vec2                tex;
+};
+
+struct vertex_info_dist_tex_c
+{
+    vec2                pos;
+    uint16              dist[2];
+    vec2                tex;
+};
+
+static const int rose_palette_capacity = 4096;  /* the maximum of a constant buffer */
+
+struct rose_palette_colors
+{
+    vec4                colors[rose_palette_capacity];
+};
+
+class rose_palette
+{
+public:
+    typedef unordered_map<uint, uint> color_indices;
+
+public:
+    void clear();
+    uint get_index(uint cr)
+    {
+        if(_last_valid && _last_color == cr)
+            return _last_index;
+        _last_color = cr;
+        _last_valid = true;
+        return _last_index = find_index(cr);
+    }
+    int size() const { return (int)_colors.size(); }
+    const vec4* get_colors() const { return _colors.empty() ? nullptr : &_colors.front(); }
+
+protected:
+    vector<vec4>        _colors;
+    color_indices       _indices;
+    uint                _last_color = 0;
+    uint                _last_index = 0;
+    bool                _last_valid = false;
+
+protected:
+    uint find_index(uint cr);
+};
+
+struct rose_vertex_context
+{
+    render_ring_buffer* ring = nullptr;
+    rose_vertex_layout  layout = rvl_full;
+    rose_palette*       palette = nullptr;
+};
+
+extern uint16 rose_float_to_half(float f);
+extern float rose_half_to_float(uint16 h);
+
+inline uint rose_pack_color(const vec4& cr)
+{
+    auto to_byte = [](float f)-> uint { return (uint)(gs_clamp(f, 0.f, 1.f) * 255.f + 0.5f); };
+    return to_byte(cr.x) | (to_byte(cr.y) << 8) | (to_byte(cr.z) << 16) | (to_byte(cr.w) << 24);
+}
+
+inline vec4 rose_unpack_color(uint cr)
+{
+    static const float s = 1.f / 255.f;
+    return vec4((float)(cr & 0xff) * s, (float)((cr >> 8) & 0xff) * s, (float)((cr >> 16) & 0xff) * s, (float)(cr >> 24) * s);
+}
+
+inline void rose_pack_klm(uint16 klm[4], const vec3& v)
+{
+    klm[0] = rose_float_to_half(v.x);
+    klm[1] = rose_float_to_half(v.y);
+    klm[2] = rose_float_to_half(v.z);
+    klm[3] = 0;
+}
+
+/* the distance was linear over the primitive, so it could be interpolated instead of the coefficients. */
+inline void rose_pack_dist(uint16 dist[2], const vec2& p, const vec4& coef)
+{
+    float len = sqrtf(coef.x * coef.x + coef.y * coef.y);
+    float d = (len == 0.f) ? 0.f : -(coef.x * p.x + coef.y * p.y + coef.z) / len;
+    dist[0] = rose_float_to_half(d);
+    dist[1] = rose_float_to_half(coef.w);
+}
+
+inline uint rose_pack_vertex_color(const vec4& cr, const rose_vertex_context& ctx)
+{
+    uint c = rose_pack_color(cr);
+    if(ctx.layout != rvl_palette)
+        return c;
+    assert(ctx.palette);
+    return ctx.palette->get_index(c);
+}
+
+inline int rose_get_vertex_stride(const vertex_info_cr*, rose_vertex_layout layout) { return layout == rvl_full ? sizeof(vertex_info_cr) : sizeof(vertex_info_cr_c); }
+inline int rose_get_vertex_stride(const vertex_info_klm_cr*, rose_vertex_layout layout) { return layout == rvl_full ? sizeof(vertex_info_klm_cr) : sizeof(vertex_info_klm_cr_c); }
+inline int rose_get_vertex_stride(const vertex_info_coef_cr*, rose_vertex_layout layout) { return layout == rvl_full ? sizeof(vertex_info_coef_cr) : sizeof(vertex_info_dist_cr_c); }
+inline int rose_get_vertex_stride(const vertex_info_klm_tex*, rose_vertex_layout layout) { return layout == rvl_full ? sizeof(vertex_info_klm_tex) : sizeof(vertex_info_klm_tex_c); }
+inline int rose_get_vertex_stride(const vertex_info_coef_tex*, rose_vertex_layout layout) { return layout == rvl_full ? sizeof(vertex_info_coef_tex) : sizeof(vertex_info_dist_tex_c); }
+
+inline void rose_pack_vertex(byte* p, const vertex_info_cr& v, const rose_vertex_context& ctx)
+{
+    if(ctx.layout == rvl_full) {
+        memcpy(p, &v, sizeof(v));
+        return;
+    }
+    auto& c = *reinterpret_cast<vertex_info_cr_c*>(p);
+    c.pos = v.pos;
+    c.cr = rose_pack_vertex_color(v.cr, ctx);
+}
+
+inline void rose_pack_vertex(byte* p, const vertex_info_klm_cr& v, const rose_vertex_context& ctx)
+{
+    if(ctx.layout == rvl_full) {
+        memcpy(p, &v, sizeof(v));
+        return;
+    }
+    auto& c = *reinterpret_cast<vertex_info_klm_cr_c*>(p);
+    c.pos = v.pos;
+    rose_pack_klm(c.klm, v.klm);
+    c.cr = rose_pack_vertex_color(v.cr, ctx);
+}
+
+inline void rose_pack_vertex(byte* p, const vertex_info_coef_cr& v, const rose_vertex_context& ctx)
+{
+    if(ctx.layout == rvl_full) {
+        memcpy(p, &v, sizeof(v));
+        return;
+    }
+    auto& c = *reinterpret_cast<vertex_info_dist_cr_c*>(p);
+    c.pos = v.pos;
+    rose_pack_dist(c.dist, v.pos, v.coef);
+    c.cr = rose_pack_vertex_color(v.cr, ctx);
+}
+
+inline void rose_pack_vertex(byte* p, const vertex_info_klm_tex& v, const rose_vertex_context& ctx)
+{
+    if(ctx.layout == rvl_full) {
+        memcpy(p, &v, sizeof(v));
+        return;
+    }
+    auto& c = *reinterpret_cast<vertex_info_klm_tex_c*>(p);
+    c.pos = v.pos;
+    rose_pack_klm(c.klm, v.klm);
+    c.tex = v.tex;
+}
+
+inline void rose_pack_vertex(byte* p, const vertex_info_coef_tex& v, const rose_vertex_context& ctx)
+{
+    if(ctx.layout == rvl_full) {
+        memcpy(p, &v, sizeof(v));
+        return;
+    }
+    auto& c = *reinterpret_cast<vertex_info_dist_tex_c*>(p);
+    c.pos = v.pos;
+    rose_pack_dist(c.dist, v.pos, v.coef);
+    c.tex = v.tex;
+}
+
+/* write the vertices into the ring in the layout selected, the unused part would be given back on commit. */
+template<class _vertex>
+class rose_vertex_writer
+{
+public:
+    typedef render_vertex_buffer vertex_buffer;
+
+public:
+    rose_vertex_writer(const rose_vertex_context& ctx, int capacity): _ctx(ctx)
+    {
+        assert(ctx.ring && capacity >= 0);
+        _stride = rose_get_vertex_stride((const _vertex*)nullptr, ctx.layout);
+        _capacity = capacity;
+        _size = 0;
+        _buffer = nullptr;
+        _offset = 0;
+        _data = !capacity ? nullptr : ctx.ring->allocate(capacity * _stride, _stride, _buffer, _offset);
+        assert(!capacity || _data);
+    }
+    int push_back(const _vertex& v)
+    {
+        assert(_size < _capacity);
+        rose_pack_vertex(_data + _size * _stride, v, _ctx);
+        return _size ++;
+    }
+    void commit() { _ctx.ring->shrink((_capacity - _size) * _stride); _capacity = _size; }
+    int size() const { return _size; }
+    int get_stride() const { return _stride; }
+    vertex_buffer* get_buffer() const { return _buffer; }
+    int get_start() const { return (int)(_offset / _stride); }
+    const byte* get_data() const { return _data; }
+
+protected:
+    const rose_vertex_context& _ctx;
+    byte*               _data;
+    int                 _stride;
+    int                 _size;
+    int                 _capacity;
+    vertex_buffer*      _buffer;
+    uint                _offset;
+};
+
 class rose_batch;
 typedef list<rose_bind_info_cr> rose_bind_list_cr;
 typedef list<rose_bind_info_tex> rose_bind_list_tex;
 typedef vector<rose_batch*> rose_batch_list;
-typedef vector<vertex_info_cr> vertex_stream_cr;
-typedef vector<vertex_info_klm_cr> vertex_stream_klm_cr;
-typedef vector<vertex_info_coef_cr> vertex_stream_cf_cr;
-typedef vector<vertex_info_klm_tex> vertex_stream_klm_tex;
-typedef vector<vertex_info_coef_tex> vertex_stream_cf_tex;
+typedef rose_vertex_writer<vertex_info_cr> vertex_writer_cr;
+typedef rose_vertex_writer<vertex_info_klm_cr> vertex_writer_klm_cr;
+typedef rose_vertex_writer<vertex_info_coef_cr> vertex_writer_cf_cr;
+typedef rose_vertex_writer<vertex_info_klm_tex> vertex_writer_klm_tex;
+typedef rose_vertex_writer<vertex_info_coef_tex> vertex_writer_cf_tex;
 typedef vector<int> index_stream;
 typedef bat_type rose_batch_tag;
 
+struct rose_submit_stats
+{
+    int                 requested_states = 0;   /* the state sets the batches asked for */
+    int                 issued_states = 0;      /* the ones really sent to the render system */
+    int                 requested_draws = 0;
+    int                 issued_draws = 0;
+    int                 vertex_buffers = 0;     /* created in the frame */
+    int64               vertex_bytes = 0;       /* streamed into the ring */
+    int64               copied_bytes = 0;
+    int                 index_buffers = 0;
+    int64               index_bytes = 0;
+    int                 vertices = 0;           /* written after the shared ones were merged */
+    int                 indices = 0;            /* the vertices it would take without the indices */
+    int64               flat_bytes = 0;         /* the vertex bytes it would take without the indices */
+    int                 instanced_draws = 0;
+    int                 instances = 0;          /* drawn by the instanced draws */
+};
+
+/*
+ * The submission layer of the rose, the states bound to the render system were cached within a frame, so that the
+ * batches could set their states through it regardless, the redundant sets were skipped.
+ */
+class rose_submitter
+{
+public:
+    typedef rendersys::vertex_buffer vertex_buffer;
+    typedef rendersys::index_buffer index_buffer;
+    typedef rendersys::constant_buffer constant_buffer;
+    typedef rendersys::sampler_state sampler_state;
+    typedef unordered_map<uint, const void*> slot_bindings;
+
+public:
+    void begin(rendersys* rsys);
+    void set_vertex_shader(vertex_shader* vs);
+    void set_pixel_shader(pixel_shader* ps);
+    void set_vertex_format(vertex_format* vf);
+    void set_topology(uint topo);
+    void set_vertex_buffer(vertex_buffer* vb, uint stride);
+    void set_index_buffer(index_buffer* ib, render_index_format fmt);
+    void set_instance_buffer(vertex_buffer* vb, uint stride);
+    void set_constant_buffer(uint slot, constant_buffer* cb, shader_type st);
+    void set_sampler_state(uint slot, sampler_state* ss, shader_type st);
+    void set_shader_resource(uint slot, shader_resource_view* srv, shader_type st);
+    void draw(uint count, uint start);
+    void draw_indexed(uint count, uint start, int base);
+    void draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance);
+    void add_requested_draw() { _stats.requested_draws ++; }
+    void add_ring_stats(const render_ring_stats& st);
+    void add_index_ring_stats(const render_ring_stats& st);
+    void add_batch_stats(int vertices, int indices, int stride);
+    rendersys* get_rendersys() const { return _rsys; }
+    const rose_submit_stats& get_stats() const { return _stats; }
+    void tracing() const;
+
+protected:
+    rendersys*          _rsys = nullptr;
+    rose_submit_stats   _stats;
+    vertex_shader*      _vertex_shader = nullptr;
+    pixel_shader*       _pixel_shader = nullptr;
+    vertex_format*      _vertex_format = nullptr;
+    uint                _topology = 0;
+    bool                _topology_valid = false;
+    vertex_buffer*      _vertex_buffer = nullptr;
+    uint                _vertex_stride = 0;
+    index_buffer*       _index_buffer = nullptr;
+    render_index_format _index_format = rif_uint32;
+    vertex_buffer*      _instance_buffer = nullptr;
+    uint                _instance_stride = 0;
+    slot_bindings       _constant_buffers;
+    slot_bindings       _sampler_states;
+    slot_bindings       _shader_resources;
+
+protected:
+    bool request_state(bool changed);
+    bool request_binding(slot_bindings& bindings, uint slot, shader_type st, const void* p);
+};
+
 class __gs_novtable rose_batch abstract
 {
 public:
@@ -112,31 +446,62 @@ public:
 
 public:
     rose_batch(int index);
-    virtual ~rose_batch();
+    virtual ~rose_batch() {}
     virtual rose_batch_tag get_tag() const = 0;
     virtual void create(bat_batch* bat) = 0;
-    virtual int buffering(rendersys* rsys) = 0;
-    virtual void draw(rendersys* rsys) = 0;
+    virtual int buffering(rendersys* rsys) { return get_vertex_count(); }
+    virtual void draw(rose_submitter& sub) = 0;
     virtual void tracing() const = 0;
+    virtual bool is_mergeable() const { return true; }     /* no resources of its own, could be drawn along with the adjacent ones */
+    virtual bool is_pooled() const { return false; }        /* kept by the rose across the frames rather than deleted */
 
 protected:
     int                 _bat_index;
     vertex_shader*      _vertex_shader;
     pixel_shader*       _pixel_shader;
     vertex_format*      _vertex_format;
-    vertex_buffer*      _vertex_buffer;
+    const rose_vertex_context* _vctx;
+    vertex_buffer*      _vertex_buffer;         /* the ring of the rose */
+    const byte*         _vertex_data;           /* valid until the ring was flushed */
+    int                 _vertex_stride;
+    int                 _vertex_start;
+    int                 _vertex_count;
+    index_stream        _indices;               /* local to the vertices of the batch */
+    index_buffer*       _index_buffer;          /* the index ring of the rose */
+    render_index_format _index_format;
+    int                 _index_start;
+    int                 _draw_count;            /* count of the indices, 0 if it was merged into the previous one */
 
 public:
     int get_batch_index() const { return _bat_index; }
     void set_vertex_shader(vertex_shader* p) { _vertex_shader = p; }
     void set_pixel_shader(pixel_shader* p) { _pixel_shader = p; }
     void set_vertex_format(vertex_format* p) { _vertex_format = p; }
-    void setup_vs_and_ps(rendersys* rsys);
-    void setup_vf_and_topology(rendersys* rsys, uint topo);
+    void set_vertex_context(const rose_vertex_context* p) { _vctx = p; }
+    vertex_buffer* get_vertex_buffer() const { return _vertex_buffer; }
+    int get_vertex_stride() const { return _vertex_stride; }
+    int get_vertex_start() const { return _vertex_start; }
+    int get_vertex_count() const { return _vertex_count; }
+    int get_draw_count() const { return _draw_count; }
+    void setup_vs_and_ps(rose_submitter& sub);
+    void setup_vf_and_topology(rose_submitter& sub, uint topo);
+    void merge(rose_batch* p);
+    virtual void buffer_indices(render_ring_buffer& ring);
 
 protected:
-    template<class stream_type>
-    int template_buffering(stream_type& stm, rendersys* rsys);
+    template<class _vertex>
+    void set_vertices(rose_vertex_writer<_vertex>& w)
+    {
+        w.commit();
+        _vertex_buffer = w.get_buffer();
+        _vertex_data = w.get_data();
+        _vertex_stride = w.get_stride();
+        _vertex_start = w.get_start();
+        _vertex_count = w.size();
+        _draw_count = (int)_indices.size();
+    }
+    const vec2& get_vertex_position(int i) const { return *reinterpret_cast<const vec2*>(_vertex_data + i * _vertex_stride); }
+    rose_vertex_layout get_vertex_layout() const { return _vctx ? _vctx->layout : rvl_full; }
 };
 
 class rose_fill_batch_cr:
@@ -146,13 +511,9 @@ public:
     rose_fill_batch_cr(int index): rose_batch(index) {}
     rose_batch_tag get_tag() const override { return bf_cr; }
     void create(bat_batch* bat) override;
-    int buffering(rendersys* rsys) override;
-    void draw(rendersys* rsys) override;
+    void draw(rose_submitter& sub) override;
     void tracing() const override;
 
-protected:
-    vertex_stream_cr    _vertices;
-
 private:
     void create_from_fill(bat_fill_batch* bat);
     void create_from_stroke(bat_stroke_batch* bat);
@@ -165,12 +526,8 @@ public:
     rose_fill_batch_klm_cr(int index) : rose_batch(index) {}
     rose_batch_tag get_tag() const override { return bf_klm_cr; }
     void create(bat_batch* bat) override;
-    int buffering(rendersys* rsys) override;
-    void draw(rendersys* rsys) override;
+    void draw(rose_submitter& sub) override;
     void tracing() const override;
-
-protected:
-    vertex_stream_klm_cr _vertices;
 };
 
 class rose_fill_batch_klm_tex:
@@ -184,12 +541,13 @@ public:
     rose_batch_tag get_tag() const override { return bf_klm_tex; }
     void create(bat_batch* bat) override;
     int buffering(rendersys* rsys) override;
-    void draw(rendersys* rsys) override;
+    void draw(rose_submitter& sub) override;
     void tracing() const override;
+    bool is_mergeable() const override { return false; }
     void destroy();
+    void set_tex_atlas(tex_atlas* atlas) { _texbatch.set_atlas(atlas); }
 
 protected:
-    vertex_stream_klm_tex _vertices;
     tex_batcher         _texbatch;
     render_sampler_state* _sstate;
     shader_resource_view* _srv;
@@ -207,12 +565,8 @@ public:
     rose_stroke_batch_coef_cr(int index) : rose_batch(index) {}
     rose_batch_tag get_tag() const override { return bs_coef_cr; }
     void create(bat_batch* bat) override;
-    int buffering(rendersys* rsys) override;
-    void draw(rendersys* rsys) override;
+    void draw(rose_submitter& sub) override;
     void tracing() const override;
-
-protected:
-    vertex_stream_cf_cr _vertices;
 };
 
 class rose_stroke_batch_coef_tex:
@@ -224,12 +578,13 @@ public:
     rose_batch_tag get_tag() const override { return bs_coef_tex; }
     void create(bat_batch* bat) override;
     int buffering(rendersys* rsys) override;
-    void draw(rendersys* rsys) override;
+    void draw(rose_submitter& sub) override;
     void tracing() const override;
+    bool is_mergeable() const override { return false; }
     void destroy();
+    void set_tex_atlas(tex_atlas* atlas) { _texbatch.set_atlas(atlas); }
 
 protected:
-    vertex_stream_cf_tex _vertices;
     tex_batcher         _texbatch;
     render_sampler_state* _sstate;
     shader_resource_view* _srv;
@@ -256,6 +611,76 @@ protected:
     void create_vertices(bat_batch* bat);
 };
 
+/* the geometry of a symbol was tessellated once on the registration, kept in the buffers of its own. */
+struct rose_symbol
+{
+    render_vertex_buffer* vertex_buffer = nullptr;
+    render_index_buffer* index_buffer = nullptr;
+    render_index_format index_format = rif_uint32;
+    int                 vertex_count = 0;
+    int                 index_count = 0;
+};
+
+/* the instances of a symbol drawn in a row, with a single instanced draw. */
+class rose_symbol_batch:
+    public rose_batch
+{
+public:
+    typedef vector<rose_instance_info> instance_list;
+
+public:
+    rose_symbol_batch(int index, const rose_symbol* sym);
+    ~rose_symbol_batch();
+    rose_batch_tag get_tag() const override { return bf_klm_cr; }
+    void create(bat_batch* bat) override { assert(!"the symbols were tessellated on registration."); }
+    void draw(rose_submitter& sub) override;
+    void tracing() const override;
+    bool is_mergeable() const override { return false; }
+    void buffer_indices(render_ring_buffer& ring) override;     /* the indices were in the symbol, stream the instances instead */
+    void add_instance(const rose_instance_info& inst) { _instances.push_back(inst); }
+    const rose_symbol* get_symbol() const { return _symbol; }
+    int get_instance_count() const { return (int)_instances.size(); }
+
+protected:
+    const rose_symbol*  _symbol;
+    instance_list       _instances;
+    vertex_buffer*      _instance_buffer;       /* the vertex ring of the rose */
+    int                 _instance_start;
+};
+
+/*
+ * The glyphs of the texts drawn in a row on the same page of the glyph atlas, streamed into the ring as quads and drawn
+ * with the shared quad indices. The glyph batches were pooled, so the texts took no allocations in the steady frames.
+ */
+class rose_glyph_batch:
+    public rose_batch
+{
+public:
+    typedef vector<vertex_info_glyph> glyph_vertices;
+
+public:
+    rose_glyph_batch();
+    rose_batch_tag get_tag() const override { return bf_klm_tex; }
+    void create(bat_batch* bat) override { assert(!"the glyphs were laid out by the font system."); }
+    void draw(rose_submitter& sub) override;
+    void tracing() const override;
+    bool is_mergeable() const override { return false; }
+    bool is_pooled() const override { return true; }
+    void buffer_indices(render_ring_buffer& ring) override;     /* the indices were shared, stream the quads instead */
+    void reset(int index, texture2d* page, shader_resource_view* srv, render_sampler_state* ss, index_buffer* quad_indices);
+    void add_quad(const rectf& dest, const rectf& uv, uint cr, const mat3& m);
+    texture2d* get_page() const { return _page; }
+
+protected:
+    glyph_vertices      _glyphs;                /* 4 for each quad */
+    texture2d*          _page;
+    shader_resource_view* _srv;                 /* held by the rose */
+    render_sampler_state* _sstate;
+
+protected:
+    void draw_quads(rose_submitter& sub);
+};
+
 class rose_bindings
 {
 public:
@@ -312,6 +737,9 @@ public:
     typedef render_constant_buffer constant_buffer;
     typedef render_sampler_state sampler_state;
     typedef list<graphics_obj> graphics_obj_cache;
+    typedef unordered_map<painter_symbol, rose_symbol*> symbol_map;
+    typedef vector<rose_glyph_batch*> glyph_batch_pool;
+    typedef unordered_map<texture2d*, shader_resource_view*> glyph_page_map;
 
 public:
     rose();
@@ -320,10 +748,16 @@ public:
     virtual void draw_path(const painter_path& path) override;
     virtual void on_draw_begin() override;
     virtual void on_draw_end() override;
+    virtual painter_symbol register_symbol(const painter_path& path) override;
+    virtual void unregister_symbol(painter_symbol sym) override;
+    virtual void draw_symbol(painter_symbol sym, const painter_symbol_instance instances[], int count) override;
+    virtual void draw_text(const gchar* str, float x, float y, const color& cr, int length = -1) override;
 
 public:
-    void setup(rendersys* rsys);
+    void setup(rendersys* rsys, rose_vertex_layout layout = rvl_full);
     rendersys* get_rendersys() const { return _rsys; }
+    const rose_submit_stats& get_submit_stats() const { return _submitter.get_stats(); }
+    void tracing_submit_stats() const { _submitter.tracing(); }
     void fill_non_picture_graphics_obj(graphics_obj& gfx, uint brush_tag);
     bat_batch* fill_picture_graphics_obj(graphics_obj& gfx);
     void stroke_graphics_obj(graphics_obj& gfx, uint pen_tag);
@@ -337,9 +771,24 @@ protected:
     rose_configs        _cfgs;
     batch_processor     _bp;
     rose_batch_list     _batches;
+    render_ring_buffer  _ring;
+    render_ring_buffer  _index_ring;
+    rose_palette        _palette;
+    rose_vertex_context _vertex_context;
+    rose_submitter      _submitter;
     rose_bindings       _bindings;
     graphics_obj_cache  _gocache;
+    tex_atlas           _atlas;
     float               _nextz;
+    symbol_map          _symbols;
+    rose_symbol_batch*  _last_symbol_batch;     /* the instances of the same symbol drawn next were appended to it */
+    fontsys_glyph_quads _glyph_quads;           /* kept for the capacity */
+    glyph_batch_pool    _glyph_pool;
+    int                 _glyph_pool_used;
+    glyph_page_map      _glyph_pages;
+    rose_glyph_batch*   _last_glyph_batch;
+    rectf               _layer_rect;            /* the bound of the paths not yet turned into batches */
+    bool                _layer_drawn;
 
 protected:
     void setup_configs();
@@ -352,11 +801,19 @@ protected:
     rose_batch* create_stroke_batch_cr(int index);
     rose_batch* create_stroke_batch_tex(int index);
     rose_batch* create_stroke_batch_assoc(int index, rose_fill_batch_klm_tex* assoc);
+    rose_symbol_batch* create_symbol_batch(int index, const rose_symbol* sym);
+    rose_glyph_batch* create_glyph_batch(int index, texture2d* page);
     void clear_batches();
+    void clear_symbols();
+    void clear_glyphs();
+    void setup_glyphs();
+    void flush_layer();
     void prepare_batches();
+    void buffer_batches();
     void draw_batches();
+    void update_palette();
 
-#if use_rendersys_d3d_11
+#if use_rendersys_d3d_11 || use_rendersys_software
 protected:
     void initialize();
     void destroy_miscs();
@@ -378,9 +835,17 @@ protected:
     pixel_shader*       _pss_coef_tex;
     vertex_format*      _vf_coef_cr;
     vertex_format*      _vf_coef_tex;
+    vertex_shader*      _vsf_klm_inst;
+    vertex_format*      _vf_klm_inst;
+    vertex_shader*      _vsf_glyph;
+    pixel_shader*       _psf_glyph;
+    vertex_format*      _vf_glyph;
+    render_index_buffer* _glyph_indices;        /* the quads, shared by the glyph batches */
     sampler_state*      _sampler_state;
     constant_buffer*    _cb_configs;
     uint                _cb_config_slot;
+    constant_buffer*    _cb_palette;
+    uint                _cb_palette_slot;
 #endif
 };
 
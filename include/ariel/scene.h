@@ -33,6 +33,7 @@
 #include <ariel/rendersys.h>
 #include <ariel/framesys.h>
 #include <ariel/widget.h>
+#include <ariel/textlayout.h>
 
 __ariel_begin__
 
@@ -67,6 +68,8 @@ protected:
     void on_next_frame_start();
     void on_next_frame_end();
     bool on_next_event(const frame_event& event);
+    bool on_next_message(const frame_message& msg);
+    void on_next_messages(const frame_message msgs[], int count);
 
 public:
     stage* prev_presentation_stage() const { return _prev_presentation_stage; }
@@ -92,6 +95,8 @@ public:
     virtual void on_frame_start() override { on_next_frame_start(); }
     virtual void on_frame_end() override { on_next_frame_end(); }
     virtual bool on_frame_event(const frame_event& event) override;
+    virtual bool on_frame_message(const frame_message& msg) override;
+    virtual void on_frame_messages(const frame_message msgs[], int count) override;
 
 public:
     wsys_manager* get_wsys_manager() { return &_wsys_manager; }
@@ -122,6 +127,7 @@ public:
     stage* get_stage(const gchar* name);
     wsys_manager* get_ui_system() const { return _uisys; }
     fontsys* get_fontsys() const { return _fontsys; }
+    text_layout_cache* get_text_layouts() { return &_text_layouts; }
     rendersys* get_rendersys() const { return _rendersys; }
     void set_rendersys(rendersys* rsys) { _rendersys = rsys; }
     void set_rose(rose* ptr) { _rose = ptr; }
@@ -141,6 +147,7 @@ protected:
     stages              _stages;
     wsys_manager*       _uisys;
     fontsys*            _fontsys;
+    text_layout_cache   _text_layouts;
     stage*              _notify;
     stage*              _present;
 
@@ -151,6 +158,8 @@ public:
     virtual void on_frame_start() override;
     virtual void on_frame_end() override;
     virtual bool on_frame_event(const frame_event& event) override;
+    virtual bool on_frame_message(const frame_message& msg) override;
+    virtual void on_frame_messages(const frame_message msgs[], int count) override;
 };
 
 __ariel_end__
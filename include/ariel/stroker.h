@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef stroker_13ed290e_2ac2_40c6_be8d_cf3fd405d925_h
+#define stroker_13ed290e_2ac2_40c6_be8d_cf3fd405d925_h
+
+#include <ariel/painterpath.h>
+
+__ariel_begin__
+
+enum stroke_join_style
+{
+    sjs_miter,
+    sjs_round,
+    sjs_bevel,
+};
+
+enum stroke_cap_style
+{
+    scs_butt,
+    scs_square,
+    scs_round,
+};
+
+struct stroke_style
+{
+    float               width = 1.f;
+    float               miter_limit = 4.f;      /* in units of half width, exceeded miters fall back to bevel */
+    float               fringe = 0.f;           /* anti-aliasing fringe out of the stroke, 0 for none */
+    float               tolerance = 0.25f;      /* max distance error of the round joins and caps */
+    stroke_join_style   join = sjs_miter;
+    stroke_cap_style    cap = scs_butt;
+};
+
+struct stroke_vertex
+{
+    vec2                pos;
+    float               coverage;               /* 1 in the stroke, fades to 0 at the edge of the fringe */
+
+public:
+    stroke_vertex() {}
+    stroke_vertex(const vec2& p, float c): pos(p), coverage(c) {}
+};
+
+/* a single triangle strip, the separated parts were linked by degenerate triangles. */
+typedef vector<stroke_vertex> stroke_strip;
+
+/*
+ * Stroke the flattened linestrips in float directly. the scratch buffers were held by the stroker, so reuse the
+ * stroker and the output strip to avoid allocations in the steady state.
+ */
+class ariel_export polyline_stroker
+{
+public:
+    polyline_stroker() {}
+    polyline_stroker(const stroke_style& st) { _style = st; }
+    void set_style(const stroke_style& st) { _style = st; }
+    const stroke_style& get_style() const { return _style; }
+    void stroke(stroke_strip& strip, const painter_linestrip& ls);
+    void stroke(stroke_strip& strip, const painter_linestrips& lss);
+    void offset(painter_linestrip& output, const painter_linestrip& input, float off);
+
+protected:
+    struct rib
+    {
+        vec2            pos;
+        vec2            left;                   /* offset direction of the left side, scaled by the half width */
+        vec2            right;
+        float           coverage;
+    };
+    typedef vector<vec2> points;
+    typedef vector<float> lengths;
+    typedef vector<rib> ribs;
+
+protected:
+    stroke_style        _style;
+    points              _points;
+    points              _normals;
+    lengths             _lengths;
+    ribs                _ribs;
+
+protected:
+    int prepare_points(const painter_linestrip& ls);
+    void build_ribs(bool closed, float hw, float fringe, bool capped);
+    void add_rib(const vec2& p, const vec2& l, const vec2& r, float cov = 1.f);
+    void add_join(int i, int prev, int next, float hw, float fringe);
+    void add_start_cap(const vec2& p, const vec2& d, const vec2& n, float hw, float fringe);
+    void add_end_cap(const vec2& p, const vec2& d, const vec2& n, float hw, float fringe);
+    void emit_ribs(stroke_strip& strip, float hw, float fringe) const;
+    int calc_arc_steps(float angle, float radius) const;
+};
+
+__ariel_end__
+
+#endif
@@ -28,6 +28,7 @@
 #ifndef style_ac50d5be_0f99_48dc_908f_ab8a309b2a27_h
 #define style_ac50d5be_0f99_48dc_908f_ab8a309b2a27_h
 
+#include <mutex>
 #include <gslib/string.h>
 #include <gslib/std.h>
 #include <ariel/type.h>
@@ -49,6 +50,71 @@ enum style_sheet_type
 extern const string& get_style_sheet_type_name(style_sheet_type sst);
 typedef std::pair<style_sheet_type, string> style_sheet_def;
 typedef unordered_map<string, int> style_sheet_info_map;
+typedef uint style_property_id;
+typedef unordered_map<style_property_id, int> style_sheet_id_map;
+typedef vector<std::pair<string, string>> style_sheet_props;
+
+/* fnv-1a of the property name, the ids of the literal names were folded at compile time by style_id. */
+constexpr style_property_id style_hash(const gchar* name, style_property_id h = 2166136261u)
+{
+    return *name ? style_hash(name + 1, (h ^ (style_property_id)*name) * 16777619u) : h;
+}
+
+#define style_id(name) (std::integral_constant<style_property_id, style_hash(_t(name))>::value)
+
+class compiled_style_sheet;
+typedef std::shared_ptr<const compiled_style_sheet> compiled_style_ptr;
+
+/* the lookups of a defs table, built once & shared by all the sheets of the table. */
+struct style_sheet_info
+{
+    style_sheet_info_map    names;
+    style_sheet_id_map      ids;
+    mutable std::mutex      lock;           /* guarded the defaults */
+    mutable compiled_style_ptr defaults;    /* the common defaults of the sheets, shared if theirs were the same */
+};
+
+struct style_value
+{
+    style_sheet_type        type = sst_unknown;
+    color                   cr;
+    int                     i = 0;
+    float                   f = 0.f;
+    bool                    b = false;
+    string                  str;
+};
+
+/*
+ * The values of a style sheet parsed once by the types of the defs, which was immutable & shared by the widgets.
+ * A modification was made on a copy if it was shared.
+ */
+class compiled_style_sheet
+{
+public:
+    typedef std::pair<int, style_value> entry;      /* index in the defs & the value */
+    typedef vector<entry> entry_list;
+
+public:
+    compiled_style_sheet(const style_sheet_def* ssp, int len): _ss_pairs(ssp), _ss_length(len) {}
+    const style_sheet_def* get_defs() const { return _ss_pairs; }
+    int get_defs_length() const { return _ss_length; }
+    const entry_list& get_entries() const { return _entries; }
+    const compiled_style_ptr& get_source() const { return _source; }
+    const style_value* find(int index) const;
+    bool is_same(const compiled_style_sheet& that) const;
+    static compiled_style_ptr compile(const style_sheet_def* ssp, int len, const style_sheet_props& props);
+    static compiled_style_ptr resolve(const compiled_style_ptr& css, const compiled_style_ptr& defaults);
+    static void set_value(compiled_style_ptr& css, int index, const style_value& value);
+
+protected:
+    const style_sheet_def*  _ss_pairs;
+    int                     _ss_length;
+    entry_list              _entries;       /* sorted by the indices */
+    compiled_style_ptr      _source;        /* the sheet resolved over the defaults, if it was resolved */
+
+protected:
+    void store(int index, const style_value& value);
+};
 
 struct accel_key;
 
@@ -61,7 +127,7 @@ public:
     style_sheet(const style_sheet_def* ssp, int len);
     virtual ~style_sheet() {}
     virtual bool get_value(const string& name, string& value) = 0;
-    virtual void set_value(const string& name, const string& value) = 0;
+    virtual void set_typed_value(int index, const style_value& value) = 0;
     virtual int get_content_size() const { return _ss_length; }
     virtual style_sheet_type get_content_type(int index) const;
     virtual const string& get_content_name(int index) const;
@@ -70,13 +136,24 @@ public:
 protected:
     const style_sheet_def*  _ss_pairs;
     int                     _ss_length;
-    style_sheet_info_map    _ss_info;
+    const style_sheet_info* _ss_info;
+    compiled_style_ptr      _ss_applied;    /* the sheet resolved over the defaults, published by a single swap */
+    compiled_style_ptr      _ss_defaults;   /* the values before any sheet applied */
 
 public:
     void initialize_style_sheet(const style_sheet_def* ssp, int len);
     int get_style_sheet_index(const string& name) const;
+    int get_style_sheet_index(style_property_id id) const;
+    void set_value(const string& name, const string& value);
+    void set_value(style_property_id id, const style_value& value);
+    compiled_style_ptr compile_style(const style_sheet_props& props) const;
+    bool apply_style(const compiled_style_ptr& css);
+    const compiled_style_ptr& get_applied_style() const { return _ss_applied ? _ss_applied->get_source() : _ss_applied; }
+    static bool parse_value(style_value& value, style_sheet_type sst, const string& str);
+    static const style_sheet_info* query_style_sheet_info(const style_sheet_def* ssp, int len);
 
 protected:
+    void capture_defaults();
     static bool from_color(string& str, const color& cr);
     static bool to_color(color& cr, const string& str);
     static bool from_integer(string& str, int i);
@@ -87,6 +164,7 @@ protected:
     static bool to_float(float& f, const string& str);
     static bool from_accel_key(string& str, const accel_key& k);
     static bool to_accel_key(accel_key& k, const string& str);
+    static void set_rgb(color& cr, const color& src) { cr.red = src.red; cr.green = src.green; cr.blue = src.blue; }
     static void setup_brush_by_color(painter_brush& brush, const color& cr);
     static void setup_pen_by_color(painter_pen& pen, const color& cr);
     static void setup_font(font& ft, const string& name, int size);
@@ -256,16 +256,51 @@ public:
     //virtual int get_clipboard(clipboard_list& cl, int c) = 0;
 };
 
+/* a glyph of the text in the atlas of the font system, placed relative to the top left of the text. */
+struct fontsys_glyph_quad
+{
+    int                 page;       /* the page of the atlas */
+    rectf               dest;
+    rectf               uv;         /* normalized in the page */
+};
+
+typedef vector<fontsys_glyph_quad> fontsys_glyph_quads;
+
 class __gs_novtable fontsys abstract
 {
 public:
     virtual ~fontsys() {}
     virtual void initialize() = 0;
     virtual void set_font(const font& f) = 0;
+    virtual const font& get_font() const = 0;
     virtual bool query_size(const gchar* str, int& w, int& h, int len = -1) = 0;
     virtual bool create_text_image(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) = 0;
     virtual bool create_text_texture(texture2d** tex, const gchar* str, int margin, const color& cr, int len = -1) = 0;
     virtual void draw(image& img, const gchar* str, int x, int y, const color& cr, int len = -1) = 0;
+
+public:
+    /* the glyph atlas was optional, the painters fell back to create_text_texture without it. */
+    virtual bool query_glyphs(fontsys_glyph_quads& quads, const gchar* str, int len = -1) { return false; }
+    virtual texture2d* get_glyph_page(int page) const { return nullptr; }
+    virtual void commit_glyphs() {}     /* upload the glyphs rasterized since the last commit */
+    /* the pen positions of a single line, xs[i] was before the i-th gchar and xs[len] at the end. */
+    virtual bool query_advances(vector<float>& xs, const gchar* str, int len = -1) { return false; }
+};
+
+/* the font set for the queries in the scope, the one set before was restored on leaving. */
+class fontsys_font_scope
+{
+public:
+    fontsys_font_scope(fontsys* fsys, const font& ft): _fsys(fsys), _last(fsys->get_font()) { fsys->set_font(ft); }
+    ~fontsys_font_scope()
+    {
+        if(!_last.name.empty())
+            _fsys->set_font(_last);
+    }
+
+private:
+    fontsys*            _fsys;
+    font                _last;
 };
 
 __ariel_end__
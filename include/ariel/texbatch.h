@@ -46,16 +46,112 @@ typedef render_texture2d texture2d;
 #define location_key    const image*
 #endif
 
+typedef unordered_map<location_key, rectf> tex_location_map;
+
+/*
+ * The persistent atlas, the textures were kept in pages across the frames, a page was allocated in shelves.
+ * Only the textures missing from the page would be copied, or the ones whose revision had been changed.
+ */
+class tex_atlas
+{
+public:
+    struct span
+    {
+        int             left;
+        int             width;
+    };
+    typedef vector<span> span_list;
+    struct shelf
+    {
+        int             top;
+        int             height;
+        int             cursor;
+        span_list       spans;      /* free spans before the cursor, sorted by left */
+    };
+    typedef vector<shelf> shelf_list;
+    struct page
+    {
+        texture2d*      tex;
+        unordered_access_view* uav;
+        shelf_list      shelves;
+        int             used_area;
+        int             entries;
+        uint            last_frame;
+    };
+    typedef vector<page> page_list;
+    struct entry
+    {
+        texture2d*      source;     /* held a reference while cached */
+        int             page;
+        int             shelf;
+        rect            slot;       /* the gap included */
+        uint            revision;
+        uint            last_frame;
+    };
+    typedef vector<entry> entry_list;
+    typedef unordered_map<texture2d*, entry_list> entry_map;
+    struct stats
+    {
+        int             pages;
+        int             entries;
+        int             uploads;
+        int             evictions;
+        int             compactions;
+        float           occupancy;
+    };
+
+public:
+    tex_atlas();
+    ~tex_atlas() { destroy(); }
+    void setup(rendersys* rsys, int page_size = 2048, int max_pages = 4, int max_idle_frames = 120);
+    void destroy();
+    void begin_frame();
+    void end_frame();
+    int acquire(tex_location_map& lm);
+    int get_page_size() const { return _page_size; }
+    texture2d* get_page_texture(int index) const;
+    const stats& get_stats() const { return _stats; }
+    void tracing() const;
+
+protected:
+    rendersys*          _rsys;
+    page_list           _pages;
+    entry_map           _entries;
+    stats               _stats;
+    uint                _frame;
+    int                 _page_size;
+    int                 _max_pages;
+    int                 _max_idle_frames;
+    int                 _gap;
+
+protected:
+    int create_page();
+    void release_page(int index);
+    int count_on_page(const tex_location_map& lm, int index) const;
+    bool place_on_page(tex_location_map& lm, int index);
+    bool evict_one(int index);
+    entry* find_entry(texture2d* tex, int index);
+    void remove_entry(texture2d* tex, int index);
+    bool allocate_slot(page& pg, int w, int h, int& shelf_index, rect& slot);
+    void free_slot(page& pg, int shelf_index, const rect& slot);
+    void upload_entry(const entry& ent);
+    void evict_idle_entries();
+    void compact_one_page();
+    void update_stats();
+};
+
 class tex_batcher
 {
 public:
-    typedef unordered_map<location_key, rectf> location_map;
+    typedef tex_location_map location_map;
 
 public:
     tex_batcher();
-    bool is_empty() const { return _rect_packer.is_empty(); }
-    float get_width() const { return _rect_packer.get_width() + _gap; }
-    float get_height() const { return _rect_packer.get_height() + _gap; }
+    bool is_empty() const { return _page < 0 ? _rect_packer.is_empty() : false; }
+    float get_width() const;
+    float get_height() const;
+    void set_atlas(tex_atlas* atlas) { _atlas = atlas; }
+    void set_packing_strategy(rect_packer::packing_strategy strategy) { _strategy = strategy; }
     void add_image(const image* p);
     void add_texture(texture2d* p);
     void arrange();
@@ -66,8 +162,11 @@ public:
 
 protected:
     rect_packer         _rect_packer;
+    rect_packer::packing_strategy _strategy;
     location_map        _location_map;
     float               _gap;
+    tex_atlas*          _atlas;
+    int                 _page;
 
 private:
     void prepare_input_list(rp_input_list& inputs);
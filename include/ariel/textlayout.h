@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef textlayout_3ce93885_4395_41cd_bebb_952db1622e33_h
+#define textlayout_3ce93885_4395_41cd_bebb_952db1622e33_h
+
+#include <gslib/std.h>
+#include <ariel/type.h>
+#include <ariel/sysop.h>
+
+__ariel_begin__
+
+/*
+ * The measured layout of a text, the caret stops were the boundaries of the chars, with the x offsets accumulated
+ * in their lines. The lines were broken at '\n', every line in the same height.
+ */
+struct text_layout
+{
+    struct line
+    {
+        int             start;      /* [start, end) of the gchars, the line break excluded */
+        int             end;
+        int             first_stop;
+        int             last_stop;
+    };
+    typedef vector<line> line_list;
+    typedef vector<int> stop_list;
+    typedef vector<float> offset_list;
+
+public:
+    size_t              hash;       /* of the font and the text */
+    font                ft;
+    string              text;
+    line_list           lines;
+    stop_list           stops;      /* gchar index of the caret stops, ascending */
+    offset_list         xs;         /* x of the caret stops in their lines */
+    int                 width;
+    int                 height;
+    int                 line_height;
+
+public:
+    int get_line(int index) const;
+    int get_stop(int index) const;
+    point get_caret_pos(int index) const;
+    int hit_index(const point& pt) const;
+    int get_fit_length(int w, int ln = 0) const;
+};
+
+/*
+ * The text layouts were cached by the font and the hash of the text, the least recently used ones would be evicted
+ * when the capacity was exceeded. A layout returned by query was valid until the next query.
+ */
+class text_layout_cache
+{
+public:
+    typedef list<text_layout> layout_list;
+    typedef layout_list::iterator layout_iter;
+    typedef unordered_map<size_t, layout_iter> layout_map;
+    struct stats
+    {
+        int             entries;
+        int             hits;
+        int             misses;
+        int             evictions;
+        int             collisions;
+    };
+
+public:
+    text_layout_cache();
+    ~text_layout_cache() { clear(); }
+    void set_fontsys(fontsys* fsys);
+    void set_capacity(int cap);
+    void clear();
+    const text_layout* query(const font& ft, const gchar* str, int len = -1);
+    bool query_size(const font& ft, const gchar* str, int& w, int& h, int len = -1);
+    point get_caret_pos(const font& ft, const gchar* str, int index, int len = -1);
+    int hit_index(const font& ft, const gchar* str, const point& pt, int len = -1);
+    const stats& get_stats() const { return _stats; }
+    void reset_stats();
+    void tracing() const;
+
+protected:
+    fontsys*            _fontsys;
+    layout_list         _layouts;   /* the most recently used in front */
+    layout_map          _index;
+    int                 _capacity;
+    stats               _stats;
+    vector<float>       _advances;
+
+protected:
+    void measure(text_layout& tl);
+    void measure_line(text_layout& tl, int start, int end);
+    void evict();
+};
+
+__ariel_end__
+
+#endif
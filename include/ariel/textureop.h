@@ -60,18 +60,20 @@ public:
     void set_fade(render_texture2d* dest, render_texture2d* src, float s);
     void set_inverse(render_texture2d* dest, render_texture2d* src);
     render_texture2d* convert_from_premultiplied(render_texture2d* src);
+    bool convert_to_image(image& img, render_texture2d* src);
 
 public:
     static void get_texture_dimension(render_texture2d* p, int& w, int& h);
     static void get_assoc_device(render_texture2d* p, render_device** ppdev);
-    static bool convert_to_image(image& img, render_texture2d* src);
+    static uint get_revision(render_texture2d* p);
+    static void touch(render_texture2d* p);
 
 protected:
     rendersys*          _rsys;
 
 private:
     render_device* get_device() const;
-    render_context* get_immediate_context() const;
+    render_context* get_context() const;
     render_constant_buffer* get_constant_buffer() const;
     template<class _cls>
     bool check_valid_device(_cls* p) const;
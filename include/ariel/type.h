@@ -86,6 +86,7 @@ public:
 private:
     friend class fsys_win32;
     friend class fsys_dwrite;
+    friend class fsys_freetype;
     mutable uint sysfont;
 
 public:
@@ -31,8 +31,10 @@
 #include <gslib/std.h>
 #include <gslib/dvt.h>
 #include <gslib/uuid.h>
+#include <gslib/rtree.h>
 #include <ariel/sysop.h>
 #include <ariel/painter.h>
+#include <ariel/widgetlayer.h>
 
 __ariel_begin__
 
@@ -102,6 +104,14 @@ public:
     wsys_manager* get_manager() const { return _manager; }
     bool register_accelerator(unikey key, uint mask);
     widget* unregister_accelerator(unikey key, uint mask);
+    void set_layered(bool b);
+    bool is_layered() const { return _layered; }
+    void invalidate_layer(const rect* rc = nullptr);
+
+protected:
+    /* mark the rect dirty without invalidating the layer, for the moves & the visibility changes */
+    void expose(const rect& rc, bool imm);
+    void expose(bool imm) { expose(rect(0, 0, get_width(), get_height()), imm); }
 
 protected:
     widget*         _prev;
@@ -110,6 +120,12 @@ protected:
     widget*         _last_child;
     widget*         _parent;
 
+private:
+    uint            _zorder;        /* the creation order, which was also the order among the siblings */
+    bool            _indexed;
+    rect            _index_rect;    /* the global rect clipped by the ancestors, kept in the index */
+    bool            _layered;       /* the output was retained in a layer and composited */
+
 public:
     widget* get_parent() const { return _parent; }
     widget* get_prev() const { return _prev; }
@@ -294,6 +310,13 @@ public:
     const string& to_string(string& str) const;
 };
 
+typedef rtree_entity<widget*> widget_entity;
+typedef rtree_node<widget_entity> widget_node;
+typedef _tree_allocator<widget_node> widget_alloc;
+typedef tree<widget_entity, widget_node, widget_alloc> widget_tree;
+typedef rtree<widget_entity, quadratic_split_alg<16, 6, widget_tree>, widget_node, widget_alloc> widget_rtree;
+typedef vector<widget*> widget_list;
+
 class wsys_manager:
     public wsys_notify
 {
@@ -321,7 +344,7 @@ public:
     void refresh(const rect& rc, bool imm = false);
     void update();
     void update(widget* w);
-    widget* hit_test(const point& pt) { return hit_test(_root, pt); }
+    widget* hit_test(const point& pt);
     widget* hit_test(widget* ptr, const point& pt);
     widget* hit_widget(const point& pt, point& pt1);
     widget* set_capture(widget* ptr, bool b);
@@ -390,6 +413,26 @@ public:
 protected:
     bool remove_widget_internal(widget* ptr);
 
+protected:
+    /* the visible widgets in their global rects clipped by the ancestors, for the hit tests and the repaints */
+    widget_rtree    _index;
+    widget_list     _index_hits;
+    uint            _next_zorder;
+    widget_layer_cache  _layers;
+
+public:
+    uint next_zorder() { return _next_zorder ++; }
+    widget_layer_cache& get_layers() { return _layers; }
+    void reindex_widget(widget* w);
+    void unindex_widget(widget* w);
+    int query_widgets(const rect& rc, widget_list& ws) const;
+
+protected:
+    void reindex_subtree(widget* w, const point& org, const rect* clip, bool visible);
+    void unindex_subtree(widget* w);
+    bool is_hitable(widget* w, const point& pt) const;
+    static bool is_painted_before(const widget* w1, const widget* w2);
+
 public:
     void set_ime(widget* ptr, point pt, const font& ft);
     void set_clipboard(clipfmt fmt, const void* ptr, int size);
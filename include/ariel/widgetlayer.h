@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifndef widgetlayer_120edeb8_cead_43b3_93c4_905d8cc0c5eb_h
+#define widgetlayer_120edeb8_cead_43b3_93c4_905d8cc0c5eb_h
+
+#include <gslib/std.h>
+#include <ariel/rendersys.h>
+#include <ariel/raster.h>
+
+__ariel_begin__
+
+class widget;
+
+/*
+ * The retained output of a layered widget, painted by the raster painter into an image and uploaded to a texture
+ * of the widget size, which was composited as a single quad until the layer was invalidated. A refresh of a part
+ * only repainted & uploaded the dirty rects of it, the rest of the texture was kept.
+ */
+struct widget_layer
+{
+    widget*             owner;
+    texture2d*          tex;
+    int                 width;
+    int                 height;
+    bool                valid;          /* false to repaint the whole */
+    bool                unsupported;    /* the widget drew something the raster painter could not, never layered again */
+    dirty_list          dirty;          /* the parts to repaint of a valid layer */
+
+public:
+    int get_bytes() const { return width * height * 4; }
+};
+
+/*
+ * The layers were kept in the order of use, the least recently used ones were released when the bytes of the textures
+ * exceeded the budget. A widget larger than the budget was drawn directly.
+ */
+class widget_layer_cache
+{
+public:
+    typedef list<widget_layer> layer_list;
+    typedef layer_list::iterator layer_iter;
+    typedef unordered_map<widget*, layer_iter> layer_map;
+    struct stats
+    {
+        int             layers;
+        int             bytes;
+        int             hits;
+        int             repaints;
+        int             partials;       /* the repaints of the dirty parts only */
+        int             evictions;
+        int             fallbacks;
+    };
+
+public:
+    widget_layer_cache();
+    ~widget_layer_cache() { clear(); }
+    void set_budget(int bytes);
+    int get_budget() const { return _budget; }
+    bool draw(widget* w, painter* paint);   /* false if the widget should be drawn directly */
+    void invalidate(widget* w, const rect* rc = nullptr);  /* in the widget space, nullptr for the whole */
+    void remove(widget* w);
+    void clear();
+    const stats& get_stats() const { return _stats; }
+    void reset_stats();
+    void tracing() const;
+
+protected:
+    layer_list          _layers;    /* the most recently used in front */
+    layer_map           _index;
+    int                 _budget;
+    stats               _stats;
+    raster_painter*     _raster;
+
+protected:
+    bool repaint(widget_layer& layer);
+    void release(widget_layer& layer);
+    void evict(int bytes);
+};
+
+__ariel_end__
+
+#endif
@@ -279,7 +279,8 @@ project "ariel"
 		todir,
 		"include",
 		"src",
-		"ext"
+		"ext",
+		"ext/freetype/include"
 	}
 	libdirs {
 		"$(OutDir)"
@@ -295,6 +296,16 @@ project "ariel"
 		'fxc /T ps_4_0 /E "rose_psf_klm_tex" /Fd /Zi /Fh "rose_psf_klm_tex.h" "../../src/ariel/rose.hlsl"',
 		'fxc /T vs_4_0 /E "rose_vss_coef_tex" /Fd /Zi /Fh "rose_vss_coef_tex.h" "../../src/ariel/rose.hlsl"',
 		'fxc /T ps_4_0 /E "rose_pss_coef_tex" /Fd /Zi /Fh "rose_pss_coef_tex.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_cr_pal" /Fd /Zi /Fh "rose_vsf_cr_pal.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_klm_cr_pal" /Fd /Zi /Fh "rose_vsf_klm_cr_pal.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vss_dist_cr" /Fd /Zi /Fh "rose_vss_dist_cr.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vss_dist_cr_pal" /Fd /Zi /Fh "rose_vss_dist_cr_pal.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T ps_4_0 /E "rose_pss_dist_cr" /Fd /Zi /Fh "rose_pss_dist_cr.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vss_dist_tex" /Fd /Zi /Fh "rose_vss_dist_tex.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T ps_4_0 /E "rose_pss_dist_tex" /Fd /Zi /Fh "rose_pss_dist_tex.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_klm_inst" /Fd /Zi /Fh "rose_vsf_klm_inst.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_glyph" /Fd /Zi /Fh "rose_vsf_glyph.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T ps_4_0 /E "rose_psf_glyph" /Fd /Zi /Fh "rose_psf_glyph.h" "../../src/ariel/rose.hlsl"',
 		'fxc /T vs_4_0 /E "ariel_smaa_edge_detection_vs" /Fd /Zi /Fh "ariel_smaa_edge_detection_vs.h" "../../src/ariel/smaa.hlsl"',
 		'fxc /T ps_4_1 /E "ariel_smaa_luma_edge_detection_ps" /Fd /Zi /Fh "ariel_smaa_luma_edge_detection_ps.h" "../../src/ariel/smaa.hlsl"',
 		'fxc /T ps_4_1 /E "ariel_smaa_color_edge_detection_ps" /Fd /Zi /Fh "ariel_smaa_color_edge_detection_ps.h" "../../src/ariel/smaa.hlsl"',
@@ -321,31 +332,40 @@ project "ariel"
 		"include/ariel/framesys.h",
 		"include/ariel/fsyswin32.h",
 		"include/ariel/fsysdwrite.h",
+		"include/ariel/fsysfreetype.h",
 		"include/ariel/image.h",
 		"include/ariel/imageop.h",
 		"include/ariel/imageio.h",
+		"include/ariel/itemmodel.h",
 		"include/ariel/loopblinn.h",
 		"include/ariel/mesh.h",
 		"include/ariel/painter.h",
 		"include/ariel/painterpath.h",
 		"include/ariel/painterport.h",
+		"include/ariel/profiler.h",
+		"include/ariel/raster.h",
 		"include/ariel/rectpack.h",
 		"include/ariel/render.h",
 		"include/ariel/rendersys.h",
 		"include/ariel/rendersysd3d11.h",
+		"include/ariel/rendersysrec.h",
+		"include/ariel/rendersyssw.h",
 		"include/ariel/resourcemgr.h",
 		"include/ariel/rose.h",
 		"include/ariel/sskeleton.h",
 		"include/ariel/style.h",
+		"include/ariel/stroker.h",
 		"include/ariel/scene.h",
 		"include/ariel/scenemgr.h",
 		"include/ariel/smaa.h",
 		"include/ariel/sysop.h",
 		"include/ariel/temporal.h",
 		"include/ariel/texbatch.h",
+		"include/ariel/textlayout.h",
 		"include/ariel/textureop.h",
 		"include/ariel/type.h",
 		"include/ariel/widget.h",
+		"include/ariel/widgetlayer.h",
 		"include/ariel/classicstyle/slider_service.h",
 		"include/ariel/classicstyle/scrollarea_service.h",
 		"include/ariel/io/utilities.h",
@@ -360,30 +380,39 @@ project "ariel"
 		"src/ariel/framesyswin32.cpp",
 		"src/ariel/fsyswin32.cpp",
 		"src/ariel/fsysdwrite.cpp",
+		"src/ariel/fsysfreetype.cpp",
 		"src/ariel/image.cpp",
 		"src/ariel/imageop.cpp",
 		"src/ariel/imageio.cpp",
+		"src/ariel/itemmodel.cpp",
 		"src/ariel/loopblinn.cpp",
 		"src/ariel/mesh.cpp",
 		"src/ariel/painter.cpp",
 		"src/ariel/painterpath.cpp",
 		"src/ariel/painterport.cpp",
+		"src/ariel/profiler.cpp",
+		"src/ariel/raster.cpp",
 		"src/ariel/rectpack.cpp",
 		"src/ariel/render.cpp",
 		"src/ariel/rendersys.cpp",
 		"src/ariel/rendersysd3d11.cpp",
+		"src/ariel/rendersysrec.cpp",
+		"src/ariel/rendersyssw.cpp",
 		"src/ariel/resourcemgr.cpp",
 		"src/ariel/rose.cpp",
 		"src/ariel/sskeleton.cpp",
 		"src/ariel/scene.cpp",
 		"src/ariel/scenemgr.cpp",
 		"src/ariel/style.cpp",
+		"src/ariel/stroker.cpp",
 		"src/ariel/smaa.cpp",
 		"src/ariel/temporal.cpp",
 		"src/ariel/texbatch.cpp",
+		"src/ariel/textlayout.cpp",
 		"src/ariel/textureop.cpp",
 		--"src/ariel/textureop.hlsl",
 		"src/ariel/widget.cpp",
+		"src/ariel/widgetlayer.cpp",
 		--"src/ariel/rose.hlsl",
 		--"src/ariel/smaa.hlsl",
 		"src/ariel/io/utilities.cpp",
@@ -466,7 +495,8 @@ project "uieditor"
 	entrypoint ""
 	dependson {
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		todir,
@@ -486,6 +516,7 @@ project "uieditor"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"imm32.lib",
 		"snmpapi.lib",
 		"d3d10_1.lib",
@@ -508,7 +539,8 @@ project "uic"
 	entrypoint ""
 	dependson {
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		todir,
@@ -528,6 +560,7 @@ project "uic"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"imm32.lib",
 		"snmpapi.lib",
 		"d3d10_1.lib",
@@ -278,7 +278,8 @@ project "ariel"
 		"include",
 		"src",
 		"ext",
-		"framework"
+		"framework",
+		"ext/freetype/include"
 	}
 	libdirs {
 		"$(OutDir)"
@@ -294,6 +295,16 @@ project "ariel"
 		'fxc /T ps_4_0 /E "rose_psf_klm_tex" /Fd /Zi /Fh "rose_psf_klm_tex.h" "../../src/ariel/rose.hlsl"',
 		'fxc /T vs_4_0 /E "rose_vss_coef_tex" /Fd /Zi /Fh "rose_vss_coef_tex.h" "../../src/ariel/rose.hlsl"',
 		'fxc /T ps_4_0 /E "rose_pss_coef_tex" /Fd /Zi /Fh "rose_pss_coef_tex.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_cr_pal" /Fd /Zi /Fh "rose_vsf_cr_pal.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_klm_cr_pal" /Fd /Zi /Fh "rose_vsf_klm_cr_pal.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vss_dist_cr" /Fd /Zi /Fh "rose_vss_dist_cr.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vss_dist_cr_pal" /Fd /Zi /Fh "rose_vss_dist_cr_pal.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T ps_4_0 /E "rose_pss_dist_cr" /Fd /Zi /Fh "rose_pss_dist_cr.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vss_dist_tex" /Fd /Zi /Fh "rose_vss_dist_tex.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T ps_4_0 /E "rose_pss_dist_tex" /Fd /Zi /Fh "rose_pss_dist_tex.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_klm_inst" /Fd /Zi /Fh "rose_vsf_klm_inst.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T vs_4_0 /E "rose_vsf_glyph" /Fd /Zi /Fh "rose_vsf_glyph.h" "../../src/ariel/rose.hlsl"',
+		'fxc /T ps_4_0 /E "rose_psf_glyph" /Fd /Zi /Fh "rose_psf_glyph.h" "../../src/ariel/rose.hlsl"',
 		'fxc /T vs_4_0 /E "ariel_smaa_edge_detection_vs" /Fd /Zi /Fh "ariel_smaa_edge_detection_vs.h" "../../src/ariel/smaa.hlsl"',
 		'fxc /T ps_4_1 /E "ariel_smaa_luma_edge_detection_ps" /Fd /Zi /Fh "ariel_smaa_luma_edge_detection_ps.h" "../../src/ariel/smaa.hlsl"',
 		'fxc /T ps_4_1 /E "ariel_smaa_color_edge_detection_ps" /Fd /Zi /Fh "ariel_smaa_color_edge_detection_ps.h" "../../src/ariel/smaa.hlsl"',
@@ -320,29 +331,37 @@ project "ariel"
 		"include/ariel/framesys.h",
 		"include/ariel/fsyswin32.h",
 		"include/ariel/fsysdwrite.h",
+		"include/ariel/fsysfreetype.h",
 		"include/ariel/image.h",
 		"include/ariel/imageop.h",
 		"include/ariel/imageio.h",
+		"include/ariel/itemmodel.h",
 		"include/ariel/loopblinn.h",
 		"include/ariel/mesh.h",
 		"include/ariel/painter.h",
+		"include/ariel/profiler.h",
 		"include/ariel/raster.h",
 		"include/ariel/rectpack.h",
 		"include/ariel/render.h",
 		"include/ariel/rendersys.h",
 		"include/ariel/rendersysd3d11.h",
+		"include/ariel/rendersysrec.h",
+		"include/ariel/rendersyssw.h",
 		"include/ariel/resourcemgr.h",
 		"include/ariel/rose.h",
 		"include/ariel/style.h",
+		"include/ariel/stroker.h",
 		"include/ariel/scene.h",
 		"include/ariel/scenemgr.h",
 		"include/ariel/smaa.h",
 		"include/ariel/sysop.h",
 		"include/ariel/temporal.h",
 		"include/ariel/texbatch.h",
+		"include/ariel/textlayout.h",
 		"include/ariel/textureop.h",
 		"include/ariel/type.h",
 		"include/ariel/widget.h",
+		"include/ariel/widgetlayer.h",
 		"include/ariel/classicstyle/slider_service.h",
 		"include/ariel/classicstyle/canvas_service.h",
 		"include/ariel/io/utilities.h",
@@ -357,28 +376,36 @@ project "ariel"
 		"src/ariel/framesyswin32.cpp",
 		"src/ariel/fsyswin32.cpp",
 		"src/ariel/fsysdwrite.cpp",
+		"src/ariel/fsysfreetype.cpp",
 		"src/ariel/image.cpp",
 		"src/ariel/imageop.cpp",
 		"src/ariel/imageio.cpp",
+		"src/ariel/itemmodel.cpp",
 		"src/ariel/loopblinn.cpp",
 		"src/ariel/mesh.cpp",
 		"src/ariel/painter.cpp",
+		"src/ariel/profiler.cpp",
 		"src/ariel/raster.cpp",
 		"src/ariel/rectpack.cpp",
 		"src/ariel/render.cpp",
 		"src/ariel/rendersys.cpp",
 		"src/ariel/rendersysd3d11.cpp",
+		"src/ariel/rendersysrec.cpp",
+		"src/ariel/rendersyssw.cpp",
 		"src/ariel/resourcemgr.cpp",
 		"src/ariel/rose.cpp",
 		"src/ariel/scene.cpp",
 		"src/ariel/scenemgr.cpp",
 		"src/ariel/style.cpp",
+		"src/ariel/stroker.cpp",
 		"src/ariel/smaa.cpp",
 		"src/ariel/temporal.cpp",
 		"src/ariel/texbatch.cpp",
+		"src/ariel/textlayout.cpp",
 		"src/ariel/textureop.cpp",
 		--"src/ariel/textureop.hlsl",
 		"src/ariel/widget.cpp",
+		"src/ariel/widgetlayer.cpp",
 		--"src/ariel/rose.hlsl",
 		--"src/ariel/smaa.hlsl",
 		"src/ariel/io/utilities.cpp",
@@ -396,7 +423,8 @@ project "test111"
 		"libpng",
 		"libjpeg",
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		todir,
@@ -416,6 +444,7 @@ project "test111"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"imm32.lib",
 		"snmpapi.lib"
 	}
@@ -434,7 +463,8 @@ project "widget"
 		"libpng",
 		"libjpeg",
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		todir,
@@ -454,6 +484,7 @@ project "widget"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"imm32.lib",
 		"snmpapi.lib",
 		"d3d10_1.lib",
@@ -546,7 +577,8 @@ project "cdt"
 		"libpng",
 		"libjpeg",
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		"include",
@@ -561,6 +593,7 @@ project "cdt"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"d3d10_1.lib",
 		"dwrite.lib",
 		"d2d1.lib"
@@ -622,6 +655,198 @@ project "rectpack"
 		"test/rectpack/main.cpp"
 	}
 
+project "stroker"
+	language "C++"
+	kind "ConsoleApp"
+	entrypoint ""
+	dependson {
+		"zlib",
+		"libpng",
+		"libjpeg",
+		"gslib",
+		"ariel",
+		"freetype"
+	}
+	includedirs {
+		"include",
+		"ext"
+	}
+	libdirs {
+		"$(OutDir)"
+	}
+	links {
+		"zlib.lib",
+		"libjpeg.lib",
+		"libpng.lib",
+		"gslib.lib",
+		"ariel.lib",
+		"freetype.lib",
+		"d3d10_1.lib",
+		"dwrite.lib",
+		"d2d1.lib"
+	}
+	files {
+		"test/stroker/main.cpp"
+	}
+
+project "batch"
+	language "C++"
+	kind "ConsoleApp"
+	entrypoint ""
+	dependson {
+		"zlib",
+		"libpng",
+		"libjpeg",
+		"gslib",
+		"ariel",
+		"freetype"
+	}
+	includedirs {
+		"include",
+		"ext"
+	}
+	libdirs {
+		"$(OutDir)"
+	}
+	links {
+		"zlib.lib",
+		"libjpeg.lib",
+		"libpng.lib",
+		"gslib.lib",
+		"ariel.lib",
+		"freetype.lib",
+		"d3d10_1.lib",
+		"dwrite.lib",
+		"d2d1.lib"
+	}
+	files {
+		"test/batch/main.cpp"
+	}
+
+project "capture"
+	language "C++"
+	kind "ConsoleApp"
+	entrypoint ""
+	dependson {
+		"zlib",
+		"libpng",
+		"libjpeg",
+		"gslib",
+		"ariel",
+		"freetype"
+	}
+	includedirs {
+		"include",
+		"ext"
+	}
+	libdirs {
+		"$(OutDir)"
+	}
+	links {
+		"zlib.lib",
+		"libjpeg.lib",
+		"libpng.lib",
+		"gslib.lib",
+		"ariel.lib",
+		"freetype.lib",
+		"dxgi.lib",
+		"d3d11.lib",
+		"imm32.lib",
+		"d3d10_1.lib",
+		"dwrite.lib",
+		"d2d1.lib"
+	}
+	files {
+		"test/capture/main.cpp"
+	}
+
+project "dirty"
+	language "C++"
+	kind "ConsoleApp"
+	entrypoint ""
+	includedirs {
+		"include",
+		"ext"
+	}
+	files {
+		"include/gslib/config.h",
+		"src/gslib/error.cpp",
+		"include/gslib/error.h",
+		"include/gslib/pool.h",
+		"include/gslib/std.h",
+		"src/gslib/string.cpp",
+		"include/gslib/string.h",
+		"include/gslib/type.h",
+		"src/gslib/type.cpp",
+		"include/ariel/config.h",
+		"include/ariel/type.h",
+		"src/ariel/dirty.cpp",
+		"include/ariel/dirty.h",
+		"test/dirty/main.cpp"
+	}
+
+project "itemrows"
+	language "C++"
+	kind "ConsoleApp"
+	entrypoint ""
+	includedirs {
+		"include",
+		"ext"
+	}
+	files {
+		"include/gslib/config.h",
+		"src/gslib/error.cpp",
+		"include/gslib/error.h",
+		"include/gslib/pool.h",
+		"include/gslib/std.h",
+		"src/gslib/string.cpp",
+		"include/gslib/string.h",
+		"include/gslib/type.h",
+		"src/gslib/type.cpp",
+		"include/ariel/config.h",
+		"include/ariel/type.h",
+		"src/ariel/itemmodel.cpp",
+		"include/ariel/itemmodel.h",
+		"test/itemrows/main.cpp"
+	}
+
+project "timerwheel"
+	language "C++"
+	kind "ConsoleApp"
+	entrypoint ""
+	dependson {
+		"zlib",
+		"libpng",
+		"libjpeg",
+		"gslib",
+		"ariel",
+		"freetype"
+	}
+	includedirs {
+		"include",
+		"ext"
+	}
+	libdirs {
+		"$(OutDir)"
+	}
+	links {
+		"zlib.lib",
+		"libjpeg.lib",
+		"libpng.lib",
+		"gslib.lib",
+		"ariel.lib",
+		"freetype.lib",
+		"dxgi.lib",
+		"d3d11.lib",
+		"imm32.lib",
+		"d3d10_1.lib",
+		"dwrite.lib",
+		"d2d1.lib"
+	}
+	files {
+		"test/timerwheel/main.cpp"
+	}
+
 project "testfreetype"
 	language "C++"
 	kind "ConsoleApp"
@@ -652,7 +877,8 @@ project "texpack"
 		"libjpeg",
 		"zlib",
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		"include",
@@ -667,6 +893,7 @@ project "texpack"
 		"zlib.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"dxgi.lib",
 		"imm32.lib",
 		"d3d11.lib",
@@ -715,7 +942,8 @@ project "uieditor"
 	entrypoint ""
 	dependson {
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		todir,
@@ -736,6 +964,7 @@ project "uieditor"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"imm32.lib",
 		"snmpapi.lib",
 		"d3d10_1.lib",
@@ -760,7 +989,8 @@ project "uic"
 	entrypoint ""
 	dependson {
 		"gslib",
-		"ariel"
+		"ariel",
+		"freetype"
 	}
 	includedirs {
 		todir,
@@ -781,6 +1011,7 @@ project "uic"
 		"libpng.lib",
 		"gslib.lib",
 		"ariel.lib",
+		"freetype.lib",
 		"imm32.lib",
 		"snmpapi.lib",
 		"d3d10_1.lib",
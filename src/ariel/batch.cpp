@@ -23,8 +23,10 @@
  * SOFTWARE.
  */
 
+#include <chrono>
 #include <ariel/batch.h>
 #include <ariel/painter.h>
+#include <ariel/profiler.h>
 #include <gslib/utility.h>
 
 __ariel_begin__
@@ -57,40 +59,6 @@ static bat_type bat_decide_type(uint brush_tag, bool has_klm)
     }
 }
 
-static bool bat_is_triangle_overlapped(const bat_triangle* triangle, const rectf& rc, const bat_batch* batch)
-{
-    assert(triangle && batch);
-    assert((batch->get_type() >= bf_start) && (batch->get_type() <= bf_end));
-    auto& rtr = static_cast<const bat_fill_batch*>(batch)->const_rtree();
-    vector<bat_triangle*> result;
-    rtr.query(rc, result);
-    for(auto* p : result) {
-        assert(p);
-        if(p->is_overlapped(*triangle))
-            return true;
-    }
-    return false;
-}
-
-static bool bat_is_triangle_overlapped(const bat_triangle* triangle, const bat_batch* batch)
-{
-    assert(triangle && batch);
-    rectf rc;
-    triangle->make_rect(rc);
-    return bat_is_triangle_overlapped(triangle, rc, batch);
-}
-
-static bool bat_is_triangles_overlapped(const bat_triangles& triangles, const bat_batch* batch)
-{
-    assert(batch);
-    for(const bat_triangle* p : triangles) {
-        assert(p);
-        if(bat_is_triangle_overlapped(p, batch))
-            return true;
-    }
-    return false;
-}
-
 bat_triangle::bat_triangle()
 {
     _joints[0] = _joints[1] = _joints[2] = 0;
@@ -548,14 +516,108 @@ bat_stroke_host_batch::~bat_stroke_host_batch()
     _lines.clear();
 }
 
+/* tiles for the overlapping sweep, the pairs were tested in parallel by tiles */
+static const float bat_tile_size = 256.f;
+static const int bat_max_tiles_per_side = 32;
+static const int bat_parallel_threshold = 4096;
+
+struct bat_tile_grid
+{
+    rectf               bound;
+    float               step;
+    int                 cols;
+    int                 rows;
+
+public:
+    int get_col(float x) const { return gs_clamp((int)((x - bound.left) / step), 0, cols - 1); }
+    int get_row(float y) const { return gs_clamp((int)((y - bound.top) / step), 0, rows - 1); }
+    int get_tile_count() const { return cols * rows; }
+};
+
+struct bat_pair
+{
+    int                 later;
+    int                 earlier;
+
+public:
+    bat_pair(int l, int e): later(l), earlier(e) {}
+    bool operator<(const bat_pair& that) const { return later < that.later || (later == that.later && earlier < that.earlier); }
+};
+
+typedef vector<bat_pair> bat_pairs;
+typedef vector<int> bat_tile_bin;
+typedef vector<bat_tile_bin> bat_tile_bins;
+
+static bool bat_is_relevant_pair(const bat_records& records, int earlier, int later)
+{
+    const auto& e = records.at(earlier);
+    const auto& l = records.at(later);
+    /* the single triangles were only blocked by the same type, the tex groups by anything before them */
+    if(l.group < 0)
+        return e.type == l.type;
+    return e.group != l.group;
+}
+
+static void bat_sweep_tile(bat_pairs& pairs, const bat_records& records, const bat_tile_bin& bin, const bat_tile_grid& grid, int col, int row)
+{
+    /* sort and sweep along the x axis */
+    bat_tile_bin sorted(bin);
+    std::sort(sorted.begin(), sorted.end(), [&records](int a, int b)-> bool {
+        return records.at(a).bound.left < records.at(b).bound.left;
+    });
+    int c = (int)sorted.size();
+    for(int i = 0; i < c; i ++) {
+        int a = sorted.at(i);
+        const auto& ra = records.at(a);
+        for(int j = i + 1; j < c; j ++) {
+            int b = sorted.at(j);
+            const auto& rb = records.at(b);
+            if(rb.bound.left > ra.bound.right)
+                break;
+            if(rb.bound.top > ra.bound.bottom || rb.bound.bottom < ra.bound.top)
+                continue;
+            /* only the tile holding the top left of the intersection takes the pair */
+            if(grid.get_col(gs_max(ra.bound.left, rb.bound.left)) != col ||
+                grid.get_row(gs_max(ra.bound.top, rb.bound.top)) != row
+                )
+                continue;
+            int earlier = gs_min(a, b), later = gs_max(a, b);
+            if(!bat_is_relevant_pair(records, earlier, later))
+                continue;
+            if(records.at(earlier).triangle->is_overlapped(*records.at(later).triangle))
+                pairs.push_back(bat_pair(later, earlier));
+        }
+    }
+}
+
 batch_processor::batch_processor()
 {
     _antialias = false;
+    memset(&_stats, 0, sizeof(_stats));
 }
 
 batch_processor::~batch_processor()
 {
     clear_batches();
+    if(_pool) {
+        delete _pool;
+        _pool = nullptr;
+    }
+}
+
+void batch_processor::set_workers(int workers)
+{
+    if(!workers)
+        workers = (int)std::thread::hardware_concurrency();
+    if(workers == _workers && (_pool || workers <= 1))
+        return;
+    if(_pool) {
+        delete _pool;
+        _pool = nullptr;
+    }
+    _workers = workers;
+    if(workers > 1)
+        _pool = new thread_pool(workers);
 }
 
 void batch_processor::add_non_tex_polygon(lb_polygon* poly, float z, uint brush_tag)
@@ -595,25 +657,20 @@ bat_batch* batch_processor::add_tex_polygons(lb_polygon_list& polys, float z)
     }
     if(triangles.empty())
         return nullptr;
-    /* find which batch could contain the whole polygon */
-    auto* f = find_containable_tex_batch(triangles);
-    if(!f) {
-        f = create_batch<bat_fill_batch>(bf_klm_tex);
-        if(is_aa_enabled()) {
-            /* for every bf_klm_tex batch, will have a bs_coef_tex batch for boundary anti-aliasing. */
-            create_batch<bat_stroke_host_batch>(bs_coef_tex);
-        }
-    }
-    assert(f && (f->get_type() == bf_klm_tex));
-    /* insert all the triangles into the batch */
-    auto& rtr = static_cast<bat_fill_batch*>(f)->get_rtree();
+    /* the batch would be decided in the sweep, it might be merged into a former one which could contain the whole polygon */
+    bat_tex_group g;
+    g.batch = new bat_fill_batch(bf_klm_tex);
+    /* for every bf_klm_tex batch, will have a bs_coef_tex batch for boundary anti-aliasing. */
+    g.host = is_aa_enabled() ? new bat_stroke_host_batch(bs_coef_tex) : nullptr;
+    g.first = (int)_records.size();
+    int index = (int)_tex_groups.size();
     for(auto* t : triangles) {
         assert(t);
-        rectf rc;
-        t->make_rect(rc);
-        rtr.insert(t, rc);
+        record_triangle(t, bf_klm_tex, index);
     }
-    return f;
+    g.last = (int)_records.size();
+    _tex_groups.push_back(g);
+    return g.batch;
 }
 
 bat_line* batch_processor::add_line(lb_joint* i, lb_joint* j, float w, float z, uint pen_tag)
@@ -631,17 +688,26 @@ bat_line* batch_processor::add_aa_border(lb_joint* i, lb_joint* j, float z, uint
 
 void batch_processor::finish_batching()
 {
+    ariel_profile_scope("batch_processor::finish_batching");
+    ariel_profile_counter(pci_triangles, _triangles.size());
+    sweep_batches();
     proceed_line_batch();
 }
 
 void batch_processor::clear_batches()
 {
+    for(auto& g : _tex_groups) {
+        delete g.batch;
+        delete g.host;
+    }
     for(auto* p : _batches) { delete p; }
     for(auto* p : _triangles) { delete p; }
     for(auto* p : _lines) { delete p; }
     _batches.clear();
     _triangles.clear();
     _lines.clear();
+    _records.clear();
+    _tex_groups.clear();
 }
 
 template<class _batch>
@@ -686,34 +752,167 @@ void batch_processor::add_triangle(lb_joint* j1, lb_joint* j2, lb_joint* j3, flo
     auto* triangle = create_triangle(j1, j2, j3, z);
     assert(triangle);
     // collect_aa_borders(triangle, b);
-    rectf rc;
-    triangle->make_rect(rc);
-    auto t = triangle->decide(brush_tag);
-    auto find_next_batch = [](bat_type t, bat_iter from, bat_iter to)->bat_iter {
-        for(auto i = from; i != to; ++ i) {
-            if((*i)->get_type() == t)
-                return i;
+    record_triangle(triangle, triangle->decide(brush_tag), -1);
+}
+
+void batch_processor::record_triangle(bat_triangle* triangle, bat_type t, int group)
+{
+    assert(triangle);
+    bat_record r;
+    r.triangle = triangle;
+    r.type = t;
+    r.group = group;
+    triangle->make_rect(r.bound);
+    _records.push_back(r);
+}
+
+/*
+ * A triangle goes into the first batch of its type with no triangle overlapped, a tex group goes into the furthest
+ * klm_tex batch it could reach backwards. The overlapped pairs were found in tiles in parallel, the assignment was
+ * a sequential sweep over the pairs in the order of submission, so the result was the same as doing it one by one.
+ */
+void batch_processor::sweep_batches()
+{
+    auto start = std::chrono::steady_clock::now();
+    memset(&_stats, 0, sizeof(_stats));
+    int c = (int)_records.size();
+    if(!c)
+        return;
+    assert(_batches.empty());
+    /* the reduced triangles were made lazily, make them ahead for the workers */
+    rectf bound = _records.front().bound;
+    for(auto& r : _records) {
+        r.triangle->ensure_make_reduced();
+        bound.left = gs_min(bound.left, r.bound.left);
+        bound.top = gs_min(bound.top, r.bound.top);
+        bound.right = gs_max(bound.right, r.bound.right);
+        bound.bottom = gs_max(bound.bottom, r.bound.bottom);
+    }
+    bat_tile_grid grid;
+    grid.bound = bound;
+    grid.step = gs_max(bat_tile_size, gs_max(bound.width(), bound.height()) / bat_max_tiles_per_side);
+    grid.cols = gs_max(1, (int)ceil(bound.width() / grid.step));
+    grid.rows = gs_max(1, (int)ceil(bound.height() / grid.step));
+    int tiles = grid.get_tile_count();
+    bat_tile_bins bins(tiles);
+    for(int i = 0; i < c; i ++) {
+        const auto& rc = _records.at(i).bound;
+        int c0 = grid.get_col(rc.left), c1 = grid.get_col(rc.right);
+        int r0 = grid.get_row(rc.top), r1 = grid.get_row(rc.bottom);
+        for(int r = r0; r <= r1; r ++) {
+            for(int k = c0; k <= c1; k ++)
+                bins.at(r * grid.cols + k).push_back(i);
+        }
+    }
+    /* find the overlapped pairs */
+    vector<bat_pairs> tile_pairs(tiles);
+    auto do_tile = [&](int i) {
+        bat_sweep_tile(tile_pairs.at(i), _records, bins.at(i), grid, i % grid.cols, i / grid.cols);
+    };
+    if(c >= bat_parallel_threshold && tiles > 1 && !_workers)
+        set_workers(0);
+    if(c < bat_parallel_threshold || tiles <= 1 || !_pool) {
+        for(int i = 0; i < tiles; i ++)
+            do_tile(i);
+    }
+    else {
+        for(int i = 0; i < tiles; i ++)
+            _pool->add(do_tile, i);
+        _pool->join();
+    }
+    bat_pairs pairs;
+    for(auto& tp : tile_pairs)
+        pairs.insert(pairs.end(), tp.begin(), tp.end());
+    std::sort(pairs.begin(), pairs.end());
+    vector<int> offsets(c + 1, 0);
+    for(const auto& p : pairs)
+        offsets.at(p.later + 1) ++;
+    for(int i = 0; i < c; i ++)
+        offsets.at(i + 1) += offsets.at(i);
+    /* sweep in the order of submission */
+    vector<int> batch_of(c, -1);
+    vector<int> stamps;
+    vector<int> type_batches[bf_end - bf_start + 1];
+    int stamp = 0;
+    auto block_batches = [&](int i) {
+        for(int k = offsets.at(i); k < offsets.at(i + 1); k ++) {
+            int b = batch_of.at(pairs.at(k).earlier);
+            assert(b >= 0);
+            stamps.at(b) = stamp;
         }
-        return to;
     };
-    auto f = find_next_batch(t, _batches.begin(), _batches.end());
-    while(f != _batches.end()) {
-        auto* bat = *f;
-        assert(bat);
-        assert((bat->get_type() >= bf_start) && (bat->get_type() <= bf_end));
-        if(!bat_is_triangle_overlapped(triangle, rc, bat)) {
-            auto& rtr = static_cast<bat_fill_batch*>(bat)->get_rtree();
-            rtr.insert(triangle, rc);
-            return;
+    for(int i = 0; i < c;) {
+        const auto& r = _records.at(i);
+        stamp ++;
+        if(r.group < 0) {
+            block_batches(i);
+            auto& candidates = type_batches[r.type - bf_start];
+            int found = -1;
+            for(int b : candidates) {
+                if(stamps.at(b) != stamp) {
+                    found = b;
+                    break;
+                }
+            }
+            if(found < 0) {
+                create_batch<bat_fill_batch>(r.type);
+                found = (int)_batches.size() - 1;
+                stamps.push_back(0);
+                candidates.push_back(found);
+            }
+            static_cast<bat_fill_batch*>(_batches.at(found))->get_rtree().insert(r.triangle, r.bound);
+            batch_of.at(i) = found;
+            i ++;
+            continue;
+        }
+        auto& g = _tex_groups.at(r.group);
+        for(int j = g.first; j < g.last; j ++)
+            block_batches(j);
+        int found = find_containable_tex_batch(stamps, stamp);
+        bat_fill_batch* bat = nullptr;
+        if(found < 0) {
+            _batches.push_back(g.batch);
+            found = (int)_batches.size() - 1;
+            stamps.push_back(0);
+            /* the single picture triangles could go into it as well */
+            type_batches[bf_klm_tex - bf_start].push_back(found);
+            if(g.host) {
+                _batches.push_back(g.host);
+                stamps.push_back(0);
+            }
+            bat = g.batch;
+        }
+        else {
+            bat = static_cast<bat_fill_batch*>(_batches.at(found));
+            if(g.host) {
+                assert(found + 1 < (int)_batches.size());
+                auto* host = _batches.at(found + 1);
+                assert(host->get_type() == bs_coef_tex);
+                auto& lines = static_cast<bat_stroke_batch*>(host)->get_lines();
+                auto& moving = g.host->get_lines();
+                lines.insert(lines.end(), moving.begin(), moving.end());
+                moving.clear();
+                delete g.host;
+            }
+            delete g.batch;
+        }
+        g.batch = nullptr;
+        g.host = nullptr;
+        auto& rtr = bat->get_rtree();
+        for(int j = g.first; j < g.last; j ++) {
+            const auto& t = _records.at(j);
+            rtr.insert(t.triangle, t.bound);
+            batch_of.at(j) = found;
         }
-        f = find_next_batch(t, ++ f, _batches.end());
+        i = g.last;
     }
-    assert(f == _batches.end());
-    auto* bat = create_batch<bat_fill_batch>(t);
-    assert(bat);
-    assert((bat->get_type() >= bf_start) && (bat->get_type() <= bf_end));
-    auto& rtr = bat->get_rtree();
-    rtr.insert(triangle, rc);
+    _stats.triangles = c;
+    _stats.pairs = (int)pairs.size();
+    _stats.tiles = tiles;
+    _stats.batches = (int)_batches.size();
+    _stats.sweep_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    _records.clear();
+    _tex_groups.clear();
 }
 
 void batch_processor::collect_aa_borders(bat_triangle* triangle, bool b[3], uint pen_tag)
@@ -857,39 +1056,22 @@ void batch_processor::gather_tex_triangles(bat_triangles& triangles, lb_polygon*
     }
 }
 
-bat_batch* batch_processor::find_containable_tex_batch(const bat_triangles& triangles)
+int batch_processor::find_containable_tex_batch(const vector<int>& stamps, int stamp) const
 {
-    auto find_next_batch = [&triangles](bat_reversed_iter from, bat_reversed_iter to)-> bat_reversed_iter {
-        for(auto i = from; i != to; ++ i) {
-            auto t = (*i)->get_type();
-            if(t >= bs_start && t <= bs_end) {
-                if(t == bs_coef_tex) {
-                    auto n = std::next(i);
-                    if(n != to && ((*n)->get_type() == bf_klm_tex))
-                        continue;
-                }
-                return to;
-            }
-            assert(t >= bf_start && t <= bf_end);
-            if(t == bf_klm_tex)
-                return i;
-            else {
-                if(bat_is_triangles_overlapped(triangles, *i))
-                    return to;
-            }
+    /* the batches stamped were overlapped */
+    int lastfound = -1;
+    for(int i = (int)_batches.size() - 1; i >= 0; i --) {
+        auto t = _batches.at(i)->get_type();
+        if(t >= bs_start && t <= bs_end) {
+            if(t == bs_coef_tex && i > 0 && (_batches.at(i - 1)->get_type() == bf_klm_tex))
+                continue;
+            break;
         }
-        return to;
-    };
-    bat_batch* lastfound = nullptr;
-    auto f = find_next_batch(_batches.rbegin(), _batches.rend());
-    while(f != _batches.rend()) {
-        auto* bat = *f;
-        assert(bat);
-        assert(bat->get_type() == bf_klm_tex);
-        if(bat_is_triangles_overlapped(triangles, bat))
+        assert(t >= bf_start && t <= bf_end);
+        if(stamps.at(i) == stamp)
             break;
-        lastfound = bat;
-        f = find_next_batch(++ f, _batches.rend());
+        if(t == bf_klm_tex)
+            lastfound = i;
     }
     return lastfound;
 }
@@ -898,6 +1080,11 @@ bat_stroke_batch* batch_processor::find_associated_tex_stroke_batch(const bat_ba
 {
     assert(is_aa_enabled());
     assert(bat && (bat->get_type() == bf_klm_tex));
+    /* still pending? */
+    for(const auto& g : _tex_groups) {
+        if(g.batch == bat)
+            return g.host;
+    }
     auto f = _batches.begin();
     for(; f != _batches.end(); ++ f) {
         if(*f == bat)
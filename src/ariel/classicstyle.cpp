@@ -87,7 +87,7 @@ static const style_sheet_def __button_style_sheet_defs[] =
     std::make_pair(sst_string, _t("caption")),
     std::make_pair(sst_string, _t("caption_font_name")),
     std::make_pair(sst_integer, _t("caption_font_size")),
-    std::make_pair(sst_string, _t("caption_font_color")),
+    std::make_pair(sst_color, _t("caption_font_color")),
 };
 
 static const style_sheet_def __edit_line_style_sheet_defs[] =
@@ -131,7 +131,7 @@ static const style_sheet_def __combo_box_style_sheet_defs[] =
     std::make_pair(sst_string, _t("candidate_items")),
     std::make_pair(sst_string, _t("item_font_name")),
     std::make_pair(sst_integer, _t("item_font_size")),
-    std::make_pair(sst_string, _t("item_font_color")),
+    std::make_pair(sst_color, _t("item_font_color")),
     std::make_pair(sst_color, _t("text_background_color")),
     std::make_pair(sst_color, _t("text_disable_background_color")),
     std::make_pair(sst_integer, _t("text_horizontal_margin")),
@@ -161,7 +161,7 @@ static const style_sheet_def __menu_style_sheet_defs[] =
     std::make_pair(sst_string, _t("caption")),
     std::make_pair(sst_string, _t("caption_font_name")),
     std::make_pair(sst_integer, _t("caption_font_size")),
-    std::make_pair(sst_string, _t("caption_font_color")),
+    std::make_pair(sst_color, _t("caption_font_color")),
     /* extensions */
     std::make_pair(sst_color, _t("border_color")),
     std::make_pair(sst_color, _t("separator_color")),
@@ -213,6 +213,9 @@ static const style_sheet_def __tree_view_style_sheet_defs[] =
     std::make_pair(sst_integer, _t("item_indent")),
     std::make_pair(sst_integer, _t("item_spacing")),
     std::make_pair(sst_color, _t("connect_line_color")),
+    std::make_pair(sst_string, _t("item_font_name")),
+    std::make_pair(sst_integer, _t("item_font_size")),
+    std::make_pair(sst_color, _t("item_font_color")),
 };
 
 widget_style_sheet::widget_style_sheet():
@@ -250,21 +253,19 @@ bool widget_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void widget_style_sheet::set_value(const string& name, const string& value)
+void widget_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_fill_color, value));
+        set_rgb(_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_stroke_color, value));
+        set_rgb(_stroke_color, value.cr);
         break;
     case 2:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for widget_style_sheet.");
                 return;
@@ -274,8 +275,7 @@ void widget_style_sheet::set_value(const string& name, const string& value)
         }
     case 3:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for widget_style_sheet.");
                 return;
@@ -284,15 +284,14 @@ void widget_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 4:
-        verify(to_color(_disable_fill_color, value));
+        set_rgb(_disable_fill_color, value.cr);
         break;
     case 5:
-        verify(to_color(_disable_stroke_color, value));
+        set_rgb(_disable_stroke_color, value.cr);
         break;
     case 6:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for widget_style_sheet.");
                 return;
@@ -302,8 +301,7 @@ void widget_style_sheet::set_value(const string& name, const string& value)
         }
     case 7:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for widget_style_sheet.");
                 return;
@@ -338,16 +336,15 @@ bool root_widget_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void root_widget_style_sheet::set_value(const string& name, const string& value)
+void root_widget_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_bkground_color, value));
+        set_rgb(_bkground_color, value.cr);
         break;
     case 1:
-        _bkground_image = value;
+        _bkground_image = value.str;
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -394,21 +391,19 @@ bool placeholder_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void placeholder_style_sheet::set_value(const string& name, const string& value)
+void placeholder_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_fill_color, value));
+        set_rgb(_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_stroke_color, value));
+        set_rgb(_stroke_color, value.cr);
         break;
     case 2:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for widget_style_sheet.");
                 return;
@@ -418,8 +413,7 @@ void placeholder_style_sheet::set_value(const string& name, const string& value)
         }
     case 3:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for widget_style_sheet.");
                 return;
@@ -428,16 +422,16 @@ void placeholder_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 4:
-        _remark = value;
+        _remark = value.str;
         break;
     case 5:
-        _remark_font_name = value;
+        _remark_font_name = value.str;
         break;
     case 6:
-        verify(to_integer(_remark_font_size, value));
+        _remark_font_size = value.i;
         break;
     case 7:
-        verify(to_color(_remark_font_color, value));
+        set_rgb(_remark_font_color, value.cr);
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -513,39 +507,37 @@ bool button_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void button_style_sheet::set_value(const string& name, const string& value)
+void button_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_normal_fill_color, value));
+        set_rgb(_normal_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_normal_stroke_color, value));
+        set_rgb(_normal_stroke_color, value.cr);
         break;
     case 2:
-        verify(to_color(_hover_fill_color, value));
+        set_rgb(_hover_fill_color, value.cr);
         break;
     case 3:
-        verify(to_color(_hover_stroke_color, value));
+        set_rgb(_hover_stroke_color, value.cr);
         break;
     case 4:
-        verify(to_color(_press_fill_color, value));
+        set_rgb(_press_fill_color, value.cr);
         break;
     case 5:
-        verify(to_color(_press_stroke_color, value));
+        set_rgb(_press_stroke_color, value.cr);
         break;
     case 6:
-        verify(to_color(_disable_fill_color, value));
+        set_rgb(_disable_fill_color, value.cr);
         break;
     case 7:
-        verify(to_color(_disable_stroke_color, value));
+        set_rgb(_disable_stroke_color, value.cr);
         break;
     case 8:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -555,8 +547,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 9:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -566,8 +557,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 10:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -577,8 +567,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 11:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -588,8 +577,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 12:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -599,8 +587,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 13:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -610,8 +597,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 14:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -621,8 +607,7 @@ void button_style_sheet::set_value(const string& name, const string& value)
         }
     case 15:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -631,20 +616,19 @@ void button_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 16:
-        _caption = value;
+        _caption = value.str;
         break;
     case 17:
-        _caption_font_name = value;
+        _caption_font_name = value.str;
         break;
     case 18:
         {
-            int i;
-            verify(to_integer(i, value));
+            int i = value.i;
             _caption_font_size = i;
             break;
         }
     case 19:
-        verify(to_color(_caption_font_color, value));
+        set_rgb(_caption_font_color, value.cr);
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -709,21 +693,19 @@ bool edit_line_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void edit_line_style_sheet::set_value(const string& name, const string& value)
+void edit_line_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_normal_fill_color, value));
+        set_rgb(_normal_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_normal_stroke_color, value));
+        set_rgb(_normal_stroke_color, value.cr);
         break;
     case 2:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -733,8 +715,7 @@ void edit_line_style_sheet::set_value(const string& name, const string& value)
         }
     case 3:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -743,15 +724,14 @@ void edit_line_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 4:
-        verify(to_color(_focus_fill_color, value));
+        set_rgb(_focus_fill_color, value.cr);
         break;
     case 5:
-        verify(to_color(_focus_stroke_color, value));
+        set_rgb(_focus_stroke_color, value.cr);
         break;
     case 6:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -761,8 +741,7 @@ void edit_line_style_sheet::set_value(const string& name, const string& value)
         }
     case 7:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -771,15 +750,14 @@ void edit_line_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 8:
-        verify(to_color(_disable_fill_color, value));
+        set_rgb(_disable_fill_color, value.cr);
         break;
     case 9:
-        verify(to_color(_disable_stroke_color, value));
+        set_rgb(_disable_stroke_color, value.cr);
         break;
     case 10:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -789,8 +767,7 @@ void edit_line_style_sheet::set_value(const string& name, const string& value)
         }
     case 11:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -799,18 +776,17 @@ void edit_line_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 12:
-        _text_font_name = value;
+        _text_font_name = value.str;
         break;
     case 13:
-        verify(to_integer(_text_font_size, value));
+        _text_font_size = value.i;
         break;
     case 14:
-        verify(to_color(_text_font_color, value));
+        set_rgb(_text_font_color, value.cr);
         break;
     case 15:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for edit_style_sheet.");
                 return;
@@ -908,39 +884,37 @@ bool combo_box_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void combo_box_style_sheet::set_value(const string& name, const string& value)
+void combo_box_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_normal_fill_color, value));
+        set_rgb(_normal_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_normal_stroke_color, value));
+        set_rgb(_normal_stroke_color, value.cr);
         break;
     case 2:
-        verify(to_color(_hover_fill_color, value));
+        set_rgb(_hover_fill_color, value.cr);
         break;
     case 3:
-        verify(to_color(_hover_stroke_color, value));
+        set_rgb(_hover_stroke_color, value.cr);
         break;
     case 4:
-        verify(to_color(_press_fill_color, value));
+        set_rgb(_press_fill_color, value.cr);
         break;
     case 5:
-        verify(to_color(_press_stroke_color, value));
+        set_rgb(_press_stroke_color, value.cr);
         break;
     case 6:
-        verify(to_color(_disable_fill_color, value));
+        set_rgb(_disable_fill_color, value.cr);
         break;
     case 7:
-        verify(to_color(_disable_stroke_color, value));
+        set_rgb(_disable_stroke_color, value.cr);
         break;
     case 8:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -950,8 +924,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 9:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -961,8 +934,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 10:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -972,8 +944,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 11:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -983,8 +954,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 12:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -994,8 +964,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 13:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1005,8 +974,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 14:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1016,8 +984,7 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
         }
     case 15:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1026,35 +993,34 @@ void combo_box_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 16:
-        _candidate_items = value;
+        _candidate_items = value.str;
         break;
     case 17:
-        _item_font_name = value;
+        _item_font_name = value.str;
         break;
     case 18:
         {
-            int i;
-            verify(to_integer(i, value));
+            int i = value.i;
             _item_font_size = i;
             break;
         }
     case 19:
-        verify(to_color(_item_font_color, value));
+        set_rgb(_item_font_color, value.cr);
         break;
     case 20:
-        verify(to_color(_text_bkground_color, value));
+        set_rgb(_text_bkground_color, value.cr);
         break;
     case 21:
-        verify(to_color(_text_disable_bkground_color, value));
+        set_rgb(_text_disable_bkground_color, value.cr);
         break;
     case 22:
-        verify(to_integer(_text_horizontal_margin, value));
+        _text_horizontal_margin = value.i;
         break;
     case 23:
-        verify(to_integer(_text_vertical_margin, value));
+        _text_vertical_margin = value.i;
         break;
     case 24:
-        verify(to_integer(_candidate_box_width, value));
+        _candidate_box_width = value.i;
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -1154,39 +1120,37 @@ bool menu_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void menu_style_sheet::set_value(const string& name, const string& value)
+void menu_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_normal_fill_color, value));
+        set_rgb(_normal_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_normal_stroke_color, value));
+        set_rgb(_normal_stroke_color, value.cr);
         break;
     case 2:
-        verify(to_color(_hover_fill_color, value));
+        set_rgb(_hover_fill_color, value.cr);
         break;
     case 3:
-        verify(to_color(_hover_stroke_color, value));
+        set_rgb(_hover_stroke_color, value.cr);
         break;
     case 4:
-        verify(to_color(_press_fill_color, value));
+        set_rgb(_press_fill_color, value.cr);
         break;
     case 5:
-        verify(to_color(_press_stroke_color, value));
+        set_rgb(_press_stroke_color, value.cr);
         break;
     case 6:
-        verify(to_color(_disable_fill_color, value));
+        set_rgb(_disable_fill_color, value.cr);
         break;
     case 7:
-        verify(to_color(_disable_stroke_color, value));
+        set_rgb(_disable_stroke_color, value.cr);
         break;
     case 8:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1196,8 +1160,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 9:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1207,8 +1170,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 10:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1218,8 +1180,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 11:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1229,8 +1190,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 12:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1240,8 +1200,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 13:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1251,8 +1210,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 14:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1262,8 +1220,7 @@ void menu_style_sheet::set_value(const string& name, const string& value)
         }
     case 15:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for button_style_sheet.");
                 return;
@@ -1272,41 +1229,40 @@ void menu_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 16:
-        _caption = value;
+        _caption = value.str;
         break;
     case 17:
-        _caption_font_name = value;
+        _caption_font_name = value.str;
         break;
     case 18:
         {
-            int i;
-            verify(to_integer(i, value));
+            int i = value.i;
             _caption_font_size = i;
             break;
         }
     case 19:
-        verify(to_color(_caption_font_color, value));
+        set_rgb(_caption_font_color, value.cr);
         break;
     case 20:
-        verify(to_color(_border_color, value));
+        set_rgb(_border_color, value.cr);
         break;
     case 21:
-        verify(to_color(_separator_color, value));
+        set_rgb(_separator_color, value.cr);
         break;
     case 22:
-        verify(to_integer(_separator_space, value));
+        _separator_space = value.i;
         break;
     case 23:
-        verify(to_integer(_text_horizontal_margin, value));
+        _text_horizontal_margin = value.i;
         break;
     case 24:
-        verify(to_integer(_text_vertical_margin, value));
+        _text_vertical_margin = value.i;
         break;
     case 25:
-        verify(to_integer(_caption_reserved_space, value));
+        _caption_reserved_space = value.i;
         break;
     case 26:
-        verify(to_integer(_accel_reserved_space, value));
+        _accel_reserved_space = value.i;
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -1335,16 +1291,15 @@ bool menu_cmd_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void menu_cmd_style_sheet::set_value(const string& name, const string& value)
+void menu_cmd_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        _caption = value;
+        _caption = value.str;
         break;
     case 1:
-        verify(to_accel_key(_accel_key, value));
+        verify(to_accel_key(_accel_key, value.str));
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -1371,13 +1326,12 @@ bool menu_sub_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void menu_sub_style_sheet::set_value(const string& name, const string& value)
+void menu_sub_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        _caption = value;
+        _caption = value.str;
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -1409,13 +1363,12 @@ bool menubar_button_style_sheet::get_value(const string& name, string& value)
     }
 }
 
-void menubar_button_style_sheet::set_value(const string& name, const string& value)
+void menubar_button_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        _caption = value;
+        _caption = value.str;
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -1433,7 +1386,7 @@ bool table_view_style_sheet::get_value(const string& name, string& value)
     return false;
 }
 
-void table_view_style_sheet::set_value(const string& name, const string& value)
+void table_view_style_sheet::set_typed_value(int index, const style_value& value)
 {
 }
 
@@ -1445,6 +1398,9 @@ tree_view_style_sheet::tree_view_style_sheet():
     _item_indent = 14;
     _item_spacing = 1;
     _connect_line_color = color(127, 127, 127);
+    _item_font_name.assign(_t("Tahoma"));
+    _item_font_size = 10;
+    _item_font_color = color(0, 0, 0);
 }
 
 bool tree_view_style_sheet::get_value(const string& name, string& value)
@@ -1466,26 +1422,31 @@ bool tree_view_style_sheet::get_value(const string& name, string& value)
         return from_integer(value, _item_spacing);
     case 6:
         return from_color(value, _connect_line_color);
+    case 7:
+        value = _item_font_name;
+        return true;
+    case 8:
+        return from_integer(value, _item_font_size);
+    case 9:
+        return from_color(value, _item_font_color);
     default:
         return false;
     }
 }
 
-void tree_view_style_sheet::set_value(const string& name, const string& value)
+void tree_view_style_sheet::set_typed_value(int index, const style_value& value)
 {
-    int index = get_style_sheet_index(name);
     switch(index)
     {
     case 0:
-        verify(to_color(_view_fill_color, value));
+        set_rgb(_view_fill_color, value.cr);
         break;
     case 1:
-        verify(to_color(_view_stroke_color, value));
+        set_rgb(_view_stroke_color, value.cr);
         break;
     case 2:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for tree_view_style_sheet.");
                 return;
@@ -1495,8 +1456,7 @@ void tree_view_style_sheet::set_value(const string& name, const string& value)
         }
     case 3:
         {
-            float f;
-            verify(to_float(f, value));
+            float f = value.f;
             if(f < 0.f || f > 1.f) {
                 assert(!"invalid opacity for tree_view_style_sheet.");
                 return;
@@ -1505,13 +1465,22 @@ void tree_view_style_sheet::set_value(const string& name, const string& value)
             break;
         }
     case 4:
-        verify(to_integer(_item_indent, value));
+        _item_indent = value.i;
         break;
     case 5:
-        verify(to_integer(_item_spacing, value));
+        _item_spacing = value.i;
         break;
     case 6:
-        verify(to_color(_connect_line_color, value));
+        set_rgb(_connect_line_color, value.cr);
+        break;
+    case 7:
+        _item_font_name = value.str;
+        break;
+    case 8:
+        _item_font_size = value.i;
+        break;
+    case 9:
+        set_rgb(_item_font_color, value.cr);
         break;
     default:
         assert(!"unexpected style sheet name.");
@@ -1548,6 +1517,7 @@ void widget::flush_style()
     setup_pen_by_color(_normal_pen, _stroke_color);
     setup_brush_by_color(_disable_brush, _disable_fill_color);
     setup_pen_by_color(_disable_pen, _disable_stroke_color);
+    invalidate_layer();
 }
 
 void* root_widget::query_interface(const uuid& uid)
@@ -1574,6 +1544,7 @@ void root_widget::flush_style()
         assert(tex);
         _bktex.attach(tex);
     }
+    invalidate_layer();
 }
 
 void* placeholder::query_interface(const uuid& uid)
@@ -1601,6 +1572,7 @@ void placeholder::flush_style()
     setup_brush_by_color(_normal_brush, _fill_color);
     setup_pen_by_color(_normal_pen, _stroke_color);
     setup_font(_remark_font, _remark_font_name, _remark_font_size);
+    invalidate_layer();
 }
 
 void* button::query_interface(const uuid& uid)
@@ -1649,6 +1621,7 @@ void button::flush_style()
     setup_pen_by_color(_disable_pen, _disable_stroke_color);
     setup_font(_caption_font, _caption_font_name, _caption_font_size);
     is_enabled() ? set_normal() : set_gray();
+    invalidate_layer();
 }
 
 void button::set_press()
@@ -1699,6 +1672,7 @@ void edit_line::flush_style()
     setup_brush_by_color(_disable_brush, _disable_fill_color);
     setup_pen_by_color(_disable_pen, _disable_stroke_color);
     setup_font(_text_font, _text_font_name, _text_font_size);
+    invalidate_layer();
 }
 
 void edit_line::draw_background(painter* paint)
@@ -2367,11 +2341,117 @@ void tree_view::move(const rect& rc)
 
 void tree_view::draw(painter* paint)
 {
-    painter_objs objs;
-    auto rc = get_rectf();
-    //rc.move_to();
-    _paintport.query_objs(objs, rc);
-    __asm nop;
+    assert(paint && _hori_scrollbar && _vert_scrollbar);
+    if(_item_rows.get_model()) {
+        draw_items(paint, get_width() - _scrollbar_width, get_height() - _scrollbar_width);
+        return;
+    }
+    /* only the contents in the viewport were drawn, which was scrolled over the area by the ratios */
+    rectf area;
+    _paintport.get_area_rect(area);
+    float w = (float)(get_width() - _scrollbar_width);
+    float h = (float)(get_height() - _scrollbar_width);
+    if(w <= 0.f || h <= 0.f)
+        return;
+    float x = area.left + _hori_scrollbar->get_scroll_ratio() * gs_max(area.width() - w, 0.f);
+    float y = area.top + _vert_scrollbar->get_scroll_ratio() * gs_max(area.height() - h, 0.f);
+    _paintport.flush_port(paint, rectf(x, y, w, h));
+}
+
+void tree_view::on_click(uint um, unikey uk, const point& pt)
+{
+    __super::on_click(um, uk, pt);
+    auto* model = _item_rows.get_model();
+    int h = get_height() - _scrollbar_width;
+    if(!model || pt.y < 0 || pt.y >= h)
+        return;
+    int row = _item_rows.find_row(calc_items_offset(h) + pt.y);
+    if(row >= _item_rows.get_row_count())
+        return;
+    item_data data;
+    model->get_row_data(row, data);
+    if(data.branch)
+        expand_item(row, !_item_rows.is_expanded(row));
+}
+
+void tree_view::flush_style()
+{
+    setup_brush_by_color(_view_brush, _view_fill_color);
+    setup_pen_by_color(_view_pen, _view_stroke_color);
+    setup_font(_item_font, _item_font_name, _item_font_size);
+    invalidate_layer();
+}
+
+void tree_view::set_item_model(item_model* model)
+{
+    _item_rows.set_model(model);
+    _item_visuals.clear();
+    assert(_vert_scrollbar);
+    _vert_scrollbar->set_scrollarea_range(_item_rows.get_total_height());
+    refresh(false);
+}
+
+void tree_view::reload_items()
+{
+    _item_rows.reload();
+    _item_visuals.clear();
+    assert(_vert_scrollbar);
+    _vert_scrollbar->set_scrollarea_range(_item_rows.get_total_height());
+    refresh(false);
+}
+
+void tree_view::expand_item(int row, bool b)
+{
+    if(_item_rows.is_expanded(row) == b)
+        return;
+    _item_rows.expand(row, b);
+    _item_visuals.invalidate(row);
+    assert(_vert_scrollbar);
+    _vert_scrollbar->set_scrollarea_range(_item_rows.get_total_height());
+    refresh(false);
+}
+
+/*
+ * Only the rows in the viewport were visited, each in O(log n) by the offsets, and only the rows newly exposed
+ * would ask the model for the data.
+ */
+void tree_view::draw_items(painter* paint, int w, int h)
+{
+    assert(paint);
+    if(w <= 0 || h <= 0)
+        return;
+    paint->save();
+    paint->set_brush(_view_brush);
+    paint->set_pen(_view_pen);
+    paint->draw_rect(rectf(0.f, 0.f, (float)w, (float)h));
+    paint->restore();
+    auto* model = _item_rows.get_model();
+    assert(model);
+    int offset = calc_items_offset(h);
+    int count = _item_rows.get_row_count();
+    font last_font = paint->get_font();
+    paint->set_font(_item_font);
+    _item_visuals.begin_frame();
+    for(int row = _item_rows.find_row(offset); row < count; row = _item_rows.next_row(row)) {
+        int top = _item_rows.get_row_top(row) - offset;
+        if(top >= h)
+            break;
+        auto& v = _item_visuals.acquire(model, row);
+        float x = (float)(model->get_row_depth(row) * _item_indent);
+        if(v.data.branch)
+            paint->draw_text(_item_rows.is_expanded(row) ? _t("-") : _t("+"), x, (float)top, _item_font_color, 1);
+        if(!v.data.text.empty())
+            paint->draw_text(v.data.text.c_str(), x + (float)_item_indent, (float)top, _item_font_color, v.data.text.length());
+    }
+    _item_visuals.end_frame();
+    paint->set_font(last_font);
+}
+
+int tree_view::calc_items_offset(int h) const
+{
+    assert(_vert_scrollbar);
+    int range = gs_max(_item_rows.get_total_height() - h, 0);
+    return round(_vert_scrollbar->get_scroll_ratio() * (float)range);
 }
 
 void tree_view::refresh_tree_view()
@@ -2506,6 +2586,7 @@ void menu_sub_item::flush_style()
     assert(_menu);
     _brush_ptr = &_menu->_menu_normal_brush;
     _pen_ptr = &_menu->_menu_normal_pen;
+    invalidate_layer();
 }
 
 static void retrieve_text_dimensions(const font& ft, const string& str, int& w, int& h)
@@ -2514,10 +2595,7 @@ static void retrieve_text_dimensions(const font& ft, const string& str, int& w,
         w = h = 0;
         return;
     }
-    auto* fsys = scene::get_singleton_ptr()->get_fontsys();
-    assert(fsys);
-    fsys->set_font(ft);
-    fsys->query_size(str.c_str(), w, h, str.length());
+    scene::get_singleton_ptr()->get_text_layouts()->query_size(ft, str.c_str(), w, h, str.length());
 }
 
 void menu_sub_item::get_caption_dimensions(int& w, int& h) const
@@ -2608,6 +2686,7 @@ void menu_cmd_item::flush_style()
     assert(_menu);
     _brush_ptr = &_menu->_menu_normal_brush;
     _pen_ptr = &_menu->_menu_normal_pen;
+    invalidate_layer();
 }
 
 void menu_cmd_item::get_caption_dimensions(int& w, int& h) const
@@ -2868,6 +2947,7 @@ void menu::flush_style()
     setup_brush_by_color(_menu_disable_brush, _disable_fill_color);
     setup_pen_by_color(_menu_disable_pen, _disable_stroke_color);
     setup_font(_menu_font, _caption_font_name, _caption_font_size);
+    invalidate_layer();
 }
 
 void menu::startup()
@@ -3067,6 +3147,7 @@ void menubar_button::flush_style()
     set_caption(menubar_button::_caption);
     _brush_ptr = &_menubar->_menubar_normal_brush;
     _pen_ptr = &_menubar->_menubar_normal_pen;
+    invalidate_layer();
 }
 
 void menubar_button::refresh_menubar_button_size()
@@ -3113,6 +3194,7 @@ void menubar::flush_style()
     setup_brush_by_color(_menubar_disable_brush, _disable_fill_color);
     setup_pen_by_color(_menubar_disable_pen, _disable_stroke_color);
     setup_font(_menubar_font, _caption_font_name, _caption_font_size);
+    invalidate_layer();
 }
 
 menubar_button* menubar::register_menubar_button()
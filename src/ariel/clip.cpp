@@ -24,8 +24,10 @@
  */
 
 #include <ariel/clip.h>
+#include <ariel/stroker.h>
 #include <gslib/utility.h>
 #include <gslib/error.h>
+#include <gslib/thdpool.h>
 
 #undef min
 #undef max
@@ -280,7 +282,8 @@ public:
     const intersect_info_map& get_intersect_info_map() const { return _itrs_map; }
 };
 
-static clipper*  __current_clipper = nullptr;
+/* per thread, the zfill callback of the AJ clipper carries no user data. */
+static thread_local clipper* __current_clipper = nullptr;
 
 static clip_edge* determine_edge(const clip_point* p1, const clip_point* p2)
 {
@@ -1361,14 +1364,50 @@ void clip_remap_points(painter_linestrips& output, clip_point_attr& attrmap, con
     if(pc)  pc->finish();
 }
 
+static float get_signed_area(const painter_linestrip& ls)
+{
+    float area = 0.f;
+    int size = ls.get_size();
+    for(int i = 0, j = size - 1; i < size; j = i ++) {
+        const vec2& p1 = ls.get_point(j);
+        const vec2& p2 = ls.get_point(i);
+        area += p1.x * p2.y - p2.x * p1.y;
+    }
+    return area * 0.5f;
+}
+
+/*
+ * Offset by the float stroker, then the overlaps were merged by the non-zero rule. Like the ClipperOffset did, the
+ * side was decided by the orientation of the outermost one, so that the holes in the other orientation shrank.
+ */
 void clip_offset(painter_linestrips& lss, const painter_linestrips& input, float offset, float miter_limit)
 {
-    Paths out, paths;
-    convert_to_clipper_paths(paths, input);
-    ClipperOffset co(miter_limit);
-    co.AddPaths(paths, jtMiter, etClosedPolygon);
-    co.Execute(out, (double)(offset * int_scale_ratio));
-    convert_to_polygons(lss, out);
+    const painter_linestrip* outer = nullptr;
+    float left = FLT_MAX;
+    for(const painter_linestrip& ls : input) {
+        for(int i = 0; i < ls.get_size(); i ++) {
+            if(ls.get_point(i).x < left) {
+                left = ls.get_point(i).x;
+                outer = &ls;
+            }
+        }
+    }
+    if(!outer)
+        return;
+    float off = get_signed_area(*outer) < 0.f ? -offset : offset;
+    stroke_style st;
+    st.join = sjs_miter;
+    st.miter_limit = miter_limit;
+    polyline_stroker stroker(st);
+    painter_linestrip src, ls;
+    Paths paths;
+    for(const painter_linestrip& org : input) {
+        src = org;
+        src.set_closed(true);
+        stroker.offset(ls, src, off);
+        convert_to_clipper_paths(paths, ls);
+    }
+    clip_simplify(lss, paths, pftNonZero);
 }
 
 static void clip_convert_path(painter_path& out, clip_result_const_iter i)
@@ -1425,4 +1464,208 @@ void clip_exclude(clip_result& output, const painter_path& subjects, const paint
     c.do_exclude(output);
 }
 
+struct clip_tile_bound
+{
+    cInt            left;
+    cInt            top;
+    cInt            right;
+    cInt            bottom;
+
+public:
+    clip_tile_bound() { left = top = right = bottom = 0; }
+    bool is_valid() const { return left < right && top < bottom; }
+};
+
+typedef vector<clip_tile_bound> clip_tile_bounds;
+typedef vector<int> clip_tile_bin;
+typedef vector<clip_tile_bin> clip_tile_bins;
+typedef vector<Paths> clip_tile_results;
+
+struct clip_tile_grid
+{
+    clip_tile_bound bound;
+    cInt            step;
+    int             cols;
+    int             rows;
+
+public:
+    int get_tile_count() const { return cols * rows; }
+    int get_col(cInt x) const { return gs_clamp((int)((x - bound.left) / step), 0, cols - 1); }
+    int get_row(cInt y) const { return gs_clamp((int)((y - bound.top) / step), 0, rows - 1); }
+    clip_tile_bound get_tile(int i) const
+    {
+        clip_tile_bound bd;
+        bd.left = bound.left + step * (i % cols);
+        bd.top = bound.top + step * (i / cols);
+        bd.right = bd.left + step;
+        bd.bottom = bd.top + step;
+        return bd;
+    }
+};
+
+static clip_tile_bound calc_tile_bound(const Path& path)
+{
+    clip_tile_bound bd;
+    if(path.empty())
+        return bd;
+    bd.left = bd.right = path.front().X;
+    bd.top = bd.bottom = path.front().Y;
+    for(const IntPoint& p : path) {
+        bd.left = gs_min(bd.left, p.X);
+        bd.right = gs_max(bd.right, p.X);
+        bd.top = gs_min(bd.top, p.Y);
+        bd.bottom = gs_max(bd.bottom, p.Y);
+    }
+    return bd;
+}
+
+static clip_tile_bound calc_tile_bounds(clip_tile_bounds& bounds, const Paths& paths)
+{
+    clip_tile_bound total;
+    bool first = true;
+    bounds.resize(paths.size());
+    for(int i = 0; i < (int)paths.size(); i ++) {
+        clip_tile_bound& bd = bounds.at(i) = calc_tile_bound(paths.at(i));
+        if(paths.at(i).size() < 3)
+            continue;
+        if(first) {
+            total = bd;
+            first = false;
+            continue;
+        }
+        total.left = gs_min(total.left, bd.left);
+        total.right = gs_max(total.right, bd.right);
+        total.top = gs_min(total.top, bd.top);
+        total.bottom = gs_max(total.bottom, bd.bottom);
+    }
+    return total;
+}
+
+/*
+ * a ring contributes nothing to the winding numbers out of its bound, so binning the rings by the bounds keeps the fill
+ * rule inside every tile. cutting the rings at the tile borders ahead was tried, but the AJ clipper was not robust to the
+ * collinear edges that left on the borders, so leave the cutting to the clipper itself.
+ */
+static void bin_tile_paths(clip_tile_bins& bins, const clip_tile_grid& grid, const Paths& paths, const clip_tile_bounds& bounds)
+{
+    for(int i = 0; i < (int)paths.size(); i ++) {
+        const clip_tile_bound& bd = bounds.at(i);
+        if(paths.at(i).size() < 3)
+            continue;
+        if(bd.right < grid.bound.left || bd.left > grid.bound.right || bd.bottom < grid.bound.top || bd.top > grid.bound.bottom)
+            continue;
+        int c1 = grid.get_col(bd.left), c2 = grid.get_col(bd.right);
+        int r1 = grid.get_row(bd.top), r2 = grid.get_row(bd.bottom);
+        for(int r = r1; r <= r2; r ++) {
+            for(int c = c1; c <= c2; c ++)
+                bins.at(r * grid.cols + c).push_back(i);
+        }
+    }
+}
+
+static void clip_tile(Paths& output, const Paths& subjects, const clip_tile_bin& subject_bin, const Paths& clips, const clip_tile_bin& clip_bin, const clip_tile_bound& tile, PolyFillType ft)
+{
+    output.clear();
+    if(subject_bin.empty() || clip_bin.empty())
+        return;
+    Path rc;
+    rc.push_back(IntPoint(tile.left, tile.top));
+    rc.push_back(IntPoint(tile.right, tile.top));
+    rc.push_back(IntPoint(tile.right, tile.bottom));
+    rc.push_back(IntPoint(tile.left, tile.bottom));
+    Paths cut;
+    Clipper c1;
+    for(int i : subject_bin)
+        c1.AddPath(subjects.at(i), ptSubject, true);
+    c1.AddPath(rc, ptClip, true);
+    c1.Execute(ctIntersection, cut, ft, pftNonZero);
+    if(cut.empty())
+        return;
+    Clipper c2;
+    c2.AddPaths(cut, ptSubject, true);
+    for(int i : clip_bin)
+        c2.AddPath(clips.at(i), ptClip, true);
+    c2.Execute(ctIntersection, output, pftNonZero, ft);
+}
+
+/* the tiles were disjoint, so non-zero union just stitches them at the borders. */
+static void stitch_tiles(Paths& output, const clip_tile_results& tiles, int start, int count)
+{
+    output.clear();
+    Clipper c;
+    bool empty = true;
+    for(int i = start; i < start + count; i ++) {
+        if(!tiles.at(i).empty()) {
+            c.AddPaths(tiles.at(i), ptSubject, true);
+            empty = false;
+        }
+    }
+    if(!empty)
+        c.Execute(ctUnion, output, pftNonZero, pftNonZero);
+}
+
+void clip_intersect_tiled(painter_linestrips& output, const painter_paths& subjects, const painter_path& clips, clip_fill_type ft, float tile_size, int workers)
+{
+    static const int max_tiles_per_side = 64;
+    Paths subject_paths, clip_paths;
+    for(const painter_path& path : subjects) {
+        painter_linestrips lss;
+        path.get_linestrips(lss);
+        convert_to_clipper_paths(subject_paths, lss);
+    }
+    painter_linestrips clss;
+    clips.get_linestrips(clss);
+    convert_to_clipper_paths(clip_paths, clss);
+    clip_tile_bounds subject_bounds, clip_bounds;
+    clip_tile_bound sbd = calc_tile_bounds(subject_bounds, subject_paths);
+    clip_tile_bound cbd = calc_tile_bounds(clip_bounds, clip_paths);
+    /* nothing could be left outside the overlapped area of both sides */
+    clip_tile_grid grid;
+    grid.bound.left = gs_max(sbd.left, cbd.left);
+    grid.bound.top = gs_max(sbd.top, cbd.top);
+    grid.bound.right = gs_min(sbd.right, cbd.right);
+    grid.bound.bottom = gs_min(sbd.bottom, cbd.bottom);
+    if(!grid.bound.is_valid())
+        return;
+    cInt width = grid.bound.right - grid.bound.left;
+    cInt height = grid.bound.bottom - grid.bound.top;
+    grid.step = gs_max((cInt)(tile_size * int_scale_ratio), (cInt)1);
+    grid.step = gs_max(grid.step, (gs_max(width, height) + max_tiles_per_side - 1) / max_tiles_per_side);
+    grid.cols = (int)((width + grid.step - 1) / grid.step);
+    grid.rows = (int)((height + grid.step - 1) / grid.step);
+    int tiles = grid.get_tile_count();
+    assert(tiles > 0);
+    clip_tile_bins subject_bins(tiles), clip_bins(tiles);
+    bin_tile_paths(subject_bins, grid, subject_paths, subject_bounds);
+    bin_tile_paths(clip_bins, grid, clip_paths, clip_bounds);
+    clip_tile_results results(tiles), stitched_rows(grid.rows);
+    auto do_tile = [&](int i) {
+        clip_tile(results.at(i), subject_paths, subject_bins.at(i), clip_paths, clip_bins.at(i), grid.get_tile(i), (PolyFillType)ft);
+    };
+    auto stitch_row = [&](int r) { stitch_tiles(stitched_rows.at(r), results, r * grid.cols, grid.cols); };
+    if(workers <= 0)
+        workers = (int)std::thread::hardware_concurrency();
+    workers = gs_min(workers, tiles);
+    if(workers <= 1) {
+        for(int i = 0; i < tiles; i ++)
+            do_tile(i);
+        for(int r = 0; r < grid.rows; r ++)
+            stitch_row(r);
+    }
+    else {
+        thread_pool pool(workers);
+        for(int i = 0; i < tiles; i ++)
+            pool.add(do_tile, i);
+        pool.join();
+        for(int r = 0; r < grid.rows; r ++)
+            pool.add(stitch_row, r);
+        pool.join();
+    }
+    Paths out;
+    stitch_tiles(out, stitched_rows, 0, grid.rows);
+    convert_to_polygons(output, out);
+    for(painter_linestrip& ls : output)
+        ls.set_closed(true);
+}
+
 __ariel_end__
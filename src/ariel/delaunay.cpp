@@ -26,6 +26,7 @@
 #include <gslib/error.h>
 #include <gslib/utility.h>
 #include <ariel/delaunay.h>
+#include <ariel/profiler.h>
 
 __ariel_begin__
 
@@ -394,6 +395,7 @@ void delaunay_triangulation::initialize(dt_input_joints& inputs)
 
 void delaunay_triangulation::run()
 {
+    ariel_profile_scope("delaunay_triangulation::run");
     int c = (int)_sorted_joints.size();
     if(c == 0)
         return;
@@ -23,11 +23,236 @@
  * SOFTWARE.
  */
 
+#include <gslib/error.h>
 #include <ariel/dirty.h>
 
 __ariel_begin__
 
-#define max_dirty   64
+#define max_dirty           64
+#define default_draw_cost   4096    /* about a 64x64 overdraw for one more rect */
+
+enum region_op
+{
+    rgn_union,
+    rgn_intersect,
+    rgn_subtract,
+};
+
+static bool region_op_test(int op, bool in1, bool in2)
+{
+    switch(op)
+    {
+    case rgn_union:
+        return in1 || in2;
+    case rgn_intersect:
+        return in1 && in2;
+    case rgn_subtract:
+        return in1 && !in2;
+    default:
+        assert(!"unknown region op.");
+        return false;
+    }
+}
+
+static void combine_spans(dirty_region::span_list& spans, const dirty_region::span* s1, int n1, const dirty_region::span* s2, int n2, int op)
+{
+    spans.clear();
+    int i1 = 0, i2 = 0, open = 0;
+    bool in1 = false, in2 = false, in = false;
+    for(;;) {
+        /* sweep the edges in x */
+        int x1 = i1 < n1 ? (in1 ? s1[i1].right : s1[i1].left) : INT_MAX;
+        int x2 = i2 < n2 ? (in2 ? s2[i2].right : s2[i2].left) : INT_MAX;
+        int x = gs_min(x1, x2);
+        if(x == INT_MAX)
+            break;
+        if(x1 == x) {
+            if(in1)
+                i1 ++;
+            in1 = !in1;
+        }
+        if(x2 == x) {
+            if(in2)
+                i2 ++;
+            in2 = !in2;
+        }
+        bool now = region_op_test(op, in1, in2);
+        if(now == in)
+            continue;
+        in = now;
+        if(in)
+            open = x;
+        else if(x > open) {
+            if(!spans.empty() && spans.back().right == open)
+                spans.back().right = x;
+            else {
+                dirty_region::span s = { open, x };
+                spans.push_back(s);
+            }
+        }
+    }
+}
+
+void dirty_region::clear()
+{
+    _bands.clear();
+    _spans.clear();
+    _bound = rect();
+}
+
+void dirty_region::set_rect(const rect& rc)
+{
+    clear();
+    if(rc.left >= rc.right || rc.top >= rc.bottom)
+        return;
+    band b = { rc.top, rc.bottom, 0, 1 };
+    span s = { rc.left, rc.right };
+    _bands.push_back(b);
+    _spans.push_back(s);
+    _bound = rc;
+}
+
+int dirty_region::get_area() const
+{
+    int area = 0;
+    for(const band& b : _bands) {
+        for(int i = b.first; i < b.first + b.count; i ++)
+            area += (_spans.at(i).right - _spans.at(i).left) * (b.bottom - b.top);
+    }
+    return area;
+}
+
+void dirty_region::unite(const dirty_region& rgn)
+{
+    if(rgn.is_empty())
+        return;
+    if(is_empty()) {
+        *this = rgn;
+        return;
+    }
+    combine(rgn, rgn_union);
+}
+
+void dirty_region::intersect(const dirty_region& rgn)
+{
+    if(is_empty())
+        return;
+    if(rgn.is_empty() || !is_rect_intersected(_bound, rgn._bound)) {
+        clear();
+        return;
+    }
+    combine(rgn, rgn_intersect);
+}
+
+void dirty_region::subtract(const dirty_region& rgn)
+{
+    if(is_empty() || rgn.is_empty() || !is_rect_intersected(_bound, rgn._bound))
+        return;
+    combine(rgn, rgn_subtract);
+}
+
+bool dirty_region::is_intersected(const rect& rc) const
+{
+    if(rc.left >= rc.right || rc.top >= rc.bottom || !is_rect_intersected(_bound, rc))
+        return false;
+    /* the first band below the top of the rect */
+    auto f = std::upper_bound(_bands.begin(), _bands.end(), rc.top, [](int y, const band& b)->bool { return y < b.bottom; });
+    for( ; f != _bands.end() && f->top < rc.bottom; ++ f) {
+        auto first = _spans.begin() + f->first, last = first + f->count;
+        auto s = std::upper_bound(first, last, rc.left, [](int x, const span& s)->bool { return x < s.right; });
+        if(s != last && s->left < rc.right)
+            return true;
+    }
+    return false;
+}
+
+bool dirty_region::get_row_spans(int y, const span*& spans, int& count) const
+{
+    auto f = std::upper_bound(_bands.begin(), _bands.end(), y, [](int y, const band& b)->bool { return y < b.bottom; });
+    if(f == _bands.end() || f->top > y)
+        return false;
+    spans = &_spans.at(f->first);
+    count = f->count;
+    return true;
+}
+
+void dirty_region::get_rects(rect_list& rcs) const
+{
+    for_each_rect([&rcs](const rect& rc) { rcs.push_back(rc); });
+}
+
+void dirty_region::combine(const dirty_region& rgn, int op)
+{
+    dirty_region result;
+    span_list spans;
+    const band_list& b1 = _bands;
+    const band_list& b2 = rgn._bands;
+    int n1 = (int)b1.size(), n2 = (int)b2.size();
+    int i1 = 0, i2 = 0;
+    int y = gs_min(n1 ? b1.front().top : INT_MAX, n2 ? b2.front().top : INT_MAX);
+    for(;;) {
+        /* sweep the edges in y, every interval between was a band */
+        while(i1 < n1 && b1.at(i1).bottom <= y)
+            i1 ++;
+        while(i2 < n2 && b2.at(i2).bottom <= y)
+            i2 ++;
+        if(i1 >= n1 && i2 >= n2)
+            break;
+        bool in1 = i1 < n1 && b1.at(i1).top <= y;
+        bool in2 = i2 < n2 && b2.at(i2).top <= y;
+        int next = INT_MAX;
+        if(i1 < n1)
+            next = gs_min(next, in1 ? b1.at(i1).bottom : b1.at(i1).top);
+        if(i2 < n2)
+            next = gs_min(next, in2 ? b2.at(i2).bottom : b2.at(i2).top);
+        if(in1 || in2) {
+            const span* s1 = in1 ? &_spans.at(b1.at(i1).first) : nullptr;
+            const span* s2 = in2 ? &rgn._spans.at(b2.at(i2).first) : nullptr;
+            combine_spans(spans, s1, in1 ? b1.at(i1).count : 0, s2, in2 ? b2.at(i2).count : 0, op);
+            result.append_band(y, next, spans);
+        }
+        y = next;
+    }
+    result.update_bound();
+    _bands.swap(result._bands);
+    _spans.swap(result._spans);
+    _bound = result._bound;
+}
+
+void dirty_region::append_band(int top, int bottom, const span_list& spans)
+{
+    if(spans.empty() || top >= bottom)
+        return;
+    if(!_bands.empty()) {
+        /* coalesce with the band above of the same spans */
+        band& last = _bands.back();
+        if(last.bottom == top && last.count == (int)spans.size() &&
+            std::equal(spans.begin(), spans.end(), _spans.begin() + last.first, [](const span& s1, const span& s2)->bool { return s1.left == s2.left && s1.right == s2.right; })
+            ) {
+            last.bottom = bottom;
+            return;
+        }
+    }
+    band b = { top, bottom, (int)_spans.size(), (int)spans.size() };
+    _bands.push_back(b);
+    _spans.insert(_spans.end(), spans.begin(), spans.end());
+}
+
+void dirty_region::update_bound()
+{
+    if(_bands.empty()) {
+        _bound = rect();
+        return;
+    }
+    _bound.top = _bands.front().top;
+    _bound.bottom = _bands.back().bottom;
+    _bound.left = INT_MAX;
+    _bound.right = INT_MIN;
+    for(const band& b : _bands) {
+        _bound.left = gs_min(_bound.left, _spans.at(b.first).left);
+        _bound.right = gs_max(_bound.right, _spans.at(b.first + b.count - 1).right);
+    }
+}
 
 dirty_list::dirty_list()
 {
@@ -35,6 +260,7 @@ dirty_list::dirty_list()
     _height = 0;
     _whole = false;
     _cap = max_dirty;
+    _draw_cost = default_draw_cost;
 }
 
 dirty_list::dirty_list(int w, int h)
@@ -43,11 +269,12 @@ dirty_list::dirty_list(int w, int h)
     _height = h;
     _whole = false;
     _cap = max_dirty;
+    _draw_cost = default_draw_cost;
 }
 
 void dirty_list::clear()
 {
-    _rclist.clear();
+    _region.clear();
     _whole = false;
 }
 
@@ -60,39 +287,39 @@ void dirty_list::set_dimension(int w, int h)
 
 void dirty_list::add(rect rc)
 {
-    if(_whole || rc.left >= _width || rc.top >= _height ||
-        rc.left >= rc.right || rc.top >= rc.bottom
-        )
+    if(_whole)
         return;
 
-    if((int)_rclist.size() == _cap) {
-        _whole = true;
-        return;
-    }
+    rc.left = gs_max(rc.left, 0);
+    rc.top = gs_max(rc.top, 0);
+    rc.right = gs_min(rc.right, _width);
+    rc.bottom = gs_min(rc.bottom, _height);
 
-    if(rc.right > _width)
-        rc.right = _width;
-    if(rc.bottom > _height)
-        rc.bottom = _height;
+    /* nothing left in the screen */
+    if(rc.left >= rc.right || rc.top >= rc.bottom)
+        return;
 
-    for(iterator i = _rclist.begin(); i != _rclist.end(); ++ i) {
-        /* inside the rect */
-        if(rc.left >= i->left && rc.top >= i->top && rc.right <= i->right &&
-            rc.bottom <= i->bottom
-            )
-            return;
-        /* intersect */
-        if(is_rect_intersected(rc, *i)) {
-            rect rc1;
-            union_rect(rc1, rc, *i);
-            _rclist.erase(i);
-            add(rc1);
-            return;
+    /* merge with the rect nearby which saved the most */
+    rect merged = rc;
+    int best = 0;
+    _region.for_each_rect([&](const rect& q) {
+        rect u, i;
+        union_rect(u, q, rc);
+        int overlap = intersect_rect(i, q, rc) ? i.area() : 0;
+        int overdraw = u.area() - q.area() - rc.area() + overlap;
+        int saved = _draw_cost - overdraw;
+        if(saved > best) {
+            best = saved;
+            merged = u;
         }
-    }
+    });
+    _region.unite(merged);
 
-    /* no intersection */
-    _rclist.push_back(rc);
+    /* too fragmented, fall back to the bound, copied since the region was cleared first */
+    if(_region.get_rect_count() > _cap) {
+        rect bound = _region.get_bound();
+        _region.set_rect(bound);
+    }
 }
 
 bool dirty_list::is_dirty(const rect& rc) const
@@ -105,12 +332,16 @@ bool dirty_list::is_dirty(const rect& rc) const
     if(_whole)
         return true;
 
-    for(const_iterator i = _rclist.begin(); i != _rclist.end(); ++ i) {
-        if(is_rect_intersected(rc, *i))
-            return true;
-    }
+    return _region.is_intersected(rc);
+}
 
-    return false;
+void dirty_list::get_rects(rect_list& rcs) const
+{
+    if(_whole) {
+        rcs.push_back(rect(0, 0, _width, _height));
+        return;
+    }
+    _region.get_rects(rcs);
 }
 
 __ariel_end__
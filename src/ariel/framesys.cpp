@@ -27,133 +27,432 @@
 #include <ariel/rendersysd3d11.h>
 #include <ariel/scene.h>
 #include <ariel/rose.h>
+#include <ariel/profiler.h>
 #include <gslib/dvt.h>
 
 __ariel_begin__
 
-void frame_dispatcher::on_show(bool b)
+bool frame_message::from_event(const frame_event& event)
+{
+    id = event.get_id();
+    time = 0;
+    switch(id)
+    {
+    case feid_draw:
+    case feid_close:
+    case feid_halt:
+    case feid_resume:
+        return true;
+    case feid_timer:
+        timer.timerid = static_cast<const frame_timer_event&>(event).timerid;
+        return true;
+    case feid_paint:
+        set_boundary(static_cast<const frame_paint_event&>(event).boundary);
+        return true;
+    case feid_resize:
+        set_boundary(static_cast<const frame_resize_event&>(event).boundary);
+        return true;
+    case feid_show:
+        visibility.show = static_cast<const frame_show_event&>(event).show;
+        return true;
+    case feid_create:
+        {
+            auto& e = static_cast<const frame_create_event&>(event);
+            set_boundary(e.boundary);
+            create.driver = e.driver;
+            return true;
+        }
+    case feid_mouse_down:
+        {
+            auto& e = static_cast<const frame_mouse_down_event&>(event);
+            mouse.modifier = e.modifier;
+            mouse.key = e.key;
+            set_position(e.position);
+            return true;
+        }
+    case feid_mouse_up:
+        {
+            auto& e = static_cast<const frame_mouse_up_event&>(event);
+            mouse.modifier = e.modifier;
+            mouse.key = e.key;
+            set_position(e.position);
+            return true;
+        }
+    case feid_mouse_move:
+        {
+            auto& e = static_cast<const frame_mouse_move_event&>(event);
+            mouse.modifier = e.modifier;
+            mouse.key = uk_null;
+            set_position(e.position);
+            return true;
+        }
+    case feid_key_down:
+        {
+            auto& e = static_cast<const frame_key_down_event&>(event);
+            keyboard.modifier = e.modifier;
+            keyboard.key = e.key;
+            return true;
+        }
+    case feid_key_up:
+        {
+            auto& e = static_cast<const frame_key_up_event&>(event);
+            keyboard.modifier = e.modifier;
+            keyboard.key = e.key;
+            return true;
+        }
+    case feid_char:
+        {
+            auto& e = static_cast<const frame_char_event&>(event);
+            input.modifier = e.modifier;
+            input.charactor = e.charactor;
+            return true;
+        }
+    default:
+        return false;
+    }
+}
+
+/* the listeners knowing nothing about the messages got the events as before. */
+bool frame_listener::on_frame_message(const frame_message& msg)
+{
+    switch(msg.id)
+    {
+    case feid_draw:
+        {
+            frame_event_table<feid_draw>::type event;
+            return on_frame_event(event);
+        }
+    case feid_timer:
+        {
+            frame_event_table<feid_timer>::type event;
+            event.timerid = msg.timer.timerid;
+            return on_frame_event(event);
+        }
+    case feid_paint:
+        {
+            frame_event_table<feid_paint>::type event;
+            event.boundary = msg.get_boundary();
+            return on_frame_event(event);
+        }
+    case feid_mouse_down:
+        {
+            frame_event_table<feid_mouse_down>::type event;
+            event.modifier = msg.mouse.modifier;
+            event.key = msg.mouse.key;
+            event.position = msg.get_position();
+            return on_frame_event(event);
+        }
+    case feid_mouse_up:
+        {
+            frame_event_table<feid_mouse_up>::type event;
+            event.modifier = msg.mouse.modifier;
+            event.key = msg.mouse.key;
+            event.position = msg.get_position();
+            return on_frame_event(event);
+        }
+    case feid_mouse_move:
+        {
+            frame_event_table<feid_mouse_move>::type event;
+            event.modifier = msg.mouse.modifier;
+            event.position = msg.get_position();
+            return on_frame_event(event);
+        }
+    case feid_key_down:
+        {
+            frame_event_table<feid_key_down>::type event;
+            event.modifier = msg.keyboard.modifier;
+            event.key = msg.keyboard.key;
+            return on_frame_event(event);
+        }
+    case feid_key_up:
+        {
+            frame_event_table<feid_key_up>::type event;
+            event.modifier = msg.keyboard.modifier;
+            event.key = msg.keyboard.key;
+            return on_frame_event(event);
+        }
+    case feid_char:
+        {
+            frame_event_table<feid_char>::type event;
+            event.modifier = msg.input.modifier;
+            event.charactor = msg.input.charactor;
+            return on_frame_event(event);
+        }
+    case feid_show:
+        {
+            frame_event_table<feid_show>::type event;
+            event.show = msg.visibility.show;
+            return on_frame_event(event);
+        }
+    case feid_create:
+        {
+            frame_event_table<feid_create>::type event;
+            event.driver = msg.create.driver;
+            event.boundary = msg.get_boundary();
+            return on_frame_event(event);
+        }
+    case feid_close:
+        {
+            frame_event_table<feid_close>::type event;
+            return on_frame_event(event);
+        }
+    case feid_resize:
+        {
+            frame_event_table<feid_resize>::type event;
+            event.boundary = msg.get_boundary();
+            return on_frame_event(event);
+        }
+    case feid_halt:
+        {
+            frame_event_table<feid_halt>::type event;
+            return on_frame_event(event);
+        }
+    case feid_resume:
+        {
+            frame_event_table<feid_resume>::type event;
+            return on_frame_event(event);
+        }
+    default:
+        assert(!"unexpected message.");
+        return false;
+    }
+}
+
+void frame_listener::on_frame_messages(const frame_message msgs[], int count)
+{
+    for(int i = 0; i < count; i ++)
+        on_frame_message(msgs[i]);
+}
+
+bool frame_message_queue::post(const frame_message& msg)
+{
+    if(_tail != _sealed) {
+        frame_message& last = _messages[(_tail - 1) & (capacity - 1)];
+        if(last.id == msg.id) {
+            /* the time of the first one was kept to tell the latency. */
+            if(msg.id == feid_mouse_move && last.mouse.modifier == msg.mouse.modifier) {
+                last.mouse.x = msg.mouse.x;
+                last.mouse.y = msg.mouse.y;
+                ariel_profile_counter(pci_events_coalesced, 1);
+                return false;
+            }
+            if(msg.id == feid_paint) {
+                last.boundary.left = gs_min(last.boundary.left, msg.boundary.left);
+                last.boundary.top = gs_min(last.boundary.top, msg.boundary.top);
+                last.boundary.right = gs_max(last.boundary.right, msg.boundary.right);
+                last.boundary.bottom = gs_max(last.boundary.bottom, msg.boundary.bottom);
+                ariel_profile_counter(pci_events_coalesced, 1);
+                return false;
+            }
+        }
+    }
+    if(is_full()) {
+        _dropped ++;
+        return false;
+    }
+    _messages[_tail & (capacity - 1)] = msg;
+    _tail ++;
+    return true;
+}
+
+/* delivered in the contiguous spans, the head was advanced after each span so that the handlers could post. */
+void frame_message_queue::deliver(frame_listener* listener)
+{
+    assert(listener);
+    if(_delivering || is_empty())
+        return;
+    ariel_profile_scope("frame_message_queue::deliver");
+    auto* prof = profiler::get_singleton_ptr();
+    int64 start = prof->get_time();
+    _delivering = true;
+    _sealed = _tail;
+    int delivered = 0;
+    int64 latency = 0;
+    while(_head != _sealed) {
+        uint i = _head & (capacity - 1);
+        int n = (int)gs_min(_sealed - _head, (uint)capacity - i);
+        for(int j = 0; j < n; j ++)
+            latency += start - _messages[i + j].time;
+        listener->on_frame_messages(_messages + i, n);
+        _head += n;
+        delivered += n;
+    }
+    _delivering = false;
+    ariel_profile_counter(pci_events, delivered);
+    ariel_profile_counter(pci_event_latency, latency);
+    ariel_profile_counter(pci_event_cost, prof->get_time() - start);
+}
+
+void frame_dispatcher::post(frame_message& msg)
+{
+    msg.time = profiler::get_singleton_ptr()->get_time();
+    if(_queue.is_full())
+        framesys::get_framesys()->dispatch_messages();
+    _queue.post(msg);
+}
+
+/* the pending ones went first to keep the order. */
+void frame_dispatcher::post_immediately(frame_message& msg)
+{
+    post(msg);
+    framesys::get_framesys()->dispatch_messages();
+}
+
+void frame_dispatcher::deliver()
 {
-    frame_event_table<feid_show>::type event;
-    event.show = b;
     assert(_listener);
-    _listener->on_frame_event(event);
+    _queue.deliver(_listener);
+}
+
+void frame_dispatcher::on_show(bool b)
+{
+    frame_message msg;
+    msg.id = feid_show;
+    msg.visibility.show = b;
+    post_immediately(msg);
 }
 
 void frame_dispatcher::on_create(system_driver* ptr, const rect& rc)
 {
-    frame_event_table<feid_create>::type event;
-    event.driver = ptr;
-    event.boundary = rc;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_create;
+    msg.set_boundary(rc);
+    msg.create.driver = ptr;
+    post_immediately(msg);
 }
 
 void frame_dispatcher::on_close()
 {
-    frame_event_table<feid_close>::type event;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    framesys::get_framesys()->_pipeline.stop();
+    frame_message msg;
+    msg.id = feid_close;
+    post_immediately(msg);
 }
 
 void frame_dispatcher::on_resize(const rect& rc)
 {
-    frame_event_table<feid_resize>::type event;
-    event.boundary = rc;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    framesys::get_framesys()->flush_frames();
+    frame_message msg;
+    msg.id = feid_resize;
+    msg.set_boundary(rc);
+    post_immediately(msg);
 }
 
+/*
+ * The idle frames never ran in the modal loops of the system, e.g. the live resizing, so the paints were delivered
+ * at once rather than left to the next frame, the paint queued before was still merged with it.
+ */
 void frame_dispatcher::on_paint(const rect& rc)
 {
-    frame_event_table<feid_paint>::type event;
-    event.boundary = rc;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_paint;
+    msg.set_boundary(rc);
+    post_immediately(msg);
 }
 
 void frame_dispatcher::on_halt()
 {
-    frame_event_table<feid_halt>::type event;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_halt;
+    post_immediately(msg);
 }
 
 void frame_dispatcher::on_resume()
 {
-    frame_event_table<feid_resume>::type event;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_resume;
+    post_immediately(msg);
 }
 
+/* the input was queued till the next frame, so it was always taken. */
 bool frame_dispatcher::on_mouse_down(uint um, unikey uk, const point& pt)
 {
-    frame_event_table<feid_mouse_down>::type event;
-    event.modifier = um;
-    event.key = uk;
-    event.position = pt;
-    assert(_listener);
-    return _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_mouse_down;
+    msg.mouse.modifier = um;
+    msg.mouse.key = uk;
+    msg.set_position(pt);
+    post(msg);
+    return true;
 }
 
 bool frame_dispatcher::on_mouse_up(uint um, unikey uk, const point& pt)
 {
-    frame_event_table<feid_mouse_up>::type event;
-    event.modifier = um;
-    event.key = uk;
-    event.position = pt;
-    assert(_listener);
-    return _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_mouse_up;
+    msg.mouse.modifier = um;
+    msg.mouse.key = uk;
+    msg.set_position(pt);
+    post(msg);
+    return true;
 }
 
 bool frame_dispatcher::on_mouse_move(uint um, const point& pt)
 {
-    frame_event_table<feid_mouse_move>::type event;
-    event.modifier = um;
-    event.position = pt;
-    assert(_listener);
-    return _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_mouse_move;
+    msg.mouse.modifier = um;
+    msg.mouse.key = uk_null;
+    msg.set_position(pt);
+    post(msg);
+    return true;
 }
 
 bool frame_dispatcher::on_key_down(uint um, unikey uk)
 {
-    frame_event_table<feid_key_down>::type event;
-    event.modifier = um;
-    event.key = uk;
-    assert(_listener);
-    return _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_key_down;
+    msg.keyboard.modifier = um;
+    msg.keyboard.key = uk;
+    post(msg);
+    return true;
 }
 
 bool frame_dispatcher::on_key_up(uint um, unikey uk)
 {
-    frame_event_table<feid_key_up>::type event;
-    event.modifier = um;
-    event.key = uk;
-    assert(_listener);
-    return _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_key_up;
+    msg.keyboard.modifier = um;
+    msg.keyboard.key = uk;
+    post(msg);
+    return true;
 }
 
 bool frame_dispatcher::on_char(uint um, uint ch)
 {
-    frame_event_table<feid_char>::type event;
-    event.modifier = um;
-    event.charactor = ch;
-    assert(_listener);
-    return _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_char;
+    msg.input.modifier = um;
+    msg.input.charactor = ch;
+    post(msg);
+    return true;
 }
 
 void frame_dispatcher::on_timer(uint tid)
 {
-    frame_event_table<feid_timer>::type event;
-    event.timerid = tid;
-    assert(_listener);
-    _listener->on_frame_event(event);
+    frame_message msg;
+    msg.id = feid_timer;
+    msg.timer.timerid = tid;
+    post(msg);
 }
 
 void frame_dispatcher::do_draw()
 {
-    frame_event_table<feid_draw>::type event;
+    frame_message msg;
+    msg.id = feid_draw;
+    msg.time = 0;
     assert(_listener);
-    _listener->on_frame_event(event);
+    _listener->on_frame_message(msg);
+}
+
+void frame_dispatcher::fire_timer(uint tid)
+{
+    frame_message msg;
+    msg.id = feid_timer;
+    msg.time = profiler::get_singleton_ptr()->get_time();
+    msg.timer.timerid = tid;
+    assert(_listener);
+    _listener->on_frame_message(msg);
 }
 
 void frame_dispatcher::on_frame_start()
@@ -181,6 +480,7 @@ framesys::framesys()
 
 framesys::~framesys()
 {
+    _pipeline.stop();
     if(_rose) {
         delete _rose;
         _rose = nullptr;
@@ -208,6 +508,7 @@ void framesys::initialize(const rect& rc)
 
 void framesys::refresh()
 {
+    flush_frames();
     _dispatcher.do_draw();
 }
 
@@ -222,20 +523,479 @@ void framesys::set_frame_strategy(frame_strategy stt)
     case fs_lazy_passive:
         _empty_frame_proc = &framesys::empty_frame_lazy;
         break;
+    case fs_pipelined:
+        _empty_frame_proc = &framesys::empty_frame_pipelined;
+        break;
     }
+    if(stt != fs_pipelined)
+        _pipeline.stop();
+    _last_frame_valid = false;
+}
+
+void framesys::get_frame_stats(frame_stats& st)
+{
+    st = _stats;
+    _pipeline.get_submit_histogram(st.submit);
+}
+
+void framesys::reset_frame_stats()
+{
+    _stats.record.reset();
+    _stats.submit.reset();
+    _stats.stall.reset();
+    _stats.interval.reset();
+    _pipeline.reset_submit_histogram();
+    _last_frame_valid = false;
+}
+
+void framesys::tracing_frame_stats()
+{
+    frame_stats st;
+    get_frame_stats(st);
+    st.record.tracing(_t("record"));
+    st.submit.tracing(_t("submit"));
+    st.stall.tracing(_t("stall"));
+    st.interval.tracing(_t("interval"));
+}
+
+void framesys::on_frame_started()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(_last_frame_valid)
+        _stats.interval.add(std::chrono::duration<double, std::milli>(now - _last_frame).count());
+    _last_frame = now;
+    _last_frame_valid = true;
+}
+
+/* the paints drew on the immediate context unless they were recorded into the command list. */
+void framesys::dispatch_messages()
+{
+    auto* rsys = static_cast<rendersys_d3d11*>(_rendersys);
+    if(rsys && !rsys->is_recording())
+        flush_frames();
+    _dispatcher.deliver();
+}
+
+/* the timers due were all fired in the tick, the ones killed by the callbacks before were skipped. */
+void framesys::fire_timers()
+{
+    if(_timers.is_empty())
+        return;
+    auto& fired = _timers.advance(get_ticks());
+    for(int i = 0; i < (int)fired.size(); i ++) {
+        uint tid = fired.at(i);
+        if(_timers.is_alive(tid))
+            _dispatcher.fire_timer(tid);
+    }
+    arm_system_timer();
+}
+
+int framesys::get_idle_timeout() const
+{
+    if(_strategy != fs_lazy_passive || _dispatcher.has_pending())
+        return 0;
+    int64 next = _timers.get_next_deadline();
+    if(next < 0)
+        return -1;
+    return (int)gs_clamp(next - get_ticks(), (int64)0, (int64)INT_MAX);
 }
 
 void framesys::empty_frame_lazy()
 {
+    dispatch_messages();
+    fire_timers();
     dvt_collector::get_singleton_ptr()->cleanup();
 }
 
 void framesys::empty_frame_busy()
 {
+    on_frame_started();
+    auto start = std::chrono::steady_clock::now();
+    profiler::get_singleton_ptr()->begin_frame();
+    dispatch_messages();
+    fire_timers();
     _dispatcher.on_frame_start();
     _dispatcher.do_draw();
     _dispatcher.on_frame_end();
+    profiler::get_singleton_ptr()->end_frame();
+    _stats.record.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     dvt_collector::get_singleton_ptr()->cleanup();
 }
 
+/*
+ * Same as the busy loop except that the frame went into a command list, the painting, the tessellation & the
+ * batching were still done in the recording, which overlapped the submission of the frames before.
+ */
+void framesys::empty_frame_pipelined()
+{
+    auto* rsys = static_cast<rendersys_d3d11*>(_rendersys);
+    assert(rsys);
+    if(!_pipeline.start(rsys)) {
+        empty_frame_busy();
+        return;
+    }
+    _stats.stall.add(_pipeline.acquire());
+    if(!rsys->begin_command_list()) {
+        _pipeline.flush();
+        empty_frame_busy();
+        return;
+    }
+    on_frame_started();
+    auto start = std::chrono::steady_clock::now();
+    profiler::get_singleton_ptr()->begin_frame();
+    dispatch_messages();
+    fire_timers();
+    _dispatcher.on_frame_start();
+    _dispatcher.do_draw();
+    _dispatcher.on_frame_end();
+    _pipeline.submit(rsys->end_command_list());
+    profiler::get_singleton_ptr()->end_frame();
+    _stats.record.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    dvt_collector::get_singleton_ptr()->cleanup();
+}
+
+void frame_histogram::reset()
+{
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    total = 0.0;
+    peak = 0.0;
+}
+
+void frame_histogram::add(double ms)
+{
+    int i = 0;
+    while(i < bucket_count - 1 && ms >= get_bucket_bound(i))
+        i ++;
+    buckets[i] ++;
+    count ++;
+    total += ms;
+    peak = gs_max(peak, ms);
+}
+
+double frame_histogram::get_percentile(float p) const
+{
+    if(!count)
+        return 0.0;
+    int target = (int)ceil(gs_clamp(p, 0.f, 1.f) * count);
+    int sum = 0;
+    for(int i = 0; i < bucket_count - 1; i ++) {
+        sum += buckets[i];
+        if(sum >= target)
+            return get_bucket_bound(i);
+    }
+    return peak;
+}
+
+void frame_histogram::tracing(const gchar* name) const
+{
+    trace(_t("frame %s: %d frames, avg %.2fms, p50 %.2fms, p95 %.2fms, p99 %.2fms, peak %.2fms;\n"), name, count, get_average(),
+        get_percentile(0.5f), get_percentile(0.95f), get_percentile(0.99f), peak
+        );
+    for(int i = 0; i < bucket_count; i ++) {
+        if(buckets[i])
+            trace(_t("    < %.2fms: %d\n"), i < bucket_count - 1 ? get_bucket_bound(i) : peak, buckets[i]);
+    }
+}
+
+bool frame_pipeline::start(rendersys_d3d11* rsys)
+{
+    if(is_running())
+        return true;
+    assert(rsys);
+    _rsys = rsys;
+    _stop = false;
+    _thread = std::thread([this]() { run(); });
+    return is_running();
+}
+
+/* the frames in flight were all presented before the thread quit. */
+void frame_pipeline::stop()
+{
+    if(!is_running())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv_submit.notify_all();
+    _thread.join();
+    assert(_lists.empty() && !_in_flight);
+}
+
+void frame_pipeline::flush()
+{
+    if(!is_running())
+        return;
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cv_done.wait(lock, [this]() { return !_in_flight; });
+}
+
+double frame_pipeline::acquire()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cv_done.wait(lock, [this]() { return _in_flight < _max_latency; });
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void frame_pipeline::submit(render_command_list* cl)
+{
+    assert(is_running());
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _lists.push_back(cl);
+        _in_flight ++;
+    }
+    _cv_submit.notify_one();
+}
+
+void frame_pipeline::set_max_latency(int frames)
+{
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _max_latency = gs_clamp(frames, 1, 3);
+    }
+    _cv_done.notify_all();
+}
+
+void frame_pipeline::get_submit_histogram(frame_histogram& hist)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    hist = _submit;
+}
+
+void frame_pipeline::reset_submit_histogram()
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    _submit.reset();
+}
+
+void frame_pipeline::run()
+{
+    for(;;) {
+        render_command_list* cl = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cv_submit.wait(lock, [this]() { return _stop || !_lists.empty(); });
+            if(_lists.empty())
+                return;
+            cl = _lists.front();
+            _lists.pop_front();
+        }
+        auto start = std::chrono::steady_clock::now();
+        assert(_rsys);
+        {
+            ariel_profile_scope("frame_pipeline::present");
+            _rsys->execute_command_list(cl, true);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _submit.add(ms);
+            _in_flight --;
+        }
+        _cv_done.notify_all();
+    }
+}
+
+frame_timer_wheel::frame_timer_wheel()
+{
+    for(auto& s : _slots)
+        s = -1;
+}
+
+/* a power of 2 within the slack was taken as the granularity, so that the deadlines of the timers coincided. */
+int64 frame_timer_wheel::get_deadline(int64 now, int elapse) const
+{
+    elapse = gs_max(elapse, 1);
+    int slack = gs_min(_slack, elapse / 4);
+    int64 g = 1;
+    while(g * 2 <= slack)
+        g *= 2;
+    return (now + elapse + g - 1) & ~(g - 1);
+}
+
+void frame_timer_wheel::set_timer(uint tid, int elapse, int64 now)
+{
+    if(_map.empty())
+        _current = now;
+    int i;
+    auto f = _map.find(tid);
+    if(f != _map.end()) {
+        i = f->second;
+        unlink(i);
+    }
+    else {
+        if(_free >= 0) {
+            i = _free;
+            _free = _entries.at(i).next;
+        }
+        else {
+            i = (int)_entries.size();
+            _entries.push_back(entry());
+        }
+        _map.emplace(tid, i);
+    }
+    entry& e = _entries.at(i);
+    e.id = tid;
+    e.elapse = elapse;
+    e.deadline = get_deadline(now, elapse);
+    link(i);
+}
+
+void frame_timer_wheel::kill_timer(uint tid)
+{
+    auto f = _map.find(tid);
+    if(f == _map.end())
+        return;
+    int i = f->second;
+    _map.erase(f);
+    unlink(i);
+    _entries.at(i).next = _free;
+    _free = i;
+}
+
+/* the ones beyond the wheel were put in the last level and cascaded down again. */
+void frame_timer_wheel::link(int i)
+{
+    entry& e = _entries.at(i);
+    int64 d = gs_max(e.deadline, _current);
+    int64 delta = d - _current;
+    int level = 0;
+    while(level < level_count - 1 && delta >= ((int64)1 << (slot_bits * (level + 1))))
+        level ++;
+    if(delta >= ((int64)1 << (slot_bits * level_count)))
+        d = _current + ((int64)1 << (slot_bits * level_count)) - 1;
+    int slot = level * slot_count + (int)((d >> (slot_bits * level)) & slot_mask);
+    e.slot = slot;
+    e.prev = -1;
+    e.next = _slots[slot];
+    if(e.next >= 0)
+        _entries.at(e.next).prev = i;
+    _slots[slot] = i;
+}
+
+void frame_timer_wheel::unlink(int i)
+{
+    entry& e = _entries.at(i);
+    if(e.slot < 0)
+        return;
+    if(e.prev >= 0)
+        _entries.at(e.prev).next = e.next;
+    else
+        _slots[e.slot] = e.next;
+    if(e.next >= 0)
+        _entries.at(e.next).prev = e.prev;
+    e.slot = e.prev = e.next = -1;
+}
+
+/*
+ * The slot of level 0 was fired at its tick, the slot of a level above was cascaded at the first tick of its range,
+ * the empty ones in between were skipped at once.
+ */
+int64 frame_timer_wheel::get_next_tick() const
+{
+    int64 next = -1;
+    for(int level = 0; level < level_count; level ++) {
+        int shift = slot_bits * level;
+        int64 unit = (int64)1 << shift;
+        int64 base = (_current + unit - 1) & ~(unit - 1);
+        int start = (int)((base >> shift) & slot_mask);
+        for(int j = 0; j < slot_count; j ++) {
+            if(_slots[level * slot_count + ((start + j) & slot_mask)] < 0)
+                continue;
+            int64 t = base + j * unit;
+            if(next < 0 || t < next)
+                next = t;
+            break;
+        }
+    }
+    return next;
+}
+
+/* returns the index of the level, the next level cascaded on 0. */
+int frame_timer_wheel::cascade(int level)
+{
+    int index = (int)((_current >> (slot_bits * level)) & slot_mask);
+    int slot = level * slot_count + index;
+    int i = _slots[slot];
+    _slots[slot] = -1;
+    while(i >= 0) {
+        int next = _entries.at(i).next;
+        _entries.at(i).slot = -1;
+        link(i);
+        i = next;
+    }
+    return index;
+}
+
+const frame_timer_wheel::fired_list& frame_timer_wheel::advance(int64 now)
+{
+    _fired.clear();
+    if(_map.empty()) {
+        _current = now + 1;
+        return _fired;
+    }
+    for(;;) {
+        int64 tick = get_next_tick();
+        if(tick < 0 || tick > now) {
+            _current = now + 1;
+            break;
+        }
+        _current = tick;
+        int index = (int)(_current & slot_mask);
+        if(!index) {
+            for(int level = 1; level < level_count; level ++) {
+                if(cascade(level))
+                    break;
+            }
+        }
+        int i = _slots[index];
+        _slots[index] = -1;
+        while(i >= 0) {
+            entry& e = _entries.at(i);
+            int next = e.next;
+            e.slot = -1;
+            _fired.push_back(e.id);
+            /* rescheduled from now rather than the deadline, so that a late tick never fired the timers in bursts. */
+            e.deadline = get_deadline(now, e.elapse);
+            i = next;
+        }
+        _current ++;
+    }
+    for(uint tid : _fired) {
+        auto f = _map.find(tid);
+        assert(f != _map.end());
+        link(f->second);
+    }
+    return _fired;
+}
+
+/* the first slot occupied in each level held the earliest deadlines of the level. */
+int64 frame_timer_wheel::get_next_deadline() const
+{
+    if(_map.empty())
+        return -1;
+    int64 next = -1;
+    for(int level = 0; level < level_count; level ++) {
+        int start = (int)((_current >> (slot_bits * level)) & slot_mask);
+        /* the slot of the current tick was cascaded already unless it started right at the tick. */
+        if(level > 0 && (_current & (((int64)1 << (slot_bits * level)) - 1)))
+            start ++;
+        for(int j = 0; j < slot_count; j ++) {
+            int i = _slots[level * slot_count + ((start + j) & slot_mask)];
+            if(i < 0)
+                continue;
+            for(; i >= 0; i = _entries.at(i).next) {
+                int64 d = _entries.at(i).deadline;
+                if(next < 0 || d < next)
+                    next = d;
+            }
+            break;
+        }
+    }
+    return next;
+}
+
 __ariel_end__
@@ -79,6 +79,8 @@ static LOGFONT              __frame_immfont;
 static cursor_manager       __cursor_manager;
 static HCURSOR              __frame_cursor = 0;
 
+static const UINT_PTR       frame_system_timer_id = 0xf7a3e001;
+
 int framesys::run()
 {
     MSG msg = { 0 };
@@ -91,6 +93,10 @@ int framesys::run()
             framesys* frmsys = framesys::get_framesys();
             assert(frmsys);
             frmsys->idle();
+            /* the lazy one slept till the next message or the next deadline of the timers. */
+            int timeout = frmsys->get_idle_timeout();
+            if(timeout != 0)
+                MsgWaitForMultipleObjects(0, nullptr, FALSE, timeout < 0 ? INFINITE : (DWORD)timeout, QS_ALLINPUT);
         }
     }
     return (int)msg.wParam;
@@ -132,16 +138,48 @@ void framesys::close()
     }
 }
 
+/* the timers were kept in the wheel rather than one per id by the system, fired in the idle ticks. */
 void framesys::set_timer(uint tid, int t)
 {
-    assert(__frame_hwnd);
-    SetTimer(__frame_hwnd, tid, t, 0);
+    _timers.set_timer(tid, t, get_ticks());
+    arm_system_timer();
 }
 
 void framesys::kill_timer(uint tid)
 {
-    assert(__frame_hwnd);
-    KillTimer(__frame_hwnd, tid);
+    _timers.kill_timer(tid);
+    arm_system_timer();
+}
+
+/*
+ * The idle ticks were never reached in the modal loops of the system, e.g. moving, sizing or the menus, so one system
+ * timer was kept for the next deadline of the wheel, it was re-armed only when the deadline changed.
+ */
+void framesys::arm_system_timer()
+{
+    if(!__frame_hwnd)
+        return;
+    int64 next = _timers.get_next_deadline();
+    if(next == _system_deadline)
+        return;
+    _system_deadline = next;
+    if(next < 0) {
+        KillTimer(__frame_hwnd, frame_system_timer_id);
+        return;
+    }
+    int64 elapse = gs_clamp(next - get_ticks(), (int64)USER_TIMER_MINIMUM, (int64)USER_TIMER_MAXIMUM);
+    SetTimer(__frame_hwnd, frame_system_timer_id, (UINT)elapse, 0);
+}
+
+/* the system timer was periodic, killed here and re-armed for the deadline next to the ones fired. */
+void framesys::on_system_timer()
+{
+    if(!__frame_hwnd)
+        return;
+    KillTimer(__frame_hwnd, frame_system_timer_id);
+    _system_deadline = -1;
+    fire_timers();
+    arm_system_timer();
 }
 
 void framesys::update()
@@ -339,7 +377,10 @@ static LRESULT __stdcall frame_window_proc(HWND hwnd, UINT msg, WPARAM wparam, L
     {
     case WM_TIMER:
         {
-            get_frame_notify()->on_timer((uint)wparam);
+            if(wparam == frame_system_timer_id)
+                framesys::get_framesys()->on_system_timer();
+            else
+                get_frame_notify()->on_timer((uint)wparam);
             break;
         }
     case WM_PAINT:
@@ -84,6 +84,7 @@ void fsys_dwrite::initialize()
 
 void fsys_dwrite::set_font(const font& ft)
 {
+    _font = ft;
     if(ft.sysfont) {
         _current_font = (IDWriteTextFormat*)ft.sysfont;
         return;
@@ -142,6 +143,49 @@ bool fsys_dwrite::query_size(const gchar* str, int& w, int& h, int len)
     return true;
 }
 
+/* the pen positions were summed up by the clusters, all the chars of a cluster were at its start. */
+bool fsys_dwrite::query_advances(vector<float>& xs, const gchar* str, int len)
+{
+    xs.clear();
+#if !defined(UNICODE) && !defined(_UNICODE)
+    /* the clusters were counted in utf-16, which did not match the multibyte chars. */
+    return false;
+#else
+    if(!str || !_current_font)
+        return false;
+    if(len < 0)
+        len = strtool::length(str);
+    assert(_dwfactory);
+    xs.resize(len + 1, 0.f);
+    if(!len)
+        return true;
+    com_ptr<IDWriteTextLayout> splayout;
+    _dwfactory->CreateTextLayout(str, len, _current_font, FLT_MAX, FLT_MAX, &splayout);
+    if(!splayout) {
+        xs.clear();
+        return false;
+    }
+    splayout->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
+    UINT32 count = 0;
+    splayout->GetClusterMetrics(nullptr, 0, &count);
+    vector<DWRITE_CLUSTER_METRICS> clusters(count);
+    if(!count || FAILED(splayout->GetClusterMetrics(&clusters.front(), count, &count))) {
+        xs.clear();
+        return false;
+    }
+    float x = 0.f;
+    int i = 0;
+    for(const DWRITE_CLUSTER_METRICS& c : clusters) {
+        for(int k = 0; k < (int)c.length && i < len; k ++)
+            xs.at(i ++) = x;
+        x += c.width;
+    }
+    for(; i <= len; i ++)
+        xs.at(i) = x;
+    return true;
+#endif
+}
+
 bool fsys_dwrite::create_text_texture(texture2d** tex, const gchar* str, int margin, const color& cr, int len)
 {
     if(!str || !tex)
@@ -0,0 +1,608 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <windows.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYNTHESIS_H
+#include <ariel/fsysfreetype.h>
+#include <ariel/scene.h>
+
+__ariel_begin__
+
+static FT_Face ft_open_face(FT_Library lib, const string& path)
+{
+    assert(lib);
+#if defined(UNICODE) || defined(_UNICODE)
+    _string<char> str;
+    str.from(path.c_str(), path.length());
+    const char* p = str.c_str();
+#else
+    const char* p = path.c_str();
+#endif
+    FT_Face face = nullptr;
+    if(FT_New_Face(lib, p, 0, &face))
+        return nullptr;
+    return face;
+}
+
+/* the fonts were listed by the full names like "Arial Bold (TrueType)", the collections like "A & B (TrueType)". */
+static bool ft_match_font_name(const gchar* value, const string& name)
+{
+    int len = name.length();
+    for(const gchar* p = value; p && *p; ) {
+        if(!strtool::compare_cl(p, name.c_str(), len) &&
+            (!p[len] || (p[len] == _t(' ') && (p[len + 1] == _t('(') || p[len + 1] == _t('&'))))
+            )
+            return true;
+        if(p = strtool::find(p, _t(" & ")))
+            p += 3;
+    }
+    return false;
+}
+
+ft_glyph_atlas::ft_glyph_atlas()
+{
+    _rsys = nullptr;
+    memset(&_stats, 0, sizeof(_stats));
+    _page_size = 1024;
+    _gap = 1;
+}
+
+void ft_glyph_atlas::setup(rendersys* rsys, int page_size)
+{
+    assert(rsys && page_size > 0);
+    _rsys = rsys;
+    _page_size = page_size;
+}
+
+void ft_glyph_atlas::destroy()
+{
+    for(auto& pg : _pages)
+        release_texture2d(pg.tex);
+    _pages.clear();
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool ft_glyph_atlas::create_page()
+{
+    assert(_rsys);
+    _pages.push_back(page());
+    auto& pg = _pages.back();
+    pg.pixels.create(image::fmt_rgba, _page_size, _page_size);
+    pg.pixels.enable_alpha_channel(true);
+    pg.pixels.clear(color(255, 255, 255, 0));
+    pg.tex = _rsys->create_rgba_texture2d(pg.pixels);
+    if(!pg.tex) {
+        _pages.pop_back();
+        return false;
+    }
+    _stats.pages ++;
+    return true;
+}
+
+/* the shelf of the least height was taken, a new shelf was opened if none could hold it. */
+bool ft_glyph_atlas::allocate(int w, int h, int& index, rect& slot)
+{
+    assert(w > 0 && h > 0);
+    int sw = w + _gap, sh = h + _gap;
+    if(sw + _gap > _page_size || sh + _gap > _page_size)
+        return false;
+    for(int i = 0; i < (int)_pages.size(); i ++) {
+        auto& shelves = _pages.at(i).shelves;
+        shelf* best = nullptr;
+        int bottom = _gap;
+        for(auto& s : shelves) {
+            bottom = s.top + s.height;
+            if(s.height >= sh && s.cursor + sw <= _page_size && (!best || s.height < best->height))
+                best = &s;
+        }
+        if(!best && bottom + sh <= _page_size) {
+            /* rounded up, so that the glyphs of the close heights would share the shelf */
+            shelf s = { bottom, gs_min((sh + 3) & ~3, _page_size - bottom), _gap };
+            shelves.push_back(s);
+            best = &shelves.back();
+        }
+        if(best) {
+            index = i;
+            slot.set_rect(best->cursor, best->top, w, h);
+            best->cursor += sw;
+            _stats.glyphs ++;
+            return true;
+        }
+    }
+    if(!create_page())
+        return false;
+    return allocate(w, h, index, slot);
+}
+
+void ft_glyph_atlas::write(int index, const rect& slot, const byte* coverage, int pitch)
+{
+    assert(coverage);
+    auto& pg = _pages.at(index);
+    int w = slot.width(), h = slot.height();
+    for(int j = 0; j < h; j ++) {
+        byte* d = pg.pixels.get_data(slot.left, slot.top + j);
+        const byte* s = coverage + pitch * j;
+        for(int i = 0; i < w; i ++, d += 4)
+            d[3] = s[i];
+    }
+    if(pg.dirty.width() <= 0 || pg.dirty.height() <= 0)
+        pg.dirty = slot;
+    else
+        union_rect(pg.dirty, pg.dirty, slot);
+}
+
+void ft_glyph_atlas::commit()
+{
+    assert(_rsys);
+    for(auto& pg : _pages) {
+        int w = pg.dirty.width(), h = pg.dirty.height();
+        if(w <= 0 || h <= 0)
+            continue;
+        _rsys->update_texture2d(pg.tex, pg.dirty, pg.pixels.get_data(pg.dirty.left, pg.dirty.top), pg.pixels.get_bytes_per_line());
+        _stats.uploads ++;
+        _stats.uploaded_bytes += (int64)w * h * 4;
+        pg.dirty = rect();
+    }
+}
+
+texture2d* ft_glyph_atlas::get_page_texture(int index) const
+{
+    if(index < 0 || index >= (int)_pages.size())
+        return nullptr;
+    return _pages.at(index).tex;
+}
+
+fsys_freetype::fsys_freetype()
+{
+    _library = nullptr;
+    _current_font = nullptr;
+    _next_font_id = 1;
+}
+
+fsys_freetype::~fsys_freetype()
+{
+    destroy_fonts();
+    _atlas.destroy();
+    if(_library) {
+        FT_Done_FreeType(_library);
+        _library = nullptr;
+    }
+}
+
+void fsys_freetype::initialize()
+{
+    auto* rsys = scene::get_singleton_ptr()->get_rendersys();
+    assert(rsys);
+    _atlas.setup(rsys);
+    assert(!_library);
+    verify(!FT_Init_FreeType(&_library));
+    gchar dir[MAX_PATH];
+    UINT len = GetWindowsDirectory(dir, MAX_PATH);
+    if(len > 0 && len < MAX_PATH) {
+        _system_font_dir.assign(dir, len);
+        _system_font_dir.append(_t("\\Fonts\\"));
+    }
+}
+
+void fsys_freetype::register_font_file(const gchar* name, const gchar* path)
+{
+    assert(name && path);
+    _font_files[string(name)] = string(path);
+}
+
+void fsys_freetype::set_font(const font& ft)
+{
+    _font = ft;
+    if(ft.sysfont) {
+        _current_font = (font_entry*)ft.sysfont;
+        return;
+    }
+    auto f = _font_map.find(ft);
+    if(f != _font_map.end()) {
+        ft.sysfont = (uint)f->second;
+        _current_font = f->second;
+        return;
+    }
+    bool bold = (ft.weight % 10) >= 6, italic = (ft.mask & font::ftm_italic) != 0;
+    bool embolden = false, oblique = false;
+    auto* face = open_face(ft.name, bold, italic, embolden, oblique);
+    if(!face)
+        face = open_face(string(_t("Arial")), bold, italic, embolden, oblique);
+    if(!face) {
+        assert(!"no font face available.");
+        return;
+    }
+    auto* entry = new font_entry;
+    entry->face = face;
+    entry->id = _next_font_id ++;
+    entry->pixel_size = gs_max((ft.size * 96 + 36) / 72, 1);
+    entry->embolden = embolden;
+    entry->oblique = oblique;
+    select_size(entry);
+    const auto& metrics = face->face->size->metrics;
+    entry->ascender = (int)((metrics.ascender + 63) >> 6);
+    entry->height = (int)((metrics.height + 63) >> 6);
+    ft.sysfont = (uint)entry;
+    _current_font = entry;
+    _font_map.emplace(ft, entry);
+}
+
+bool fsys_freetype::query_size(const gchar* str, int& w, int& h, int len)
+{
+    if(!str || !_current_font) {
+        w = 0, h = 0;
+        return false;
+    }
+    assert(len <= strtool::length(str));
+    if(len <= 0)
+        len = strtool::length(str);
+    float right = 0.f, baseline = (float)_current_font->ascender;
+    layout_text(str, len, [&](const ft_glyph& g, float x, float y) {
+        right = gs_max(right, x + g.advance);
+        baseline = y;
+    });
+    w = (int)ceil(right);
+    h = (int)baseline - _current_font->ascender + _current_font->height;
+    return true;
+}
+
+bool fsys_freetype::create_text_image(image& img, const gchar* str, int x, int y, const color& cr, int len)
+{
+    if(!str || !img.is_valid() || x < 0 || y < 0)
+        return false;
+    if(x > img.get_width() || y > img.get_height())
+        return false;
+    if(len < 0)
+        len = strtool::length(str);
+    int w, h;
+    if(!query_size(str, w, h, len))
+        return false;
+    /* erase the background */
+    rect rcclr(x, y, w, h);
+    img.clear(color(cr.red, cr.green, cr.blue, 0), &rcclr);
+    blend_text(img, str, x, y, cr, len);
+    return true;
+}
+
+bool fsys_freetype::create_text_texture(texture2d** tex, const gchar* str, int margin, const color& cr, int len)
+{
+    if(!str || !tex)
+        return false;
+    if(len < 0)
+        len = strtool::length(str);
+    int w, h;
+    if(!query_size(str, w, h, len))
+        return false;
+    w += (margin * 2);
+    h += (margin * 2);
+    image img;
+    img.create(image::fmt_rgba, gs_max(w, 1), gs_max(h, 1));
+    img.enable_alpha_channel(true);
+    img.clear(color(cr.red, cr.green, cr.blue, 0));
+    blend_text(img, str, margin, margin, cr, len);
+    auto* rsys = scene::get_singleton_ptr()->get_rendersys();
+    assert(rsys);
+    *tex = rsys->create_rgba_texture2d(img);
+    return *tex ? true : false;
+}
+
+void fsys_freetype::draw(image& img, const gchar* str, int x, int y, const color& cr, int len)
+{
+    if(!str || !img.is_valid())
+        return;
+    if(len < 0)
+        len = strtool::length(str);
+    blend_text(img, str, x, y, cr, len);
+}
+
+bool fsys_freetype::query_glyphs(fontsys_glyph_quads& quads, const gchar* str, int len)
+{
+    quads.clear();
+    if(!str || !_current_font)
+        return false;
+    if(len < 0)
+        len = strtool::length(str);
+    float scale = 1.f / (float)_atlas.get_page_size();
+    bool oversized = false;
+    layout_text(str, len, [&](const ft_glyph& g, float x, float y) {
+        if(g.page == ft_page_oversized)
+            oversized = true;
+        if(g.page < 0)
+            return;
+        /* the pen was snapped to the pixels, so that the glyphs were sampled texel to texel. */
+        float left = floorf(x + 0.5f) + (float)g.left, top = y - (float)g.top;
+        float w = (float)g.slot.width(), h = (float)g.slot.height();
+        fontsys_glyph_quad q;
+        q.page = g.page;
+        q.dest.set_rect(left, top, w, h);
+        q.uv.set_rect((float)g.slot.left * scale, (float)g.slot.top * scale, w * scale, h * scale);
+        quads.push_back(q);
+    });
+    /* the glyphs out of the atlas could not be drawn as quads, the painter falls back on the image of the text. */
+    if(oversized) {
+        quads.clear();
+        return false;
+    }
+    return true;
+}
+
+bool fsys_freetype::query_advances(vector<float>& xs, const gchar* str, int len)
+{
+    xs.clear();
+    if(!str || !_current_font)
+        return false;
+    if(len < 0)
+        len = strtool::length(str);
+    auto* ft = _current_font;
+    select_size(ft);
+    FT_Face face = ft->face->face;
+    bool kerning = FT_HAS_KERNING(face) != 0;
+    xs.resize(len + 1);
+    float x = 0.f;
+    uint prev = 0;
+    const gchar* end = str + len;
+    int i = 0;
+    while(i < len) {
+        uint c = 0;
+        const gchar* next = get_next_char(str + i, c, end);
+        if(!c || !next)
+            break;
+        if(c != _t('\r') && c != _t('\t') && c != _t('\n')) {
+            uint index = FT_Get_Char_Index(face, c);
+            if(kerning && prev && index) {
+                FT_Vector delta;
+                if(!FT_Get_Kerning(face, prev, index, FT_KERNING_DEFAULT, &delta))
+                    x += (float)delta.x / 64.f;
+            }
+            const ft_glyph* g = acquire_glyph(ft, index);
+            assert(g);
+            xs.at(i) = x;
+            x += g->advance;
+            prev = index;
+        }
+        else
+            xs.at(i) = x;
+        /* the rest of a multibyte char */
+        int n = gs_min((int)(next - str), len);
+        for(int k = i + 1; k < n; k ++)
+            xs.at(k) = xs.at(i);
+        i = n;
+    }
+    for(; i <= len; i ++)
+        xs.at(i) = x;
+    return true;
+}
+
+fsys_freetype::face_entry* fsys_freetype::open_face(const string& name, bool bold, bool italic, bool& embolden, bool& oblique)
+{
+    string path;
+    string styled(name);
+    if(bold)
+        styled.append(_t(" Bold"));
+    if(italic)
+        styled.append(_t(" Italic"));
+    embolden = oblique = false;
+    if(!(bold || italic) || !find_font_file(styled, path)) {
+        /* synthesized from the regular face */
+        if(!find_font_file(name, path))
+            return nullptr;
+        embolden = bold;
+        oblique = italic;
+    }
+    auto f = _faces.find(path);
+    if(f != _faces.end())
+        return &f->second;
+    FT_Face face = ft_open_face(_library, path);
+    if(!face)
+        return nullptr;
+    auto& entry = _faces[path];
+    entry.face = face;
+    entry.pixel_size = 0;
+    return &entry;
+}
+
+bool fsys_freetype::find_font_file(const string& name, string& path)
+{
+    auto f = _font_files.find(name);
+    if(f != _font_files.end()) {
+        path = f->second;
+        return true;
+    }
+    HKEY key;
+    if(RegOpenKeyEx(HKEY_LOCAL_MACHINE, _t("SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Fonts"), 0, KEY_READ, &key) != ERROR_SUCCESS)
+        return false;
+    bool found = false;
+    gchar value[256];
+    gchar data[MAX_PATH];
+    for(DWORD i = 0; !found; i ++) {
+        DWORD vlen = _countof(value), dlen = sizeof(data) - sizeof(gchar), type = 0;
+        if(RegEnumValue(key, i, value, &vlen, nullptr, &type, (LPBYTE)data, &dlen) != ERROR_SUCCESS)
+            break;
+        if(type != REG_SZ || !ft_match_font_name(value, name))
+            continue;
+        data[dlen / sizeof(gchar)] = 0;
+        /* the installed ones were listed by the file names, the others by the full paths. */
+        if(strtool::find(data, _t(":\\")))
+            path.assign(data);
+        else {
+            path = _system_font_dir;
+            path.append(data);
+        }
+        found = true;
+    }
+    RegCloseKey(key);
+    if(found)
+        _font_files.emplace(name, path);
+    return found;
+}
+
+void fsys_freetype::select_size(font_entry* ft)
+{
+    assert(ft && ft->face);
+    auto* face = ft->face;
+    if(face->pixel_size == ft->pixel_size)
+        return;
+    FT_Set_Pixel_Sizes(face->face, 0, ft->pixel_size);
+    face->pixel_size = ft->pixel_size;
+}
+
+const ft_glyph* fsys_freetype::acquire_glyph(font_entry* ft, uint index)
+{
+    assert(ft);
+    uint64 key = ((uint64)ft->id << 32) | index;
+    auto f = _glyphs.find(key);
+    if(f != _glyphs.end())
+        return &f->second;
+    select_size(ft);
+    FT_Face face = ft->face->face;
+    ft_glyph g;
+    g.page = -1;
+    g.left = g.top = 0;
+    g.advance = 0.f;
+    g.oversized = -1;
+    if(!FT_Load_Glyph(face, index, FT_LOAD_DEFAULT | FT_LOAD_TARGET_LIGHT)) {
+        FT_GlyphSlot slot = face->glyph;
+        if(ft->oblique)
+            FT_GlyphSlot_Oblique(slot);
+        if(ft->embolden)
+            FT_GlyphSlot_Embolden(slot);
+        if(!FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL)) {
+            g.advance = (float)slot->advance.x / 64.f;
+            const FT_Bitmap& bm = slot->bitmap;
+            int w = (int)bm.width, h = (int)bm.rows;
+            if(w > 0 && h > 0 && bm.pixel_mode == FT_PIXEL_MODE_GRAY) {
+                g.left = slot->bitmap_left;
+                g.top = slot->bitmap_top;
+                if(_atlas.allocate(w, h, g.page, g.slot))
+                    _atlas.write(g.page, g.slot, bm.buffer, bm.pitch);
+                else if(!_atlas.can_hold(w, h)) {
+                    trace(_t("the glyph %d x %d was larger than a page of the atlas, the texts of it were drawn as images.\n"), w, h);
+                    g.page = ft_page_oversized;
+                    g.slot.set_rect(0, 0, w, h);
+                    g.oversized = (int)_oversized.size();
+                    _oversized.push_back(image());
+                    auto& img = _oversized.back();
+                    img.create(image::fmt_rgba, w, h);
+                    img.enable_alpha_channel(true);
+                    img.clear(color(255, 255, 255, 0));
+                    for(int j = 0; j < h; j ++) {
+                        byte* d = img.get_data(0, j);
+                        const byte* s = bm.buffer + bm.pitch * j;
+                        for(int i = 0; i < w; i ++, d += 4)
+                            d[3] = s[i];
+                    }
+                }
+            }
+        }
+    }
+    return &_glyphs.emplace(key, g).first->second;
+}
+
+/* the glyphs were passed to fn with the pen position on the baseline, relative to the top left of the text. */
+template<class _fn>
+void fsys_freetype::layout_text(const gchar* str, int len, _fn fn)
+{
+    auto* ft = _current_font;
+    assert(ft);
+    select_size(ft);
+    FT_Face face = ft->face->face;
+    bool kerning = FT_HAS_KERNING(face) != 0;
+    float x = 0.f, y = (float)ft->ascender;
+    uint prev = 0;
+    const gchar* end = str + len;
+    for(;;) {
+        uint c = 0;
+        str = get_next_char(str, c, end);
+        if(!c)
+            break;
+        if(c == _t('\n')) {
+            x = 0.f;
+            y += (float)ft->height;
+            prev = 0;
+            continue;
+        }
+        if(c == _t('\r') || c == _t('\t'))
+            continue;
+        uint index = FT_Get_Char_Index(face, c);
+        if(kerning && prev && index) {
+            FT_Vector delta;
+            if(!FT_Get_Kerning(face, prev, index, FT_KERNING_DEFAULT, &delta))
+                x += (float)delta.x / 64.f;
+        }
+        const ft_glyph* g = acquire_glyph(ft, index);
+        assert(g);
+        fn(*g, x, y);
+        x += g->advance;
+        prev = index;
+    }
+}
+
+void fsys_freetype::blend_text(image& img, const gchar* str, int x, int y, const color& cr, int len)
+{
+    int w = img.get_width(), h = img.get_height();
+    layout_text(str, len, [&](const ft_glyph& g, float gx, float gy) {
+        if(g.page < 0 && g.page != ft_page_oversized)
+            return;
+        const image& src = (g.page == ft_page_oversized) ? _oversized.at(g.oversized) : _atlas.get_page(g.page).pixels;
+        int left = x + (int)floorf(gx + 0.5f) + g.left, top = y + (int)gy - g.top;
+        for(int j = 0; j < g.slot.height(); j ++) {
+            int v = top + j;
+            if(v < 0 || v >= h)
+                continue;
+            const byte* s = src.get_data(g.slot.left, g.slot.top + j);
+            for(int i = 0; i < g.slot.width(); i ++) {
+                int u = left + i;
+                int a = (int)s[i * 4 + 3] * cr.alpha / 255;
+                if(u < 0 || u >= w || !a)
+                    continue;
+                /* source over, the colors were not premultiplied */
+                color* d = reinterpret_cast<color*>(img.get_data(u, v));
+                int da = (int)d->alpha * (255 - a) / 255, oa = a + da;
+                d->red = (byte)(((int)cr.red * a + (int)d->red * da) / oa);
+                d->green = (byte)(((int)cr.green * a + (int)d->green * da) / oa);
+                d->blue = (byte)(((int)cr.blue * a + (int)d->blue * da) / oa);
+                d->alpha = (byte)oa;
+            }
+        }
+    });
+}
+
+void fsys_freetype::destroy_fonts()
+{
+    for(auto& p : _font_map)
+        delete p.second;
+    _font_map.clear();
+    for(auto& p : _faces)
+        FT_Done_Face(p.second.face);
+    _faces.clear();
+    _glyphs.clear();
+    _oversized.clear();
+    _current_font = nullptr;
+}
+
+__ariel_end__
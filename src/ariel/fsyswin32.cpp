@@ -99,6 +99,7 @@ void fsys_win32::initialize()
 void fsys_win32::set_font(const font& ft)
 {
     assert(_container_dc);
+    _font = ft;
     if(ft.sysfont) {
         HFONT h = (HFONT)SelectObject(_container_dc, (HFONT)ft.sysfont);
         if(!_old_font)
@@ -147,6 +148,28 @@ bool fsys_win32::query_size(const gchar* str, int& w, int& h, int len)
     return true;
 }
 
+/* the extents of all the prefixes were taken in a single call. */
+bool fsys_win32::query_advances(vector<float>& xs, const gchar* str, int len)
+{
+    xs.clear();
+    if(!str)
+        return false;
+    if(len < 0)
+        len = strtool::length(str);
+    xs.resize(len + 1, 0.f);
+    if(!len)
+        return true;
+    vector<int> dx(len);
+    SIZE sz;
+    if(!GetTextExtentExPoint(_container_dc, str, len, 0, nullptr, &dx.front(), &sz)) {
+        xs.clear();
+        return false;
+    }
+    for(int i = 0; i < len; i ++)
+        xs.at(i + 1) = (float)dx.at(i);
+    return true;
+}
+
 bool fsys_win32::create_text_image(image& img, const gchar* str, int x, int y, const color& cr, int len)
 {
     if(!str || !img.is_valid() || x < 0 || y < 0)
@@ -243,7 +266,7 @@ bool fsys_win32::create_text_texture(texture2d** tex, const gchar* str, int marg
     img.clear(color(0, 0, 0, 0));
     if(!create_text_image(img, str, margin, margin, cr, len))
         return false;
-    auto* p = rsys->create_texture2d(img, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0);
+    auto* p = rsys->create_rgba_texture2d(img);
     assert(p && tex);
     *tex = p;
     return true;
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gslib/error.h>
+#include <ariel/itemmodel.h>
+
+__ariel_begin__
+
+void row_height_index::reset(int count)
+{
+    assert(count >= 0);
+    _base = 1;
+    while(_base < count)
+        _base <<= 1;
+    _heights.assign(count, 0);
+    _sums.assign(_base * 2, 0);
+    _covers.assign(_base * 2, 0);
+}
+
+void row_height_index::pull(int node)
+{
+    if(_covers.at(node))
+        _sums.at(node) = 0;
+    else if(node >= _base) {
+        int row = node - _base;
+        _sums.at(node) = row < size() ? _heights.at(row) : 0;
+    }
+    else
+        _sums.at(node) = _sums.at(node * 2) + _sums.at(node * 2 + 1);
+}
+
+void row_height_index::set_height(int row, int h)
+{
+    assert(row >= 0 && row < size() && h >= 0);
+    if(_heights.at(row) == h)
+        return;
+    _heights.at(row) = h;
+    for(int i = _base + row; i > 0; i >>= 1)
+        pull(i);
+}
+
+int row_height_index::get_height(int row) const
+{
+    assert(row >= 0 && row < size());
+    for(int i = _base + row; i > 0; i >>= 1) {
+        if(_covers.at(i))
+            return 0;
+    }
+    return _heights.at(row);
+}
+
+/* the left siblings on the path were summed, the rest under a covered node were all hidden. */
+int row_height_index::get_top(int row) const
+{
+    assert(row >= 0 && row <= size());
+    if(row >= _base)
+        return get_total();
+    int s = 0;
+    int node = 1, lo = 0, span = _base;
+    while(node < _base) {
+        if(_covers.at(node))
+            return s;
+        span >>= 1;
+        if(row >= lo + span) {
+            s += _sums.at(node * 2);
+            node = node * 2 + 1;
+            lo += span;
+        }
+        else
+            node = node * 2;
+    }
+    return s;
+}
+
+/* descend the tree for the first row whose bottom was over y, the hidden rows summed to zero were passed by. */
+int row_height_index::find_row(int y) const
+{
+    if(y < 0)
+        return 0;
+    if(get_total() <= y)
+        return size();
+    int node = 1;
+    while(node < _base) {
+        int left = node * 2;
+        if(_sums.at(left) > y)
+            node = left;
+        else {
+            y -= _sums.at(left);
+            node = left + 1;
+        }
+    }
+    return node - _base;
+}
+
+/* the counts were never pushed down, a node summed to zero while any range covered it entirely. */
+void row_height_index::cover(int node, int lo, int span, int begin, int end, int d)
+{
+    if(begin >= lo + span || end <= lo)
+        return;
+    if(begin <= lo && end >= lo + span) {
+        _covers.at(node) += d;
+        assert(_covers.at(node) >= 0);
+        pull(node);
+        return;
+    }
+    span >>= 1;
+    cover(node * 2, lo, span, begin, end, d);
+    cover(node * 2 + 1, lo + span, span, begin, end, d);
+    pull(node);
+}
+
+void item_visual_pool::begin_frame()
+{
+    for(auto& v : _visuals)
+        v.used = false;
+}
+
+item_visual& item_visual_pool::acquire(const item_model* model, int row)
+{
+    assert(model);
+    auto f = _rows.find(row);
+    if(f != _rows.end()) {
+        auto& v = _visuals.at(f->second);
+        v.used = true;
+        return v;
+    }
+    int index;
+    if(!_free.empty()) {
+        index = _free.back();
+        _free.pop_back();
+    }
+    else {
+        index = (int)_visuals.size();
+        _visuals.push_back(item_visual());
+    }
+    auto& v = _visuals.at(index);
+    v.row = row;
+    v.used = true;
+    v.data.text.clear();
+    v.data.branch = false;
+    model->get_row_data(row, v.data);
+    _fetches ++;
+    _rows.emplace(row, index);
+    return v;
+}
+
+/* the visuals unused in this frame were unbound for the rows exposed next. */
+void item_visual_pool::end_frame()
+{
+    for(int i = 0; i < (int)_visuals.size(); i ++) {
+        auto& v = _visuals.at(i);
+        if(v.used || v.row < 0)
+            continue;
+        _rows.erase(v.row);
+        v.row = -1;
+        _free.push_back(i);
+    }
+}
+
+void item_visual_pool::clear()
+{
+    _visuals.clear();
+    _rows.clear();
+    _free.clear();
+}
+
+void item_visual_pool::invalidate(int row)
+{
+    auto f = _rows.find(row);
+    if(f == _rows.end())
+        return;
+    _visuals.at(f->second).row = -1;
+    _free.push_back(f->second);
+    _rows.erase(f);
+}
+
+void item_rows::set_model(item_model* model)
+{
+    _model = model;
+    reload();
+}
+
+void item_rows::reload()
+{
+    int count = _model ? _model->get_row_count() : 0;
+    _collapsed.assign(count, false);
+    _index.build(count, [this](int row)->int { return _model->get_row_height(row); });
+    /* a subtree was closed by the next row not deeper than it. */
+    _ends.assign(count, count);
+    vector<int> opened, depths;
+    for(int i = 0; i < count; i ++) {
+        int d = _model->get_row_depth(i);
+        while(!depths.empty() && depths.back() >= d) {
+            _ends.at(opened.back()) = i;
+            opened.pop_back();
+            depths.pop_back();
+        }
+        opened.push_back(i);
+        depths.push_back(d);
+    }
+}
+
+int item_rows::next_row(int row) const
+{
+    assert(row >= 0 && row < get_row_count());
+    return _index.find_row(_index.get_top(row + 1));
+}
+
+/* the descendants were hidden or shown as a range in O(log n), those under a collapsed child stayed covered by its range. */
+void item_rows::expand(int row, bool b)
+{
+    assert(_model);
+    if(is_expanded(row) == b)
+        return;
+    _collapsed.at(row) = !b;
+    int end = end_of_subtree(row);
+    if(end <= row + 1)
+        return;
+    if(b)
+        _index.show_rows(row + 1, end);
+    else
+        _index.hide_rows(row + 1, end);
+}
+
+void item_rows::update_row_height(int row)
+{
+    assert(_model);
+    _index.set_height(row, _model->get_row_height(row));
+}
+
+__ariel_end__
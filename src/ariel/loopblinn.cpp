@@ -26,6 +26,7 @@
 #include <gslib/error.h>
 #include <gslib/utility.h>
 #include <ariel/loopblinn.h>
+#include <ariel/profiler.h>
 
 __ariel_begin__
 
@@ -1105,6 +1106,7 @@ loop_blinn_processor::~loop_blinn_processor()
 
 void loop_blinn_processor::proceed(const painter_path& path)
 {
+    ariel_profile_scope("loop_blinn_processor::proceed");
     flattening(path);
     if(_polygons.empty())
         return;
@@ -72,6 +72,10 @@ void painter::set_hints(uint hints, bool enable)
 
 void painter::set_font(const font& ft)
 {
+    _font = ft;
+    /* restored to none, the font system kept the last one */
+    if(ft.name.empty())
+        return;
     scene* scn = scene::get_singleton_ptr();
     assert(scn);
     fontsys* fsys = scn->get_fontsys();
@@ -98,6 +102,11 @@ void painter::get_text_dimension(const gchar* str, int& w, int& h, int len)
     assert(str);
     scene* scn = scene::get_singleton_ptr();
     assert(scn);
+    if(!_font.name.empty()) {
+        scn->get_text_layouts()->query_size(_font, str, w, h, len);
+        return;
+    }
+    /* no font was set through the painter */
     fontsys* fsys = scn->get_fontsys();
     assert(fsys);
     fsys->query_size(str, w, h, len);
@@ -184,6 +193,41 @@ void painter::draw_text(const gchar* str, float x, float y, const color& cr, int
     draw_image(tex.detach(), rectf(x, y, cw, ch), rectf((float)margin, (float)margin, cw, ch));
 }
 
+painter_symbol painter::register_symbol(const painter_path& path)
+{
+    painter_symbol sym = _next_symbol ++;
+    _symbol_paths[sym].duplicate(path);
+    return sym;
+}
+
+void painter::unregister_symbol(painter_symbol sym)
+{
+    _symbol_paths.erase(sym);
+}
+
+void painter::draw_symbol(painter_symbol sym, const painter_symbol_instance instances[], int count)
+{
+    assert(instances || !count);
+    auto f = _symbol_paths.find(sym);
+    if(f == _symbol_paths.end()) {
+        assert(!"unknown symbol.");
+        return;
+    }
+    /* the fallback draws the path for each of the instances. */
+    for(int i = 0; i < count; i ++) {
+        const auto& inst = instances[i];
+        save();
+        painter_brush brush;
+        brush.set_tag(painter_brush::solid);
+        brush.set_color(inst.cr);
+        set_brush(brush);
+        set_pen(painter_pen(painter_pen::none));
+        set_tranform(inst.transform);
+        draw_path(f->second);
+        restore();
+    }
+}
+
 void painter::get_transform_recursively(mat3& m) const
 {
     m = _context.get_trasnform();
@@ -28,6 +28,22 @@
 
 __ariel_begin__
 
+static bool painter_obj_order_less(const painter_obj* o1, const painter_obj* o2)
+{
+    assert(o1 && o2);
+    return o1->get_order() < o2->get_order();
+}
+
+void painter_obj::setup_context(painter* paint, const rectf& vp) const
+{
+    assert(paint);
+    paint->set_brush(_ctx.get_brush());
+    paint->set_pen(_ctx.get_pen());
+    mat3 m;
+    m.translation(-vp.left, -vp.top);
+    paint->set_tranform(m);
+}
+
 rectf& painter_line_obj::get_rect(rectf& rc) const
 {
     rc.set_by_pts(_p1, _p2);
@@ -42,10 +58,20 @@ void painter_line_obj::draw_to(painter* paint, const rectf& vp) const
     vec2 p1, p2;
     p1.lerp(_p1, _p2, t[0]);
     p2.lerp(_p1, _p2, t[1]);
-    p1 -= vp.top_left();
-    p2 -= vp.top_left();
     assert(paint);
+    paint->save();
+    setup_context(paint, vp);
     paint->draw_line(p1, p2);
+    paint->restore();
+}
+
+void painter_rect_obj::draw_to(painter* paint, const rectf& vp) const
+{
+    assert(paint);
+    paint->save();
+    setup_context(paint, vp);
+    paint->draw_rect(_rc);
+    paint->restore();
 }
 
 rectf& painter_path_obj::get_rect(rectf& rc) const
@@ -63,18 +89,68 @@ rectf& painter_path_obj::rebuild_rect(rectf& rc) const
     return get_rect(rc);
 }
 
+void painter_path_obj::draw_to(painter* paint, const rectf& vp) const
+{
+    assert(paint);
+    paint->save();
+    setup_context(paint, vp);
+    if(_ctx.get_brush().get_tag() != painter_brush::solid || _ctx.get_pen().get_tag() != painter_pen::none) {
+        paint->draw_path(_path);
+        paint->restore();
+        return;
+    }
+    if(_sym_owner != paint) {
+        release_symbol();
+        _sym = paint->register_symbol(_path);
+        _sym_owner = paint;
+    }
+    /* the viewport offset was taken from the context set up */
+    painter_symbol_instance inst;
+    inst.transform.identity();
+    inst.cr = _ctx.get_brush().get_color();
+    paint->draw_symbol(_sym, &inst, 1);
+    paint->restore();
+}
+
+void painter_path_obj::release_symbol() const
+{
+    if(_sym_owner) {
+        _sym_owner->unregister_symbol(_sym);
+        _sym_owner = nullptr;
+        _sym = 0;
+    }
+}
+
 rectf& painter_text_obj::get_rect(rectf& rc) const
 {
     scene* scn = scene::get_singleton_ptr();
     assert(scn);
     fontsys* fsys = scn->get_fontsys();
     assert(fsys);
-    int w, h;
-    fsys->query_size(_text.c_str(), w, h);
+    int w = 0, h = 0;
+    fontsys_font_scope scope(fsys, _font);
+    fsys->query_size(_text.c_str(), w, h, (int)_text.length());
     rc.set_rect(_pos.x, _pos.y, (float)w, (float)h);
     return rc;
 }
 
+void painter_text_obj::draw_to(painter* paint, const rectf& vp) const
+{
+    assert(paint);
+    scene* scn = scene::get_singleton_ptr();
+    assert(scn);
+    fontsys* fsys = scn->get_fontsys();
+    assert(fsys);
+    font last = paint->get_font();
+    {
+        /* the font of the painter might be none, the font system was restored on its own */
+        fontsys_font_scope scope(fsys, _font);
+        paint->set_font(_font);
+        paint->draw_text(_text.c_str(), _pos.x - vp.left, _pos.y - vp.top, _cr, (int)_text.length());
+    }
+    paint->set_font(last);
+}
+
 painterport::~painterport()
 {
     clear_objs();
@@ -82,24 +158,61 @@ painterport::~painterport()
 
 void painterport::draw_path(const painter_path& path)
 {
-    add_obj(new painter_path_obj(get_context(), path));
+    mat3 m;
+    get_transform_recursively(m);
+    painter_path p;
+    p.duplicate(path);
+    p.transform(m);
+    add_obj(new painter_path_obj(get_context(), p));
 }
 
 void painterport::draw_line(const vec2& p1, const vec2& p2)
 {
-    auto* obj = new painter_line_obj(get_context(), p1, p2);
+    mat3 m;
+    get_transform_recursively(m);
+    vec2 q1, q2;
+    q1.transformcoord(p1, m);
+    q2.transformcoord(p2, m);
+    auto* obj = new painter_line_obj(get_context(), q1, q2);
     assert(obj);
-    _rtree.insert_line(obj, p1, p2);
+    rectf rc;
+    obj->set_order(_next_order ++);
+    obj->set_bound(obj->get_rect(rc));
+    _rtree.insert_line(obj, q1, q2);
+    _visible_valid = false;
 }
 
 void painterport::draw_rect(const rectf& rc)
 {
-    add_obj(new painter_rect_obj(get_context(), rc));
+    mat3 m;
+    get_transform_recursively(m);
+    if(m._12 != 0.f || m._21 != 0.f) {
+        /* rotated, no longer a rect */
+        painter_path p;
+        p.add_rect(rc);
+        p.transform(m);
+        add_obj(new painter_path_obj(get_context(), p));
+        return;
+    }
+    vec2 p1, p2;
+    p1.transformcoord(vec2(rc.left, rc.top), m);
+    p2.transformcoord(vec2(rc.right, rc.bottom), m);
+    rectf rc1;
+    rc1.set_by_pts(p1, p2);
+    add_obj(new painter_rect_obj(get_context(), rc1));
 }
 
 void painterport::draw_text(const gchar* str, float x, float y, const color& cr, int length)
 {
-    add_obj(new painter_text_obj(get_context(), string(str, length), pointf(x, y), cr));
+    if(!str || !length)
+        return;
+    if(length < 0)
+        length = strtool::length(str);
+    mat3 m;
+    get_transform_recursively(m);
+    vec2 p;
+    p.transformcoord(vec2(x, y), m);
+    add_obj(new painter_text_obj(get_context(), string(str, length), pointf(p.x, p.y), cr, _font));
 }
 
 void painterport::on_draw_begin()
@@ -111,12 +224,14 @@ void painterport::on_draw_begin()
 void painterport::flush_port(painter* paint, const rectf& rc) const
 {
     assert(paint);
-    painter_objs vo;
-    query_objs(vo, rc);
+    const auto& vo = get_visible_objs(rc);
     paint->save();
-    // todo:
-    for(painter_obj* o : vo)
+    for(painter_obj* o : vo) {
+        /* the rtree nodes might be larger than the objects */
+        if(!is_rect_intersected(o->get_bound(), rc))
+            continue;
         o->draw_to(paint, rc);
+    }
     paint->restore();
 }
 
@@ -136,18 +251,71 @@ void painterport::query_objs(painter_objs& objs, const rectf& rc) const
     _rtree.query(rc, objs);
 }
 
+const painter_objs& painterport::get_visible_objs(const rectf& vp) const
+{
+    update_visible(vp);
+    return _visible;
+}
+
 void painterport::add_obj(painter_obj* obj)
 {
     assert(obj);
     rectf rc;
     obj->get_rect(rc);
+    obj->set_order(_next_order ++);
+    obj->set_bound(rc);
     _rtree.insert(obj, rc);
+    _visible_valid = false;
 }
 
 void painterport::clear_objs()
 {
     _rtree.for_each([](painter_obj_entity* ent) { delete ent->get_bind_arg(); });
     _rtree.destroy();
+    _next_order = 0;
+    _visible.clear();
+    _visible_valid = false;
+}
+
+/*
+ * If the viewport was scrolled from the last one, the objects out of it were dropped, and only the strips newly
+ * exposed were queried, the objects overlapped the last viewport were already in.
+ */
+void painterport::update_visible(const rectf& vp) const
+{
+    if(_visible_valid && !memcmp(&_visible_rect, &vp, sizeof(vp)))
+        return;
+    if(!_visible_valid || !is_rect_intersected(_visible_rect, vp)) {
+        _visible.clear();
+        query_objs(_visible, vp);
+        std::sort(_visible.begin(), _visible.end(), painter_obj_order_less);
+        _visible_rect = vp;
+        _visible_valid = true;
+        return;
+    }
+    const rectf old = _visible_rect;
+    auto last = std::remove_if(_visible.begin(), _visible.end(), [&vp](painter_obj* o)->bool { return !is_rect_intersected(o->get_bound(), vp); });
+    _visible.erase(last, _visible.end());
+    _exposed.clear();
+    float top = gs_max(vp.top, old.top), bottom = gs_min(vp.bottom, old.bottom);
+    if(vp.top < old.top)
+        query_objs(_exposed, rectf(vp.left, vp.top, vp.width(), old.top - vp.top));
+    if(vp.bottom > old.bottom)
+        query_objs(_exposed, rectf(vp.left, old.bottom, vp.width(), vp.bottom - old.bottom));
+    if(vp.left < old.left)
+        query_objs(_exposed, rectf(vp.left, top, old.left - vp.left, bottom - top));
+    if(vp.right > old.right)
+        query_objs(_exposed, rectf(old.right, top, vp.right - old.right, bottom - top));
+    last = std::remove_if(_exposed.begin(), _exposed.end(), [&old](painter_obj* o)->bool { return is_rect_intersected(o->get_bound(), old); });
+    _exposed.erase(last, _exposed.end());
+    if(!_exposed.empty()) {
+        std::sort(_exposed.begin(), _exposed.end(), painter_obj_order_less);
+        _exposed.erase(std::unique(_exposed.begin(), _exposed.end()), _exposed.end());
+        size_t mid = _visible.size();
+        _visible.insert(_visible.end(), _exposed.begin(), _exposed.end());
+        std::inplace_merge(_visible.begin(), _visible.begin() + mid, _visible.end(), painter_obj_order_less);
+    }
+    _visible_rect = vp;
 }
 
 __ariel_end__
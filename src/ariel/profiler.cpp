@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gslib/error.h>
+#include <gslib/file.h>
+#include <ariel/profiler.h>
+
+__ariel_begin__
+
+static thread_local profile_ring* __profile_ring = nullptr;
+static const char* __profile_frame_name = "frame";     /* told apart by the pointer */
+
+profile_ring::profile_ring(uint tid)
+{
+    _tid = tid;
+    _head.store(0, std::memory_order_relaxed);
+    _events.resize(capacity);
+}
+
+void profile_ring::collect(events& output, int64 from, int64 to) const
+{
+    uint head = _head.load(std::memory_order_acquire);
+    uint first = head >= capacity ? head - capacity + 1 : 0;
+    int start = (int)output.size();
+    vector<uint> indices;
+    for(uint i = first; i != head; i ++) {
+        const profile_event& e = _events[i & (capacity - 1)];
+        if(e.start >= from && e.start < to) {
+            output.push_back(e);
+            indices.push_back(i);
+        }
+    }
+    /* the ones overwritten during the copy were dropped, including the one the writer might be writing. */
+    uint last = _head.load(std::memory_order_acquire);
+    if(last - first < capacity)
+        return;
+    uint valid = last - capacity + 1;
+    int j = start;
+    for(int i = 0; i < (int)indices.size(); i ++) {
+        if(indices.at(i) >= valid)
+            output.at(j ++) = output.at(start + i);
+    }
+    output.resize(j);
+}
+
+profiler::profiler()
+{
+    _enabled.store(false, std::memory_order_relaxed);
+    _epoch = std::chrono::steady_clock::now();
+    for(auto& c : _counters)
+        c.store(0, std::memory_order_relaxed);
+}
+
+profiler::~profiler()
+{
+    for(auto* p : _rings)
+        delete p;
+    _rings.clear();
+}
+
+/* the rings were kept after their threads quit, so that the events could still be exported. */
+profile_ring* profiler::get_ring()
+{
+    if(!__profile_ring) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        __profile_ring = new profile_ring((uint)_rings.size() + 1);
+        _rings.push_back(__profile_ring);
+    }
+    return __profile_ring;
+}
+
+void profiler::begin_frame()
+{
+    _frame_start = is_enabled() ? get_time() : -1;
+}
+
+void profiler::end_frame()
+{
+    if(_frame_start < 0 || !is_enabled())
+        return;
+    profile_frame frame;
+    frame.start = _frame_start;
+    frame.end = get_time();
+    /* the counters were accumulated since the last frame ended, the events posted in between were counted too. */
+    for(int i = 0; i < pci_count; i ++)
+        frame.counters[i] = _counters[i].exchange(0, std::memory_order_relaxed);
+    get_ring()->record(__profile_frame_name, frame.start, frame.end, 0);
+    if((int)_frames.size() >= max_frames)
+        _frames.pop_front();
+    _frames.push_back(frame);
+    _frame_start = -1;
+}
+
+void profiler::reset()
+{
+    _frames.clear();
+    _frame_start = -1;
+    for(auto& c : _counters)
+        c.store(0, std::memory_order_relaxed);
+}
+
+void profiler::collect(profile_ring::events& output, int64 from, int64 to)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    for(auto* p : _rings)
+        p->collect(output, from, to);
+}
+
+/* the scopes of the same name were merged, sorted by the time spent, the frame itself left out. */
+void profiler::get_summary(string& str)
+{
+    str.clear();
+    if(_frames.empty())
+        return;
+    const profile_frame& frame = _frames.back();
+    double frame_ms = (double)(frame.end - frame.start) * 1e-6;
+    str.format(_t("frame %d: %.3fms\n"), (int)_frames.size() - 1, frame_ms);
+    profile_ring::events events;
+    collect(events, frame.start, frame.end);
+    struct scope_summary
+    {
+        const char*     name;
+        int64           total;
+        int             calls;
+    };
+    unordered_map<const char*, scope_summary> merged;
+    for(const auto& e : events) {
+        if(e.name == __profile_frame_name)
+            continue;
+        auto& s = merged.emplace(e.name, scope_summary{ e.name, 0, 0 }).first->second;
+        s.total += e.duration;
+        s.calls ++;
+    }
+    vector<scope_summary> sorted;
+    for(const auto& p : merged)
+        sorted.push_back(p.second);
+    std::sort(sorted.begin(), sorted.end(), [](const scope_summary& s1, const scope_summary& s2)-> bool { return s1.total > s2.total; });
+    string s, name;
+    for(const auto& ss : sorted) {
+        name.from(ss.name);
+        double ms = (double)ss.total * 1e-6;
+        s.format(_t("    %s: %.3fms, %d calls, %.1f%%\n"), name.c_str(), ms, ss.calls, frame_ms > 0.0 ? ms * 100.0 / frame_ms : 0.0);
+        str.append(s);
+    }
+    for(int i = 0; i < pci_count; i ++) {
+        s.format(_t("    %s: %lld\n"), get_counter_name((profile_counter_id)i), frame.counters[i]);
+        str.append(s);
+    }
+}
+
+void profiler::tracing()
+{
+    string str;
+    get_summary(str);
+    trace(_t("%s"), str.c_str());
+}
+
+/* in the trace event format of chrome://tracing, the scopes as the complete events and the counters per frame. */
+bool profiler::export_chrome_trace(const gchar* path)
+{
+    assert(path);
+    _string<char> json, s, name;
+    auto append = [&json](const _string<char>& item) {
+        json.append(json.empty() ? "{\"traceEvents\":[\n" : ",\n");
+        json.append(item);
+    };
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        profile_ring::events events;
+        for(auto* p : _rings) {
+            uint tid = p->get_thread_id();
+            s.format("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", tid, tid);
+            append(s);
+            events.clear();
+            p->collect(events, 0, INT64_MAX);
+            for(const auto& e : events) {
+                s.format("{\"name\":\"%s\",\"cat\":\"ariel\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    e.name, tid, (double)e.start * 1e-3, (double)e.duration * 1e-3
+                    );
+                append(s);
+            }
+        }
+    }
+    for(const auto& f : _frames) {
+        for(int i = 0; i < pci_count; i ++) {
+            name.from(get_counter_name((profile_counter_id)i));
+            s.format("{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                name.c_str(), (double)f.end * 1e-3, f.counters[i]
+                );
+            append(s);
+        }
+    }
+    if(json.empty())
+        json.assign("{\"traceEvents\":[");
+    json.append("\n]}\n");
+    file f(path, _t("wb"));
+    if(!f.is_valid())
+        return false;
+    f.put((const byte*)json.c_str(), json.length());
+    f.close();
+    return true;
+}
+
+const gchar* profiler::get_counter_name(profile_counter_id id)
+{
+    switch(id)
+    {
+    case pci_paths:
+        return _t("paths");
+    case pci_triangles:
+        return _t("triangles");
+    case pci_batches:
+        return _t("batches");
+    case pci_bytes_uploaded:
+        return _t("bytes uploaded");
+    case pci_vertices:
+        return _t("vertices");
+    case pci_vertices_saved:
+        return _t("vertices saved");
+    case pci_events:
+        return _t("events");
+    case pci_events_coalesced:
+        return _t("events coalesced");
+    case pci_event_latency:
+        return _t("event latency ns");
+    case pci_event_cost:
+        return _t("event cost ns");
+    default:
+        return _t("unknown");
+    }
+}
+
+__ariel_end__
@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <thread>
+#include <algorithm>
+#include <emmintrin.h>
+#include <gslib/error.h>
+#include <ariel/raster.h>
+#include <ariel/scene.h>
+
+__ariel_begin__
+
+static const float raster_min_area = 1e-6f;
+
+static inline void raster_push_cell(raster_coverage::cells& cs, int x, int y, float cover, float area, int w)
+{
+    if(x >= w)
+        return;
+    raster_cell c;
+    c.x = x;
+    c.y = y;
+    c.cover = cover;
+    c.area = area;
+    cs.push_back(c);
+}
+
+/* split the part of an edge in row y into the cells it crossed, dy was signed by the winding. */
+static void raster_accumulate_row(raster_coverage::cells& cs, int y, float xa, float xb, float dy, int w)
+{
+    xa = gs_clamp(xa, 0.f, (float)w);
+    xb = gs_clamp(xb, 0.f, (float)w);
+    int ca = (int)xa, cb = (int)xb;
+    if(ca == cb || xa == xb) {
+        raster_push_cell(cs, ca, y, dy, dy * ((float)(ca + 1) - (xa + xb) * 0.5f), w);
+        return;
+    }
+    float dydx = dy / (xb - xa);
+    float x = xa;
+    if(xa < xb) {
+        for(int c = ca; c <= cb; c ++) {
+            float nx = gs_min(xb, (float)(c + 1));
+            if(nx > x) {
+                float d = dydx * (nx - x);
+                raster_push_cell(cs, c, y, d, d * ((float)(c + 1) - (x + nx) * 0.5f), w);
+            }
+            x = nx;
+        }
+    }
+    else {
+        for(int c = ca; c >= cb; c --) {
+            float nx = gs_max(xb, (float)c);
+            if(nx < x) {
+                float d = dydx * (nx - x);
+                raster_push_cell(cs, c, y, d, d * ((float)(c + 1) - (x + nx) * 0.5f), w);
+            }
+            x = nx;
+        }
+    }
+}
+
+static inline float raster_get_coverage(float c, raster_fill_rule rule, bool antialias)
+{
+    c = fabsf(c);
+    if(rule == rfr_even_odd) {
+        c = fmodf(c, 2.f);
+        if(c > 1.f)
+            c = 2.f - c;
+    }
+    else if(c > 1.f)
+        c = 1.f;
+    if(!antialias)
+        return c >= 0.5f ? 1.f : 0.f;
+    return c;
+}
+
+/* the blend factor in [0, 256] of source over. */
+static inline int raster_get_factor(float coverage, const color& cr)
+{
+    return (int)(coverage * (float)cr.alpha * (256.f / 255.f) + 0.5f);
+}
+
+/*
+ * Source over in straight alpha. The colors were weighted by the alphas and divided by the result alpha, so that
+ * the translucent pixels drawn into a transparent layer kept their colors rather than being darkened by the black
+ * of it. Over an opaque pixel it was the plain lerp.
+ */
+static inline void raster_blend_pixel(byte* d, const color& cr, int f)
+{
+    int g = 256 - f;
+    if(d[3] == 255) {
+        d[0] = (byte)((d[0] * g + cr.red * f) >> 8);
+        d[1] = (byte)((d[1] * g + cr.green * f) >> 8);
+        d[2] = (byte)((d[2] * g + cr.blue * f) >> 8);
+        return;
+    }
+    int ws = 255 * f, wd = d[3] * g, w = ws + wd;
+    if(!w)
+        return;
+    d[0] = (byte)((cr.red * ws + d[0] * wd + w / 2) / w);
+    d[1] = (byte)((cr.green * ws + d[1] * wd + w / 2) / w);
+    d[2] = (byte)((cr.blue * ws + d[2] * wd + w / 2) / w);
+    d[3] = (byte)((w + 128) >> 8);
+}
+
+/*
+ * d * (256 - f) + s * f never exceeded 0xffff, so the lerp could be done in the 16 bits lanes, 4 pixels a time, if
+ * they were all opaque; the translucent ones took the straight over one by one.
+ */
+static void raster_fill_span(byte* d, int count, const color& cr, int f)
+{
+    if(f <= 0 || count <= 0)
+        return;
+    color src(cr.red, cr.green, cr.blue, 255);
+    __m128i s = _mm_set1_epi32((int)src.data());
+    int i = 0;
+    if(f >= 256) {
+        for(; i + 4 <= count; i += 4)
+            _mm_storeu_si128((__m128i*)(d + i * 4), s);
+        for(; i < count; i ++)
+            ((uint*)d)[i] = src.data();
+        return;
+    }
+    __m128i zero = _mm_setzero_si128();
+    __m128i sf = _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), _mm_set1_epi16((short)f));
+    __m128i g = _mm_set1_epi16((short)(256 - f));
+    __m128i opaque = _mm_set1_epi32((int)0xff000000);
+    for(; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(d + i * 4));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(p, opaque), opaque)) != 0xffff) {
+            for(int j = i; j < i + 4; j ++)
+                raster_blend_pixel(d + j * 4, cr, f);
+            continue;
+        }
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, g), sf), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, g), sf), 8);
+        _mm_storeu_si128((__m128i*)(d + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    for(; i < count; i ++)
+        raster_blend_pixel(d + i * 4, cr, f);
+}
+
+/* the spans of the clip region on a row, walked from left to right along with the runs. */
+struct raster_row_clip
+{
+    const dirty_region::span* spans;
+    int                 count;
+    int                 cursor;
+
+public:
+    void fill(byte* line, int x, int n, const color& cr, int f)
+    {
+        if(!spans) {
+            raster_fill_span(line + x * 4, n, cr, f);
+            return;
+        }
+        if(f <= 0 || n <= 0)
+            return;
+        int end = x + n;
+        for(; cursor < count && spans[cursor].right <= x; cursor ++);
+        for(int k = cursor; k < count && spans[k].left < end; k ++) {
+            int l = gs_max(x, spans[k].left), r = gs_min(end, spans[k].right);
+            raster_fill_span(line + l * 4, r - l, cr, f);
+        }
+    }
+    bool contains(int x)
+    {
+        if(!spans)
+            return true;
+        for(; cursor < count && spans[cursor].right <= x; cursor ++);
+        return cursor < count && spans[cursor].left <= x;
+    }
+};
+
+void raster_coverage::reset(int w, int h)
+{
+    assert(w >= 0 && h >= 0);
+    _width = w;
+    _height = h;
+    _edges.clear();
+    _bands.resize((h + raster_band_height - 1) / raster_band_height);
+}
+
+void raster_coverage::add_line(const vec2& p1, const vec2& p2)
+{
+    if(p1.y == p2.y)
+        return;
+    float w = (float)_width, h = (float)_height;
+    if((p1.y <= 0.f && p2.y <= 0.f) || (p1.y >= h && p2.y >= h))
+        return;
+    if(p1.x >= w && p2.x >= w)
+        return;
+    /* the part on the right of the image was invisible, drop it. */
+    if(p1.x > w || p2.x > w) {
+        vec2 m(w, p1.y + (p2.y - p1.y) * (w - p1.x) / (p2.x - p1.x));
+        if(p1.x > w)
+            add_clipped_line(m, p2);
+        else
+            add_clipped_line(p1, m);
+        return;
+    }
+    add_clipped_line(p1, p2);
+}
+
+/* the part on the left of the image still covered the pixels on its right, so it was projected onto x = 0. */
+void raster_coverage::add_clipped_line(const vec2& p1, const vec2& p2)
+{
+    auto push = [this](const vec2& a, const vec2& b) {
+        if(a.y == b.y)
+            return;
+        raster_edge e;
+        e.from = a;
+        e.to = b;
+        _edges.push_back(e);
+    };
+    if(p1.x >= 0.f && p2.x >= 0.f)
+        push(p1, p2);
+    else if(p1.x <= 0.f && p2.x <= 0.f)
+        push(vec2(0.f, p1.y), vec2(0.f, p2.y));
+    else {
+        vec2 m(0.f, p1.y + (p2.y - p1.y) * (-p1.x) / (p2.x - p1.x));
+        if(p1.x < 0.f) {
+            push(vec2(0.f, p1.y), m);
+            push(m, p2);
+        }
+        else {
+            push(p1, m);
+            push(m, vec2(0.f, p2.y));
+        }
+    }
+}
+
+void raster_coverage::add_polygon(const painter_linestrip& ls)
+{
+    int cnt = ls.get_size();
+    if(cnt < 3)
+        return;
+    for(int i = 0, j = cnt - 1; i < cnt; j = i ++)
+        add_line(ls.get_point(j), ls.get_point(i));
+}
+
+void raster_coverage::add_polygons(const painter_linestrips& lss)
+{
+    for(const painter_linestrip& ls : lss)
+        add_polygon(ls);
+}
+
+/* every triangle was added counter clockwise, so the overlapped parts summed up under the non-zero rule. */
+void raster_coverage::add_triangle(const vec2& p1, const vec2& p2, const vec2& p3)
+{
+    float area = (p2.x - p1.x) * (p3.y - p1.y) - (p3.x - p1.x) * (p2.y - p1.y);
+    if(fabsf(area) < raster_min_area)
+        return;
+    if(area > 0.f) {
+        add_line(p1, p2);
+        add_line(p2, p3);
+        add_line(p3, p1);
+    }
+    else {
+        add_line(p1, p3);
+        add_line(p3, p2);
+        add_line(p2, p1);
+    }
+}
+
+/* the triangles fully in the stroke went into the edges, the ones reaching the fringe were kept to be blended by their coverage. */
+void raster_coverage::add_strip(const stroke_strip& strip)
+{
+    int cnt = (int)strip.size();
+    for(int i = 0; i + 2 < cnt; i ++) {
+        const stroke_vertex& v1 = strip.at(i);
+        const stroke_vertex& v2 = strip.at(i + 1);
+        const stroke_vertex& v3 = strip.at(i + 2);
+        if(v1.coverage >= 1.f && v2.coverage >= 1.f && v3.coverage >= 1.f) {
+            add_triangle(v1.pos, v2.pos, v3.pos);
+            continue;
+        }
+        float area = (v2.pos.x - v1.pos.x) * (v3.pos.y - v1.pos.y) - (v3.pos.x - v1.pos.x) * (v2.pos.y - v1.pos.y);
+        if(fabsf(area) < raster_min_area)
+            continue;
+        raster_fringe f;
+        f.points[0] = v1.pos;
+        f.points[1] = v2.pos;
+        f.points[2] = v3.pos;
+        f.coverage[0] = v1.coverage;
+        f.coverage[1] = v2.coverage;
+        f.coverage[2] = v3.coverage;
+        _fringes.push_back(f);
+    }
+}
+
+void raster_coverage::bucket_edges()
+{
+    for(band& b : _bands) {
+        b.indices.clear();
+        b.accum.clear();
+    }
+    int last = (int)_bands.size() - 1;
+    if(last < 0)
+        return;
+    for(int i = 0; i < (int)_edges.size(); i ++) {
+        const raster_edge& e = _edges.at(i);
+        float y0 = gs_max(gs_min(e.from.y, e.to.y), 0.f);
+        float y1 = gs_min(gs_max(e.from.y, e.to.y), (float)_height);
+        if(y0 >= y1)
+            continue;
+        int b0 = gs_min((int)y0 / raster_band_height, last);
+        int b1 = gs_min(gs_max((int)ceilf(y1) - 1, 0) / raster_band_height, last);
+        for(int j = b0; j <= b1; j ++)
+            _bands.at(j).indices.push_back(i);
+    }
+}
+
+void raster_coverage::accumulate_band(int i)
+{
+    band& b = _bands.at(i);
+    float top = (float)(i * raster_band_height);
+    float bottom = gs_min(top + (float)raster_band_height, (float)_height);
+    for(int idx : b.indices) {
+        const raster_edge& e = _edges.at(idx);
+        vec2 p1 = e.from, p2 = e.to;
+        float dir = 1.f;
+        if(p1.y > p2.y) {
+            gs_swap(p1, p2);
+            dir = -1.f;
+        }
+        float y0 = gs_max(p1.y, top), y1 = gs_min(p2.y, bottom);
+        if(y0 >= y1)
+            continue;
+        float dxdy = (p2.x - p1.x) / (p2.y - p1.y);
+        int r0 = (int)y0, r1 = (int)ceilf(y1) - 1;
+        for(int r = r0; r <= r1; r ++) {
+            float ya = gs_max(y0, (float)r), yb = gs_min(y1, (float)(r + 1));
+            if(ya >= yb)
+                continue;
+            float xa = p1.x + (ya - p1.y) * dxdy;
+            float xb = p1.x + (yb - p1.y) * dxdy;
+            raster_accumulate_row(b.accum, r, xa, xb, (yb - ya) * dir, _width);
+        }
+    }
+    std::sort(b.accum.begin(), b.accum.end(), [](const raster_cell& c1, const raster_cell& c2)->bool {
+        return c1.y < c2.y || (c1.y == c2.y && c1.x < c2.x);
+    });
+}
+
+/*
+ * Sweep the sorted cells of each row, the coverage of a cell was the accumulated cover on its left plus its own
+ * area, and the pixels between two cells were all covered by the accumulated cover.
+ */
+void raster_coverage::render_band(int i, image& img, const color& cr, raster_fill_rule rule, bool antialias, const dirty_region* clip)
+{
+    const cells& cs = _bands.at(i).accum;
+    int cnt = (int)cs.size();
+    for(int j = 0; j < cnt;) {
+        int y = cs.at(j).y;
+        raster_row_clip rc = { nullptr, 0, 0 };
+        if(clip && !clip->get_row_spans(y, rc.spans, rc.count)) {
+            /* the row was clipped out */
+            for(; j < cnt && cs.at(j).y == y; j ++);
+            continue;
+        }
+        byte* line = img.get_data(0, y);
+        float acc = 0.f;
+        int px = 0;
+        while(j < cnt && cs.at(j).y == y) {
+            int x = cs.at(j).x;
+            float cover = 0.f, area = 0.f;
+            for(; j < cnt && cs.at(j).y == y && cs.at(j).x == x; j ++) {
+                cover += cs.at(j).cover;
+                area += cs.at(j).area;
+            }
+            if(x > px)
+                rc.fill(line, px, x - px, cr, raster_get_factor(raster_get_coverage(acc, rule, antialias), cr));
+            int f = raster_get_factor(raster_get_coverage(acc + area, rule, antialias), cr);
+            if(f > 0 && rc.contains(x))
+                raster_blend_pixel(line + x * 4, cr, gs_min(f, 256));
+            acc += cover;
+            px = x + 1;
+        }
+        if(px < _width)
+            rc.fill(line, px, _width - px, cr, raster_get_factor(raster_get_coverage(acc, rule, antialias), cr));
+    }
+}
+
+/*
+ * The coverage of the fringes was interpolated at the pixel centers and the max of the overlapped ones was taken,
+ * so the fringes at the joins were not blended twice. They were blended over the stroke itself, where a fringe
+ * lapped over the inner side of a join a translucent stroke got slightly darker there.
+ */
+void raster_coverage::render_fringes(int i, image& img, const color& cr, bool antialias, const dirty_region* clip)
+{
+    int top = i * raster_band_height;
+    int bottom = gs_min(top + raster_band_height, _height);
+    fringe_coverages& fc = _bands.at(i).fringe;
+    bool touched = false;
+    for(const raster_fringe& f : _fringes) {
+        const vec2& p1 = f.points[0];
+        const vec2& p2 = f.points[1];
+        const vec2& p3 = f.points[2];
+        int y0 = gs_max((int)floorf(gs_min(p1.y, gs_min(p2.y, p3.y))), top);
+        int y1 = gs_min((int)ceilf(gs_max(p1.y, gs_max(p2.y, p3.y))), bottom);
+        int x0 = gs_max((int)floorf(gs_min(p1.x, gs_min(p2.x, p3.x))), 0);
+        int x1 = gs_min((int)ceilf(gs_max(p1.x, gs_max(p2.x, p3.x))), _width);
+        if(y0 >= y1 || x0 >= x1)
+            continue;
+        if(!touched) {
+            fc.assign(_width * raster_band_height, 0.f);
+            touched = true;
+        }
+        float area = (p2.x - p1.x) * (p3.y - p1.y) - (p3.x - p1.x) * (p2.y - p1.y);
+        float inv = 1.f / area;
+        for(int y = y0; y < y1; y ++) {
+            float py = (float)y + 0.5f;
+            float* row = &fc.at((y - top) * _width);
+            for(int x = x0; x < x1; x ++) {
+                float px = (float)x + 0.5f;
+                float w1 = ((p2.x - px) * (p3.y - py) - (p3.x - px) * (p2.y - py)) * inv;
+                float w2 = ((p3.x - px) * (p1.y - py) - (p1.x - px) * (p3.y - py)) * inv;
+                float w3 = 1.f - w1 - w2;
+                if(w1 < 0.f || w2 < 0.f || w3 < 0.f)
+                    continue;
+                float c = w1 * f.coverage[0] + w2 * f.coverage[1] + w3 * f.coverage[2];
+                row[x] = gs_max(row[x], gs_clamp(c, 0.f, 1.f));
+            }
+        }
+    }
+    if(!touched)
+        return;
+    for(int y = top; y < bottom; y ++) {
+        raster_row_clip rc = { nullptr, 0, 0 };
+        if(clip && !clip->get_row_spans(y, rc.spans, rc.count))
+            continue;
+        byte* line = img.get_data(0, y);
+        const float* row = &fc.at((y - top) * _width);
+        for(int x = 0; x < _width; x ++) {
+            if(row[x] <= 0.f)
+                continue;
+            int f = raster_get_factor(raster_get_coverage(row[x], rfr_non_zero, antialias), cr);
+            if(f > 0 && rc.contains(x))
+                raster_blend_pixel(line + x * 4, cr, gs_min(f, 256));
+        }
+    }
+}
+
+void raster_coverage::render(image& img, const color& cr, raster_fill_rule rule, bool antialias, thread_pool* pool, const dirty_region* clip)
+{
+    assert(img.get_format() == image::fmt_rgba);
+    assert(img.get_width() == _width && img.get_height() == _height);
+    if(is_empty() || !cr.alpha)
+        return;
+    bucket_edges();
+    int cnt = (int)_bands.size();
+    auto fn = [&](int i) {
+        if(_bands.at(i).indices.empty() && _fringes.empty())
+            return;
+        if(clip && !clip->is_intersected(rect(0, i * raster_band_height, _width, raster_band_height)))
+            return;
+        if(!_bands.at(i).indices.empty()) {
+            accumulate_band(i);
+            render_band(i, img, cr, rule, antialias, clip);
+        }
+        if(!_fringes.empty())
+            render_fringes(i, img, cr, antialias, clip);
+    };
+    if(!pool) {
+        for(int i = 0; i < cnt; i ++)
+            fn(i);
+        return;
+    }
+    for(int i = 0; i < cnt; i ++)
+        pool->add(fn, i);
+    pool->join();
+}
+
+raster_painter::raster_painter()
+{
+    stroke_style st;
+    _stroker.set_style(st);
+    set_workers((int)std::thread::hardware_concurrency());
+}
+
+raster_painter::~raster_painter()
+{
+    set_workers(0);
+}
+
+void raster_painter::set_workers(int workers)
+{
+    if(_pool) {
+        delete _pool;
+        _pool = nullptr;
+    }
+    if(workers > 1)
+        _pool = new thread_pool(workers);
+}
+
+void raster_painter::resize(int w, int h)
+{
+    if(w == _image.get_width() && h == _image.get_height() && _image.is_valid())
+        return;
+    _image.destroy();
+    if(w > 0 && h > 0) {
+        _image.create(image::fmt_rgba, w, h);
+        _image.enable_alpha_channel(true);
+        _image.clear(color(0, 0, 0, 0));
+    }
+    _coverage.reset(w, h);
+    setup_dimensions(w, h);
+}
+
+void raster_painter::draw_path(const painter_path& path)
+{
+    if(!_image.is_valid())
+        return;
+    context& ctx = get_context();
+    auto& brush = ctx.get_brush();
+    auto& pen = ctx.get_pen();
+    mat3 m;
+    get_transform_recursively(m);
+    painter_path p;
+    p.duplicate(path);
+    p.transform(m);
+    if(brush.get_tag() == painter_brush::solid)
+        fill_path(p, brush.get_color());
+    else if(brush.get_tag() == painter_brush::picture)
+        on_unsupported();
+    if(pen.get_tag() == painter_pen::solid)
+        stroke_path(p, pen.get_color());
+    else if(pen.get_tag() == painter_pen::picture)
+        on_unsupported();
+}
+
+void raster_painter::draw_text(const gchar* str, float x, float y, const color& cr, int length)
+{
+    if(!str || !length || !_image.is_valid())
+        return;
+    scene* scn = scene::get_singleton_ptr();
+    assert(scn);
+    fontsys* fsys = scn->get_fontsys();
+    assert(fsys);
+    /* the glyphs were blended straight into the image, only the translation was taken */
+    mat3 m;
+    get_transform_recursively(m);
+    vec2 p;
+    p.transformcoord(vec2(x, y), m);
+    fsys->draw(_image, str, (int)round(p.x), (int)round(p.y), cr, length);
+}
+
+void raster_painter::on_unsupported()
+{
+    if(_strict) {
+        assert(!"unsupported brush or pen for raster painter.");
+    }
+    _unsupported ++;
+}
+
+void raster_painter::fill_path(const painter_path& path, const color& cr)
+{
+    painter_linestrips lss;
+    path.get_linestrips(lss);
+    _coverage.clear();
+    _coverage.add_polygons(lss);
+    _coverage.render(_image, cr, _fill_rule, query_antialias(), _pool, get_clip());
+}
+
+void raster_painter::stroke_path(const painter_path& path, const color& cr)
+{
+    painter_linestrips lss;
+    path.get_linestrips(lss);
+    _strip.clear();
+    _stroker.stroke(_strip, lss);
+    _coverage.clear();
+    _coverage.add_strip(_strip);
+    _coverage.render(_image, cr, rfr_non_zero, query_antialias(), _pool, get_clip());
+}
+
+__ariel_end__
@@ -60,6 +60,9 @@ rect_packer::rect_packer()
 {
     _strategy = ps_unknown;
     _pack_times = 0;
+    _bin_width = _bin_height = 0.f;
+    _extent_width = _extent_height = 0.f;
+    _used_area = 0.f;
 }
 
 rect_packer::~rect_packer()
@@ -70,15 +73,25 @@ rect_packer::~rect_packer()
 
 void rect_packer::pack_automatically(rp_input_list& inputs)
 {
-    /* 1.few inputs, use dynamic strategy. */
-    if(inputs.size() <= 10) {
+    /* few inputs, use dynamic strategy, otherwise use compact strategy */
+    pack_automatically(inputs, inputs.size() <= 10 ? ps_dynamically : ps_compactly);
+}
+
+void rect_packer::pack_automatically(rp_input_list& inputs, packing_strategy strategy)
+{
+    if(strategy == ps_unknown) {
+        pack_automatically(inputs);
+        return;
+    }
+    /* 1.dynamic strategy takes them one by one */
+    if(strategy == ps_dynamically) {
         _pack_times = 1;
         initialize_dynamically();
         for(auto& i : inputs)
             add_rect_dynamically(i.width, i.height, i.binding);
         return;
     }
-    /* 2.otherwise use compact strategy, first sort them by max side */
+    /* 2.otherwise first sort them by max side */
     inputs.sort([](const rp_input& a, const rp_input& b)-> bool {
         return gs_max(a.width, a.height) > gs_max(b.width, b.height);
     });
@@ -98,9 +111,16 @@ void rect_packer::pack_automatically(rp_input_list& inputs)
     for(;;) {
         _pack_times ++;
         float side = sqrtf(totals);
-        initialize_compactly(side, side);
-        if(pack_compactly(inputs))
-            return;
+        if(strategy == ps_compactly) {
+            initialize_compactly(side, side);
+            if(pack_compactly(inputs))
+                return;
+        }
+        else {
+            reset(strategy, side, side);
+            if(pack_online(inputs))
+                return;
+        }
         expand_ratio += step;
         totals = sum_area * expand_ratio;
     }
@@ -116,6 +136,10 @@ void rect_packer::tracing() const
     case ps_dynamically:
         trace_dynamically();
         break;
+    case ps_skyline:
+    case ps_maxrects:
+        trace_online();
+        break;
     default:
         assert(!"unknown strategy.");
     }
@@ -946,4 +970,516 @@ void rect_packer::trace_dynamically() const
     trace(_t("#end tracing.\n"));
 }
 
+void rp_skyline::reset(float w, float h)
+{
+    _width = w;
+    _height = h;
+    _segments.clear();
+    _wastes.clear();
+    segment s;
+    s.x = 0.f;
+    s.y = 0.f;
+    s.width = w;
+    _segments.push_back(s);
+}
+
+bool rp_skyline::find(float w, float h, rp_rect& rc, bool& transposed) const
+{
+    /* reuse the waste area first */
+    int wi = find_waste(w, h, transposed);
+    if(wi >= 0) {
+        const auto& r = _wastes.at(wi);
+        transposed ? rc.set_rect(r.x, r.y, h, w) : rc.set_rect(r.x, r.y, w, h);
+        return true;
+    }
+    /* bottom-left, the lowest bottom first, then the leftmost */
+    float best_bottom = FLT_MAX, best_x = FLT_MAX;
+    bool found = false;
+    for(int i = 0; i < (int)_segments.size(); i ++) {
+        const auto& s = _segments.at(i);
+        float y;
+        if(fit_segment(i, w, h, y) && (y + h < best_bottom || (y + h == best_bottom && s.x < best_x))) {
+            best_bottom = y + h;
+            best_x = s.x;
+            rc.set_rect(s.x, y, w, h);
+            transposed = false;
+            found = true;
+        }
+        if(w != h && fit_segment(i, h, w, y) && (y + w < best_bottom || (y + w == best_bottom && s.x < best_x))) {
+            best_bottom = y + w;
+            best_x = s.x;
+            rc.set_rect(s.x, y, h, w);
+            transposed = true;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void rp_skyline::occupy(const rp_rect& rc)
+{
+    /* was it taken from the waste list? split the rest in guillotine way */
+    for(int i = 0; i < (int)_wastes.size(); i ++) {
+        rp_rect r = _wastes.at(i);
+        if(rc.left() < r.left() || rc.top() < r.top() || rc.right() > r.right() || rc.bottom() > r.bottom())
+            continue;
+        _wastes.erase(_wastes.begin() + i);
+        float dw = r.right() - rc.right(), dh = r.bottom() - rc.bottom();
+        rp_rect right, bottom;
+        if(dw > dh) {
+            right.set_rect(rc.right(), r.top(), dw, r.height);
+            bottom.set_rect(r.left(), rc.bottom(), rc.right() - r.left(), dh);
+        }
+        else {
+            right.set_rect(rc.right(), r.top(), dw, rc.bottom() - r.top());
+            bottom.set_rect(r.left(), rc.bottom(), r.width, dh);
+        }
+        if(right.width > 0.f && right.height > 0.f)
+            _wastes.push_back(right);
+        if(bottom.width > 0.f && bottom.height > 0.f)
+            _wastes.push_back(bottom);
+        return;
+    }
+    /* otherwise it was on the skyline */
+    int i = 0;
+    while(i < (int)_segments.size() && _segments.at(i).x + _segments.at(i).width <= rc.left())
+        i ++;
+    assert(i < (int)_segments.size());
+    if(_segments.at(i).x < rc.left()) {
+        segment s = _segments.at(i);
+        s.width = rc.left() - s.x;
+        _segments.at(i).width -= s.width;
+        _segments.at(i).x = rc.left();
+        _segments.insert(_segments.begin() + i, s);
+        i ++;
+    }
+    /* the area under the new rect was wasted */
+    for(int j = i; j < (int)_segments.size() && _segments.at(j).x < rc.right(); j ++) {
+        const auto& s = _segments.at(j);
+        float l = gs_max(s.x, rc.left()), r = gs_min(s.x + s.width, rc.right());
+        if(s.y < rc.top() && r > l)
+            _wastes.push_back(rp_rect(l, s.y, r - l, rc.top() - s.y));
+    }
+    segment ns;
+    ns.x = rc.left();
+    ns.y = rc.bottom();
+    ns.width = rc.width;
+    _segments.insert(_segments.begin() + i, ns);
+    /* cut the ones covered */
+    for(int j = i + 1; j < (int)_segments.size();) {
+        auto& s = _segments.at(j);
+        if(s.x >= rc.right())
+            break;
+        float r = s.x + s.width;
+        if(r <= rc.right()) {
+            _segments.erase(_segments.begin() + j);
+            continue;
+        }
+        s.width = r - rc.right();
+        s.x = rc.right();
+        break;
+    }
+    merge_segments();
+}
+
+void rp_skyline::release(const rp_rect& rc)
+{
+    rp_rect r = rc;
+    /* grow it with the waste neighbours sharing a whole edge */
+    for(bool merged = true; merged;) {
+        merged = false;
+        for(int i = 0; i < (int)_wastes.size(); i ++) {
+            const auto& f = _wastes.at(i);
+            if(f.top() == r.top() && f.height == r.height && (f.right() == r.left() || f.left() == r.right()))
+                r.set_rect(gs_min(f.left(), r.left()), r.top(), f.width + r.width, r.height);
+            else if(f.left() == r.left() && f.width == r.width && (f.bottom() == r.top() || f.top() == r.bottom()))
+                r.set_rect(r.left(), gs_min(f.top(), r.top()), r.width, f.height + r.height);
+            else
+                continue;
+            _wastes.erase(_wastes.begin() + i);
+            merged = true;
+            break;
+        }
+    }
+    if(!is_on_top(r)) {
+        _wastes.push_back(r);
+        return;
+    }
+    lower_skyline(r);
+    /* the wastes just above might be on the top now */
+    for(int i = 0; i < (int)_wastes.size();) {
+        rp_rect f = _wastes.at(i);
+        if(!is_on_top(f)) {
+            i ++;
+            continue;
+        }
+        _wastes.erase(_wastes.begin() + i);
+        lower_skyline(f);
+        i = 0;
+    }
+}
+
+bool rp_skyline::fit_segment(int i, float w, float h, float& y) const
+{
+    const auto& first = _segments.at(i);
+    if(first.x + w > _width)
+        return false;
+    y = first.y;
+    float remain = w;
+    for(int j = i; j < (int)_segments.size() && remain > 0.f; j ++) {
+        const auto& s = _segments.at(j);
+        y = gs_max(y, s.y);
+        if(y + h > _height)
+            return false;
+        remain -= s.width;
+    }
+    return true;
+}
+
+int rp_skyline::find_waste(float w, float h, bool& transposed) const
+{
+    /* best short side fit */
+    int best = -1;
+    float best_short = FLT_MAX;
+    for(int i = 0; i < (int)_wastes.size(); i ++) {
+        const auto& r = _wastes.at(i);
+        if(r.width >= w && r.height >= h) {
+            float d = gs_min(r.width - w, r.height - h);
+            if(d < best_short) {
+                best = i;
+                best_short = d;
+                transposed = false;
+            }
+        }
+        if(w != h && r.width >= h && r.height >= w) {
+            float d = gs_min(r.width - h, r.height - w);
+            if(d < best_short) {
+                best = i;
+                best_short = d;
+                transposed = true;
+            }
+        }
+    }
+    return best;
+}
+
+bool rp_skyline::is_on_top(const rp_rect& rc) const
+{
+    for(const auto& s : _segments) {
+        if(s.x + s.width <= rc.left() || s.x >= rc.right())
+            continue;
+        if(s.y != rc.bottom())
+            return false;
+    }
+    return true;
+}
+
+void rp_skyline::lower_skyline(const rp_rect& rc)
+{
+    segment_list segs;
+    for(const auto& s : _segments) {
+        float r = s.x + s.width;
+        if(r <= rc.left() || s.x >= rc.right()) {
+            segs.push_back(s);
+            continue;
+        }
+        segment t = s;
+        if(s.x < rc.left()) {
+            t.width = rc.left() - s.x;
+            segs.push_back(t);
+        }
+        t.x = gs_max(s.x, rc.left());
+        t.width = gs_min(r, rc.right()) - t.x;
+        t.y = rc.top();
+        segs.push_back(t);
+        if(r > rc.right()) {
+            t.x = rc.right();
+            t.width = r - rc.right();
+            t.y = s.y;
+            segs.push_back(t);
+        }
+    }
+    _segments.swap(segs);
+    merge_segments();
+}
+
+void rp_skyline::merge_segments()
+{
+    for(int i = 1; i < (int)_segments.size();) {
+        auto& p = _segments.at(i - 1);
+        if(p.y == _segments.at(i).y) {
+            p.width += _segments.at(i).width;
+            _segments.erase(_segments.begin() + i);
+        }
+        else
+            i ++;
+    }
+}
+
+static bool rp_contains(const rp_rect& a, const rp_rect& b)
+{
+    return a.left() <= b.left() && a.top() <= b.top() && a.right() >= b.right() && a.bottom() >= b.bottom();
+}
+
+static bool rp_overlaps(const rp_rect& a, const rp_rect& b)
+{
+    return a.left() < b.right() && b.left() < a.right() && a.top() < b.bottom() && b.top() < a.bottom();
+}
+
+static void rp_split(const rp_rect& f, const rp_rect& rc, vector<rp_rect>& splits)
+{
+    if(rc.left() > f.left())
+        splits.push_back(rp_rect(f.left(), f.top(), rc.left() - f.left(), f.height));
+    if(rc.right() < f.right())
+        splits.push_back(rp_rect(rc.right(), f.top(), f.right() - rc.right(), f.height));
+    if(rc.top() > f.top())
+        splits.push_back(rp_rect(f.left(), f.top(), f.width, rc.top() - f.top()));
+    if(rc.bottom() < f.bottom())
+        splits.push_back(rp_rect(f.left(), rc.bottom(), f.width, f.bottom() - rc.bottom()));
+}
+
+static void rp_drop_contained(vector<rp_rect>& rcs)
+{
+    int c = (int)rcs.size();
+    vector<bool> dropped(c, false);
+    for(int i = 0; i < c; i ++) {
+        for(int j = 0; j < c; j ++) {
+            if(i == j || dropped.at(j))
+                continue;
+            /* for the identical ones keep the first */
+            if(rp_contains(rcs.at(j), rcs.at(i)) && (j < i || !rp_contains(rcs.at(i), rcs.at(j)))) {
+                dropped.at(i) = true;
+                break;
+            }
+        }
+    }
+    int k = 0;
+    for(int i = 0; i < c; i ++) {
+        if(!dropped.at(i))
+            rcs.at(k ++) = rcs.at(i);
+    }
+    rcs.resize(k);
+}
+
+void rp_maxrects::reset(float w, float h)
+{
+    _free.clear();
+    _bin.set_rect(0.f, 0.f, w, h);
+    add_free(_bin);
+}
+
+bool rp_maxrects::find(float w, float h, rp_rect& rc, bool& transposed) const
+{
+    float best_short = FLT_MAX, best_long = FLT_MAX;
+    float max_side = gs_max(w, h);
+    bool found = false;
+    auto try_fit = [&](const rp_rect& f, float fw, float fh, bool t) {
+        if(f.width < fw || f.height < fh)
+            return;
+        float ds = gs_min(f.width - fw, f.height - fh);
+        float dl = gs_max(f.width - fw, f.height - fh);
+        if(ds < best_short || (ds == best_short && dl < best_long)) {
+            best_short = ds;
+            best_long = dl;
+            rc.set_rect(f.left(), f.top(), fw, fh);
+            transposed = t;
+            found = true;
+        }
+    };
+    /* the ones with a shorter side could never hold it */
+    for(auto i = _free.lower_bound(gs_min(w, h)); i != _free.end(); ++ i) {
+        /* the short side fit of the rest would be no better */
+        if(i->first - max_side > best_short)
+            break;
+        try_fit(i->second, w, h, false);
+        if(w != h)
+            try_fit(i->second, h, w, true);
+    }
+    return found;
+}
+
+void rp_maxrects::occupy(const rp_rect& rc)
+{
+    vector<rp_rect> splits;
+    for(auto i = _free.begin(); i != _free.end();) {
+        const auto& f = i->second;
+        if(!rp_overlaps(rc, f)) {
+            ++ i;
+            continue;
+        }
+        rp_split(f, rc, splits);
+        i = _free.erase(i);
+    }
+    prune(splits);
+}
+
+void rp_maxrects::release(const rp_rect& rc, const rp_placement_map& placed)
+{
+    /*
+     * the maximal rects that were new after the release were all across the released rect, a piece apart from it
+     * could never be split into one across it, so the others were dropped as soon as they were split out.
+     */
+    vector<rp_rect> rcs, splits;
+    rcs.push_back(_bin);
+    for(const auto& p : placed) {
+        const auto& o = p.second;
+        assert(!rp_overlaps(o, rc));
+        splits.clear();
+        bool split = false;
+        for(const auto& f : rcs) {
+            if(!rp_overlaps(o, f)) {
+                splits.push_back(f);
+                continue;
+            }
+            int c = (int)splits.size();
+            rp_split(f, o, splits);
+            for(int i = (int)splits.size() - 1; i >= c; i --) {
+                if(!rp_overlaps(splits.at(i), rc))
+                    splits.erase(splits.begin() + i);
+            }
+            split = true;
+        }
+        if(!split)
+            continue;
+        rp_drop_contained(splits);
+        rcs.swap(splits);
+    }
+    prune(rcs);
+}
+
+void rp_maxrects::prune(vector<rp_rect>& rcs)
+{
+    rp_drop_contained(rcs);
+    for(const auto& r : rcs) {
+        bool dropped = false;
+        for(const auto& f : _free) {
+            if(rp_contains(f.second, r)) {
+                dropped = true;
+                break;
+            }
+        }
+        if(dropped)
+            continue;
+        for(auto j = _free.begin(); j != _free.end();) {
+            if(rp_contains(r, j->second))
+                j = _free.erase(j);
+            else
+                ++ j;
+        }
+        add_free(r);
+    }
+}
+
+void rect_packer::reset(packing_strategy strategy, float w, float h)
+{
+    assert((strategy == ps_skyline || strategy == ps_maxrects) && "only for the online strategies.");
+    _tree.destroy();
+    _strategy = strategy;
+    _placements.clear();
+    _bin_width = w;
+    _bin_height = h;
+    _extent_width = _extent_height = 0.f;
+    _used_area = 0.f;
+    strategy == ps_skyline ? _skyline.reset(w, h) : _maxrects.reset(w, h);
+}
+
+bool rect_packer::insert(float w, float h, void* binding)
+{
+    assert(is_online());
+    assert(_placements.find(binding) == _placements.end() && "the binding must be unique.");
+    rp_placement pl;
+    pl.transposed = false;
+    bool found = (_strategy == ps_skyline) ? _skyline.find(w, h, pl, pl.transposed) :
+        _maxrects.find(w, h, pl, pl.transposed);
+    if(!found)
+        return false;
+    (_strategy == ps_skyline) ? _skyline.occupy(pl) : _maxrects.occupy(pl);
+    _placements.emplace(binding, pl);
+    _used_area += pl.area();
+    _extent_width = gs_max(_extent_width, pl.right());
+    _extent_height = gs_max(_extent_height, pl.bottom());
+    return true;
+}
+
+bool rect_packer::remove(void* binding)
+{
+    assert(is_online());
+    auto f = _placements.find(binding);
+    if(f == _placements.end())
+        return false;
+    rp_placement pl = f->second;
+    _placements.erase(f);
+    (_strategy == ps_skyline) ? _skyline.release(pl) : _maxrects.release(pl, _placements);
+    _used_area -= pl.area();
+    bool on_edge = (pl.right() >= _extent_width || pl.bottom() >= _extent_height);
+    if(on_edge)
+        update_extent();
+    return true;
+}
+
+float rect_packer::get_occupancy() const
+{
+    float a = _bin_width * _bin_height;
+    return a > 0.f ? _used_area / a : 0.f;
+}
+
+int rect_packer::get_free_rect_count() const
+{
+    switch(_strategy)
+    {
+    case ps_skyline:
+        return _skyline.get_free_count();
+    case ps_maxrects:
+        return _maxrects.get_free_count();
+    default:
+        return 0;
+    }
+}
+
+bool rect_packer::pack_online(const rp_input_list& inputs)
+{
+    for(const auto& rc : inputs) {
+        if(!insert(rc.width, rc.height, rc.binding))
+            return false;
+    }
+    return true;
+}
+
+void rect_packer::update_extent()
+{
+    _extent_width = _extent_height = 0.f;
+    for(const auto& p : _placements) {
+        _extent_width = gs_max(_extent_width, p.second.right());
+        _extent_height = gs_max(_extent_height, p.second.bottom());
+    }
+}
+
+void rect_packer::trace_online() const
+{
+    assert(is_online());
+    trace(_t("#start tracing %s.\n"), _strategy == ps_skyline ? _t("skyline") : _t("maxrects"));
+    for(const auto& p : _placements) {
+        const auto& rc = p.second;
+        trace(_t("@!\n"));
+        int r = rand() % 256;
+        int g = rand() % 256;
+        int b = rand() % 256;
+        string cr;
+        cr.format(_t("rgb(%d,%d,%d)"), r, g, b);
+        trace(_t("@&strokeColor=%s;\n"), cr.c_str());
+        trace(_t("@&withArrow=false;\n"));
+        trace(_t("@rect %f, %f, %f, %f;\n"), rc.left(), rc.top(), rc.right(), rc.bottom());
+        if(rc.transposed)
+            trace(_t("#this rect was transposed.\n"));
+        trace(_t("@@\n"));
+    }
+    /* add a boundary. */
+    trace(_t("@!\n"));
+    trace(_t("@&strokeColor=rgb(0,0,0);\n"));
+    trace(_t("@rect %f, %f, %f, %f;\n"), 0.f, 0.f, _bin_width, _bin_height);
+    trace(_t("@@\n"));
+    trace(_t("#occupancy: %f, free rects: %d.\n"), get_occupancy(), get_free_rect_count());
+    trace(_t("#end tracing.\n"));
+}
+
 __ariel_end__
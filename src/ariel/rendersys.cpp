@@ -24,6 +24,11 @@
  */
 
 #include <ariel/rendersys.h>
+#include <ariel/profiler.h>
+
+#if use_rendersys_software
+#include <ariel/rendersyssw.h>
+#endif
 
 __ariel_begin__
 
@@ -75,6 +80,36 @@ void rendersys::set_background_color(const color& cr)
     _bkcr[3] = (float)cr.alpha / 255.f;
 }
 
+rendersys::texture2d* rendersys::create_rgba_texture2d(const image& img)
+{
+    assert(img.get_format() == image::fmt_rgba);
+#if use_rendersys_d3d_11
+    return create_texture2d(img, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0);
+#elif use_rendersys_software
+    return create_texture2d(img, 1, 0, sw_bind_shader_resource, 0, 0);
+#else
+    assert(!"unsupported render platform.");
+    return nullptr;
+#endif
+}
+
+rendersys::texture2d* rendersys::create_rgba_texture2d(int width, int height, bool writable)
+{
+    assert(width > 0 && height > 0);
+#if use_rendersys_d3d_11
+    uint bindflags = D3D11_BIND_SHADER_RESOURCE;
+    if(writable)
+        bindflags |= D3D11_BIND_UNORDERED_ACCESS;
+    return create_texture2d(width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 1, D3D11_USAGE_DEFAULT, bindflags, 0, 0);
+#elif use_rendersys_software
+    /* the cpu textures were always writable. */
+    return create_texture2d(width, height, sw_format_r8g8b8a8_unorm, 1, 0, sw_bind_shader_resource, 0, 0);
+#else
+    assert(!"unsupported render platform.");
+    return nullptr;
+#endif
+}
+
 void rendersys::register_dev_index_service(void* dev, rendersys* rsys)
 {
     _dev_indexing.emplace(dev, rsys);
@@ -91,4 +126,209 @@ rendersys* rendersys::find_by_dev(void* dev)
     return f == _dev_indexing.end() ? nullptr : f->second;
 }
 
+static_assert(std::is_same<render_vertex_buffer, render_index_buffer>::value, "the ring takes the index buffers as the vertex buffers.");
+
+static const int ring_shrink_frames = 120;
+
+bool render_ring_buffer::create(rendersys* rsys, render_ring_target target, uint capacity, uint usage)
+{
+    assert(rsys && capacity);
+    destroy();
+    _rsys = rsys;
+    _target = target;
+    _usage = usage;
+    _min_capacity = capacity;
+    return create_buffer(capacity);
+}
+
+void render_ring_buffer::destroy()
+{
+    flush();
+    release_buffer(_buffer);
+    _buffer = nullptr;
+    for(auto& r : _retired)
+        release_buffer(r.buffer);
+    _retired.clear();
+    _capacity = _head = _dirty = 0;
+    _frame_written = false;
+    _frame_start = _frame_carried = _last_used = 0;
+    _idle_frames = 0;
+    _last_size = 0;
+}
+
+bool render_ring_buffer::create_buffer(uint capacity)
+{
+    assert(_rsys && !_buffer);
+    if(_target == rrt_index_buffer) {
+        /* either format could be streamed, the capacity was kept in whole 32 bits indices */
+        capacity = (capacity + 3) & ~3u;
+        _buffer = _rsys->create_index_buffer(capacity / get_index_size(rif_uint32), rif_uint32, false, true, _usage, nullptr);
+    }
+    else
+        _buffer = _rsys->create_vertex_buffer(1, capacity, false, true, _usage, nullptr);
+    if(!_buffer) {
+        assert(!"create ring buffer failed.");
+        _capacity = 0;
+        return false;
+    }
+    _stats.buffers_created ++;
+    _capacity = capacity;
+    _head = _dirty = 0;
+    _discard = true;
+    _last_size = 0;
+    return true;
+}
+
+/* retire the buffer in use, it would be released in the next frame. */
+bool render_ring_buffer::renew_buffer(uint capacity)
+{
+    flush();
+    retired_buffer r = { _buffer, _frame };
+    _retired.push_back(r);
+    _buffer = nullptr;
+    return create_buffer(capacity);
+}
+
+void render_ring_buffer::release_buffer(vertex_buffer* buf)
+{
+    _target == rrt_index_buffer ? release_index_buffer(buf) : release_vertex_buffer(buf);
+}
+
+void render_ring_buffer::begin_frame()
+{
+    _frame ++;
+    _stats = render_ring_stats();
+    /* the draws of the last frame were all issued, the device holds the retired buffers itself if still in use. */
+    for(int i = (int)_retired.size() - 1; i >= 0; i --) {
+        if(_retired.at(i).frame >= _frame)
+            continue;
+        release_buffer(_retired.at(i).buffer);
+        _retired.erase(_retired.begin() + i);
+    }
+    if(_frame_written || _frame_carried)
+        _last_used = get_frame_used();
+    _frame_written = false;
+    _frame_carried = 0;
+    _last_size = 0;
+    if(!_buffer)
+        return;
+    if(_capacity > _min_capacity && _last_used < _capacity / 4) {
+        if(++ _idle_frames >= ring_shrink_frames) {
+            _idle_frames = 0;
+            renew_buffer(gs_max(_capacity / 2, _min_capacity));
+            return;
+        }
+    }
+    else
+        _idle_frames = 0;
+    /* wrap now if this frame might not fit in the rest, it could not wrap over its own writes later. */
+    if(_head && _capacity - _head < _last_used) {
+        flush();
+        _head = 0;
+        _discard = true;
+        _stats.wraps ++;
+    }
+}
+
+void render_ring_buffer::end_frame()
+{
+    flush();
+    _last_used = get_frame_used();
+    _frame_written = false;
+    _frame_carried = 0;
+    _last_size = 0;
+}
+
+bool render_ring_buffer::fit(uint size, uint align, uint& offset) const
+{
+    if(size > _capacity)
+        return false;
+    uint p = (_head + align - 1) / align * align;
+    if(p + size <= _capacity) {
+        offset = p;
+        return true;
+    }
+    /* wrap around with a discard, unless it would throw away the writes of the frame not drawn yet. */
+    if(_frame_written)
+        return false;
+    offset = 0;
+    return true;
+}
+
+byte* render_ring_buffer::map()
+{
+    assert(_rsys && _buffer && !_mapped);
+    _mapped = (byte*)_rsys->map_buffer(_buffer, _discard ? bmm_write_discard : bmm_write_no_overwrite);
+    assert(_mapped);
+    _discard = false;
+    _stats.maps ++;
+    return _mapped;
+}
+
+byte* render_ring_buffer::allocate(uint size, uint align, vertex_buffer*& vb, uint& offset)
+{
+    assert(_buffer && size && align);
+    if(!_buffer)
+        return nullptr;
+    _last_head = _head;
+    _last_written = _frame_written;
+    if(!fit(size, align, offset)) {
+        /* the frame used more than it was expected, grow if it was over the capacity itself, otherwise just renew it. */
+        uint used = get_frame_used();
+        if(!renew_buffer(used + size > _capacity ? gs_max(_capacity * 2, (used + size) * 2) : _capacity))
+            return nullptr;
+        _frame_carried = used;
+        _frame_start = 0;
+        _last_head = 0;
+        verify(fit(size, align, offset));
+    }
+    else if(offset < _head) {
+        flush();
+        _discard = true;
+        _stats.wraps ++;
+    }
+    if(!_mapped) {
+        if(!map())
+            return nullptr;
+        _dirty = offset;
+    }
+    else if(offset < _dirty)
+        _dirty = offset;
+    if(!_frame_written)
+        _frame_start = offset;
+    _head = offset + size;
+    _frame_written = true;
+    _last_size = size;
+    _stats.bytes_written += size;
+    vb = _buffer;
+    return _mapped + offset;
+}
+
+void render_ring_buffer::shrink(uint size)
+{
+    if(!size)
+        return;
+    assert(size <= _last_size);
+    _stats.bytes_written -= size;
+    if(size < _last_size) {
+        _head -= size;
+        _last_size -= size;
+        return;
+    }
+    /* nothing was written at all, undo the allocation. */
+    _head = _last_head;
+    _frame_written = _last_written;
+    _last_size = 0;
+}
+
+void render_ring_buffer::flush()
+{
+    if(!_mapped)
+        return;
+    assert(_rsys && _buffer);
+    _rsys->unmap_buffer(_buffer, _dirty, _head > _dirty ? _head - _dirty : 0);
+    ariel_profile_counter(pci_bytes_uploaded, _head > _dirty ? _head - _dirty : 0);
+    _mapped = nullptr;
+}
+
 __ariel_end__
@@ -148,6 +148,7 @@ bool rendersys_d3d11::setup(uint hwnd, const configs& cfg)
     }
     if(!_device || !_context)
         return false;
+    _immediate = _context;
     /* query MSAA support */
     uint sampler_count = _msaa_x, sampler_quality = 0;
     if(_msaa) {
@@ -279,6 +280,9 @@ bool rendersys_d3d11::setup(uint hwnd, const configs& cfg)
 void rendersys_d3d11::destroy()
 {
     unregister_dev_index_service(_device);
+    SafeRelease(_deferred);
+    _context = _immediate;
+    _immediate = nullptr;
     if(_context)
         _context->ClearState();
     SafeRelease(_blendstate);
@@ -474,12 +478,12 @@ render_vertex_buffer* rendersys_d3d11::create_vertex_buffer(uint stride, uint co
     return FAILED(_device->CreateBuffer(&desc, psd, &vb)) ? 0 : vb;
 }
 
-render_index_buffer* rendersys_d3d11::create_index_buffer(uint count, bool read, bool write, uint usage, const void* ptr)
+render_index_buffer* rendersys_d3d11::create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr)
 {
     D3D11_BUFFER_DESC desc;
     memset(&desc, 0, sizeof(desc));
-    desc.Usage = D3D11_USAGE_DEFAULT;
-    desc.ByteWidth = count << 2;
+    desc.Usage = (D3D11_USAGE)usage;
+    desc.ByteWidth = count * get_index_size(fmt);
     desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
     desc.CPUAccessFlags = 0;
     if(read != false)
@@ -662,6 +666,38 @@ void rendersys_d3d11::update_buffer(void* buf, int size, const void* ptr)
     _context->Unmap((ID3D11Buffer*)buf, 0);
 }
 
+void rendersys_d3d11::update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch)
+{
+    assert(tex && ptr && _context);
+    D3D11_BOX box;
+    box.left = (UINT)rc.left;
+    box.top = (UINT)rc.top;
+    box.right = (UINT)rc.right;
+    box.bottom = (UINT)rc.bottom;
+    box.front = 0;
+    box.back = 1;
+    _context->UpdateSubresource(tex, 0, &box, ptr, (UINT)pitch, 0);
+}
+
+void* rendersys_d3d11::map_buffer(void* buf, buffer_map_mode mode)
+{
+    assert(buf && _context);
+    D3D11_MAPPED_SUBRESOURCE mapres;
+    D3D11_MAP maptype = (mode == bmm_write_no_overwrite) ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+    /* a deferred context should discard a dynamic buffer before it was mapped otherwise in the command list. */
+    if(is_recording() && _discarded.insert(buf).second)
+        maptype = D3D11_MAP_WRITE_DISCARD;
+    if(FAILED(_context->Map((ID3D11Buffer*)buf, 0, maptype, 0, &mapres)))
+        return nullptr;
+    return mapres.pData;
+}
+
+void rendersys_d3d11::unmap_buffer(void* buf, uint offset, uint size)
+{
+    assert(buf && _context);
+    _context->Unmap((ID3D11Buffer*)buf, 0);
+}
+
 void rendersys_d3d11::set_vertex_format(vertex_format* vfmt)
 {
     assert(_context);
@@ -674,10 +710,16 @@ void rendersys_d3d11::set_vertex_buffer(vertex_buffer* vb, uint stride, uint off
     _context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
 }
 
-void rendersys_d3d11::set_index_buffer(index_buffer* ib, uint offset)
+void rendersys_d3d11::set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt)
+{
+    assert(_context);
+    _context->IASetIndexBuffer(ib, fmt == rif_uint16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, offset);
+}
+
+void rendersys_d3d11::set_instance_buffer(vertex_buffer* vb, uint stride, uint offset)
 {
     assert(_context);
-    _context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, offset);
+    _context->IASetVertexBuffers(1, 1, &vb, &stride, &offset);
 }
 
 void rendersys_d3d11::begin_render()
@@ -689,6 +731,9 @@ void rendersys_d3d11::begin_render()
 
 void rendersys_d3d11::end_render()
 {
+    /* the command list was presented after its execution. */
+    if(is_recording())
+        return;
     assert(_swapchain);
     _swapchain->Present(_vsync ? 1 : 0, 0);
 }
@@ -794,8 +839,18 @@ void rendersys_d3d11::draw_indexed(uint count, uint start, int base)
     _context->DrawIndexed(count, start, base);
 }
 
+void rendersys_d3d11::draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance)
+{
+    assert(_context);
+    _context->DrawIndexedInstanced(count, instances, start, base, start_instance);
+}
+
 void rendersys_d3d11::capture_screen(image& img, const rectf& rc, int buff_id)
 {
+    if(is_recording()) {
+        assert(!"capture the screen out of the command lists.");
+        return;
+    }
     texture2d* tex = create_texture2d((int)ceil(rc.width()), (int)ceil(rc.height()), DXGI_FORMAT_R8G8B8A8_UNORM, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_UNORDERED_ACCESS, 0, 0);
     assert(tex);
     com_ptr<ID3D11Texture2D> buffer;
@@ -819,7 +874,8 @@ void rendersys_d3d11::capture_screen(image& img, const rectf& rc, int buff_id)
         com_ptr<ID3D11Texture2D> tmp;
         _device->CreateTexture2D(&desc, nullptr, &tmp);
         assert(tmp.get());
-        _context->ResolveSubresource(tmp.get(), 0, buffer.get(), 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+        sync_immediate_context();
+        _immediate->ResolveSubresource(tmp.get(), 0, buffer.get(), 0, DXGI_FORMAT_R8G8B8A8_UNORM);
         texop.copy_rect(tex, tmp.get(), 0, 0, (int)floorf(rc.left), (int)floorf(rc.top), (int)ceilf(rc.width()), (int)ceilf(rc.height()));
     }
     texop.convert_to_image(img, tex);
@@ -850,4 +906,63 @@ void release_index_buffer(render_index_buffer* buf) { if(buf) buf->Release(); }
 void release_constant_buffer(render_constant_buffer* buf) { if(buf) buf->Release(); }
 void release_texture2d(render_texture2d* tex) { if(tex) tex->Release(); }
 
+/*
+ * The calls were recorded into the deferred context till end_command_list, the device was free threaded so that the
+ * resources could still be created meanwhile, while the immediate context was left to the execution of the lists.
+ */
+bool rendersys_d3d11::begin_command_list()
+{
+    assert(_device && _immediate);
+    if(is_recording()) {
+        assert(!"the command list was already begun.");
+        return false;
+    }
+    if(!_deferred && FAILED(_device->CreateDeferredContext(0, &_deferred)))
+        return false;
+    assert(_deferred);
+    _context = _deferred;
+    _discarded.clear();
+    return true;
+}
+
+render_command_list* rendersys_d3d11::end_command_list()
+{
+    assert(is_recording());
+    render_command_list* cl = nullptr;
+    if(FAILED(_deferred->FinishCommandList(FALSE, &cl)))
+        cl = nullptr;
+    _context = _immediate;
+    _discarded.clear();
+    if(cl) {
+        std::lock_guard<std::mutex> lock(_pending_lock);
+        _pending ++;
+    }
+    return cl;
+}
+
+/* might be called on the render thread, the list was released after the execution. */
+void rendersys_d3d11::execute_command_list(render_command_list* cl, bool present)
+{
+    assert(_immediate && _swapchain);
+    if(cl) {
+        _immediate->ExecuteCommandList(cl, FALSE);
+        cl->Release();
+    }
+    if(present)
+        _swapchain->Present(_vsync ? 1 : 0, 0);
+    if(cl) {
+        std::lock_guard<std::mutex> lock(_pending_lock);
+        _pending --;
+        _pending_cond.notify_all();
+    }
+}
+
+/* the immediate context was used by the render thread till the lists ended were all executed. */
+void rendersys_d3d11::sync_immediate_context()
+{
+    assert(!is_recording());
+    std::unique_lock<std::mutex> lock(_pending_lock);
+    _pending_cond.wait(lock, [this]() { return _pending <= 0; });
+}
+
 __ariel_end__
@@ -0,0 +1,1238 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <chrono>
+#include <gslib/file.h>
+#include <ariel/rendersysrec.h>
+
+#if use_rendersys_d3d_11
+#include <ariel/rendersysd3d11.h>
+#elif use_rendersys_software
+#include <ariel/rendersyssw.h>
+#endif
+
+__ariel_begin__
+
+static const uint rec_stream_magic = 0x63727367;    /* "gsrc" */
+static const uint rec_stream_version = 5;
+
+#if use_rendersys_d3d_11
+static const char*& rec_semantic_name(rendersys::vertex_format_desc& desc) { return desc.SemanticName; }
+#elif use_rendersys_software
+static const char*& rec_semantic_name(rendersys::vertex_format_desc& desc) { return desc.semantic_name; }
+#endif
+
+static inline uint rec_slot_key(uint slot, shader_type st) { return ((uint)st << 16) | slot; }
+
+/* time the forwarded call and count it. */
+class rec_call_timer
+{
+public:
+    rec_call_timer(render_call_stats& st): _stats(st) { _start = std::chrono::steady_clock::now(); }
+    ~rec_call_timer()
+    {
+        _stats.calls ++;
+        _stats.time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+protected:
+    render_call_stats&  _stats;
+    std::chrono::steady_clock::time_point _start;
+};
+
+void render_command_stream::write_bytes(const void* ptr, int len)
+{
+    assert(len >= 0);
+    if(!len)
+        return;
+    assert(ptr);
+    size_t pos = _data.size();
+    _data.resize(pos + len);
+    memcpy(&_data.at(pos), ptr, len);
+}
+
+void render_command_stream::write_blob(const void* ptr, int len)
+{
+    write(ptr ? len : 0);
+    if(ptr)
+        write_bytes(ptr, len);
+}
+
+bool render_command_stream::read_bytes(void* ptr, int len)
+{
+    if(_cursor + len > (int)_data.size()) {
+        _cursor = (int)_data.size();
+        return false;
+    }
+    if(len > 0)
+        memcpy(ptr, &_data.at(_cursor), len);
+    _cursor += len;
+    return true;
+}
+
+const byte* render_command_stream::read_blob(int& len)
+{
+    len = read<int>();
+    if(len <= 0 || _cursor + len > (int)_data.size()) {
+        len = 0;
+        return nullptr;
+    }
+    const byte* p = &_data.at(_cursor);
+    _cursor += len;
+    return p;
+}
+
+bool render_command_stream::save(const gchar* path) const
+{
+    assert(path);
+    file f(path, _t("wb"));
+    if(!f.is_valid())
+        return false;
+    uint header[] = { rec_stream_magic, rec_stream_version };
+    f.put((const byte*)header, (int)sizeof(header));
+    if(!_data.empty())
+        f.put(&_data.front(), (int)_data.size());
+    f.close();
+    return true;
+}
+
+bool render_command_stream::load(const gchar* path)
+{
+    assert(path);
+    clear();
+    file f(path, _t("rb"));
+    if(!f.is_valid())
+        return false;
+    uint header[2];
+    int size = f.size() - (int)sizeof(header);
+    if(size < 0 || f.get((byte*)header, (int)sizeof(header)) != (int)sizeof(header) ||
+        header[0] != rec_stream_magic || header[1] != rec_stream_version
+        ) {
+        assert(!"bad command stream file.");
+        return false;
+    }
+    _data.resize(size);
+    if(size > 0 && f.get(&_data.front(), size) != size) {
+        _data.clear();
+        return false;
+    }
+    return true;
+}
+
+rendersys_recorder::rendersys_recorder(rendersys* target)
+{
+    assert(target);
+    _target = target;
+    _device_info = target->get_device_info();
+    memcpy(_last_bkcr, _bkcr, sizeof(_bkcr));
+    memset(&_viewport, 0, sizeof(_viewport));
+}
+
+bool rendersys_recorder::setup(uint hwnd, const configs& cfg)
+{
+    if(!_target->setup(hwnd, cfg))
+        return false;
+    _device_info = _target->get_device_info();
+    return true;
+}
+
+void rendersys_recorder::destroy()
+{
+    _target->destroy();
+    reset();
+}
+
+void rendersys_recorder::setup_pipeline_state()
+{
+    write_command(rci_setup_pipeline_state);
+    rec_call_timer t(_calls[rci_setup_pipeline_state]);
+    _target->setup_pipeline_state();
+    /* the target might reset its states here, so take the following sets as changes. */
+    clear_states();
+}
+
+render_blob* rendersys_recorder::compile_shader_from_file(const gchar* file, const gchar* entry, const gchar* sm, render_include* inc)
+{
+    /* the compiled blobs were recorded by the creations of the shaders. */
+    return _target->compile_shader_from_file(file, entry, sm, inc);
+}
+
+render_blob* rendersys_recorder::compile_shader_from_memory(const char* src, int len, const gchar* name, const gchar* entry, const gchar* sm, render_include* inc)
+{
+    return _target->compile_shader_from_memory(src, len, name, entry, sm, inc);
+}
+
+#define rec_create_shader(id, method) \
+    write_command(id); \
+    _stream.write_blob(ptr, (int)len); \
+    add_upload(id, len); \
+    rec_call_timer t(_calls[id]); \
+    auto* p = _target->method(ptr, len); \
+    register_object(p); \
+    return p;
+
+vertex_shader* rendersys_recorder::create_vertex_shader(const void* ptr, size_t len) { rec_create_shader(rci_create_vertex_shader, create_vertex_shader); }
+pixel_shader* rendersys_recorder::create_pixel_shader(const void* ptr, size_t len) { rec_create_shader(rci_create_pixel_shader, create_pixel_shader); }
+compute_shader* rendersys_recorder::create_compute_shader(const void* ptr, size_t len) { rec_create_shader(rci_create_compute_shader, create_compute_shader); }
+geometry_shader* rendersys_recorder::create_geometry_shader(const void* ptr, size_t len) { rec_create_shader(rci_create_geometry_shader, create_geometry_shader); }
+hull_shader* rendersys_recorder::create_hull_shader(const void* ptr, size_t len) { rec_create_shader(rci_create_hull_shader, create_hull_shader); }
+domain_shader* rendersys_recorder::create_domain_shader(const void* ptr, size_t len) { rec_create_shader(rci_create_domain_shader, create_domain_shader); }
+
+#undef rec_create_shader
+
+vertex_format* rendersys_recorder::create_vertex_format(const void* ptr, size_t len, vertex_format_desc desc[], uint n)
+{
+    write_command(rci_create_vertex_format);
+    _stream.write_blob(ptr, (int)len);
+    _stream.write(n);
+    for(uint i = 0; i < n; i ++) {
+        const char* name = rec_semantic_name(desc[i]);
+        _stream.write_blob(name, name ? (int)strlen(name) + 1 : 0);
+        _stream.write(desc[i]);
+    }
+    add_upload(rci_create_vertex_format, len);
+    rec_call_timer t(_calls[rci_create_vertex_format]);
+    auto* p = _target->create_vertex_format(ptr, len, desc, n);
+    register_object(p);
+    return p;
+}
+
+rendersys::vertex_buffer* rendersys_recorder::create_vertex_buffer(uint stride, uint count, bool read, bool write, uint usage, const void* ptr)
+{
+    write_command(rci_create_vertex_buffer);
+    _stream.write(stride);
+    _stream.write(count);
+    _stream.write(read);
+    _stream.write(write);
+    _stream.write(usage);
+    _stream.write_blob(ptr, (int)(stride * count));
+    if(ptr)
+        add_upload(rci_create_vertex_buffer, (int64)stride * count);
+    rec_call_timer t(_calls[rci_create_vertex_buffer]);
+    auto* p = _target->create_vertex_buffer(stride, count, read, write, usage, ptr);
+    register_object(p);
+    return p;
+}
+
+rendersys::index_buffer* rendersys_recorder::create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr)
+{
+    write_command(rci_create_index_buffer);
+    _stream.write(count);
+    _stream.write((uint)fmt);
+    _stream.write(read);
+    _stream.write(write);
+    _stream.write(usage);
+    _stream.write_blob(ptr, (int)(count * get_index_size(fmt)));
+    if(ptr)
+        add_upload(rci_create_index_buffer, (int64)count * get_index_size(fmt));
+    rec_call_timer t(_calls[rci_create_index_buffer]);
+    auto* p = _target->create_index_buffer(count, fmt, read, write, usage, ptr);
+    register_object(p);
+    return p;
+}
+
+rendersys::constant_buffer* rendersys_recorder::create_constant_buffer(uint stride, bool read, bool write, const void* ptr)
+{
+    write_command(rci_create_constant_buffer);
+    _stream.write(stride);
+    _stream.write(read);
+    _stream.write(write);
+    _stream.write_blob(ptr, (int)stride);
+    if(ptr)
+        add_upload(rci_create_constant_buffer, stride);
+    rec_call_timer t(_calls[rci_create_constant_buffer]);
+    auto* p = _target->create_constant_buffer(stride, read, write, ptr);
+    register_object(p);
+    return p;
+}
+
+#define rec_create_view(id, method) \
+    write_command(id); \
+    _stream.write(find_object(res)); \
+    add_upload(id, 0); \
+    rec_call_timer t(_calls[id]); \
+    auto* p = _target->method(res); \
+    register_object(p); \
+    return p;
+
+shader_resource_view* rendersys_recorder::create_shader_resource_view(render_resource* res) { rec_create_view(rci_create_shader_resource_view, create_shader_resource_view); }
+depth_stencil_view* rendersys_recorder::create_depth_stencil_view(render_resource* res) { rec_create_view(rci_create_depth_stencil_view, create_depth_stencil_view); }
+unordered_access_view* rendersys_recorder::create_unordered_access_view(render_resource* res) { rec_create_view(rci_create_unordered_access_view, create_unordered_access_view); }
+
+#undef rec_create_view
+
+rendersys::sampler_state* rendersys_recorder::create_sampler_state(sampler_state_filter filter)
+{
+    write_command(rci_create_sampler_state);
+    _stream.write((uint)filter);
+    add_upload(rci_create_sampler_state, 0);
+    rec_call_timer t(_calls[rci_create_sampler_state]);
+    auto* p = _target->create_sampler_state(filter);
+    register_object(p);
+    return p;
+}
+
+rendersys::texture2d* rendersys_recorder::create_texture2d(const image& img, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags)
+{
+    write_command(rci_create_texture2d_from_image);
+    write_image(img);
+    _stream.write(mips);
+    _stream.write(usage);
+    _stream.write(bindflags);
+    _stream.write(cpuflags);
+    _stream.write(miscflags);
+    add_upload(rci_create_texture2d_from_image, (int64)img.get_bytes_per_line() * img.get_height());
+    rec_call_timer t(_calls[rci_create_texture2d_from_image]);
+    auto* p = _target->create_texture2d(img, mips, usage, bindflags, cpuflags, miscflags);
+    register_object(p);
+    return p;
+}
+
+rendersys::texture2d* rendersys_recorder::create_texture2d(int width, int height, uint format, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags)
+{
+    write_command(rci_create_texture2d);
+    _stream.write(width);
+    _stream.write(height);
+    _stream.write(format);
+    _stream.write(mips);
+    _stream.write(usage);
+    _stream.write(bindflags);
+    _stream.write(cpuflags);
+    _stream.write(miscflags);
+    add_upload(rci_create_texture2d, 0);
+    rec_call_timer t(_calls[rci_create_texture2d]);
+    auto* p = _target->create_texture2d(width, height, format, mips, usage, bindflags, cpuflags, miscflags);
+    register_object(p);
+    return p;
+}
+
+void rendersys_recorder::load_with_mips(texture2d* tex, const image& img)
+{
+    write_command(rci_load_with_mips);
+    _stream.write(find_object(tex));
+    write_image(img);
+    add_upload(rci_load_with_mips, (int64)img.get_bytes_per_line() * img.get_height());
+    _current.buffer_updates ++;
+    rec_call_timer t(_calls[rci_load_with_mips]);
+    _target->load_with_mips(tex, img);
+}
+
+void rendersys_recorder::update_buffer(void* buf, int size, const void* ptr)
+{
+    write_command(rci_update_buffer);
+    _stream.write(find_object(buf));
+    _stream.write_blob(ptr, size);
+    add_upload(rci_update_buffer, size);
+    _current.buffer_updates ++;
+    rec_call_timer t(_calls[rci_update_buffer]);
+    _target->update_buffer(buf, size, ptr);
+}
+
+void rendersys_recorder::update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch)
+{
+    write_command(rci_update_texture2d);
+    _stream.write(find_object(tex));
+    _stream.write(rc);
+    /* the rows were packed tightly as a blob. */
+    int bpl = rc.width() * 4;
+    _stream.write(bpl * rc.height());
+    for(int i = 0; i < rc.height(); i ++)
+        _stream.write_bytes((const byte*)ptr + pitch * i, bpl);
+    add_upload(rci_update_texture2d, (int64)bpl * rc.height());
+    _current.buffer_updates ++;
+    rec_call_timer t(_calls[rci_update_texture2d]);
+    _target->update_texture2d(tex, rc, ptr, pitch);
+}
+
+void* rendersys_recorder::map_buffer(void* buf, buffer_map_mode mode)
+{
+    write_command(rci_map_buffer);
+    _stream.write(find_object(buf));
+    _stream.write((byte)mode);
+    rec_call_timer t(_calls[rci_map_buffer]);
+    void* ptr = _target->map_buffer(buf, mode);
+    if(ptr)
+        _mapped[buf] = (const byte*)ptr;
+    return ptr;
+}
+
+void rendersys_recorder::unmap_buffer(void* buf, uint offset, uint size)
+{
+    auto f = _mapped.find(buf);
+    assert(f != _mapped.end());
+    const byte* ptr = (f == _mapped.end()) ? nullptr : f->second + offset;
+    write_command(rci_unmap_buffer);
+    _stream.write(find_object(buf));
+    _stream.write(offset);
+    _stream.write_blob(ptr, (int)size);
+    if(f != _mapped.end())
+        _mapped.erase(f);
+    add_upload(rci_unmap_buffer, size);
+    _current.buffer_updates ++;
+    rec_call_timer t(_calls[rci_unmap_buffer]);
+    _target->unmap_buffer(buf, offset, size);
+}
+
+void rendersys_recorder::set_vertex_format(vertex_format* vfmt)
+{
+    write_command(rci_set_vertex_format);
+    _stream.write(find_object(vfmt));
+    add_state(_vertex_format != vfmt);
+    _vertex_format = vfmt;
+    rec_call_timer t(_calls[rci_set_vertex_format]);
+    _target->set_vertex_format(vfmt);
+}
+
+void rendersys_recorder::set_vertex_buffer(vertex_buffer* vb, uint stride, uint offset)
+{
+    write_command(rci_set_vertex_buffer);
+    _stream.write(find_object(vb));
+    _stream.write(stride);
+    _stream.write(offset);
+    add_state(_vertex_buffer != vb || _vertex_stride != stride || _vertex_offset != offset);
+    _vertex_buffer = vb;
+    _vertex_stride = stride;
+    _vertex_offset = offset;
+    rec_call_timer t(_calls[rci_set_vertex_buffer]);
+    _target->set_vertex_buffer(vb, stride, offset);
+}
+
+void rendersys_recorder::set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt)
+{
+    write_command(rci_set_index_buffer);
+    _stream.write(find_object(ib));
+    _stream.write(offset);
+    _stream.write((uint)fmt);
+    add_state(_index_buffer != ib || _index_offset != offset || _index_format != fmt);
+    _index_buffer = ib;
+    _index_offset = offset;
+    _index_format = fmt;
+    rec_call_timer t(_calls[rci_set_index_buffer]);
+    _target->set_index_buffer(ib, offset, fmt);
+}
+
+void rendersys_recorder::set_instance_buffer(vertex_buffer* vb, uint stride, uint offset)
+{
+    write_command(rci_set_instance_buffer);
+    _stream.write(find_object(vb));
+    _stream.write(stride);
+    _stream.write(offset);
+    add_state(_instance_buffer != vb || _instance_stride != stride || _instance_offset != offset);
+    _instance_buffer = vb;
+    _instance_stride = stride;
+    _instance_offset = offset;
+    rec_call_timer t(_calls[rci_set_instance_buffer]);
+    _target->set_instance_buffer(vb, stride, offset);
+}
+
+void rendersys_recorder::begin_render()
+{
+    write_command(rci_begin_render);
+    bool bkcr_changed = memcmp(_last_bkcr, _bkcr, sizeof(_bkcr)) != 0;
+    color cr((int)(_bkcr[0] * 255.f + 0.5f), (int)(_bkcr[1] * 255.f + 0.5f), (int)(_bkcr[2] * 255.f + 0.5f), (int)(_bkcr[3] * 255.f + 0.5f));
+    _stream.write(bkcr_changed);
+    if(bkcr_changed) {
+        _stream.write(cr);
+        memcpy(_last_bkcr, _bkcr, sizeof(_bkcr));
+        _target->set_background_color(cr);
+    }
+    rec_call_timer t(_calls[rci_begin_render]);
+    _target->begin_render();
+}
+
+void rendersys_recorder::end_render()
+{
+    write_command(rci_end_render);
+    {
+        rec_call_timer t(_calls[rci_end_render]);
+        _target->end_render();
+    }
+    _frames.push_back(_current);
+    _current = render_frame_stats();
+}
+
+void rendersys_recorder::set_render_option(render_option opt, uint val)
+{
+    write_command(rci_set_render_option);
+    _stream.write((uint)opt);
+    _stream.write(val);
+    auto f = _options.find((uint)opt);
+    add_state(f == _options.end() || f->second != val);
+    _options[(uint)opt] = val;
+    rec_call_timer t(_calls[rci_set_render_option]);
+    _target->set_render_option(opt, val);
+}
+
+void rendersys_recorder::set_vertex_shader(vertex_shader* vs)
+{
+    write_command(rci_set_vertex_shader);
+    _stream.write(find_object(vs));
+    add_state(_vertex_shader != vs);
+    _vertex_shader = vs;
+    rec_call_timer t(_calls[rci_set_vertex_shader]);
+    _target->set_vertex_shader(vs);
+}
+
+void rendersys_recorder::set_pixel_shader(pixel_shader* ps)
+{
+    write_command(rci_set_pixel_shader);
+    _stream.write(find_object(ps));
+    add_state(_pixel_shader != ps);
+    _pixel_shader = ps;
+    rec_call_timer t(_calls[rci_set_pixel_shader]);
+    _target->set_pixel_shader(ps);
+}
+
+void rendersys_recorder::set_geometry_shader(geometry_shader* gs)
+{
+    write_command(rci_set_geometry_shader);
+    _stream.write(find_object(gs));
+    add_state(_geometry_shader != gs);
+    _geometry_shader = gs;
+    rec_call_timer t(_calls[rci_set_geometry_shader]);
+    _target->set_geometry_shader(gs);
+}
+
+void rendersys_recorder::set_viewport(const viewport& vp)
+{
+    write_command(rci_set_viewport);
+    _stream.write(vp);
+    add_state(!_viewport_valid || memcmp(&_viewport, &vp, sizeof(vp)) != 0);
+    _viewport = vp;
+    _viewport_valid = true;
+    rec_call_timer t(_calls[rci_set_viewport]);
+    _target->set_viewport(vp);
+}
+
+void rendersys_recorder::set_constant_buffer(uint slot, constant_buffer* cb, shader_type st)
+{
+    write_command(rci_set_constant_buffer);
+    _stream.write(slot);
+    _stream.write(find_object(cb));
+    _stream.write((uint)st);
+    add_state(update_binding(_constant_buffers, slot, st, cb));
+    rec_call_timer t(_calls[rci_set_constant_buffer]);
+    _target->set_constant_buffer(slot, cb, st);
+}
+
+void rendersys_recorder::set_sampler_state(uint slot, sampler_state* sstate, shader_type st)
+{
+    write_command(rci_set_sampler_state);
+    _stream.write(slot);
+    _stream.write(find_object(sstate));
+    _stream.write((uint)st);
+    add_state(update_binding(_sampler_states, slot, st, sstate));
+    rec_call_timer t(_calls[rci_set_sampler_state]);
+    _target->set_sampler_state(slot, sstate, st);
+}
+
+void rendersys_recorder::set_shader_resource(uint slot, shader_resource_view* srv, shader_type st)
+{
+    write_command(rci_set_shader_resource);
+    _stream.write(slot);
+    _stream.write(find_object(srv));
+    _stream.write((uint)st);
+    add_state(update_binding(_shader_resources, slot, st, srv));
+    rec_call_timer t(_calls[rci_set_shader_resource]);
+    _target->set_shader_resource(slot, srv, st);
+}
+
+void rendersys_recorder::draw(uint count, uint start)
+{
+    write_command(rci_draw);
+    _stream.write(count);
+    _stream.write(start);
+    _current.draw_calls ++;
+    _current.vertices += (int)count;
+    rec_call_timer t(_calls[rci_draw]);
+    _target->draw(count, start);
+}
+
+void rendersys_recorder::draw_indexed(uint count, uint start, int base)
+{
+    write_command(rci_draw_indexed);
+    _stream.write(count);
+    _stream.write(start);
+    _stream.write(base);
+    _current.draw_calls ++;
+    _current.vertices += (int)count;
+    rec_call_timer t(_calls[rci_draw_indexed]);
+    _target->draw_indexed(count, start, base);
+}
+
+void rendersys_recorder::draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance)
+{
+    write_command(rci_draw_indexed_instanced);
+    _stream.write(count);
+    _stream.write(instances);
+    _stream.write(start);
+    _stream.write(base);
+    _stream.write(start_instance);
+    _current.draw_calls ++;
+    _current.vertices += (int)(count * instances);
+    rec_call_timer t(_calls[rci_draw_indexed_instanced]);
+    _target->draw_indexed_instanced(count, instances, start, base, start_instance);
+}
+
+void rendersys_recorder::capture_screen(image& img, const rectf& rc, int buff_id)
+{
+    _target->capture_screen(img, rc, buff_id);
+}
+
+void rendersys_recorder::enable_alpha_blend(bool b)
+{
+    write_command(rci_enable_alpha_blend);
+    _stream.write(b);
+    add_state(_alpha_blend != (int)b);
+    _alpha_blend = (int)b;
+    rec_call_timer t(_calls[rci_enable_alpha_blend]);
+    _target->enable_alpha_blend(b);
+}
+
+void rendersys_recorder::enable_depth(bool b)
+{
+    write_command(rci_enable_depth);
+    _stream.write(b);
+    add_state(_depth != (int)b);
+    _depth = (int)b;
+    rec_call_timer t(_calls[rci_enable_depth]);
+    _target->enable_depth(b);
+}
+
+uint rendersys_recorder::register_object(const void* p)
+{
+    /* the id was taken even if the creation failed, to keep the order the same as the replay. */
+    uint id = _next_id ++;
+    if(p)
+        _ids[p] = id;
+    return id;
+}
+
+uint rendersys_recorder::find_object(const void* p) const
+{
+    if(!p)
+        return 0;
+    auto f = _ids.find(p);
+    return f == _ids.end() ? 0 : f->second;
+}
+
+void rendersys_recorder::write_image(const image& img)
+{
+    bool valid = img.is_valid();
+    _stream.write(valid);
+    if(!valid)
+        return;
+    int w = img.get_width(), h = img.get_height(), bpl = img.get_bytes_per_line();
+    _stream.write((uint)img.get_format());
+    _stream.write(w);
+    _stream.write(h);
+    _stream.write(img.has_alpha());
+    _stream.write(bpl);
+    for(int i = 0; i < h; i ++)
+        _stream.write_bytes(img.get_data(0, i), bpl);
+}
+
+void rendersys_recorder::add_upload(render_command_id id, int64 bytes)
+{
+    _calls[id].bytes += bytes;
+    _current.bytes_uploaded += bytes;
+    if(id < rci_load_with_mips)
+        _current.creations ++;
+}
+
+void rendersys_recorder::add_state(bool changed)
+{
+    if(changed)
+        _current.state_changes ++;
+    else
+        _current.redundant_states ++;
+}
+
+bool rendersys_recorder::update_binding(slot_bindings& bindings, uint slot, shader_type st, const void* p)
+{
+    uint key = rec_slot_key(slot, st);
+    auto f = bindings.find(key);
+    if(f != bindings.end() && f->second == p)
+        return false;
+    bindings[key] = p;
+    return true;
+}
+
+void rendersys_recorder::clear_states()
+{
+    _vertex_format = nullptr;
+    _vertex_buffer = nullptr;
+    _vertex_stride = 0;
+    _vertex_offset = 0;
+    _index_buffer = nullptr;
+    _index_offset = 0;
+    _index_format = rif_uint32;
+    _instance_buffer = nullptr;
+    _instance_stride = 0;
+    _instance_offset = 0;
+    _vertex_shader = nullptr;
+    _pixel_shader = nullptr;
+    _geometry_shader = nullptr;
+    _viewport_valid = false;
+    _alpha_blend = -1;
+    _depth = -1;
+    _options.clear();
+    _constant_buffers.clear();
+    _sampler_states.clear();
+    _shader_resources.clear();
+}
+
+void rendersys_recorder::reset()
+{
+    _stream.clear();
+    _ids.clear();
+    _next_id = 1;
+    _frames.clear();
+    _current = render_frame_stats();
+    for(render_call_stats& st : _calls)
+        st = render_call_stats();
+    clear_states();
+}
+
+void rendersys_recorder::get_report(string& str) const
+{
+    string s;
+    render_frame_stats total;
+    str.format(_t("frames: %d, stream: %d bytes\n"), (int)_frames.size(), _stream.get_size());
+    str.append(_t("frame\tdraws\tvertices\tstates\tredundant\tupdates\tcreations\tuploaded\n"));
+    for(int i = 0; i < (int)_frames.size(); i ++) {
+        const render_frame_stats& fs = _frames.at(i);
+        s.format(_t("%d\t%d\t%d\t%d\t%d\t%d\t%d\t%lld\n"), i, fs.draw_calls, fs.vertices, fs.state_changes,
+            fs.redundant_states, fs.buffer_updates, fs.creations, fs.bytes_uploaded
+            );
+        str.append(s);
+        total.draw_calls += fs.draw_calls;
+        total.vertices += fs.vertices;
+        total.state_changes += fs.state_changes;
+        total.redundant_states += fs.redundant_states;
+        total.buffer_updates += fs.buffer_updates;
+        total.creations += fs.creations;
+        total.bytes_uploaded += fs.bytes_uploaded;
+    }
+    if(!_frames.empty()) {
+        float n = (float)_frames.size();
+        s.format(_t("avg\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n"), total.draw_calls / n, total.vertices / n,
+            total.state_changes / n, total.redundant_states / n, total.buffer_updates / n, total.creations / n,
+            (float)total.bytes_uploaded / n
+            );
+        str.append(s);
+    }
+    str.append(_t("call\tcount\tbytes\ttime(ms)\tavg(us)\n"));
+    for(int i = 0; i < rci_count; i ++) {
+        const render_call_stats& st = _calls[i];
+        if(!st.calls)
+            continue;
+        s.format(_t("%s\t%d\t%lld\t%.3f\t%.3f\n"), get_command_name((render_command_id)i), st.calls, st.bytes, st.time,
+            st.time * 1000.0 / st.calls
+            );
+        str.append(s);
+    }
+}
+
+const gchar* rendersys_recorder::get_command_name(render_command_id id)
+{
+    static const gchar* names[] =
+    {
+        _t("create_vertex_shader"),
+        _t("create_pixel_shader"),
+        _t("create_compute_shader"),
+        _t("create_geometry_shader"),
+        _t("create_hull_shader"),
+        _t("create_domain_shader"),
+        _t("create_vertex_format"),
+        _t("create_vertex_buffer"),
+        _t("create_index_buffer"),
+        _t("create_constant_buffer"),
+        _t("create_shader_resource_view"),
+        _t("create_depth_stencil_view"),
+        _t("create_unordered_access_view"),
+        _t("create_sampler_state"),
+        _t("create_texture2d_from_image"),
+        _t("create_texture2d"),
+        _t("load_with_mips"),
+        _t("update_buffer"),
+        _t("update_texture2d"),
+        _t("map_buffer"),
+        _t("unmap_buffer"),
+        _t("set_vertex_format"),
+        _t("set_vertex_buffer"),
+        _t("set_index_buffer"),
+        _t("set_instance_buffer"),
+        _t("begin_render"),
+        _t("end_render"),
+        _t("setup_pipeline_state"),
+        _t("set_render_option"),
+        _t("set_vertex_shader"),
+        _t("set_pixel_shader"),
+        _t("set_geometry_shader"),
+        _t("set_viewport"),
+        _t("set_constant_buffer"),
+        _t("set_sampler_state"),
+        _t("set_shader_resource"),
+        _t("draw"),
+        _t("draw_indexed"),
+        _t("draw_indexed_instanced"),
+        _t("enable_alpha_blend"),
+        _t("enable_depth"),
+    };
+    static_assert(_countof(names) == rci_count, "command names mismatch.");
+    assert(id >= 0 && id < rci_count);
+    return names[id];
+}
+
+template<class _ty>
+static void rec_release(void* p)
+{
+    if(p)
+        static_cast<_ty*>(p)->Release();
+}
+
+void render_command_replayer::release_objects()
+{
+    for(object& obj : _objects) {
+        switch(obj.kind)
+        {
+        case rci_create_vertex_shader:
+            rec_release<vertex_shader>(obj.ptr);
+            break;
+        case rci_create_pixel_shader:
+            rec_release<pixel_shader>(obj.ptr);
+            break;
+        case rci_create_compute_shader:
+            rec_release<compute_shader>(obj.ptr);
+            break;
+        case rci_create_geometry_shader:
+            rec_release<geometry_shader>(obj.ptr);
+            break;
+        case rci_create_hull_shader:
+            rec_release<hull_shader>(obj.ptr);
+            break;
+        case rci_create_domain_shader:
+            rec_release<domain_shader>(obj.ptr);
+            break;
+        case rci_create_vertex_format:
+            rec_release<vertex_format>(obj.ptr);
+            break;
+        case rci_create_vertex_buffer:
+            rec_release<render_vertex_buffer>(obj.ptr);
+            break;
+        case rci_create_index_buffer:
+            rec_release<render_index_buffer>(obj.ptr);
+            break;
+        case rci_create_constant_buffer:
+            rec_release<render_constant_buffer>(obj.ptr);
+            break;
+        case rci_create_shader_resource_view:
+            rec_release<shader_resource_view>(obj.ptr);
+            break;
+        case rci_create_depth_stencil_view:
+            rec_release<depth_stencil_view>(obj.ptr);
+            break;
+        case rci_create_unordered_access_view:
+            rec_release<unordered_access_view>(obj.ptr);
+            break;
+        case rci_create_sampler_state:
+            rec_release<render_sampler_state>(obj.ptr);
+            break;
+        case rci_create_texture2d_from_image:
+        case rci_create_texture2d:
+            rec_release<render_texture2d>(obj.ptr);
+            break;
+        default:
+            assert(!"unexpected object.");
+            break;
+        }
+    }
+    _objects.clear();
+    _semantic_names.clear();
+    _mapped.clear();
+}
+
+int render_command_replayer::replay(render_command_stream& stm)
+{
+    int frames = 0;
+    stm.rewind();
+    while(!stm.is_end()) {
+        uint id = stm.read<byte>();
+        if(id >= rci_count || !replay_command(stm, (render_command_id)id)) {
+            assert(!"corrupted command stream.");
+            break;
+        }
+        if(id == rci_end_render)
+            frames ++;
+    }
+    return frames;
+}
+
+void render_command_replayer::add_object(render_command_id kind, void* ptr, render_resource* res)
+{
+    object obj;
+    obj.kind = kind;
+    obj.ptr = ptr;
+    obj.resource = res;
+    _objects.push_back(obj);
+}
+
+void* render_command_replayer::get_object(uint id) const
+{
+    if(!id || id > (uint)_objects.size())
+        return nullptr;
+    return _objects.at(id - 1).ptr;
+}
+
+render_resource* render_command_replayer::get_resource(uint id) const
+{
+    if(!id || id > (uint)_objects.size())
+        return nullptr;
+    return _objects.at(id - 1).resource;
+}
+
+void render_command_replayer::read_image(render_command_stream& stm, image& img)
+{
+    if(!stm.read<bool>())
+        return;
+    auto fmt = (image::image_format)stm.read<uint>();
+    int w = stm.read<int>();
+    int h = stm.read<int>();
+    bool alpha = stm.read<bool>();
+    int bpl = stm.read<int>();
+    if(w <= 0 || h <= 0 || !img.create(fmt, w, h)) {
+        assert(!"bad image in command stream.");
+        return;
+    }
+    img.enable_alpha_channel(alpha);
+    assert(bpl == img.get_bytes_per_line());
+    for(int i = 0; i < h; i ++)
+        stm.read_bytes(img.get_data(0, i), bpl);
+}
+
+bool render_command_replayer::replay_command(render_command_stream& stm, render_command_id id)
+{
+    int len = 0;
+    switch(id)
+    {
+    case rci_create_vertex_shader:
+    case rci_create_pixel_shader:
+    case rci_create_compute_shader:
+    case rci_create_geometry_shader:
+    case rci_create_hull_shader:
+    case rci_create_domain_shader:
+        {
+            const byte* ptr = stm.read_blob(len);
+            void* p = nullptr;
+            if(ptr) {
+                switch(id)
+                {
+                case rci_create_vertex_shader:
+                    p = _rsys->create_vertex_shader(ptr, len);
+                    break;
+                case rci_create_pixel_shader:
+                    p = _rsys->create_pixel_shader(ptr, len);
+                    break;
+                case rci_create_compute_shader:
+                    p = _rsys->create_compute_shader(ptr, len);
+                    break;
+                case rci_create_geometry_shader:
+                    p = _rsys->create_geometry_shader(ptr, len);
+                    break;
+                case rci_create_hull_shader:
+                    p = _rsys->create_hull_shader(ptr, len);
+                    break;
+                default:
+                    p = _rsys->create_domain_shader(ptr, len);
+                    break;
+                }
+            }
+            add_object(id, p);
+            return true;
+        }
+    case rci_create_vertex_format:
+        {
+            const byte* ptr = stm.read_blob(len);
+            uint n = stm.read<uint>();
+            vector<rendersys::vertex_format_desc> desc;
+            desc.resize(n);
+            for(uint i = 0; i < n; i ++) {
+                int namelen = 0;
+                const char* name = (const char*)stm.read_blob(namelen);
+                if(!stm.read_bytes(&desc.at(i), sizeof(rendersys::vertex_format_desc)))
+                    return false;
+                /* the desc may keep the name, so hold a copy of it. */
+                if(name) {
+                    _semantic_names.push_back(_string<char>(name));
+                    rec_semantic_name(desc.at(i)) = _semantic_names.back().c_str();
+                }
+                else
+                    rec_semantic_name(desc.at(i)) = nullptr;
+            }
+            add_object(id, n ? _rsys->create_vertex_format(ptr, len, &desc.front(), n) : nullptr);
+            return true;
+        }
+    case rci_create_vertex_buffer:
+        {
+            uint stride = stm.read<uint>();
+            uint count = stm.read<uint>();
+            bool read = stm.read<bool>();
+            bool write = stm.read<bool>();
+            uint usage = stm.read<uint>();
+            const byte* ptr = stm.read_blob(len);
+            auto* p = _rsys->create_vertex_buffer(stride, count, read, write, usage, ptr);
+            add_object(id, p, p ? convert_to_resource(p) : nullptr);
+            return true;
+        }
+    case rci_create_index_buffer:
+        {
+            uint count = stm.read<uint>();
+            auto fmt = (render_index_format)stm.read<uint>();
+            bool read = stm.read<bool>();
+            bool write = stm.read<bool>();
+            uint usage = stm.read<uint>();
+            const byte* ptr = stm.read_blob(len);
+            auto* p = _rsys->create_index_buffer(count, fmt, read, write, usage, ptr);
+            add_object(id, p, p ? convert_to_resource(p) : nullptr);
+            return true;
+        }
+    case rci_create_constant_buffer:
+        {
+            uint stride = stm.read<uint>();
+            bool read = stm.read<bool>();
+            bool write = stm.read<bool>();
+            const byte* ptr = stm.read_blob(len);
+            auto* p = _rsys->create_constant_buffer(stride, read, write, ptr);
+            add_object(id, p, p ? convert_to_resource(p) : nullptr);
+            return true;
+        }
+    case rci_create_shader_resource_view:
+    case rci_create_depth_stencil_view:
+    case rci_create_unordered_access_view:
+        {
+            render_resource* res = get_resource(stm.read<uint>());
+            void* p = nullptr;
+            if(res) {
+                if(id == rci_create_shader_resource_view)
+                    p = _rsys->create_shader_resource_view(res);
+                else if(id == rci_create_depth_stencil_view)
+                    p = _rsys->create_depth_stencil_view(res);
+                else
+                    p = _rsys->create_unordered_access_view(res);
+            }
+            add_object(id, p);
+            return true;
+        }
+    case rci_create_sampler_state:
+        add_object(id, _rsys->create_sampler_state((sampler_state_filter)stm.read<uint>()));
+        return true;
+    case rci_create_texture2d_from_image:
+        {
+            image img;
+            read_image(stm, img);
+            uint mips = stm.read<uint>();
+            uint usage = stm.read<uint>();
+            uint bindflags = stm.read<uint>();
+            uint cpuflags = stm.read<uint>();
+            uint miscflags = stm.read<uint>();
+            auto* p = img.is_valid() ? _rsys->create_texture2d(img, mips, usage, bindflags, cpuflags, miscflags) : nullptr;
+            add_object(id, p, p ? convert_to_resource(p) : nullptr);
+            return true;
+        }
+    case rci_create_texture2d:
+        {
+            int width = stm.read<int>();
+            int height = stm.read<int>();
+            uint format = stm.read<uint>();
+            uint mips = stm.read<uint>();
+            uint usage = stm.read<uint>();
+            uint bindflags = stm.read<uint>();
+            uint cpuflags = stm.read<uint>();
+            uint miscflags = stm.read<uint>();
+            auto* p = _rsys->create_texture2d(width, height, format, mips, usage, bindflags, cpuflags, miscflags);
+            add_object(id, p, p ? convert_to_resource(p) : nullptr);
+            return true;
+        }
+    case rci_load_with_mips:
+        {
+            auto* tex = (rendersys::texture2d*)get_object(stm.read<uint>());
+            image img;
+            read_image(stm, img);
+            if(tex && img.is_valid())
+                _rsys->load_with_mips(tex, img);
+            return true;
+        }
+    case rci_update_buffer:
+        {
+            void* buf = get_object(stm.read<uint>());
+            const byte* ptr = stm.read_blob(len);
+            if(buf && ptr)
+                _rsys->update_buffer(buf, len, ptr);
+            return true;
+        }
+    case rci_update_texture2d:
+        {
+            auto* tex = (rendersys::texture2d*)get_object(stm.read<uint>());
+            rect rc = stm.read<rect>();
+            const byte* ptr = stm.read_blob(len);
+            if(tex && ptr && len == rc.width() * rc.height() * 4)
+                _rsys->update_texture2d(tex, rc, ptr, rc.width() * 4);
+            return true;
+        }
+    case rci_map_buffer:
+        {
+            void* buf = get_object(stm.read<uint>());
+            auto mode = (buffer_map_mode)stm.read<byte>();
+            if(buf) {
+                if(auto* ptr = (byte*)_rsys->map_buffer(buf, mode))
+                    _mapped[buf] = ptr;
+            }
+            return true;
+        }
+    case rci_unmap_buffer:
+        {
+            void* buf = get_object(stm.read<uint>());
+            uint offset = stm.read<uint>();
+            const byte* ptr = stm.read_blob(len);
+            auto f = _mapped.find(buf);
+            if(f == _mapped.end())
+                return true;
+            if(ptr && len > 0)
+                memcpy(f->second + offset, ptr, len);
+            _rsys->unmap_buffer(buf, offset, (uint)len);
+            _mapped.erase(f);
+            return true;
+        }
+    case rci_set_vertex_format:
+        _rsys->set_vertex_format((vertex_format*)get_object(stm.read<uint>()));
+        return true;
+    case rci_set_vertex_buffer:
+        {
+            auto* vb = (rendersys::vertex_buffer*)get_object(stm.read<uint>());
+            uint stride = stm.read<uint>();
+            uint offset = stm.read<uint>();
+            _rsys->set_vertex_buffer(vb, stride, offset);
+            return true;
+        }
+    case rci_set_index_buffer:
+        {
+            auto* ib = (rendersys::index_buffer*)get_object(stm.read<uint>());
+            uint offset = stm.read<uint>();
+            auto fmt = (render_index_format)stm.read<uint>();
+            _rsys->set_index_buffer(ib, offset, fmt);
+            return true;
+        }
+    case rci_set_instance_buffer:
+        {
+            auto* vb = (rendersys::vertex_buffer*)get_object(stm.read<uint>());
+            uint stride = stm.read<uint>();
+            uint offset = stm.read<uint>();
+            _rsys->set_instance_buffer(vb, stride, offset);
+            return true;
+        }
+    case rci_begin_render:
+        if(stm.read<bool>())
+            _rsys->set_background_color(stm.read<color>());
+        _rsys->begin_render();
+        return true;
+    case rci_end_render:
+        _rsys->end_render();
+        return true;
+    case rci_setup_pipeline_state:
+        _rsys->setup_pipeline_state();
+        return true;
+    case rci_set_render_option:
+        {
+            auto opt = (render_option)stm.read<uint>();
+            uint val = stm.read<uint>();
+            _rsys->set_render_option(opt, val);
+            return true;
+        }
+    case rci_set_vertex_shader:
+        _rsys->set_vertex_shader((vertex_shader*)get_object(stm.read<uint>()));
+        return true;
+    case rci_set_pixel_shader:
+        _rsys->set_pixel_shader((pixel_shader*)get_object(stm.read<uint>()));
+        return true;
+    case rci_set_geometry_shader:
+        _rsys->set_geometry_shader((geometry_shader*)get_object(stm.read<uint>()));
+        return true;
+    case rci_set_viewport:
+        _rsys->set_viewport(stm.read<viewport>());
+        return true;
+    case rci_set_constant_buffer:
+    case rci_set_sampler_state:
+    case rci_set_shader_resource:
+        {
+            uint slot = stm.read<uint>();
+            void* p = get_object(stm.read<uint>());
+            auto st = (shader_type)stm.read<uint>();
+            if(id == rci_set_constant_buffer)
+                _rsys->set_constant_buffer(slot, (rendersys::constant_buffer*)p, st);
+            else if(id == rci_set_sampler_state)
+                _rsys->set_sampler_state(slot, (rendersys::sampler_state*)p, st);
+            else
+                _rsys->set_shader_resource(slot, (shader_resource_view*)p, st);
+            return true;
+        }
+    case rci_draw:
+        {
+            uint count = stm.read<uint>();
+            uint start = stm.read<uint>();
+            _rsys->draw(count, start);
+            return true;
+        }
+    case rci_draw_indexed:
+        {
+            uint count = stm.read<uint>();
+            uint start = stm.read<uint>();
+            int base = stm.read<int>();
+            _rsys->draw_indexed(count, start, base);
+            return true;
+        }
+    case rci_draw_indexed_instanced:
+        {
+            uint count = stm.read<uint>();
+            uint instances = stm.read<uint>();
+            uint start = stm.read<uint>();
+            int base = stm.read<int>();
+            uint start_instance = stm.read<uint>();
+            _rsys->draw_indexed_instanced(count, instances, start, base, start_instance);
+            return true;
+        }
+    case rci_enable_alpha_blend:
+        _rsys->enable_alpha_blend(stm.read<bool>());
+        return true;
+    case rci_enable_depth:
+        _rsys->enable_depth(stm.read<bool>());
+        return true;
+    default:
+        return false;
+    }
+}
+
+__ariel_end__
@@ -0,0 +1,867 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ariel/config.h>
+
+#if use_rendersys_software
+
+#include <chrono>
+#include <xmmintrin.h>
+#include <ariel/type.h>
+#include <ariel/rendersyssw.h>
+
+__ariel_begin__
+
+static const int sw_vertex_chunk = 1024;
+static const int sw_triangle_chunk = 512;
+
+static uint sw_get_format_size(uint format)
+{
+    switch(format)
+    {
+    case sw_format_r32_float:
+    case sw_format_r8g8b8a8_unorm:
+    case sw_format_r32_uint:
+    case sw_format_r16g16_float:
+        return 4;
+    case sw_format_r32g32_float:
+    case sw_format_r16g16b16a16_float:
+        return 8;
+    case sw_format_r32g32b32_float:
+        return 12;
+    case sw_format_r32g32b32a32_float:
+        return 16;
+    default:
+        assert(!"unexpected format.");
+        return 0;
+    }
+}
+
+static vec4 sw_fetch_texel(const image& img, int x, int y)
+{
+    const byte* p = img.get_data(x, y);
+    assert(p);
+    static const float s = 1.f / 255.f;
+    return vec4(p[0] * s, p[1] * s, p[2] * s, p[3] * s);
+}
+
+static byte sw_to_unorm(float f)
+{
+    return (byte)(gs_clamp(f, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+sw_buffer::sw_buffer(uint bindflags, uint size, const void* ptr):
+    _bindflags(bindflags)
+{
+    _data.resize(size, 0);
+    if(ptr && size)
+        memcpy(&_data.front(), ptr, size);
+}
+
+sw_texture2d::sw_texture2d(int w, int h)
+{
+    _image.create(image::fmt_rgba, w, h);
+    _image.clear(color(0, 0, 0, 0));
+}
+
+sw_texture2d::sw_texture2d(const image& img)
+{
+    assert(img.get_format() == image::fmt_rgba);
+    _image.create(image::fmt_rgba, img.get_width(), img.get_height());
+    _image.copy(img);
+}
+
+sw_shader_resource_view::sw_shader_resource_view(sw_texture2d* tex):
+    _texture(tex)
+{
+    assert(tex);
+    tex->AddRef();
+}
+
+sw_shader_resource_view::~sw_shader_resource_view()
+{
+    if(_texture) {
+        _texture->Release();
+        _texture = nullptr;
+    }
+}
+
+sw_vertex_format::sw_vertex_format(const sw_vertex_element desc[], uint n)
+{
+    assert(desc && n);
+    _elements.assign(desc, desc + n);
+    uint offsets[sw_max_slots] = { 0 };
+    for(auto& e : _elements) {
+        assert(e.input_slot < sw_max_slots);
+        uint& offset = offsets[e.input_slot];
+        if(e.aligned_byte_offset == sw_append_aligned_element)
+            e.aligned_byte_offset = offset;
+        offset = e.aligned_byte_offset + sw_get_format_size(e.format);
+    }
+    _stride = offsets[0];
+}
+
+vec4 sw_shading_context::sample(int tex, int sampler, const vec2& uv) const
+{
+    assert(tex < sw_max_slots && sampler < sw_max_slots);
+    const auto* t = textures[tex];
+    if(!t)
+        return vec4(0.f, 0.f, 0.f, 0.f);
+    const image& img = t->get_image();
+    int w = img.get_width(), h = img.get_height();
+    auto filter = samplers[sampler] ? samplers[sampler]->get_filter() : ssf_linear;
+    if(filter == ssf_point) {
+        int x = gs_clamp((int)floorf(uv.x * w), 0, w - 1);
+        int y = gs_clamp((int)floorf(uv.y * h), 0, h - 1);
+        return sw_fetch_texel(img, x, y);
+    }
+    /* bilinear with the clamp addressing, the anisotropic filter falls back to it as there were no mips. */
+    float fx = uv.x * w - 0.5f, fy = uv.y * h - 0.5f;
+    float ix = floorf(fx), iy = floorf(fy);
+    float tx = fx - ix, ty = fy - iy;
+    int x0 = gs_clamp((int)ix, 0, w - 1), x1 = gs_clamp((int)ix + 1, 0, w - 1);
+    int y0 = gs_clamp((int)iy, 0, h - 1), y1 = gs_clamp((int)iy + 1, 0, h - 1);
+    vec4 c00 = sw_fetch_texel(img, x0, y0), c10 = sw_fetch_texel(img, x1, y0);
+    vec4 c01 = sw_fetch_texel(img, x0, y1), c11 = sw_fetch_texel(img, x1, y1);
+    vec4 top = c00 * (1.f - tx) + c10 * tx;
+    vec4 bottom = c01 * (1.f - tx) + c11 * tx;
+    return top * (1.f - ty) + bottom * ty;
+}
+
+rendersys_sw::rendersys_sw()
+{
+    memset(&_vs_context, 0, sizeof(_vs_context));
+    memset(&_ps_context, 0, sizeof(_ps_context));
+    memset(&_viewport, 0, sizeof(_viewport));
+    reset_stats();
+}
+
+rendersys_sw::~rendersys_sw()
+{
+    destroy();
+}
+
+bool rendersys_sw::setup(uint hwnd, const configs& cfg)
+{
+    /* headless, the window was ignored. */
+    install_configs(cfg);
+    if(_width <= 0 || _height <= 0)
+        return false;
+    if(!_backbuffer.create(image::fmt_rgba, _width, _height) ||
+        !_frontbuffer.create(image::fmt_rgba, _width, _height)
+        )
+        return false;
+    _backbuffer.clear(color(0, 0, 0, 255));
+    _frontbuffer.clear(color(0, 0, 0, 255));
+    _depthbuffer.assign(_width * _height, 1.f);
+    int cols = (_width + sw_tile_size - 1) / sw_tile_size;
+    int rows = (_height + sw_tile_size - 1) / sw_tile_size;
+    _bins.resize(cols * rows);
+    assert(!_pool);
+    if(_workers > 1)
+        _pool = new thread_pool(_workers);
+    _device_info.vendor_id = 0;
+    register_dev_index_service(this, this);
+    return true;
+}
+
+void rendersys_sw::destroy()
+{
+    unregister_dev_index_service(this);
+    if(_pool) {
+        delete _pool;
+        _pool = nullptr;
+    }
+    _vertex_format = nullptr;
+    _vertex_buffer = nullptr;
+    _index_buffer = nullptr;
+    _vertex_shader = nullptr;
+    _pixel_shader = nullptr;
+    memset(&_vs_context, 0, sizeof(_vs_context));
+    memset(&_ps_context, 0, sizeof(_ps_context));
+    _backbuffer.destroy();
+    _frontbuffer.destroy();
+    _depthbuffer.clear();
+    _vs_outputs.clear();
+    _triangles.clear();
+    _bins.clear();
+}
+
+void rendersys_sw::setup_pipeline_state()
+{
+    viewport vp;
+    vp.left = 0;
+    vp.top = 0;
+    vp.width = (uint)_width;
+    vp.height = (uint)_height;
+    vp.min_depth = 0.f;
+    vp.max_depth = 1.f;
+    set_viewport(vp);
+    enable_alpha_blend(false);
+    enable_depth(true);
+}
+
+render_blob* rendersys_sw::compile_shader_from_file(const gchar* file, const gchar* entry, const gchar* sm, render_include* inc)
+{
+    assert(!"the software programs were written in c++, no compiler here.");
+    return nullptr;
+}
+
+render_blob* rendersys_sw::compile_shader_from_memory(const char* src, int len, const gchar* name, const gchar* entry, const gchar* sm, render_include* inc)
+{
+    assert(!"the software programs were written in c++, no compiler here.");
+    return nullptr;
+}
+
+vertex_shader* rendersys_sw::create_vertex_shader(const void* ptr, size_t len)
+{
+    assert(ptr && (len == sizeof(sw_vertex_program)));
+    auto* prog = reinterpret_cast<const sw_vertex_program*>(ptr);
+    assert(prog->func && (prog->varyings <= sw_max_varyings));
+    return new sw_vertex_shader(prog);
+}
+
+pixel_shader* rendersys_sw::create_pixel_shader(const void* ptr, size_t len)
+{
+    assert(ptr && (len == sizeof(sw_pixel_program)));
+    auto* prog = reinterpret_cast<const sw_pixel_program*>(ptr);
+    assert(prog->func);
+    return new sw_pixel_shader(prog);
+}
+
+compute_shader* rendersys_sw::create_compute_shader(const void* ptr, size_t len)
+{
+    assert(!"unsupported shader type.");
+    return nullptr;
+}
+
+geometry_shader* rendersys_sw::create_geometry_shader(const void* ptr, size_t len)
+{
+    assert(!"unsupported shader type.");
+    return nullptr;
+}
+
+hull_shader* rendersys_sw::create_hull_shader(const void* ptr, size_t len)
+{
+    assert(!"unsupported shader type.");
+    return nullptr;
+}
+
+domain_shader* rendersys_sw::create_domain_shader(const void* ptr, size_t len)
+{
+    assert(!"unsupported shader type.");
+    return nullptr;
+}
+
+vertex_format* rendersys_sw::create_vertex_format(const void* ptr, size_t len, vertex_format_desc desc[], uint n)
+{
+    return new sw_vertex_format(desc, n);
+}
+
+render_vertex_buffer* rendersys_sw::create_vertex_buffer(uint stride, uint count, bool read, bool write, uint usage, const void* ptr)
+{
+    return new sw_buffer(sw_bind_vertex_buffer, stride * count, ptr);
+}
+
+render_index_buffer* rendersys_sw::create_index_buffer(uint count, render_index_format fmt, bool read, bool write, uint usage, const void* ptr)
+{
+    return new sw_buffer(sw_bind_index_buffer, count * get_index_size(fmt), ptr);
+}
+
+render_constant_buffer* rendersys_sw::create_constant_buffer(uint stride, bool read, bool write, const void* ptr)
+{
+    return new sw_buffer(sw_bind_constant_buffer, stride, ptr);
+}
+
+shader_resource_view* rendersys_sw::create_shader_resource_view(render_resource* res)
+{
+    assert(res);
+    if(!res->is_texture()) {
+        assert(!"only the texture views were supported.");
+        return nullptr;
+    }
+    return new sw_shader_resource_view(static_cast<sw_texture2d*>(res));
+}
+
+depth_stencil_view* rendersys_sw::create_depth_stencil_view(render_resource* res)
+{
+    assert(!"the depth buffer was owned by the render system.");
+    return nullptr;
+}
+
+unordered_access_view* rendersys_sw::create_unordered_access_view(render_resource* res)
+{
+    assert(!"unordered access views were not supported.");
+    return nullptr;
+}
+
+render_sampler_state* rendersys_sw::create_sampler_state(sampler_state_filter filter)
+{
+    return new sw_sampler_state(filter);
+}
+
+render_texture2d* rendersys_sw::create_texture2d(const image& img, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags)
+{
+    if(img.get_format() != image::fmt_rgba) {
+        assert(!"unexpected format.");
+        return nullptr;
+    }
+    return new sw_texture2d(img);
+}
+
+render_texture2d* rendersys_sw::create_texture2d(int width, int height, uint format, uint mips, uint usage, uint bindflags, uint cpuflags, uint miscflags)
+{
+    if(format != sw_format_r8g8b8a8_unorm) {
+        assert(!"unexpected format.");
+        return nullptr;
+    }
+    return new sw_texture2d(width, height);
+}
+
+void rendersys_sw::load_with_mips(texture2d* tex, const image& img)
+{
+    /* no mips, the sampler never needs them. */
+    assert(tex);
+    tex->get_image().copy(img);
+}
+
+void rendersys_sw::update_buffer(void* buf, int size, const void* ptr)
+{
+    assert(buf && ptr && size > 0);
+    auto* p = reinterpret_cast<sw_buffer*>(buf);
+    assert((uint)size <= p->get_size());
+    memcpy(p->get_data(), ptr, gs_min((uint)size, p->get_size()));
+}
+
+void rendersys_sw::update_texture2d(texture2d* tex, const rect& rc, const void* ptr, int pitch)
+{
+    assert(tex && ptr);
+    auto& img = tex->get_image();
+    assert(rc.left >= 0 && rc.top >= 0 && rc.right <= img.get_width() && rc.bottom <= img.get_height());
+    int bpl = rc.width() * 4;
+    for(int i = 0; i < rc.height(); i ++)
+        memcpy(img.get_data(rc.left, rc.top + i), (const byte*)ptr + pitch * i, bpl);
+}
+
+void* rendersys_sw::map_buffer(void* buf, buffer_map_mode mode)
+{
+    /* the draws were done on the call, nothing could be pending. */
+    assert(buf);
+    return reinterpret_cast<sw_buffer*>(buf)->get_data();
+}
+
+void rendersys_sw::unmap_buffer(void* buf, uint offset, uint size)
+{
+    assert(buf);
+    assert(offset + size <= reinterpret_cast<sw_buffer*>(buf)->get_size());
+}
+
+void rendersys_sw::set_vertex_format(vertex_format* vfmt)
+{
+    _vertex_format = vfmt;
+}
+
+void rendersys_sw::set_vertex_buffer(vertex_buffer* vb, uint stride, uint offset)
+{
+    _vertex_buffer = vb;
+    _vertex_stride = stride;
+    _vertex_offset = offset;
+}
+
+void rendersys_sw::set_index_buffer(index_buffer* ib, uint offset, render_index_format fmt)
+{
+    _index_buffer = ib;
+    _index_offset = offset;
+    _index_format = fmt;
+}
+
+void rendersys_sw::set_instance_buffer(vertex_buffer* vb, uint stride, uint offset)
+{
+    _instance_buffer = vb;
+    _instance_stride = stride;
+    _instance_offset = offset;
+}
+
+void rendersys_sw::begin_render()
+{
+    color cr(sw_to_unorm(_bkcr[0]), sw_to_unorm(_bkcr[1]), sw_to_unorm(_bkcr[2]), sw_to_unorm(_bkcr[3]));
+    _backbuffer.clear(cr);
+    std::fill(_depthbuffer.begin(), _depthbuffer.end(), 1.f);
+    reset_stats();
+}
+
+void rendersys_sw::end_render()
+{
+    /* present */
+    _frontbuffer.copy(_backbuffer);
+}
+
+void rendersys_sw::set_render_option(render_option opt, uint val)
+{
+    switch(opt)
+    {
+    case opt_primitive_topology:
+        assert(val == sw_topology_triangle_list || val == sw_topology_triangle_strip);
+        _topology = val;
+        break;
+    }
+}
+
+void rendersys_sw::set_vertex_shader(vertex_shader* vs)
+{
+    _vertex_shader = vs;
+}
+
+void rendersys_sw::set_pixel_shader(pixel_shader* ps)
+{
+    _pixel_shader = ps;
+}
+
+void rendersys_sw::set_geometry_shader(geometry_shader* gs)
+{
+    assert(!gs && "unsupported shader type.");
+}
+
+void rendersys_sw::set_viewport(const viewport& vp)
+{
+    _viewport = vp;
+}
+
+void rendersys_sw::set_constant_buffer(uint slot, constant_buffer* cb, shader_type st)
+{
+    assert(cb && slot < sw_max_slots);
+    switch(st)
+    {
+    case st_vertex_shader:
+        _vs_context.constants[slot] = cb;
+        break;
+    case st_pixel_shader:
+        _ps_context.constants[slot] = cb;
+        break;
+    default:
+        assert(!"unknown shader type.");
+    }
+}
+
+void rendersys_sw::set_sampler_state(uint slot, sampler_state* sstate, shader_type st)
+{
+    assert(sstate && slot < sw_max_slots);
+    switch(st)
+    {
+    case st_vertex_shader:
+        _vs_context.samplers[slot] = sstate;
+        break;
+    case st_pixel_shader:
+        _ps_context.samplers[slot] = sstate;
+        break;
+    default:
+        assert(!"unknown shader type.");
+    }
+}
+
+void rendersys_sw::set_shader_resource(uint slot, shader_resource_view* srv, shader_type st)
+{
+    assert(srv && slot < sw_max_slots);
+    switch(st)
+    {
+    case st_vertex_shader:
+        _vs_context.textures[slot] = srv->get_texture();
+        break;
+    case st_pixel_shader:
+        _ps_context.textures[slot] = srv->get_texture();
+        break;
+    default:
+        assert(!"unknown shader type.");
+    }
+}
+
+void rendersys_sw::draw(uint count, uint start)
+{
+    draw_primitives(nullptr, count, start, 0);
+}
+
+void rendersys_sw::draw_indexed(uint count, uint start, int base)
+{
+    assert(_index_buffer);
+    if(_index_format == rif_uint16) {
+        assert(_index_offset + (start + count) * sizeof(uint16) <= _index_buffer->get_size());
+        auto* indices = reinterpret_cast<const uint16*>(_index_buffer->get_data() + _index_offset) + start;
+        _widened.assign(indices, indices + count);
+        draw_primitives(_widened.data(), count, 0, base);
+        return;
+    }
+    assert(_index_offset + (start + count) * sizeof(uint) <= _index_buffer->get_size());
+    auto* indices = reinterpret_cast<const uint*>(_index_buffer->get_data() + _index_offset) + start;
+    draw_primitives(indices, count, 0, base);
+}
+
+void rendersys_sw::draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance)
+{
+    assert(_instance_buffer && _instance_stride);
+    if(!instances)
+        return;
+    if(_instance_offset + (start_instance + instances) * _instance_stride > _instance_buffer->get_size()) {
+        assert(!"instance out of range.");
+        return;
+    }
+    /* the instances were drawn one after another, the vertices were shaded again for each of them. */
+    const byte* data = _instance_buffer->get_data() + _instance_offset + start_instance * _instance_stride;
+    int draw_calls = _stats.draw_calls;
+    for(uint i = 0; i < instances; i ++) {
+        _vs_context.instance = data + i * _instance_stride;
+        draw_indexed(count, start, base);
+    }
+    _vs_context.instance = nullptr;
+    _stats.draw_calls = draw_calls + 1;
+}
+
+void rendersys_sw::capture_screen(image& img, const rectf& rc, int buff_id)
+{
+    const image& src = !buff_id ? _backbuffer : _frontbuffer;
+    assert(src.is_valid());
+    int w = (int)ceilf(rc.width()), h = (int)ceilf(rc.height());
+    if(!img.create(image::fmt_rgba, w, h))
+        return;
+    img.clear(color(0, 0, 0, 0));
+    img.copy(src, 0, 0, w, h, (int)floorf(rc.left), (int)floorf(rc.top));
+}
+
+void rendersys_sw::enable_alpha_blend(bool b)
+{
+    _alpha_blend = b;
+}
+
+void rendersys_sw::enable_depth(bool b)
+{
+    _depth = b;
+}
+
+void rendersys_sw::install_configs(const configs& cfg)
+{
+    auto get_int = [&cfg](const gchar* key, int def)-> int {
+        auto f = cfg.find(key);
+        return f == cfg.end() ? def : f->second.to_int();
+    };
+    _width = get_int(_t("width"), 1024);
+    _height = get_int(_t("height"), 768);
+    _workers = get_int(_t("workers"), (int)std::thread::hardware_concurrency());
+}
+
+void rendersys_sw::reset_stats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void rendersys_sw::run_parallel(int count, const std::function<void(int)>& fn)
+{
+    if(!_pool || count <= 1) {
+        for(int i = 0; i < count; i ++)
+            fn(i);
+        return;
+    }
+    for(int i = 0; i < count; i ++)
+        _pool->add(fn, i);
+    _pool->join();
+}
+
+void rendersys_sw::draw_primitives(const uint* indices, uint count, uint start, int base)
+{
+    assert(_vertex_shader && _pixel_shader);
+    assert(_vertex_buffer);
+    if(count < 3)
+        return;
+    auto t0 = std::chrono::steady_clock::now();
+    uint stride = _vertex_stride ? _vertex_stride : (_vertex_format ? _vertex_format->get_stride() : 0);
+    assert(stride);
+    uint available = (_vertex_buffer->get_size() - _vertex_offset) / stride;
+    /* only shade the vertices referenced */
+    uint first = start, last = start + count;
+    if(indices) {
+        first = (uint)-1, last = 0;
+        for(uint i = 0; i < count; i ++) {
+            uint v = (uint)((int)indices[i] + base);
+            first = gs_min(first, v);
+            last = gs_max(last, v + 1);
+        }
+    }
+    if(last > available) {
+        assert(!"vertex out of range.");
+        return;
+    }
+    const byte* vertices = _vertex_buffer->get_data() + _vertex_offset + first * stride;
+    shade_vertices(vertices, stride, last - first);
+    setup_triangles(indices, count, indices ? base - (int)first : 0);
+    bin_triangles();
+    int tiles = (int)_bins.size();
+    vector<int64> pixels(tiles, 0);
+    run_parallel(tiles, [&](int i) { pixels.at(i) = rasterize_tile(i); });
+    for(int i = 0; i < tiles; i ++) {
+        if(!_bins.at(i).empty())
+            _stats.tiles_shaded ++;
+        _stats.pixels_shaded += pixels.at(i);
+    }
+    _stats.draw_calls ++;
+    _stats.vertices += (int)(last - first);
+    _stats.raster_time += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void rendersys_sw::shade_vertices(const byte* vertices, uint stride, uint count)
+{
+    _vs_outputs.resize(count);
+    auto func = _vertex_shader->get_program().func;
+    int chunks = (int)((count + sw_vertex_chunk - 1) / sw_vertex_chunk);
+    run_parallel(chunks, [&](int c) {
+        uint from = c * sw_vertex_chunk;
+        uint to = gs_min(count, from + sw_vertex_chunk);
+        for(uint i = from; i < to; i ++)
+            func(_vs_outputs.at(i), vertices + i * stride, _vs_context);
+    });
+}
+
+/*
+ * Map to the screen, cull the back faces the same as the default raster state of d3d (clockwise was front), then make
+ * the edge functions and the gradients of the varyings. There was no perspective correction since the 2d pipeline
+ * always has w = 1.
+ */
+static bool sw_setup_triangle_from(sw_setup_triangle& tri, const sw_vs_output* v[3], int varyings, const viewport& vp, const rect& target)
+{
+    float sx[3], sy[3], sz[3];
+    for(int i = 0; i < 3; i ++) {
+        const vec4& p = v[i]->position;
+        float rw = p.w != 0.f ? 1.f / p.w : 1.f;
+        sx[i] = vp.left + (p.x * rw + 1.f) * 0.5f * vp.width;
+        sy[i] = vp.top + (1.f - p.y * rw) * 0.5f * vp.height;
+        sz[i] = vp.min_depth + p.z * rw * (vp.max_depth - vp.min_depth);
+    }
+    float dx1 = sx[1] - sx[0], dy1 = sy[1] - sy[0];
+    float dx2 = sx[2] - sx[0], dy2 = sy[2] - sy[0];
+    float det = dx1 * dy2 - dx2 * dy1;
+    if(det <= 0.f)
+        return false;
+    for(int i = 0; i < 3; i ++) {
+        int j = (i + 1) % 3;
+        float a = sy[i] - sy[j];
+        float b = sx[j] - sx[i];
+        tri.edge_a[i] = a;
+        tri.edge_b[i] = b;
+        tri.edge_c[i] = -(a * sx[i] + b * sy[i]);
+        tri.top_left[i] = (a > 0.f) || (a == 0.f && b > 0.f);
+    }
+    float left = gs_min(sx[0], gs_min(sx[1], sx[2]));
+    float top = gs_min(sy[0], gs_min(sy[1], sy[2]));
+    float right = gs_max(sx[0], gs_max(sx[1], sx[2]));
+    float bottom = gs_max(sy[0], gs_max(sy[1], sy[2]));
+    tri.bound.left = gs_max(target.left, (int)floorf(left));
+    tri.bound.top = gs_max(target.top, (int)floorf(top));
+    tri.bound.right = gs_min(target.right, (int)ceilf(right));
+    tri.bound.bottom = gs_min(target.bottom, (int)ceilf(bottom));
+    if(tri.bound.left >= tri.bound.right || tri.bound.top >= tri.bound.bottom)
+        return false;
+    float rdet = 1.f / det;
+    auto gradients = [&](float v0, float v1, float v2, float& ddx, float& ddy) {
+        float d1 = v1 - v0, d2 = v2 - v0;
+        ddx = (d1 * dy2 - d2 * dy1) * rdet;
+        ddy = (d2 * dx1 - d1 * dx2) * rdet;
+    };
+    tri.x0 = sx[0];
+    tri.y0 = sy[0];
+    tri.z = sz[0];
+    gradients(sz[0], sz[1], sz[2], tri.dzdx, tri.dzdy);
+    tri.varyings = varyings;
+    for(int k = 0; k < varyings; k ++) {
+        tri.attr[k] = v[0]->varyings[k];
+        gradients(v[0]->varyings[k], v[1]->varyings[k], v[2]->varyings[k], tri.ddx[k], tri.ddy[k]);
+    }
+    return true;
+}
+
+void rendersys_sw::setup_triangles(const uint* indices, uint count, int bias)
+{
+    bool strip = (_topology == sw_topology_triangle_strip);
+    int ntri = strip ? (int)count - 2 : (int)count / 3;
+    _triangles.resize(ntri);
+    int varyings = _vertex_shader->get_program().varyings;
+    rect target;
+    target.set_ltrb(gs_max(0, _viewport.left), gs_max(0, _viewport.top),
+        gs_min(_width, _viewport.left + (int)_viewport.width), gs_min(_height, _viewport.top + (int)_viewport.height)
+        );
+    auto vertex_of = [&](uint i)-> const sw_vs_output* {
+        int v = indices ? (int)indices[i] + bias : (int)i;
+        return &_vs_outputs.at(v);
+    };
+    int chunks = (ntri + sw_triangle_chunk - 1) / sw_triangle_chunk;
+    run_parallel(chunks, [&](int c) {
+        int from = c * sw_triangle_chunk;
+        int to = gs_min(ntri, from + sw_triangle_chunk);
+        for(int i = from; i < to; i ++) {
+            const sw_vs_output* v[3];
+            if(!strip) {
+                v[0] = vertex_of(i * 3);
+                v[1] = vertex_of(i * 3 + 1);
+                v[2] = vertex_of(i * 3 + 2);
+            }
+            else {
+                /* keep the winding for the odd ones */
+                v[0] = vertex_of(i + (i & 1));
+                v[1] = vertex_of(i + 1 - (i & 1));
+                v[2] = vertex_of(i + 2);
+            }
+            auto& tri = _triangles.at(i);
+            if(!sw_setup_triangle_from(tri, v, varyings, _viewport, target))
+                tri.bound = rect();
+        }
+    });
+}
+
+void rendersys_sw::bin_triangles()
+{
+    for(auto& bin : _bins)
+        bin.clear();
+    int cols = (_width + sw_tile_size - 1) / sw_tile_size;
+    int ntri = (int)_triangles.size();
+    for(int i = 0; i < ntri; i ++) {
+        const auto& rc = _triangles.at(i).bound;
+        if(rc.left >= rc.right) {
+            _stats.culled ++;
+            continue;
+        }
+        int c0 = rc.left / sw_tile_size, c1 = (rc.right - 1) / sw_tile_size;
+        int r0 = rc.top / sw_tile_size, r1 = (rc.bottom - 1) / sw_tile_size;
+        for(int r = r0; r <= r1; r ++) {
+            for(int c = c0; c <= c1; c ++)
+                _bins.at(r * cols + c).push_back(i);
+        }
+    }
+    _stats.triangles += ntri;
+}
+
+int64 rendersys_sw::rasterize_tile(int tile)
+{
+    const auto& bin = _bins.at(tile);
+    if(bin.empty())
+        return 0;
+    int cols = (_width + sw_tile_size - 1) / sw_tile_size;
+    int x = (tile % cols) * sw_tile_size, y = (tile / cols) * sw_tile_size;
+    rect rc;
+    rc.set_ltrb(x, y, gs_min(_width, x + sw_tile_size), gs_min(_height, y + sw_tile_size));
+    int64 pixels = 0;
+    /* the bin keeps the order of submission */
+    for(int i : bin) {
+        const auto& tri = _triangles.at(i);
+        rect clip;
+        clip.set_ltrb(gs_max(rc.left, tri.bound.left), gs_max(rc.top, tri.bound.top),
+            gs_min(rc.right, tri.bound.right), gs_min(rc.bottom, tri.bound.bottom)
+            );
+        if(clip.left < clip.right && clip.top < clip.bottom)
+            pixels += rasterize_triangle(tri, clip);
+    }
+    return pixels;
+}
+
+/* the edge functions were evaluated 4 pixels a time, the covered pixels were shaded one by one. */
+int64 rendersys_sw::rasterize_triangle(const sw_setup_triangle& tri, const rect& rc)
+{
+    auto func = _pixel_shader->get_program().func;
+    const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 ea[3];
+    for(int k = 0; k < 3; k ++)
+        ea[k] = _mm_set1_ps(tri.edge_a[k]);
+    float varyings[sw_max_varyings];
+    sw_ps_input input;
+    input.varyings = varyings;
+    input.ddx = tri.ddx;
+    input.ddy = tri.ddy;
+    int64 pixels = 0;
+    for(int y = rc.top; y < rc.bottom; y ++) {
+        float py = (float)y + 0.5f;
+        __m128 eb[3];
+        for(int k = 0; k < 3; k ++)
+            eb[k] = _mm_set1_ps(tri.edge_b[k] * py + tri.edge_c[k]);
+        byte* row = _backbuffer.get_data(0, y);
+        float* depth_row = &_depthbuffer.at(y * _width);
+        for(int x = rc.left; x < rc.right; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 mask = _mm_cmpeq_ps(zero, zero);
+            for(int k = 0; k < 3; k ++) {
+                __m128 e = _mm_add_ps(_mm_mul_ps(ea[k], px), eb[k]);
+                mask = _mm_and_ps(mask, tri.top_left[k] ? _mm_cmpge_ps(e, zero) : _mm_cmpgt_ps(e, zero));
+            }
+            int bits = _mm_movemask_ps(mask);
+            int remain = rc.right - x;
+            if(remain < 4)
+                bits &= (1 << remain) - 1;
+            while(bits) {
+                int i = 0;
+                while(!(bits & (1 << i)))
+                    i ++;
+                bits &= ~(1 << i);
+                int sx = x + i;
+                float pxf = (float)sx + 0.5f;
+                float dx = pxf - tri.x0, dy = py - tri.y0;
+                float z = tri.z + tri.dzdx * dx + tri.dzdy * dy;
+                if(_depth) {
+                    if(!(z < depth_row[sx]))
+                        continue;
+                }
+                for(int k = 0; k < tri.varyings; k ++)
+                    varyings[k] = tri.attr[k] + tri.ddx[k] * dx + tri.ddy[k] * dy;
+                input.position = vec4(pxf, py, z, 1.f);
+                vec4 cr;
+                if(!func(cr, input, _ps_context))
+                    continue;
+                pixels ++;
+                if(_depth)
+                    depth_row[sx] = z;
+                byte* p = row + sx * 4;
+                if(_alpha_blend) {
+                    /* src alpha, inv src alpha for the colors, max for the alpha */
+                    static const float s = 1.f / 255.f;
+                    float sa = gs_clamp(cr.w, 0.f, 1.f), da = p[3] * s;
+                    p[0] = sw_to_unorm(cr.x * sa + p[0] * s * (1.f - sa));
+                    p[1] = sw_to_unorm(cr.y * sa + p[1] * s * (1.f - sa));
+                    p[2] = sw_to_unorm(cr.z * sa + p[2] * s * (1.f - sa));
+                    p[3] = sw_to_unorm(gs_max(sa, da));
+                }
+                else {
+                    p[0] = sw_to_unorm(cr.x);
+                    p[1] = sw_to_unorm(cr.y);
+                    p[2] = sw_to_unorm(cr.z);
+                    p[3] = sw_to_unorm(cr.w);
+                }
+            }
+        }
+    }
+    return pixels;
+}
+
+void release_vertex_buffer(render_vertex_buffer* buf) { if(buf) buf->Release(); }
+void release_index_buffer(render_index_buffer* buf) { if(buf) buf->Release(); }
+void release_constant_buffer(render_constant_buffer* buf) { if(buf) buf->Release(); }
+void release_texture2d(render_texture2d* tex) { if(tex) tex->Release(); }
+
+__ariel_end__
+
+#endif
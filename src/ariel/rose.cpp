@@ -26,9 +26,13 @@
 #include <gslib/error.h>
 #include <ariel/rose.h>
 #include <ariel/textureop.h>
+#include <ariel/scene.h>
+#include <ariel/profiler.h>
 
 #if use_rendersys_d3d_11
 #include <ariel/rosed3d11.cpp>
+#elif use_rendersys_software
+#include <ariel/rosesw.cpp>
 #endif
 
 __ariel_begin__
@@ -203,6 +207,17 @@ static vec2 rose_calc_tex_coords(texture2d* img, const vec2& p, const tex_batche
     return vec2(pt.x / pt.z, pt.y / pt.z);
 }
 
+static int rose_count_triangles(bat_rtree& rtr)
+{
+    int c = 0;
+    rtr.for_each([&c](bat_rtree_entity* ent) {
+        assert(ent);
+        if(ent->get_bind_arg())
+            c ++;
+    });
+    return c;
+}
+
 template<class _vf>
 static void rose_filling_tex_coords(lb_joint* p, const tex_batcher& batch, _vf& pt)
 {
@@ -212,37 +227,561 @@ static void rose_filling_tex_coords(lb_joint* p, const tex_batcher& batch, _vf&
     pt.tex = rose_calc_tex_coords(binding->img, binding->tex, batch);
 }
 
-rose_batch::rose_batch(int index)
+/* the vertices of the triangles were shared by the joints they came from, the ones differ in attributes were kept apart. */
+template<class _vertex, class _writer = rose_vertex_writer<_vertex>>
+class rose_joint_vertices
 {
-    _bat_index = index;
+public:
+    typedef _writer writer;
+    struct entry
+    {
+        _vertex         vertex;
+        int             index;
+        int             next;       /* the other vertices of the joint */
+    };
+    typedef unordered_map<const lb_joint*, int> joint_map;
+    typedef vector<entry> entry_list;
+
+public:
+    rose_joint_vertices(writer& w, index_stream& indices): _writer(w), _indices(indices) {}
+    void add_vertex(const lb_joint* joint, const _vertex& v)
+    {
+        assert(joint);
+        auto f = _joints.find(joint);
+        int first = (f == _joints.end()) ? -1 : f->second;
+        for(int i = first; i >= 0; i = _entries.at(i).next) {
+            const auto& e = _entries.at(i);
+            if(!memcmp(&e.vertex, &v, sizeof(v))) {
+                _indices.push_back(e.index);
+                return;
+            }
+        }
+        entry e = { v, _writer.push_back(v), first };
+        _joints[joint] = (int)_entries.size();
+        _entries.push_back(e);
+        _indices.push_back(e.index);
+    }
+
+protected:
+    writer&             _writer;
+    index_stream&       _indices;
+    joint_map           _joints;
+    entry_list          _entries;
+};
+
+/* the vertices of a symbol were kept until its buffers were created. */
+struct rose_symbol_vertices
+{
+    vector<vertex_info_klm> vertices;
+
+public:
+    int push_back(const vertex_info_klm& v)
+    {
+        vertices.push_back(v);
+        return (int)vertices.size() - 1;
+    }
+    int size() const { return (int)vertices.size(); }
+};
+
+/* the vertices of a line were written on the first reference, the triangles of the line referred to them by indices. */
+template<class _vertex, int _size>
+class rose_line_vertices
+{
+public:
+    typedef rose_vertex_writer<_vertex> writer;
+
+public:
+    rose_line_vertices(writer& w, index_stream& indices, const _vertex (&pt)[_size]): _writer(w), _indices(indices), _pt(pt)
+    {
+        for(int& i : _slots)
+            i = -1;
+    }
+    void add_triangle(int i, int j, int k)
+    {
+        add_index(i);
+        add_index(j);
+        add_index(k);
+    }
+
+protected:
+    writer&             _writer;
+    index_stream&       _indices;
+    const _vertex       (&_pt)[_size];
+    int                 _slots[_size];
+
+protected:
+    void add_index(int i)
+    {
+        assert(i >= 0 && i < _size);
+        if(_slots[i] < 0)
+            _slots[i] = _writer.push_back(_pt[i]);
+        _indices.push_back(_slots[i]);
+    }
+};
+
+static const int rose_vertex_cache_size = 32;
+
+static float rose_vertex_score(int cache_pos, int valence)
+{
+    if(!valence)
+        return 0.f;
+    float score = 0.f;
+    if(cache_pos >= 0) {
+        /* the last triangle was favored a bit less, so that the strips would not be too long. */
+        if(cache_pos < 3)
+            score = 0.75f;
+        else {
+            float s = 1.f - (float)(cache_pos - 3) / (rose_vertex_cache_size - 3);
+            score = powf(s, 1.5f);
+        }
+    }
+    /* the vertices with few triangles left were taken first, to get rid of them. */
+    return score + 2.f / sqrtf((float)valence);
+}
+
+/*
+ * Reorder the triangles for the post transform vertex cache, after the linear speed vertex cache optimisation of
+ * Tom Forsyth: the vertices were scored by their positions in a simulated LRU cache and the count of the triangles
+ * left to them, the next triangle was the best one among the triangles of the cached vertices.
+ */
+static void rose_optimize_vertex_cache(index_stream& indices, int vertex_count)
+{
+    int tri_count = (int)indices.size() / 3;
+    if(tri_count <= 2)
+        return;
+    /* the live triangles of every vertex */
+    vector<int> valence(vertex_count, 0), offsets(vertex_count + 1, 0), adjacency(indices.size());
+    for(int i : indices) {
+        assert(i >= 0 && i < vertex_count);
+        valence.at(i) ++;
+    }
+    for(int i = 0; i < vertex_count; i ++)
+        offsets.at(i + 1) = offsets.at(i) + valence.at(i);
+    vector<int> fills(offsets.begin(), offsets.end() - 1);
+    for(int i = 0; i < (int)indices.size(); i ++)
+        adjacency.at(fills.at(indices.at(i)) ++) = i / 3;
+    vector<int> cache_pos(vertex_count, -1);
+    vector<float> vscores(vertex_count), tscores(tri_count);
+    vector<byte> emitted(tri_count, 0);
+    for(int i = 0; i < vertex_count; i ++)
+        vscores.at(i) = rose_vertex_score(-1, valence.at(i));
+    int best = -1;
+    float best_score = -1.f;
+    for(int i = 0; i < tri_count; i ++) {
+        const int* tri = &indices.at(i * 3);
+        float s = tscores.at(i) = vscores.at(tri[0]) + vscores.at(tri[1]) + vscores.at(tri[2]);
+        if(s > best_score) {
+            best = i;
+            best_score = s;
+        }
+    }
+    int cache[rose_vertex_cache_size + 3], cache_size = 0, cursor = 0;
+    index_stream output;
+    output.reserve(indices.size());
+    for(int n = 0; n < tri_count; n ++) {
+        if(best < 0) {
+            /* nothing in the cache to go on, take the next one in the original order. */
+            while(emitted.at(cursor))
+                cursor ++;
+            best = cursor;
+        }
+        emitted.at(best) = 1;
+        const int* tri = &indices.at(best * 3);
+        int updated[rose_vertex_cache_size + 3], updated_size = 0;
+        for(int k = 0; k < 3; k ++) {
+            int v = tri[k];
+            output.push_back(v);
+            /* remove it from the live triangles of the vertex */
+            int* adj = &adjacency.at(offsets.at(v));
+            int& c = valence.at(v);
+            for(int i = 0; i < c; i ++) {
+                if(adj[i] == best) {
+                    adj[i] = adj[c - 1];
+                    break;
+                }
+            }
+            c --;
+            updated[updated_size ++] = v;
+        }
+        for(int i = 0; i < cache_size; i ++) {
+            int v = cache[i];
+            if(v != tri[0] && v != tri[1] && v != tri[2])
+                updated[updated_size ++] = v;
+        }
+        /* the ones pushed out of the cache */
+        for(int i = rose_vertex_cache_size; i < updated_size; i ++) {
+            int v = updated[i];
+            cache_pos.at(v) = -1;
+            vscores.at(v) = rose_vertex_score(-1, valence.at(v));
+        }
+        cache_size = gs_min(updated_size, rose_vertex_cache_size);
+        for(int i = 0; i < cache_size; i ++) {
+            int v = cache[i] = updated[i];
+            cache_pos.at(v) = i;
+            vscores.at(v) = rose_vertex_score(i, valence.at(v));
+        }
+        best = -1;
+        best_score = -1.f;
+        for(int i = 0; i < cache_size; i ++) {
+            int v = cache[i];
+            const int* adj = &adjacency.at(offsets.at(v));
+            for(int j = 0; j < valence.at(v); j ++) {
+                int t = adj[j];
+                const int* p = &indices.at(t * 3);
+                float s = tscores.at(t) = vscores.at(p[0]) + vscores.at(p[1]) + vscores.at(p[2]);
+                if(s > best_score) {
+                    best = t;
+                    best_score = s;
+                }
+            }
+        }
+    }
+    indices.swap(output);
+}
+
+uint16 rose_float_to_half(float f)
+{
+    uint x;
+    memcpy(&x, &f, sizeof(x));
+    uint sign = (x >> 16) & 0x8000;
+    uint fe = (x >> 23) & 0xff;
+    uint m = x & 0x7fffff;
+    int e = (int)fe - 127 + 15;
+    if(fe == 0xff)
+        return (uint16)(sign | 0x7c00 | (m ? 0x200 : 0));   /* inf or nan */
+    if(e >= 31)
+        return (uint16)(sign | 0x7c00);                     /* overflow */
+    if(e <= 0) {
+        /* denormalized */
+        if(e < -10)
+            return (uint16)sign;
+        m |= 0x800000;
+        uint shift = (uint)(14 - e);
+        uint h = m >> shift;
+        uint rem = m & ((1u << shift) - 1), mid = 1u << (shift - 1);
+        if(rem > mid || (rem == mid && (h & 1)))
+            h ++;
+        return (uint16)(sign | h);
+    }
+    /* round to the nearest even, a carry goes into the exponent properly. */
+    uint h = ((uint)e << 10) | (m >> 13);
+    uint rem = m & 0x1fff;
+    if(rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+        h ++;
+    return (uint16)(sign | h);
+}
+
+float rose_half_to_float(uint16 h)
+{
+    uint sign = (uint)(h & 0x8000) << 16;
+    uint e = (h >> 10) & 0x1f;
+    uint m = h & 0x3ff;
+    uint x;
+    if(!e) {
+        if(!m)
+            x = sign;
+        else {
+            /* renormalize */
+            e = 127 - 15 + 1;
+            while(!(m & 0x400)) {
+                m <<= 1;
+                e --;
+            }
+            x = sign | (e << 23) | ((m & 0x3ff) << 13);
+        }
+    }
+    else if(e == 31)
+        x = sign | 0x7f800000 | (m << 13);
+    else
+        x = sign | ((e + 127 - 15) << 23) | (m << 13);
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+void rose_palette::clear()
+{
+    _colors.clear();
+    _indices.clear();
+    _last_valid = false;
+}
+
+uint rose_palette::find_index(uint cr)
+{
+    auto f = _indices.find(cr);
+    if(f != _indices.end())
+        return f->second;
+    if((int)_colors.size() < rose_palette_capacity) {
+        uint index = (uint)_colors.size();
+        _colors.push_back(rose_unpack_color(cr));
+        _indices.emplace(cr, index);
+        return index;
+    }
+    /* the palette was full, take the nearest one. */
+    vec4 c = rose_unpack_color(cr);
+    uint index = 0;
+    float dist = FLT_MAX;
+    for(int i = 0; i < (int)_colors.size(); i ++) {
+        vec4 d;
+        d.sub(_colors.at(i), c);
+        float t = d.dot(d);
+        if(t < dist) {
+            dist = t;
+            index = (uint)i;
+        }
+    }
+    _indices.emplace(cr, index);
+    return index;
+}
+
+void rose_submitter::begin(rendersys* rsys)
+{
+    assert(rsys);
+    /* other users of the render system might have changed the states since the last frame. */
+    _rsys = rsys;
+    _stats = rose_submit_stats();
     _vertex_shader = nullptr;
     _pixel_shader = nullptr;
     _vertex_format = nullptr;
+    _topology_valid = false;
     _vertex_buffer = nullptr;
+    _vertex_stride = 0;
+    _index_buffer = nullptr;
+    _index_format = rif_uint32;
+    _instance_buffer = nullptr;
+    _instance_stride = 0;
+    _constant_buffers.clear();
+    _sampler_states.clear();
+    _shader_resources.clear();
+}
+
+bool rose_submitter::request_state(bool changed)
+{
+    _stats.requested_states ++;
+    if(changed)
+        _stats.issued_states ++;
+    return changed;
+}
+
+bool rose_submitter::request_binding(slot_bindings& bindings, uint slot, shader_type st, const void* p)
+{
+    uint key = ((uint)st << 16) | slot;
+    auto f = bindings.find(key);
+    if(!request_state(f == bindings.end() || f->second != p))
+        return false;
+    bindings[key] = p;
+    return true;
+}
+
+void rose_submitter::set_vertex_shader(vertex_shader* vs)
+{
+    assert(_rsys);
+    if(request_state(_vertex_shader != vs))
+        _rsys->set_vertex_shader(_vertex_shader = vs);
+}
+
+void rose_submitter::set_pixel_shader(pixel_shader* ps)
+{
+    assert(_rsys);
+    if(request_state(_pixel_shader != ps))
+        _rsys->set_pixel_shader(_pixel_shader = ps);
 }
 
-rose_batch::~rose_batch()
+void rose_submitter::set_vertex_format(vertex_format* vf)
 {
-    if(_vertex_buffer) {
-        release_vertex_buffer(_vertex_buffer);
-        _vertex_buffer = nullptr;
+    assert(_rsys);
+    if(request_state(_vertex_format != vf))
+        _rsys->set_vertex_format(_vertex_format = vf);
+}
+
+void rose_submitter::set_topology(uint topo)
+{
+    assert(_rsys);
+    if(request_state(!_topology_valid || _topology != topo)) {
+        _topology = topo;
+        _topology_valid = true;
+        _rsys->set_render_option(opt_primitive_topology, topo);
     }
 }
 
-void rose_batch::setup_vs_and_ps(rendersys* rsys)
+void rose_submitter::set_vertex_buffer(vertex_buffer* vb, uint stride)
+{
+    assert(_rsys);
+    if(request_state(_vertex_buffer != vb || _vertex_stride != stride)) {
+        _vertex_buffer = vb;
+        _vertex_stride = stride;
+        _rsys->set_vertex_buffer(vb, stride, 0);
+    }
+}
+
+void rose_submitter::set_index_buffer(index_buffer* ib, render_index_format fmt)
+{
+    assert(_rsys);
+    if(request_state(_index_buffer != ib || _index_format != fmt)) {
+        _index_buffer = ib;
+        _index_format = fmt;
+        _rsys->set_index_buffer(ib, 0, fmt);
+    }
+}
+
+void rose_submitter::set_instance_buffer(vertex_buffer* vb, uint stride)
+{
+    assert(_rsys);
+    if(request_state(_instance_buffer != vb || _instance_stride != stride)) {
+        _instance_buffer = vb;
+        _instance_stride = stride;
+        _rsys->set_instance_buffer(vb, stride, 0);
+    }
+}
+
+void rose_submitter::set_constant_buffer(uint slot, constant_buffer* cb, shader_type st)
+{
+    assert(_rsys);
+    if(request_binding(_constant_buffers, slot, st, cb))
+        _rsys->set_constant_buffer(slot, cb, st);
+}
+
+void rose_submitter::set_sampler_state(uint slot, sampler_state* ss, shader_type st)
+{
+    assert(_rsys);
+    if(request_binding(_sampler_states, slot, st, ss))
+        _rsys->set_sampler_state(slot, ss, st);
+}
+
+void rose_submitter::set_shader_resource(uint slot, shader_resource_view* srv, shader_type st)
+{
+    assert(_rsys);
+    if(request_binding(_shader_resources, slot, st, srv))
+        _rsys->set_shader_resource(slot, srv, st);
+}
+
+void rose_submitter::draw(uint count, uint start)
+{
+    assert(_rsys);
+    _stats.issued_draws ++;
+    _rsys->draw(count, start);
+}
+
+void rose_submitter::draw_indexed(uint count, uint start, int base)
+{
+    assert(_rsys);
+    _stats.issued_draws ++;
+    _rsys->draw_indexed(count, start, base);
+}
+
+void rose_submitter::draw_indexed_instanced(uint count, uint instances, uint start, int base, uint start_instance)
+{
+    assert(_rsys);
+    _stats.issued_draws ++;
+    _stats.instanced_draws ++;
+    _stats.instances += (int)instances;
+    _rsys->draw_indexed_instanced(count, instances, start, base, start_instance);
+}
+
+void rose_submitter::add_ring_stats(const render_ring_stats& st)
+{
+    _stats.vertex_buffers += st.buffers_created;
+    _stats.vertex_bytes += st.bytes_written;
+    _stats.copied_bytes += st.bytes_copied;
+}
+
+void rose_submitter::add_index_ring_stats(const render_ring_stats& st)
+{
+    _stats.index_buffers += st.buffers_created;
+    _stats.index_bytes += st.bytes_written;
+    _stats.copied_bytes += st.bytes_copied;
+}
+
+void rose_submitter::add_batch_stats(int vertices, int indices, int stride)
+{
+    _stats.vertices += vertices;
+    _stats.indices += indices;
+    _stats.flat_bytes += (int64)indices * stride;
+    ariel_profile_counter(pci_vertices, vertices);
+    ariel_profile_counter(pci_vertices_saved, indices - vertices);
+}
+
+void rose_submitter::tracing() const
+{
+    trace(_t("#submit stats:\n"));
+    trace(_t("states: %d requested, %d issued.\n"), _stats.requested_states, _stats.issued_states);
+    trace(_t("draws: %d requested, %d issued, %d instanced for %d instances.\n"), _stats.requested_draws, _stats.issued_draws, _stats.instanced_draws, _stats.instances);
+    trace(_t("vertices: %d written for %d indices, %.1f%% saved.\n"), _stats.vertices, _stats.indices,
+        _stats.indices ? 100.f * (_stats.indices - _stats.vertices) / _stats.indices : 0.f
+        );
+    int64 streamed = _stats.vertex_bytes + _stats.index_bytes;
+    trace(_t("bytes: %lld streamed for %lld flat, %.1f%% saved, %lld copied.\n"), streamed, _stats.flat_bytes,
+        _stats.flat_bytes ? 100.f * (float)(_stats.flat_bytes - streamed) / (float)_stats.flat_bytes : 0.f, _stats.copied_bytes
+        );
+    trace(_t("buffers: %d vertex, %d index created.\n"), _stats.vertex_buffers, _stats.index_buffers);
+}
+
+rose_batch::rose_batch(int index)
+{
+    _bat_index = index;
+    _vertex_shader = nullptr;
+    _pixel_shader = nullptr;
+    _vertex_format = nullptr;
+    _vctx = nullptr;
+    _vertex_buffer = nullptr;
+    _vertex_data = nullptr;
+    _vertex_stride = 0;
+    _vertex_start = 0;
+    _vertex_count = 0;
+    _index_buffer = nullptr;
+    _index_format = rif_uint32;
+    _index_start = 0;
+    _draw_count = 0;
+}
+
+void rose_batch::setup_vs_and_ps(rose_submitter& sub)
 {
-    assert(rsys);
     assert(_vertex_shader && _pixel_shader);
-    rsys->set_vertex_shader(_vertex_shader);
-    rsys->set_pixel_shader(_pixel_shader);
+    sub.set_vertex_shader(_vertex_shader);
+    sub.set_pixel_shader(_pixel_shader);
 }
 
-void rose_batch::setup_vf_and_topology(rendersys* rsys, uint topo)
+void rose_batch::setup_vf_and_topology(rose_submitter& sub, uint topo)
 {
-    assert(rsys);
     assert(_vertex_format);
-    rsys->set_vertex_format(_vertex_format);
-    rsys->set_render_option(opt_primitive_topology, topo);
+    sub.set_vertex_format(_vertex_format);
+    sub.set_topology(topo);
+}
+
+void rose_batch::merge(rose_batch* p)
+{
+    assert(p && p != this);
+    assert(p->_vertex_buffer == _vertex_buffer && p->_vertex_start == _vertex_start + _vertex_count);
+    int base = _vertex_count;
+    for(int i : p->_indices)
+        _indices.push_back(base + i);
+    _vertex_count += p->_vertex_count;
+    _draw_count = (int)_indices.size();
+    p->_draw_count = 0;
+}
+
+void rose_batch::buffer_indices(render_ring_buffer& ring)
+{
+    int count = (int)_indices.size();
+    assert(count == _draw_count);
+    if(!count)
+        return;
+    uint offset = 0;
+    /* the indices were based on the start vertex, so 16 bits were enough for most of the batches. */
+    if(_vertex_count <= 0xffff) {
+        auto* p = reinterpret_cast<uint16*>(ring.allocate(count * sizeof(uint16), sizeof(uint16), _index_buffer, offset));
+        assert(p);
+        for(int i = 0; i < count; i ++)
+            p[i] = (uint16)_indices.at(i);
+        _index_format = rif_uint16;
+        _index_start = (int)(offset / sizeof(uint16));
+        return;
+    }
+    auto* p = ring.allocate(count * sizeof(uint), sizeof(uint), _index_buffer, offset);
+    assert(p);
+    memcpy(p, &_indices.front(), count * sizeof(uint));
+    _index_format = rif_uint32;
+    _index_start = (int)(offset / sizeof(uint));
 }
 
 void rose_fill_batch_cr::create(bat_batch* bat)
@@ -264,24 +803,28 @@ void rose_fill_batch_cr::tracing() const
 {
     trace(_t("#start tracing fill batch cr:\n"));
     trace(_t("@!\n"));
-    int i = 0, cap = (int)_vertices.size();
+    int i = 0, cap = (int)_indices.size();
     for(; i != cap; i += 3) {
-        auto& p1 = _vertices.at(i);
-        auto& p2 = _vertices.at(i + 1);
-        auto& p3 = _vertices.at(i + 2);
-        trace(_t("@moveTo %f, %f;\n"), p1.pos.x, p1.pos.y);
-        trace(_t("@lineTo %f, %f;\n"), p2.pos.x, p2.pos.y);
-        trace(_t("@lineTo %f, %f;\n"), p3.pos.x, p3.pos.y);
-        trace(_t("@lineTo %f, %f;\n"), p1.pos.x, p1.pos.y);
+        auto& p1 = get_vertex_position(_indices.at(i));
+        auto& p2 = get_vertex_position(_indices.at(i + 1));
+        auto& p3 = get_vertex_position(_indices.at(i + 2));
+        trace(_t("@moveTo %f, %f;\n"), p1.x, p1.y);
+        trace(_t("@lineTo %f, %f;\n"), p2.x, p2.y);
+        trace(_t("@lineTo %f, %f;\n"), p3.x, p3.y);
+        trace(_t("@lineTo %f, %f;\n"), p1.x, p1.y);
     }
     trace(_t("@@\n"));
 }
 
 void rose_fill_batch_cr::create_from_fill(bat_fill_batch* bat)
 {
-    assert(bat);
+    assert(bat && _vctx);
     auto& rtr = bat->get_rtree();
-    rtr.for_each([this](bat_rtree_entity* ent) {
+    int count = rose_count_triangles(rtr) * 3;
+    vertex_writer_cr vertices(*_vctx, count);
+    _indices.reserve(count);
+    rose_joint_vertices<vertex_info_cr> shared(vertices, _indices);
+    rtr.for_each([&shared](bat_rtree_entity* ent) {
         assert(ent);
         if(!ent->get_bind_arg())
             return;
@@ -293,16 +836,20 @@ void rose_fill_batch_cr::create_from_fill(bat_fill_batch* bat)
             { triangle->get_point(1), reinterpret_cast<rose_bind_info_cr*>(triangle->get_lb_binding(1))->color },
             { triangle->get_point(2), reinterpret_cast<rose_bind_info_cr*>(triangle->get_lb_binding(2))->color }
         };
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
+        shared.add_vertex(triangle->get_joint(0), pt[0]);
+        shared.add_vertex(triangle->get_joint(1), pt[1]);
+        shared.add_vertex(triangle->get_joint(2), pt[2]);
     });
+    rose_optimize_vertex_cache(_indices, vertices.size());
+    set_vertices(vertices);
 }
 
 void rose_fill_batch_cr::create_from_stroke(bat_stroke_batch* bat)
 {
-    assert(bat);
+    assert(bat && _vctx);
     auto& lines = bat->get_lines();
+    vertex_writer_cr vertices(*_vctx, (int)lines.size() * 4);
+    _indices.reserve(lines.size() * 6);
     for(auto* line : lines) {
         assert(line);
         /* point */
@@ -330,20 +877,22 @@ void rose_fill_batch_cr::create_from_stroke(bat_stroke_batch* bat)
             { p[2], cr1 },
             { p[3], cr2 },
         };
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[3]);
+        rose_line_vertices<vertex_info_cr, _countof(pt)> quad(vertices, _indices, pt);
+        quad.add_triangle(0, 1, 2);
+        quad.add_triangle(2, 1, 3);
     }
+    set_vertices(vertices);
 }
 
 void rose_fill_batch_klm_cr::create(bat_batch* bat)
 {
-    assert(bat);
+    assert(bat && _vctx);
     auto& rtr = static_cast<bat_fill_batch*>(bat)->get_rtree();
-    rtr.for_each([this](bat_rtree_entity* ent) {
+    int count = rose_count_triangles(rtr) * 3;
+    vertex_writer_klm_cr vertices(*_vctx, count);
+    _indices.reserve(count);
+    rose_joint_vertices<vertex_info_klm_cr> shared(vertices, _indices);
+    rtr.for_each([&shared](bat_rtree_entity* ent) {
         assert(ent);
         if(!ent->get_bind_arg())
             return;
@@ -359,29 +908,37 @@ void rose_fill_batch_klm_cr::create(bat_batch* bat)
             { joint3->get_point(), vec3(), reinterpret_cast<rose_bind_info_cr*>(joint3->get_binding())->color }
         };
         rose_filling_klm_coords(triangle, pt);
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
+        shared.add_vertex(joint1, pt[0]);
+        shared.add_vertex(joint2, pt[1]);
+        shared.add_vertex(joint3, pt[2]);
     });
+    rose_optimize_vertex_cache(_indices, vertices.size());
+    set_vertices(vertices);
 }
 
 void rose_fill_batch_klm_cr::tracing() const
 {
     trace(_t("#start tracing fill batch klm cr:\n"));
     trace(_t("@!\n"));
-    int i = 0, cap = (int)_vertices.size();
+    int i = 0, cap = (int)_indices.size();
     for(; i != cap; i += 3) {
-        auto& p1 = _vertices.at(i);
-        auto& p2 = _vertices.at(i + 1);
-        auto& p3 = _vertices.at(i + 2);
-        trace(_t("@moveTo %f, %f;\n"), p1.pos.x, p1.pos.y);
-        trace(_t("@lineTo %f, %f;\n"), p2.pos.x, p2.pos.y);
-        trace(_t("@lineTo %f, %f;\n"), p3.pos.x, p3.pos.y);
-        trace(_t("@lineTo %f, %f;\n"), p1.pos.x, p1.pos.y);
+        auto& p1 = get_vertex_position(_indices.at(i));
+        auto& p2 = get_vertex_position(_indices.at(i + 1));
+        auto& p3 = get_vertex_position(_indices.at(i + 2));
+        trace(_t("@moveTo %f, %f;\n"), p1.x, p1.y);
+        trace(_t("@lineTo %f, %f;\n"), p2.x, p2.y);
+        trace(_t("@lineTo %f, %f;\n"), p3.x, p3.y);
+        trace(_t("@lineTo %f, %f;\n"), p1.x, p1.y);
+        if(get_vertex_layout() != rvl_full)
+            continue;
+        auto* v = reinterpret_cast<const vertex_info_klm_cr*>(_vertex_data);
+        auto& v1 = v[_indices.at(i)];
+        auto& v2 = v[_indices.at(i + 1)];
+        auto& v3 = v[_indices.at(i + 2)];
         trace(_t("#klm coords: %f, %f, %f, %f, %f, %f, %f, %f, %f;\n"),
-            p1.klm.x, p1.klm.y, p1.klm.z,
-            p2.klm.x, p2.klm.y, p2.klm.z,
-            p3.klm.x, p3.klm.y, p3.klm.z
+            v1.klm.x, v1.klm.y, v1.klm.z,
+            v2.klm.x, v2.klm.y, v2.klm.z,
+            v3.klm.x, v3.klm.y, v3.klm.z
             );
     }
     trace(_t("@@\n"));
@@ -417,14 +974,16 @@ void rose_fill_batch_klm_tex::tracing() const
 
 void rose_fill_batch_klm_tex::create_from_fill(bat_fill_batch* bat)
 {
-    assert(bat);
+    assert(bat && _vctx);
     auto& rtr = bat->get_rtree();
     /* deal with texture batch */
     assert(_texbatch.is_empty());
-    rtr.for_each([this](bat_rtree_entity* ent) {
+    int count = 0;
+    rtr.for_each([this, &count](bat_rtree_entity* ent) {
         assert(ent);
         if(!ent->get_bind_arg())
             return;
+        count ++;
         auto* triangle = reinterpret_cast<bat_triangle*>(ent->get_bind_arg());
         assert(triangle);
         auto* joint1 = triangle->get_joint(0);
@@ -442,7 +1001,10 @@ void rose_fill_batch_klm_tex::create_from_fill(bat_fill_batch* bat)
     /* arrange texture batch */
     _texbatch.arrange();
     /* create vertices */
-    rtr.for_each([this](bat_rtree_entity* ent) {
+    vertex_writer_klm_tex vertices(*_vctx, count * 3);
+    _indices.reserve(count * 3);
+    rose_joint_vertices<vertex_info_klm_tex> shared(vertices, _indices);
+    rtr.for_each([this, &shared](bat_rtree_entity* ent) {
         assert(ent);
         if(!ent->get_bind_arg())
             return;
@@ -466,15 +1028,17 @@ void rose_fill_batch_klm_tex::create_from_fill(bat_fill_batch* bat)
             /* simply display this triangle. */
             pt[0].klm = pt[1].klm = pt[2].klm = vec3(1.f, 0.f, 0.f);
         }
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
+        shared.add_vertex(joint1, pt[0]);
+        shared.add_vertex(joint2, pt[1]);
+        shared.add_vertex(joint3, pt[2]);
     });
+    rose_optimize_vertex_cache(_indices, vertices.size());
+    set_vertices(vertices);
 }
 
 void rose_fill_batch_klm_tex::create_from_stroke(bat_stroke_batch* bat)
 {
-    assert(bat);
+    assert(bat && _vctx);
     auto& lines = bat->get_lines();
     /* deal with texture batch */
     for(auto* line : lines) {
@@ -491,6 +1055,8 @@ void rose_fill_batch_klm_tex::create_from_stroke(bat_stroke_batch* bat)
     /* arrange texture batch */
     _texbatch.arrange();
     /* create vertices */
+    vertex_writer_klm_tex vertices(*_vctx, (int)lines.size() * 4);
+    _indices.reserve(lines.size() * 6);
     for(auto* line : lines) {
         assert(line);
         /* point */
@@ -521,19 +1087,20 @@ void rose_fill_batch_klm_tex::create_from_stroke(bat_stroke_batch* bat)
             { p[2], vec3(1.f, 0.f, 0.f), tex1 },
             { p[3], vec3(1.f, 0.f, 0.f), tex2 },
         };
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[3]);
+        rose_line_vertices<vertex_info_klm_tex, _countof(pt)> quad(vertices, _indices, pt);
+        quad.add_triangle(0, 1, 2);
+        quad.add_triangle(2, 1, 3);
     }
+    set_vertices(vertices);
 }
 
 void rose_stroke_batch_coef_cr::create(bat_batch* bat)
 {
-    assert(bat);
+    assert(bat && _vctx);
     auto& lines = static_cast<bat_stroke_batch*>(bat)->get_lines();
+    /* a quad & the joints of both ends at most, 4 triangles on 8 vertices. */
+    vertex_writer_cf_cr vertices(*_vctx, (int)lines.size() * 8);
+    _indices.reserve(lines.size() * 12);
     for(auto* line : lines) {
         assert(line);
         /* point */
@@ -569,29 +1136,20 @@ void rose_stroke_batch_coef_cr::create(bat_batch* bat)
             { line->get_start_point(), coef, cr1 },
             { line->get_end_point(), coef, cr2 },
         };
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[3]);
+        rose_line_vertices<vertex_info_coef_cr, _countof(pt)> quad(vertices, _indices, pt);
+        quad.add_triangle(0, 1, 2);
+        quad.add_triangle(2, 1, 3);
         switch(line->get_head_con())
         {
         case bct_convex_wedge:
         case bct_concave_wedge:
-            _vertices.push_back(pt[4]);
-            _vertices.push_back(pt[0]);
-            _vertices.push_back(pt[2]);
+            quad.add_triangle(4, 0, 2);
             break;
         case bct_convex_notch:
-            _vertices.push_back(pt[4]);
-            _vertices.push_back(pt[0]);
-            _vertices.push_back(pt[6]);
+            quad.add_triangle(4, 0, 6);
             break;
         case bct_concave_notch:
-            _vertices.push_back(pt[4]);
-            _vertices.push_back(pt[6]);
-            _vertices.push_back(pt[2]);
+            quad.add_triangle(4, 6, 2);
             break;
         default:
             break;
@@ -600,24 +1158,19 @@ void rose_stroke_batch_coef_cr::create(bat_batch* bat)
         {
         case bct_convex_wedge:
         case bct_concave_wedge:
-            _vertices.push_back(pt[3]);
-            _vertices.push_back(pt[1]);
-            _vertices.push_back(pt[5]);
+            quad.add_triangle(3, 1, 5);
             break;
         case bct_convex_notch:
-            _vertices.push_back(pt[7]);
-            _vertices.push_back(pt[1]);
-            _vertices.push_back(pt[5]);
+            quad.add_triangle(7, 1, 5);
             break;
         case bct_concave_notch:
-            _vertices.push_back(pt[3]);
-            _vertices.push_back(pt[7]);
-            _vertices.push_back(pt[5]);
+            quad.add_triangle(3, 7, 5);
             break;
         default:
             break;
         }
     }
+    set_vertices(vertices);
 }
 
 void rose_stroke_batch_coef_cr::tracing() const
@@ -662,6 +1215,9 @@ void rose_stroke_batch_coef_tex::create_vertices(bat_batch* bat)
 
 void rose_stroke_batch_coef_tex::create_vertices(bat_lines& lines, const tex_batcher& bat)
 {
+    assert(_vctx);
+    vertex_writer_cf_tex vertices(*_vctx, (int)lines.size() * 8);
+    _indices.reserve(lines.size() * 12);
     for(auto* line : lines) {
         assert(line);
         /* point */
@@ -700,29 +1256,20 @@ void rose_stroke_batch_coef_tex::create_vertices(bat_lines& lines, const tex_bat
             { line->get_start_point(), coef, tex1 },
             { line->get_end_point(), coef, tex2 },
         };
-        _vertices.push_back(pt[0]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[2]);
-        _vertices.push_back(pt[1]);
-        _vertices.push_back(pt[3]);
+        rose_line_vertices<vertex_info_coef_tex, _countof(pt)> quad(vertices, _indices, pt);
+        quad.add_triangle(0, 1, 2);
+        quad.add_triangle(2, 1, 3);
         switch(line->get_head_con())
         {
         case bct_convex_wedge:
         case bct_concave_wedge:
-            _vertices.push_back(pt[4]);
-            _vertices.push_back(pt[0]);
-            _vertices.push_back(pt[2]);
+            quad.add_triangle(4, 0, 2);
             break;
         case bct_convex_notch:
-            _vertices.push_back(pt[4]);
-            _vertices.push_back(pt[0]);
-            _vertices.push_back(pt[6]);
+            quad.add_triangle(4, 0, 6);
             break;
         case bct_concave_notch:
-            _vertices.push_back(pt[4]);
-            _vertices.push_back(pt[6]);
-            _vertices.push_back(pt[2]);
+            quad.add_triangle(4, 6, 2);
             break;
         default:
             break;
@@ -731,24 +1278,19 @@ void rose_stroke_batch_coef_tex::create_vertices(bat_lines& lines, const tex_bat
         {
         case bct_convex_wedge:
         case bct_concave_wedge:
-            _vertices.push_back(pt[3]);
-            _vertices.push_back(pt[1]);
-            _vertices.push_back(pt[5]);
+            quad.add_triangle(3, 1, 5);
             break;
         case bct_convex_notch:
-            _vertices.push_back(pt[7]);
-            _vertices.push_back(pt[1]);
-            _vertices.push_back(pt[5]);
+            quad.add_triangle(7, 1, 5);
             break;
         case bct_concave_notch:
-            _vertices.push_back(pt[3]);
-            _vertices.push_back(pt[7]);
-            _vertices.push_back(pt[5]);
+            quad.add_triangle(3, 7, 5);
             break;
         default:
             break;
         }
     }
+    set_vertices(vertices);
 }
 
 void rose_stroke_batch_coef_tex::tracing() const
@@ -786,6 +1328,131 @@ void rose_stroke_batch_assoc_with_klm_tex::create_vertices(bat_batch* bat)
         );
 }
 
+rose_symbol_batch::rose_symbol_batch(int index, const rose_symbol* sym):
+    rose_batch(index)
+{
+    assert(sym && sym->vertex_buffer && sym->index_buffer);
+    _symbol = sym;
+    _instance_buffer = nullptr;
+    _instance_start = 0;
+    /* hold the buffers, in case the symbol was unregistered before the frame was drawn. */
+    _vertex_buffer = sym->vertex_buffer;
+    _vertex_buffer->AddRef();
+    _index_buffer = sym->index_buffer;
+    _index_buffer->AddRef();
+    _index_format = sym->index_format;
+    _vertex_stride = sizeof(vertex_info_klm);
+    _vertex_count = sym->vertex_count;
+    _draw_count = sym->index_count;
+}
+
+rose_symbol_batch::~rose_symbol_batch()
+{
+    release_vertex_buffer(_vertex_buffer);
+    release_index_buffer(_index_buffer);
+}
+
+void rose_symbol_batch::buffer_indices(render_ring_buffer& ring)
+{
+    assert(_vctx && _vctx->ring);
+    int count = (int)_instances.size();
+    if(!count)
+        return;
+    uint offset = 0;
+    auto* p = _vctx->ring->allocate(count * sizeof(rose_instance_info), sizeof(rose_instance_info), _instance_buffer, offset);
+    assert(p);
+    memcpy(p, &_instances.front(), count * sizeof(rose_instance_info));
+    _instance_start = (int)(offset / sizeof(rose_instance_info));
+}
+
+void rose_symbol_batch::tracing() const
+{
+    trace(_t("#start tracing symbol batch: %d vertices, %d indices, %d instances.\n"), _vertex_count, _draw_count, (int)_instances.size());
+    for(const auto& inst : _instances) {
+        trace(_t("#instance: %f, %f, %f, %f, %f, %f;\n"), inst.ex.x, inst.ex.y, inst.ey.x, inst.ey.y, inst.origin.x, inst.origin.y);
+    }
+}
+
+static const int rose_max_glyph_quads = 4096;    /* by a draw, so that the indices of the quads fit in 16 bits */
+
+rose_glyph_batch::rose_glyph_batch():
+    rose_batch(0)
+{
+    _page = nullptr;
+    _srv = nullptr;
+    _sstate = nullptr;
+    _vertex_stride = sizeof(vertex_info_glyph);
+}
+
+void rose_glyph_batch::reset(int index, texture2d* page, shader_resource_view* srv, render_sampler_state* ss, index_buffer* quad_indices)
+{
+    assert(page && srv && ss && quad_indices);
+    _bat_index = index;
+    _glyphs.clear();
+    _page = page;
+    _srv = srv;
+    _sstate = ss;
+    _vertex_buffer = nullptr;
+    _vertex_data = nullptr;
+    _vertex_start = 0;
+    _vertex_count = 0;
+    _index_buffer = quad_indices;
+    _index_format = rif_uint16;
+    _index_start = 0;
+    _draw_count = 0;
+}
+
+void rose_glyph_batch::add_quad(const rectf& dest, const rectf& uv, uint cr, const mat3& m)
+{
+    auto add_corner = [&](float x, float y, float u, float v) {
+        vertex_info_glyph g;
+        g.pos = vec2(x * m._11 + y * m._21 + m._31, x * m._12 + y * m._22 + m._32);
+        g.tex = vec2(u, v);
+        g.cr = cr;
+        _glyphs.push_back(g);
+    };
+    add_corner(dest.left, dest.top, uv.left, uv.top);
+    add_corner(dest.right, dest.top, uv.right, uv.top);
+    add_corner(dest.right, dest.bottom, uv.right, uv.bottom);
+    add_corner(dest.left, dest.bottom, uv.left, uv.bottom);
+    _draw_count += 6;
+}
+
+void rose_glyph_batch::buffer_indices(render_ring_buffer& ring)
+{
+    assert(_vctx && _vctx->ring);
+    int count = (int)_glyphs.size();
+    if(!count)
+        return;
+    uint offset = 0;
+    auto* p = _vctx->ring->allocate(count * sizeof(vertex_info_glyph), sizeof(vertex_info_glyph), _vertex_buffer, offset);
+    assert(p);
+    memcpy(p, &_glyphs.front(), count * sizeof(vertex_info_glyph));
+    _vertex_data = p;
+    _vertex_start = (int)(offset / sizeof(vertex_info_glyph));
+    _vertex_count = count;
+}
+
+void rose_glyph_batch::draw_quads(rose_submitter& sub)
+{
+    int quads = _draw_count / 6;
+    assert(quads * 4 == _vertex_count);
+    for(int i = 0; i < quads; i += rose_max_glyph_quads) {
+        int n = gs_min(quads - i, rose_max_glyph_quads);
+        sub.draw_indexed(n * 6, 0, _vertex_start + i * 4);
+    }
+}
+
+void rose_glyph_batch::tracing() const
+{
+    trace(_t("#start tracing glyph batch: %d quads.\n"), (int)_glyphs.size() / 4);
+    for(int i = 0; i < (int)_glyphs.size(); i += 4) {
+        auto& p1 = _glyphs.at(i).pos;
+        auto& p2 = _glyphs.at(i + 2).pos;
+        trace(_t("#quad: %f, %f, %f, %f;\n"), p1.x, p1.y, p2.x, p2.y);
+    }
+}
+
 void rose_bindings::clear_binding_cache()
 {
     _cr_bindings.clear();
@@ -961,17 +1628,24 @@ graphics_obj::graphics_obj(float w, float h)
 rose::rose()
 {
     _nextz = 0.f;
+    _last_symbol_batch = nullptr;
+    _glyph_pool_used = 0;
+    _last_glyph_batch = nullptr;
+    _layer_drawn = false;
     initialize();
 }
 
 rose::~rose()
 {
     clear_batches();
+    clear_symbols();
+    clear_glyphs();
     destroy_miscs();
 }
 
 void rose::draw_path(const painter_path& path)
 {
+    ariel_profile_counter(pci_paths, 1);
     context& ctx = get_context();
     auto& brush = ctx.get_brush();
     auto& pen = ctx.get_pen();
@@ -980,6 +1654,18 @@ void rose::draw_path(const painter_path& path)
     painter_path p;
     p.duplicate(path);
     p.transform(m);
+    /* the strokes went out of the boundary box by the half of the line width at most. */
+    rectf rc;
+    p.get_boundary_box(rc);
+    rc.left -= 2.f;
+    rc.top -= 2.f;
+    rc.right += 2.f;
+    rc.bottom += 2.f;
+    if(_layer_drawn)
+        union_rect(_layer_rect, _layer_rect, rc);
+    else
+        _layer_rect = rc;
+    _layer_drawn = true;
     prepare_fill(p, brush);
     prepare_stroke(p, pen);
 }
@@ -991,15 +1677,25 @@ void rose::on_draw_begin()
     _bp.clear_batches();
     _bp.set_antialias(query_antialias());
     _bindings.clear_binding_cache();
+    _atlas.begin_frame();
+    clear_batches();
+    _ring.begin_frame();
+    _index_ring.begin_frame();
+    _palette.clear();
 }
 
 void rose::on_draw_end()
 {
     __super::on_draw_end();
-    _bp.finish_batching();
-    clear_batches();
-    prepare_batches();
+    flush_layer();
+    /* the glyphs rasterized in the frame were uploaded before the draws. */
+    if(auto* fsys = scene::get_singleton_ptr()->get_fontsys())
+        fsys->commit_glyphs();
+    buffer_batches();
     draw_batches();
+    _ring.end_frame();
+    _index_ring.end_frame();
+    _atlas.end_frame();
     _gocache.clear();
 }
 
@@ -1011,6 +1707,172 @@ void rose::fill_non_picture_graphics_obj(graphics_obj& gfx, uint brush_tag)
         _bp.add_non_tex_polygon(p, z, brush_tag);
 }
 
+painter_symbol rose::register_symbol(const painter_path& path)
+{
+    assert(_rsys);
+    /* the klm coordinates were invariant under the affine transforms, so the symbol was tessellated in its own space. */
+    graphics_obj gfx(gs_max((float)get_width(), 1.f), gs_max((float)get_height(), 1.f));
+    gfx->proceed_fill(path);
+    rose_symbol_vertices cache;
+    index_stream indices;
+    rose_joint_vertices<vertex_info_klm, rose_symbol_vertices> shared(cache, indices);
+    for(auto* poly : gfx->get_polygons()) {
+        assert(poly);
+        dt_traversal_triangles dtts;
+        poly->get_cdt_result().collect_triangles(dtts);
+        for(const dt_traversal_triangle& dtt : dtts) {
+            auto* j1 = reinterpret_cast<lb_joint*>(dtt.binding1);
+            auto* j2 = reinterpret_cast<lb_joint*>(dtt.binding2);
+            auto* j3 = reinterpret_cast<lb_joint*>(dtt.binding3);
+            assert(j1 && j2 && j3);
+            bat_triangle triangle(j1, j2, j3);
+            vertex_info_klm pt[3] =
+            {
+                { j1->get_point(), vec3(1.f, 0.f, 0.f) },
+                { j2->get_point(), vec3(1.f, 0.f, 0.f) },
+                { j3->get_point(), vec3(1.f, 0.f, 0.f) }
+            };
+            if(triangle.has_klm_coords())
+                rose_filling_klm_coords(&triangle, pt);
+            shared.add_vertex(j1, pt[0]);
+            shared.add_vertex(j2, pt[1]);
+            shared.add_vertex(j3, pt[2]);
+        }
+    }
+    rose_optimize_vertex_cache(indices, cache.size());
+    auto* sym = new rose_symbol;
+    sym->vertex_count = cache.size();
+    sym->index_count = (int)indices.size();
+    if(sym->index_count > 0) {
+        sym->vertex_buffer = _rsys->create_vertex_buffer(sizeof(vertex_info_klm), sym->vertex_count, false, false, rose_static_usage, &cache.vertices.front());
+        assert(sym->vertex_buffer);
+        if(sym->vertex_count <= 0xffff) {
+            vector<uint16> packed(indices.size());
+            for(int i = 0; i < sym->index_count; i ++)
+                packed.at(i) = (uint16)indices.at(i);
+            sym->index_buffer = _rsys->create_index_buffer((uint)packed.size(), rif_uint16, false, false, rose_static_usage, &packed.front());
+            sym->index_format = rif_uint16;
+        }
+        else {
+            sym->index_buffer = _rsys->create_index_buffer((uint)indices.size(), rif_uint32, false, false, rose_static_usage, &indices.front());
+            sym->index_format = rif_uint32;
+        }
+        assert(sym->index_buffer);
+    }
+    painter_symbol id = _next_symbol ++;
+    _symbols.emplace(id, sym);
+    return id;
+}
+
+void rose::unregister_symbol(painter_symbol sym)
+{
+    auto f = _symbols.find(sym);
+    if(f == _symbols.end())
+        return;
+    auto* p = f->second;
+    assert(p);
+    if(_last_symbol_batch && _last_symbol_batch->get_symbol() == p)
+        _last_symbol_batch = nullptr;
+    release_vertex_buffer(p->vertex_buffer);
+    release_index_buffer(p->index_buffer);
+    delete p;
+    _symbols.erase(f);
+}
+
+void rose::draw_symbol(painter_symbol sym, const painter_symbol_instance instances[], int count)
+{
+    assert(instances || !count);
+    auto f = _symbols.find(sym);
+    if(f == _symbols.end()) {
+        assert(!"unknown symbol.");
+        return;
+    }
+    auto* symbol = f->second;
+    assert(symbol);
+    if(count <= 0 || !symbol->index_count)
+        return;
+    /* the paths drawn before went below the symbol, they were turned into batches first. */
+    flush_layer();
+    auto* bat = _last_symbol_batch;
+    if(!bat || (bat->get_symbol() != symbol) || (_batches.back() != bat))
+        _last_symbol_batch = bat = create_symbol_batch((int)_batches.size(), symbol);
+    assert(bat);
+    mat3 m;
+    get_transform_recursively(m);
+    for(int i = 0; i < count; i ++) {
+        const auto& src = instances[i];
+        mat3 t = src.transform;
+        t *= m;
+        assert(t._13 == 0.f && t._23 == 0.f);
+        rose_instance_info inst;
+        inst.ex = vec2(t._11, t._12);
+        inst.ey = vec2(t._21, t._22);
+        inst.origin = vec2(t._31, t._32);
+        inst.cr = vec4((float)src.cr.red / 255.f, (float)src.cr.green / 255.f, (float)src.cr.blue / 255.f, (float)src.cr.alpha / 255.f);
+        bat->add_instance(inst);
+    }
+}
+
+void rose::draw_text(const gchar* str, float x, float y, const color& cr, int length)
+{
+    if(!str || !length)
+        return;
+    auto* fsys = scene::get_singleton_ptr()->get_fontsys();
+    assert(fsys);
+    if(!fsys->query_glyphs(_glyph_quads, str, length))
+        return __super::draw_text(str, x, y, cr, length);
+    if(_glyph_quads.empty())
+        return;
+    mat3 m;
+    get_transform_recursively(m);
+    /* the paths drawn before went below the text, they were turned into batches first only if the text was over them. */
+    if(_layer_drawn) {
+        rectf rc = _glyph_quads.front().dest;
+        for(const auto& q : _glyph_quads)
+            union_rect(rc, rc, q.dest);
+        rc.offset(x, y);
+        vec2 pts[] =
+        {
+            vec2(rc.left, rc.top),
+            vec2(rc.right, rc.top),
+            vec2(rc.left, rc.bottom),
+            vec2(rc.right, rc.bottom),
+        };
+        rectf bound;
+        for(int i = 0; i < _countof(pts); i ++) {
+            vec2 p;
+            p.transformcoord(pts[i], m);
+            if(!i)
+                bound.set_rect(p.x, p.y, 0.f, 0.f);
+            else {
+                bound.left = gs_min(bound.left, p.x);
+                bound.top = gs_min(bound.top, p.y);
+                bound.right = gs_max(bound.right, p.x);
+                bound.bottom = gs_max(bound.bottom, p.y);
+            }
+        }
+        if(is_rect_intersected(bound, _layer_rect))
+            flush_layer();
+    }
+    uint c = rose_pack_color(vec4((float)cr.red / 255.f, (float)cr.green / 255.f, (float)cr.blue / 255.f, (float)cr.alpha / 255.f));
+    auto* bat = (!_batches.empty() && _batches.back() == _last_glyph_batch) ? _last_glyph_batch : nullptr;
+    int page = -1;
+    texture2d* tex = nullptr;
+    for(const auto& q : _glyph_quads) {
+        if(q.page != page) {
+            page = q.page;
+            tex = fsys->get_glyph_page(page);
+            assert(tex);
+        }
+        if(!bat || bat->get_page() != tex)
+            bat = create_glyph_batch((int)_batches.size(), tex);
+        rectf dest = q.dest;
+        dest.offset(x, y);
+        bat->add_quad(dest, q.uv, c, m);
+    }
+    _last_glyph_batch = bat;
+}
+
 bat_batch* rose::fill_picture_graphics_obj(graphics_obj& gfx)
 {
     auto z = _nextz ++;
@@ -1084,6 +1946,7 @@ void rose::setup_configs()
 
 void rose::prepare_fill(const painter_path& path, const painter_brush& brush)
 {
+    ariel_profile_scope("rose::prepare_fill");
     if(brush.get_tag() == painter_brush::none)
         return;
     if(brush.get_tag() == painter_brush::picture)
@@ -1157,6 +2020,7 @@ void rose::prepare_picture_fill(const painter_path& path, const painter_brush& b
 
 void rose::prepare_stroke(const painter_path& path, const painter_pen& pen)
 {
+    ariel_profile_scope("rose::prepare_stroke");
     if(pen.get_tag() == painter_pen::none)
         return;
     graphics_obj gfx((float)get_width(), (float)get_height());
@@ -1172,6 +2036,7 @@ rose_batch* rose::create_fill_batch_cr(int index)
     ptr->set_vertex_shader(_vsf_cr);
     ptr->set_pixel_shader(_psf_cr);
     ptr->set_vertex_format(_vf_cr);
+    ptr->set_vertex_context(&_vertex_context);
     _batches.push_back(ptr);
     return ptr;
 }
@@ -1182,6 +2047,7 @@ rose_batch* rose::create_fill_batch_klm_cr(int index)
     ptr->set_vertex_shader(_vsf_klm_cr);
     ptr->set_pixel_shader(_psf_klm_cr);
     ptr->set_vertex_format(_vf_klm_cr);
+    ptr->set_vertex_context(&_vertex_context);
     _batches.push_back(ptr);
     return ptr;
 }
@@ -1190,9 +2056,11 @@ rose_batch* rose::create_fill_batch_klm_tex(int index)
 {
     auto* sstate = acquire_default_sampler_state();
     auto* ptr = new rose_fill_batch_klm_tex(index, sstate);
+    ptr->set_tex_atlas(&_atlas);
     ptr->set_vertex_shader(_vsf_klm_tex);
     ptr->set_pixel_shader(_psf_klm_tex);
     ptr->set_vertex_format(_vf_klm_tex);
+    ptr->set_vertex_context(&_vertex_context);
     _batches.push_back(ptr);
     return ptr;
 }
@@ -1205,6 +2073,7 @@ rose_batch* rose::create_stroke_batch_cr(int index)
     ptr->set_vertex_shader(_vss_coef_cr);
     ptr->set_pixel_shader(_pss_coef_cr);
     ptr->set_vertex_format(_vf_coef_cr);
+    ptr->set_vertex_context(&_vertex_context);
     _batches.push_back(ptr);
     return ptr;
 }
@@ -1215,9 +2084,11 @@ rose_batch* rose::create_stroke_batch_tex(int index)
         return create_fill_batch_klm_tex(index);
     auto* sstate = acquire_default_sampler_state();
     auto* ptr = new rose_stroke_batch_coef_tex(index, sstate);
+    ptr->set_tex_atlas(&_atlas);
     ptr->set_vertex_shader(_vss_coef_tex);
     ptr->set_pixel_shader(_pss_coef_tex);
     ptr->set_vertex_format(_vf_coef_tex);
+    ptr->set_vertex_context(&_vertex_context);
     _batches.push_back(ptr);
     return ptr;
 }
@@ -1229,20 +2100,120 @@ rose_batch* rose::create_stroke_batch_assoc(int index, rose_fill_batch_klm_tex*
     ptr->set_vertex_shader(_vss_coef_tex);
     ptr->set_pixel_shader(_pss_coef_tex);
     ptr->set_vertex_format(_vf_coef_tex);
+    ptr->set_vertex_context(&_vertex_context);
+    _batches.push_back(ptr);
+    return ptr;
+}
+
+rose_symbol_batch* rose::create_symbol_batch(int index, const rose_symbol* sym)
+{
+    auto* ptr = new rose_symbol_batch(index, sym);
+    ptr->set_vertex_shader(_vsf_klm_inst);
+    ptr->set_pixel_shader(_psf_klm_cr);
+    ptr->set_vertex_format(_vf_klm_inst);
+    ptr->set_vertex_context(&_vertex_context);
+    _batches.push_back(ptr);
+    return ptr;
+}
+
+rose_glyph_batch* rose::create_glyph_batch(int index, texture2d* page)
+{
+    assert(page && _glyph_indices);
+    auto f = _glyph_pages.find(page);
+    if(f == _glyph_pages.end()) {
+        /* hold the page, so that it could not be taken by another one while the view was cached. */
+        auto* srv = _rsys->create_shader_resource_view(convert_to_resource(page));
+        assert(srv);
+        page->AddRef();
+        f = _glyph_pages.emplace(page, srv).first;
+    }
+    rose_glyph_batch* ptr = nullptr;
+    if(_glyph_pool_used < (int)_glyph_pool.size())
+        ptr = _glyph_pool.at(_glyph_pool_used);
+    else {
+        ptr = new rose_glyph_batch;
+        ptr->set_vertex_shader(_vsf_glyph);
+        ptr->set_pixel_shader(_psf_glyph);
+        ptr->set_vertex_format(_vf_glyph);
+        ptr->set_vertex_context(&_vertex_context);
+        _glyph_pool.push_back(ptr);
+    }
+    _glyph_pool_used ++;
+    ptr->reset(index, page, f->second, _sampler_state, _glyph_indices);
     _batches.push_back(ptr);
     return ptr;
 }
 
 void rose::clear_batches()
 {
-    for(auto* p : _batches) { delete p; }
+    for(auto* p : _batches) {
+        if(!p->is_pooled())
+            delete p;
+    }
     _batches.clear();
+    _last_symbol_batch = nullptr;
+    _glyph_pool_used = 0;
+    _last_glyph_batch = nullptr;
+}
+
+void rose::clear_glyphs()
+{
+    for(auto* p : _glyph_pool) { delete p; }
+    _glyph_pool.clear();
+    _glyph_pool_used = 0;
+    _last_glyph_batch = nullptr;
+    for(auto& p : _glyph_pages) {
+        p.second->Release();
+        p.first->Release();
+    }
+    _glyph_pages.clear();
+}
+
+void rose::setup_glyphs()
+{
+    assert(_rsys && !_glyph_indices);
+    vector<uint16> indices;
+    indices.reserve(rose_max_glyph_quads * 6);
+    for(int i = 0; i < rose_max_glyph_quads; i ++) {
+        uint16 v = (uint16)(i * 4);
+        uint16 quad[] = { v, (uint16)(v + 1), (uint16)(v + 2), v, (uint16)(v + 2), (uint16)(v + 3) };
+        indices.insert(indices.end(), quad, quad + _countof(quad));
+    }
+    _glyph_indices = _rsys->create_index_buffer((uint)indices.size(), rif_uint16, false, false, rose_static_usage, &indices.front());
+    assert(_glyph_indices);
+}
+
+void rose::clear_symbols()
+{
+    for(auto& s : _symbols) {
+        auto* p = s.second;
+        assert(p);
+        release_vertex_buffer(p->vertex_buffer);
+        release_index_buffer(p->index_buffer);
+        delete p;
+    }
+    _symbols.clear();
+}
+
+/*
+ * The batch processor reorders the paths by the overlaps, which knows nothing about the symbols, so the paths were
+ * turned into the batches as a layer whenever a symbol was drawn, the layers were drawn in order. The texts flush
+ * the layer only when they were over the paths in it, the texts apart from them went ahead of the layer.
+ */
+void rose::flush_layer()
+{
+    _bp.finish_batching();
+    prepare_batches();
+    _bp.clear_batches();
+    _layer_drawn = false;
 }
 
 void rose::prepare_batches()
 {
+    ariel_profile_scope("rose::prepare_batches");
     auto& batches = _bp.get_batches();
     int size = (int)batches.size();
+    ariel_profile_counter(pci_batches, size);
     for(int i = 0; i < size; i ++) {
         auto* p = batches.at(i);
         auto t = p->get_type();
@@ -1261,6 +2232,9 @@ void rose::prepare_batches()
                 assert(bat);
                 bat->create(p);
                 bat->buffering(_rsys);
+#if (defined(_DEBUG) || defined(DEBUG)) && defined(_GS_DEBUG_VERBOSE)
+                bat->tracing();
+#endif
                 /* should have an associated stroke batch after. */
                 p = batches.at(++ i);
                 assert(i < size);
@@ -1278,19 +2252,67 @@ void rose::prepare_batches()
         assert(bat);
         bat->create(p);
         bat->buffering(_rsys);
+#if (defined(_DEBUG) || defined(DEBUG)) && defined(_GS_DEBUG_VERBOSE)
+        bat->tracing();     /* while the vertices were still mapped */
+#endif
     }
 }
 
+/*
+ * The batches streamed their vertices into the ring in order, so the adjacent ones of the same kind were contiguous
+ * unless the ring wrapped or grew in between, the ones without any resources of their own were merged into a single draw.
+ * The indices were streamed into the index ring after the merging, rebased on the first vertex of the merged draw.
+ */
+void rose::buffer_batches()
+{
+    rose_batch* first = nullptr;
+    for(auto* p : _batches) {
+        if(!p->get_draw_count())
+            continue;
+        if(first && first->is_mergeable() && p->is_mergeable() && (first->get_tag() == p->get_tag()) &&
+            (first->get_vertex_buffer() == p->get_vertex_buffer()) &&
+            (first->get_vertex_start() + first->get_vertex_count() == p->get_vertex_start())
+            ) {
+            first->merge(p);
+            continue;
+        }
+        first = p;
+    }
+    for(auto* p : _batches) {
+        if(p->get_draw_count() > 0)
+            p->buffer_indices(_index_ring);
+    }
+    _ring.flush();
+    _index_ring.flush();
+}
+
 void rose::draw_batches()
 {
+    _submitter.begin(_rsys);
+    _submitter.add_ring_stats(_ring.get_stats());
+    _submitter.add_index_ring_stats(_index_ring.get_stats());
+    _submitter.set_constant_buffer(_cb_config_slot, _cb_configs, st_vertex_shader);
+    _submitter.set_constant_buffer(_cb_config_slot, _cb_configs, st_pixel_shader);
+    if(_vertex_context.layout == rvl_palette) {
+        update_palette();
+        _submitter.set_constant_buffer(_cb_palette_slot, _cb_palette, st_vertex_shader);
+    }
     for(auto* p : _batches) {
-        p->draw(_rsys);
-#if (defined(_DEBUG) || defined(DEBUG)) && defined(_GS_DEBUG_VERBOSE)
-        p->tracing();
-#endif
+        _submitter.add_requested_draw();
+        if(p->get_draw_count() > 0) {
+            _submitter.add_batch_stats(p->get_vertex_count(), p->get_draw_count(), p->get_vertex_stride());
+            p->draw(_submitter);
+        }
     }
 }
 
+void rose::update_palette()
+{
+    assert(_cb_palette);
+    if(int size = _palette.size())
+        _rsys->update_buffer(_cb_palette, size * (int)sizeof(vec4), _palette.get_colors());
+}
+
 void rose_paint_non_picture_brush(graphics_obj& gfx, rose_bindings& bindings, const painter_brush& brush)
 {
     auto t = brush.get_tag();
@@ -29,6 +29,12 @@ cbuffer rose_configs : register(b0)
     float3x3    g_mapscreen;
 };
 
+// used for the palette layout
+cbuffer rose_palette : register(b1)
+{
+    float4      g_palette[4096];
+};
+
 // used for texture batched draw
 Texture2D       g_texture : register(t0);
 SamplerState    g_sstate : register(s0);
@@ -67,6 +73,60 @@ struct rose_vsf_coef_tex_input
     float2      tex : TEXCOORD1;
 };
 
+// the compact layouts, the colors were rgba8 & the klm were halfs, converted by the input assembler.
+struct rose_vsf_cr_pal_input
+{
+    float2      position : POSITION;
+    uint        index : BLENDINDICES;
+};
+
+struct rose_vsf_klm_cr_pal_input
+{
+    float2      position : POSITION;
+    float3      klm : TEXCOORD;
+    uint        index : BLENDINDICES;
+};
+
+struct rose_vss_dist_cr_input
+{
+    float2      position : POSITION;
+    float2      dist : TEXCOORD;        // signed distance to the line & AA tune
+    float4      color : COLOR;
+};
+
+struct rose_vss_dist_cr_pal_input
+{
+    float2      position : POSITION;
+    float2      dist : TEXCOORD;
+    uint        index : BLENDINDICES;
+};
+
+struct rose_vss_dist_tex_input
+{
+    float2      position : POSITION;
+    float2      dist : TEXCOORD0;
+    float2      tex : TEXCOORD1;
+};
+
+// the symbols were drawn instanced, the vertices in the symbol space & the transforms per instance.
+struct rose_vsf_klm_inst_input
+{
+    float2      position : POSITION;
+    float3      klm : TEXCOORD0;
+    float2      ex : TEXCOORD1;
+    float2      ey : TEXCOORD2;
+    float2      origin : TEXCOORD3;
+    float4      color : COLOR;
+};
+
+// the glyphs of the texts, the coverage was in the alpha of the atlas & the colors were rgba8.
+struct rose_vsf_glyph_input
+{
+    float2      position : POSITION;
+    float2      tex : TEXCOORD0;
+    float4      color : COLOR;
+};
+
 float2 rose_mapping_point(float2 p)
 {
     float3 cv = mul(float3(p, 1.f), g_mapscreen);
@@ -85,6 +145,17 @@ float rose_get_alpha(float4 pos, float4 coef)
     return alpha;
 }
 
+// the distance was linear over the primitive, interpolated rather than evaluated by the coefficients per pixel
+float rose_get_dist_alpha(float2 dist)
+{
+    float dx = ddx(dist.x);
+    float dy = ddy(dist.x);
+    float grad = length(float2(dx, dy));
+    float threshold = dist.y * grad;
+    float alpha = saturate(1.f - abs(dist.x / threshold));
+    return alpha;
+}
+
 void rose_vsf_cr(rose_vsf_cr_input input, out float4 pos : SV_POSITION, out float4 cr : COLOR)
 {
     pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
@@ -167,3 +238,71 @@ float4 rose_pss_coef_tex(float4 pos : SV_POSITION, float4 coef : TEXCOORD0, floa
     float4 cr = g_texture.Sample(g_sstate, tex);
     return float4(cr.xyz, cr.w * alpha);
 }
+
+void rose_vsf_klm_inst(rose_vsf_klm_inst_input input, out float4 pos : SV_POSITION, out float3 klm : TEXCOORD, out float4 cr : COLOR)
+{
+    float2 p = input.position.x * input.ex + input.position.y * input.ey + input.origin;
+    pos = float4(rose_mapping_point(p), 0.5f, 1.f);
+    klm = input.klm;
+    cr = input.color;
+}
+
+void rose_vsf_cr_pal(rose_vsf_cr_pal_input input, out float4 pos : SV_POSITION, out float4 cr : COLOR)
+{
+    pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
+    cr = g_palette[input.index];
+}
+
+void rose_vsf_klm_cr_pal(rose_vsf_klm_cr_pal_input input, out float4 pos : SV_POSITION, out float3 klm : TEXCOORD, out float4 cr : COLOR)
+{
+    pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
+    klm = input.klm;
+    cr = g_palette[input.index];
+}
+
+void rose_vss_dist_cr(rose_vss_dist_cr_input input, out float4 pos : SV_POSITION, out float2 dist : TEXCOORD, out float4 cr : COLOR)
+{
+    pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
+    dist = input.dist;
+    cr = input.color;
+}
+
+void rose_vss_dist_cr_pal(rose_vss_dist_cr_pal_input input, out float4 pos : SV_POSITION, out float2 dist : TEXCOORD, out float4 cr : COLOR)
+{
+    pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
+    dist = input.dist;
+    cr = g_palette[input.index];
+}
+
+float4 rose_pss_dist_cr(float4 pos : SV_POSITION, float2 dist : TEXCOORD, float4 cr : COLOR) : SV_TARGET
+{
+    float alpha = rose_get_dist_alpha(dist);
+    return float4(cr.xyz, cr.w * alpha);
+}
+
+void rose_vss_dist_tex(rose_vss_dist_tex_input input, out float4 pos : SV_POSITION, out float2 dist : TEXCOORD0, out float2 tex : TEXCOORD1)
+{
+    pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
+    dist = input.dist;
+    tex = input.tex;
+}
+
+float4 rose_pss_dist_tex(float4 pos : SV_POSITION, float2 dist : TEXCOORD0, float2 tex : TEXCOORD1) : SV_TARGET
+{
+    float alpha = rose_get_dist_alpha(dist);
+    float4 cr = g_texture.Sample(g_sstate, tex);
+    return float4(cr.xyz, cr.w * alpha);
+}
+
+void rose_vsf_glyph(rose_vsf_glyph_input input, out float4 pos : SV_POSITION, out float2 tex : TEXCOORD0, out float4 cr : COLOR)
+{
+    pos = float4(rose_mapping_point(input.position), 0.5f, 1.f);
+    tex = input.tex;
+    cr = input.color;
+}
+
+float4 rose_psf_glyph(float4 pos : SV_POSITION, float2 tex : TEXCOORD0, float4 cr : COLOR) : SV_TARGET
+{
+    float coverage = g_texture.Sample(g_sstate, tex).w;
+    return float4(cr.xyz, cr.w * coverage);
+}
@@ -36,9 +36,21 @@
 #include "rose_vsf_klm_tex.h"
 #include "rose_vss_coef_cr.h"
 #include "rose_vss_coef_tex.h"
+#include "rose_vsf_cr_pal.h"
+#include "rose_vsf_klm_cr_pal.h"
+#include "rose_vss_dist_cr.h"
+#include "rose_vss_dist_cr_pal.h"
+#include "rose_pss_dist_cr.h"
+#include "rose_vss_dist_tex.h"
+#include "rose_pss_dist_tex.h"
+#include "rose_vsf_klm_inst.h"
+#include "rose_vsf_glyph.h"
+#include "rose_psf_glyph.h"
 
 __ariel_begin__
 
+static const uint rose_static_usage = D3D11_USAGE_IMMUTABLE;   /* the buffers of the symbols */
+
 template<class c>
 static void release_any(c& cptr)
 {
@@ -48,55 +60,64 @@ static void release_any(c& cptr)
     }
 }
 
-static void debug_save_texture(texture2d* p, const string& path)
+struct rose_bytecode
 {
-    assert(p);
-    image img;
-    textureop::convert_to_image(img, p);
-    img.save(path);
-}
+    const void*         ptr;
+    size_t              len;
 
-template<class stream_type>
-int rose_batch::template_buffering(stream_type& stm, rendersys* rsys)
+public:
+    template<size_t _len>
+    rose_bytecode(const BYTE (&code)[_len]): ptr(code), len(_len) {}
+};
+
+static void debug_save_texture(rendersys* rsys, texture2d* p, const string& path)
 {
-    assert(rsys);
-    assert(!_vertex_buffer);
-    int c = (int)stm.size();
-    _vertex_buffer = rsys->create_vertex_buffer(sizeof(stream_type::value_type), c, false, false, D3D11_USAGE_DEFAULT, &stm.front());
-    assert(_vertex_buffer);
-    return c;
+    assert(rsys && p);
+    image img;
+    textureop(rsys).convert_to_image(img, p);
+    img.save(path);
 }
 
-int rose_fill_batch_cr::buffering(rendersys* rsys)
+void rose_fill_batch_cr::draw(rose_submitter& sub)
 {
-    return template_buffering(_vertices, rsys);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
 }
 
-void rose_fill_batch_cr::draw(rendersys* rsys)
+void rose_fill_batch_klm_cr::draw(rose_submitter& sub)
 {
-    assert(rsys);
-    setup_vs_and_ps(rsys);
-    setup_vf_and_topology(rsys, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    rsys->set_vertex_buffer(_vertex_buffer, sizeof(vertex_info_cr), 0);
-    int c = (int)_vertices.size();
-    assert(c % 3 == 0);
-    rsys->draw(c, 0);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
 }
 
-int rose_fill_batch_klm_cr::buffering(rendersys* rsys)
+void rose_symbol_batch::draw(rose_submitter& sub)
 {
-    return template_buffering(_vertices, rsys);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_instance_buffer(_instance_buffer, sizeof(rose_instance_info));
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed_instanced(_draw_count, (uint)_instances.size(), _index_start, _vertex_start, _instance_start);
 }
 
-void rose_fill_batch_klm_cr::draw(rendersys* rsys)
+void rose_glyph_batch::draw(rose_submitter& sub)
 {
-    assert(rsys);
-    setup_vs_and_ps(rsys);
-    setup_vf_and_topology(rsys, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    rsys->set_vertex_buffer(_vertex_buffer, sizeof(vertex_info_klm_cr), 0);
-    int c = (int)_vertices.size();
-    assert(c % 3 == 0);
-    rsys->draw(c, 0);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    sub.set_sampler_state(0, _sstate, st_pixel_shader);
+    sub.set_shader_resource(0, _srv, st_pixel_shader);
+    draw_quads(sub);
 }
 
 int rose_fill_batch_klm_tex::buffering(rendersys* rsys)
@@ -106,20 +127,19 @@ int rose_fill_batch_klm_tex::buffering(rendersys* rsys)
     assert(_tex);
     _srv = rsys->create_shader_resource_view(convert_to_resource(_tex));
     assert(_srv);
-    return template_buffering(_vertices, rsys);
+    return get_vertex_count();
 }
 
-void rose_fill_batch_klm_tex::draw(rendersys* rsys)
+void rose_fill_batch_klm_tex::draw(rose_submitter& sub)
 {
-    assert(rsys);
-    setup_vs_and_ps(rsys);
-    setup_vf_and_topology(rsys, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    rsys->set_vertex_buffer(_vertex_buffer, sizeof(vertex_info_klm_tex), 0);
-    rsys->set_sampler_state(0, _sstate, st_pixel_shader);
-    rsys->set_shader_resource(0, _srv, st_pixel_shader);
-    int c = (int)_vertices.size();
-    assert(c % 3 == 0);
-    rsys->draw(c, 0);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    sub.set_sampler_state(0, _sstate, st_pixel_shader);
+    sub.set_shader_resource(0, _srv, st_pixel_shader);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
 }
 
 void rose_fill_batch_klm_tex::destroy()
@@ -129,20 +149,14 @@ void rose_fill_batch_klm_tex::destroy()
     release_any(_srv);
 }
 
-int rose_stroke_batch_coef_cr::buffering(rendersys* rsys)
-{
-    return template_buffering(_vertices, rsys);
-}
-
-void rose_stroke_batch_coef_cr::draw(rendersys* rsys)
+void rose_stroke_batch_coef_cr::draw(rose_submitter& sub)
 {
-    assert(rsys);
-    setup_vs_and_ps(rsys);
-    setup_vf_and_topology(rsys, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    rsys->set_vertex_buffer(_vertex_buffer, sizeof(vertex_info_coef_cr), 0);
-    int c = (int)_vertices.size();
-    assert(c % 3 == 0);
-    rsys->draw(c, 0);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
 }
 
 int rose_stroke_batch_coef_tex::buffering(rendersys* rsys)
@@ -152,20 +166,19 @@ int rose_stroke_batch_coef_tex::buffering(rendersys* rsys)
     assert(_tex);
     _srv = rsys->create_shader_resource_view(convert_to_resource(_tex));
     assert(_srv);
-    return template_buffering(_vertices, rsys);
+    return get_vertex_count();
 }
 
-void rose_stroke_batch_coef_tex::draw(rendersys* rsys)
+void rose_stroke_batch_coef_tex::draw(rose_submitter& sub)
 {
-    assert(rsys);
-    setup_vs_and_ps(rsys);
-    setup_vf_and_topology(rsys, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    rsys->set_vertex_buffer(_vertex_buffer, sizeof(vertex_info_coef_tex), 0);
-    rsys->set_sampler_state(0, _sstate, st_pixel_shader);
-    rsys->set_shader_resource(0, _srv, st_pixel_shader);
-    int c = (int)_vertices.size();
-    assert(c % 3 == 0);
-    rsys->draw(c, 0);
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    sub.set_sampler_state(0, _sstate, st_pixel_shader);
+    sub.set_shader_resource(0, _srv, st_pixel_shader);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
 }
 
 void rose_stroke_batch_coef_tex::destroy()
@@ -182,62 +195,92 @@ int rose_stroke_batch_assoc_with_klm_tex::buffering(rendersys* rsys)
     _tex = _assoc->_tex;
     _srv = _assoc->_srv;
     assert(_tex && _srv);
-    return template_buffering(_vertices, rsys);
+    return get_vertex_count();
 }
 
-void rose::setup(rendersys* rsys)
+void rose::setup(rendersys* rsys, rose_vertex_layout layout)
 {
     assert(rsys);
     _rsys = rsys;
+    _atlas.setup(rsys);
+    _vertex_context.layout = layout;
+    /* the input assembler converts the compact formats, so the programs were shared except the palette & the distance ones. */
+    bool compact = (layout != rvl_full), palette = (layout == rvl_palette);
+    const char* crsem = palette ? "BLENDINDICES" : "COLOR";
+    DXGI_FORMAT crfmt = palette ? DXGI_FORMAT_R32_UINT : compact ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R32G32B32A32_FLOAT;
+    DXGI_FORMAT klmfmt = compact ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R32G32B32_FLOAT;
+    DXGI_FORMAT coeffmt = compact ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32G32B32A32_FLOAT;
     rendersys::vertex_format_desc descf_cr[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        { crsem, 0, crfmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
     };
     rendersys::vertex_format_desc descf_klm_cr[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        { "TEXCOORD", 0, klmfmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { crsem, 0, crfmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
     };
     rendersys::vertex_format_desc descs_coef_cr[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, coeffmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { crsem, 0, crfmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     };
     rendersys::vertex_format_desc descf_klm_tex[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, klmfmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
         { "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
     };
     rendersys::vertex_format_desc descs_coef_tex[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, coeffmt, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
         { "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     };
+    rendersys::vertex_format_desc descf_klm_inst[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 2, DXGI_FORMAT_R32G32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 3, DXGI_FORMAT_R32G32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+    rendersys::vertex_format_desc descf_glyph[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+    /* select the programs of the layout */
+    rose_bytecode vsf_cr = palette ? rose_bytecode(g_rose_vsf_cr_pal) : rose_bytecode(g_rose_vsf_cr);
+    rose_bytecode vsf_klm_cr = palette ? rose_bytecode(g_rose_vsf_klm_cr_pal) : rose_bytecode(g_rose_vsf_klm_cr);
+    rose_bytecode vss_coef_cr = palette ? rose_bytecode(g_rose_vss_dist_cr_pal) : compact ? rose_bytecode(g_rose_vss_dist_cr) : rose_bytecode(g_rose_vss_coef_cr);
+    rose_bytecode pss_coef_cr = compact ? rose_bytecode(g_rose_pss_dist_cr) : rose_bytecode(g_rose_pss_coef_cr);
+    rose_bytecode vss_coef_tex = compact ? rose_bytecode(g_rose_vss_dist_tex) : rose_bytecode(g_rose_vss_coef_tex);
+    rose_bytecode pss_coef_tex = compact ? rose_bytecode(g_rose_pss_dist_tex) : rose_bytecode(g_rose_pss_coef_tex);
     /* create shader cr */
-    _vsf_cr = _rsys->create_vertex_shader(g_rose_vsf_cr, sizeof(g_rose_vsf_cr));
+    _vsf_cr = _rsys->create_vertex_shader(vsf_cr.ptr, vsf_cr.len);
     assert(_vsf_cr);
-    _vf_cr = _rsys->create_vertex_format(g_rose_vsf_cr, sizeof(g_rose_vsf_cr), descf_cr, _countof(descf_cr));
+    _vf_cr = _rsys->create_vertex_format(vsf_cr.ptr, vsf_cr.len, descf_cr, _countof(descf_cr));
     assert(_vf_cr);
     _psf_cr = _rsys->create_pixel_shader(g_rose_psf_cr, sizeof(g_rose_psf_cr));
     assert(_psf_cr);
     /* create shader klm cr */
-    _vsf_klm_cr = _rsys->create_vertex_shader(g_rose_vsf_klm_cr, sizeof(g_rose_vsf_klm_cr));
+    _vsf_klm_cr = _rsys->create_vertex_shader(vsf_klm_cr.ptr, vsf_klm_cr.len);
     assert(_vsf_klm_cr);
-    _vf_klm_cr = _rsys->create_vertex_format(g_rose_vsf_klm_cr, sizeof(g_rose_vsf_klm_cr), descf_klm_cr, _countof(descf_klm_cr));
+    _vf_klm_cr = _rsys->create_vertex_format(vsf_klm_cr.ptr, vsf_klm_cr.len, descf_klm_cr, _countof(descf_klm_cr));
     assert(_vf_klm_cr);
     _psf_klm_cr = _rsys->create_pixel_shader(g_rose_psf_klm_cr, sizeof(g_rose_psf_klm_cr));
     assert(_psf_klm_cr);
     /* create shader coef cr */
-    _vss_coef_cr = _rsys->create_vertex_shader(g_rose_vss_coef_cr, sizeof(g_rose_vss_coef_cr));
+    _vss_coef_cr = _rsys->create_vertex_shader(vss_coef_cr.ptr, vss_coef_cr.len);
     assert(_vss_coef_cr);
-    _vf_coef_cr = _rsys->create_vertex_format(g_rose_vss_coef_cr, sizeof(g_rose_vss_coef_cr), descs_coef_cr, _countof(descs_coef_cr));
+    _vf_coef_cr = _rsys->create_vertex_format(vss_coef_cr.ptr, vss_coef_cr.len, descs_coef_cr, _countof(descs_coef_cr));
     assert(_vf_coef_cr);
-    _pss_coef_cr = _rsys->create_pixel_shader(g_rose_pss_coef_cr, sizeof(g_rose_pss_coef_cr));
+    _pss_coef_cr = _rsys->create_pixel_shader(pss_coef_cr.ptr, pss_coef_cr.len);
     assert(_pss_coef_cr);
     /* create shader klm tex */
     _vsf_klm_tex = _rsys->create_vertex_shader(g_rose_vsf_klm_tex, sizeof(g_rose_vsf_klm_tex));
@@ -247,12 +290,24 @@ void rose::setup(rendersys* rsys)
     _psf_klm_tex = _rsys->create_pixel_shader(g_rose_psf_klm_tex, sizeof(g_rose_psf_klm_tex));
     assert(_psf_klm_tex);
     /* create shader coef tex */
-    _vss_coef_tex = _rsys->create_vertex_shader(g_rose_vss_coef_tex, sizeof(g_rose_vss_coef_tex));
+    _vss_coef_tex = _rsys->create_vertex_shader(vss_coef_tex.ptr, vss_coef_tex.len);
     assert(_vss_coef_tex);
-    _vf_coef_tex = _rsys->create_vertex_format(g_rose_vss_coef_tex, sizeof(g_rose_vss_coef_tex), descs_coef_tex, _countof(descs_coef_tex));
+    _vf_coef_tex = _rsys->create_vertex_format(vss_coef_tex.ptr, vss_coef_tex.len, descs_coef_tex, _countof(descs_coef_tex));
     assert(_vf_coef_tex);
-    _pss_coef_tex = _rsys->create_pixel_shader(g_rose_pss_coef_tex, sizeof(g_rose_pss_coef_tex));
+    _pss_coef_tex = _rsys->create_pixel_shader(pss_coef_tex.ptr, pss_coef_tex.len);
     assert(_pss_coef_tex);
+    /* create shader klm inst, the symbols were always in the full layout */
+    _vsf_klm_inst = _rsys->create_vertex_shader(g_rose_vsf_klm_inst, sizeof(g_rose_vsf_klm_inst));
+    assert(_vsf_klm_inst);
+    _vf_klm_inst = _rsys->create_vertex_format(g_rose_vsf_klm_inst, sizeof(g_rose_vsf_klm_inst), descf_klm_inst, _countof(descf_klm_inst));
+    assert(_vf_klm_inst);
+    /* create shader glyph, the glyphs were always in the layout of their own */
+    _vsf_glyph = _rsys->create_vertex_shader(g_rose_vsf_glyph, sizeof(g_rose_vsf_glyph));
+    assert(_vsf_glyph);
+    _vf_glyph = _rsys->create_vertex_format(g_rose_vsf_glyph, sizeof(g_rose_vsf_glyph), descf_glyph, _countof(descf_glyph));
+    assert(_vf_glyph);
+    _psf_glyph = _rsys->create_pixel_shader(g_rose_psf_glyph, sizeof(g_rose_psf_glyph));
+    assert(_psf_glyph);
     /* create sampler state */
     _sampler_state = _rsys->create_sampler_state(ssf_linear);
     assert(_sampler_state);
@@ -260,6 +315,16 @@ void rose::setup(rendersys* rsys)
     assert(!_cb_configs);
     _cb_configs = _rsys->create_constant_buffer(pack_cb_size<rose_configs>(), false, true);
     assert(_cb_configs);
+    /* create cb_palette */
+    if(palette) {
+        assert(!_cb_palette);
+        _cb_palette = _rsys->create_constant_buffer(pack_cb_size<rose_palette_colors>(), false, true);
+        assert(_cb_palette);
+    }
+    /* create the rings of the vertices & the indices, they grow on demand */
+    verify(_ring.create(_rsys, rrt_vertex_buffer, 1 << 20, D3D11_USAGE_DYNAMIC));
+    verify(_index_ring.create(_rsys, rrt_index_buffer, 1 << 18, D3D11_USAGE_DYNAMIC));
+    setup_glyphs();
     setup_configs();
 }
 
@@ -280,14 +345,25 @@ void rose::initialize()
     _pss_coef_tex = nullptr;
     _vf_coef_cr = nullptr;
     _vf_coef_tex = nullptr;
+    _vsf_klm_inst = nullptr;
+    _vf_klm_inst = nullptr;
+    _vsf_glyph = nullptr;
+    _psf_glyph = nullptr;
+    _vf_glyph = nullptr;
+    _glyph_indices = nullptr;
     _cb_configs = nullptr;
     _sampler_state = nullptr;
     _cb_config_slot = 0;
+    _cb_palette = nullptr;
+    _cb_palette_slot = 1;
+    _vertex_context.ring = &_ring;
+    _vertex_context.palette = &_palette;
 }
 
 void rose::destroy_miscs()
 {
     release_constant_buffer(_cb_configs);
+    release_constant_buffer(_cb_palette);
     release_any(_sampler_state);
     release_any(_vf_cr);
     release_any(_vf_klm_cr);
@@ -304,7 +380,18 @@ void rose::destroy_miscs()
     release_any(_pss_coef_cr);
     release_any(_vss_coef_tex);
     release_any(_pss_coef_tex);
+    release_any(_vsf_klm_inst);
+    release_any(_vf_klm_inst);
+    release_any(_vsf_glyph);
+    release_any(_psf_glyph);
+    release_any(_vf_glyph);
+    release_index_buffer(_glyph_indices);
+    _glyph_indices = nullptr;
     _cb_configs = 0;
+    _cb_palette = 0;
+    _ring.destroy();
+    _index_ring.destroy();
+    _atlas.destroy();
 }
 
 render_sampler_state* rose::acquire_default_sampler_state()
@@ -0,0 +1,654 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ariel/rose.h>
+#include <ariel/rendersyssw.h>
+
+__ariel_begin__
+
+/* the programs in rose.hlsl, written for the software render system. */
+static vec2 rose_mapping_point(const vec2& p, const sw_shading_context& ctx)
+{
+    /* the matrix was packed in column major, so the rows on cpu side were the columns in hlsl. */
+    const auto& m = ctx.get_constants<rose_configs>(0).mapscreen;
+    return vec2(m[0][0] * p.x + m[0][1] * p.y + m[0][2], m[1][0] * p.x + m[1][1] * p.y + m[1][2]);
+}
+
+static void rose_output_position(sw_vs_output& output, const vec2& p, const sw_shading_context& ctx)
+{
+    vec2 cv = rose_mapping_point(p, ctx);
+    output.position = vec4(cv.x, cv.y, 0.5f, 1.f);
+}
+
+template<int _size>
+static void rose_output_varyings(sw_vs_output& output, int at, const float* v)
+{
+    assert(at + _size <= sw_max_varyings);
+    memcpy(output.varyings + at, v, sizeof(float) * _size);
+}
+
+static float rose_get_distance(float x, float y, const float* coef)
+{
+    return -(coef[0] * x + coef[1] * y + coef[2]) / sqrtf(coef[0] * coef[0] + coef[1] * coef[1]);
+}
+
+/* ddx & ddy were taken as the differences to the neighbour pixels, the same as the hardware does over a quad. */
+static float rose_get_alpha(const sw_ps_input& input, int at)
+{
+    const float* coef = input.varyings + at;
+    float cx[4], cy[4];
+    for(int i = 0; i < 4; i ++) {
+        cx[i] = coef[i] + input.ddx[at + i];
+        cy[i] = coef[i] + input.ddy[at + i];
+    }
+    float x = input.position.x, y = input.position.y;
+    float dist = rose_get_distance(x, y, coef);
+    float dx = rose_get_distance(x + 1.f, y, cx) - dist;
+    float dy = rose_get_distance(x, y + 1.f, cy) - dist;
+    float threshold = coef[3] * sqrtf(dx * dx + dy * dy);
+    if(threshold == 0.f)
+        return 0.f;
+    return gs_clamp(1.f - fabsf(dist / threshold), 0.f, 1.f);
+}
+
+/* the distance was linear over the primitive, interpolated rather than evaluated by the coefficients per pixel. */
+static float rose_get_dist_alpha(const sw_ps_input& input, int at)
+{
+    float dist = input.varyings[at], tune = input.varyings[at + 1];
+    float dx = input.ddx[at], dy = input.ddy[at];
+    float threshold = tune * sqrtf(dx * dx + dy * dy);
+    if(threshold == 0.f)
+        return 0.f;
+    return gs_clamp(1.f - fabsf(dist / threshold), 0.f, 1.f);
+}
+
+static void rose_output_color(sw_vs_output& output, int at, uint cr)
+{
+    vec4 c = rose_unpack_color(cr);
+    rose_output_varyings<4>(output, at, &c.x);
+}
+
+static void rose_output_palette_color(sw_vs_output& output, int at, uint index, const sw_shading_context& ctx)
+{
+    assert(index < rose_palette_capacity);
+    rose_output_varyings<4>(output, at, &ctx.get_constants<rose_palette_colors>(1).colors[index].x);
+}
+
+template<int _size>
+static void rose_output_halfs(sw_vs_output& output, int at, const uint16* h)
+{
+    float v[_size];
+    for(int i = 0; i < _size; i ++)
+        v[i] = rose_half_to_float(h[i]);
+    rose_output_varyings<_size>(output, at, v);
+}
+
+static bool rose_is_klm_discarded(const float* klm)
+{
+    return klm[0] * klm[0] * klm[0] - klm[1] * klm[2] < 0.f;
+}
+
+static void rose_vsf_cr(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_cr*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_varyings<4>(output, 0, &v.cr.x);
+}
+
+static bool rose_psf_cr(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    output = vec4(input.varyings);
+    return true;
+}
+
+static void rose_vsf_klm_cr(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_klm_cr*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_varyings<3>(output, 0, &v.klm.x);
+    rose_output_varyings<4>(output, 3, &v.cr.x);
+}
+
+static bool rose_psf_klm_cr(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    if(rose_is_klm_discarded(input.varyings))
+        return false;
+    output = vec4(input.varyings + 3);
+    return true;
+}
+
+static void rose_vss_coef_cr(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_coef_cr*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_varyings<4>(output, 0, &v.coef.x);
+    rose_output_varyings<4>(output, 4, &v.cr.x);
+}
+
+static bool rose_pss_coef_cr(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    float alpha = rose_get_alpha(input, 0);
+    const float* cr = input.varyings + 4;
+    output = vec4(cr[0], cr[1], cr[2], cr[3] * alpha);
+    return true;
+}
+
+static void rose_vsf_klm_tex(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_klm_tex*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_varyings<3>(output, 0, &v.klm.x);
+    rose_output_varyings<2>(output, 3, &v.tex.x);
+}
+
+static bool rose_psf_klm_tex(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    if(rose_is_klm_discarded(input.varyings))
+        return false;
+    output = ctx.sample(0, 0, vec2(input.varyings + 3));
+    return true;
+}
+
+static void rose_vss_coef_tex(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_coef_tex*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_varyings<4>(output, 0, &v.coef.x);
+    rose_output_varyings<2>(output, 4, &v.tex.x);
+}
+
+static bool rose_pss_coef_tex(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    float alpha = rose_get_alpha(input, 0);
+    vec4 cr = ctx.sample(0, 0, vec2(input.varyings + 4));
+    output = vec4(cr.x, cr.y, cr.z, cr.w * alpha);
+    return true;
+}
+
+/* the compact layouts, colors in rgba8 or palette indices, klm & distances in half floats. */
+static void rose_vsf_cr_c(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_cr_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_color(output, 0, v.cr);
+}
+
+static void rose_vsf_cr_pal(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_cr_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_palette_color(output, 0, v.cr, ctx);
+}
+
+static void rose_vsf_klm_cr_c(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_klm_cr_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_halfs<3>(output, 0, v.klm);
+    rose_output_color(output, 3, v.cr);
+}
+
+static void rose_vsf_klm_cr_pal(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_klm_cr_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_halfs<3>(output, 0, v.klm);
+    rose_output_palette_color(output, 3, v.cr, ctx);
+}
+
+static void rose_vss_dist_cr(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_dist_cr_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_halfs<2>(output, 0, v.dist);
+    rose_output_color(output, 2, v.cr);
+}
+
+static void rose_vss_dist_cr_pal(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_dist_cr_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_halfs<2>(output, 0, v.dist);
+    rose_output_palette_color(output, 2, v.cr, ctx);
+}
+
+static bool rose_pss_dist_cr(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    float alpha = rose_get_dist_alpha(input, 0);
+    const float* cr = input.varyings + 2;
+    output = vec4(cr[0], cr[1], cr[2], cr[3] * alpha);
+    return true;
+}
+
+static void rose_vsf_klm_tex_c(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_klm_tex_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_halfs<3>(output, 0, v.klm);
+    rose_output_varyings<2>(output, 3, &v.tex.x);
+}
+
+static void rose_vsf_klm_inst(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    assert(ctx.instance);
+    auto& v = *reinterpret_cast<const vertex_info_klm*>(input);
+    auto& inst = *reinterpret_cast<const rose_instance_info*>(ctx.instance);
+    vec2 p(v.pos.x * inst.ex.x + v.pos.y * inst.ey.x + inst.origin.x, v.pos.x * inst.ex.y + v.pos.y * inst.ey.y + inst.origin.y);
+    rose_output_position(output, p, ctx);
+    rose_output_varyings<3>(output, 0, &v.klm.x);
+    rose_output_varyings<4>(output, 3, &inst.cr.x);
+}
+
+static void rose_vss_dist_tex(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_dist_tex_c*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_halfs<2>(output, 0, v.dist);
+    rose_output_varyings<2>(output, 2, &v.tex.x);
+}
+
+static bool rose_pss_dist_tex(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    float alpha = rose_get_dist_alpha(input, 0);
+    vec4 cr = ctx.sample(0, 0, vec2(input.varyings + 2));
+    output = vec4(cr.x, cr.y, cr.z, cr.w * alpha);
+    return true;
+}
+
+static void rose_vsf_glyph(sw_vs_output& output, const byte* input, const sw_shading_context& ctx)
+{
+    auto& v = *reinterpret_cast<const vertex_info_glyph*>(input);
+    rose_output_position(output, v.pos, ctx);
+    rose_output_varyings<2>(output, 0, &v.tex.x);
+    rose_output_color(output, 2, v.cr);
+}
+
+static bool rose_psf_glyph(vec4& output, const sw_ps_input& input, const sw_shading_context& ctx)
+{
+    float coverage = ctx.sample(0, 0, vec2(input.varyings)).w;
+    const float* cr = input.varyings + 2;
+    output = vec4(cr[0], cr[1], cr[2], cr[3] * coverage);
+    return true;
+}
+
+static const sw_vertex_program g_rose_vsf_cr = { "rose_vsf_cr", rose_vsf_cr, 4 };
+static const sw_pixel_program g_rose_psf_cr = { "rose_psf_cr", rose_psf_cr };
+static const sw_vertex_program g_rose_vsf_klm_cr = { "rose_vsf_klm_cr", rose_vsf_klm_cr, 7 };
+static const sw_pixel_program g_rose_psf_klm_cr = { "rose_psf_klm_cr", rose_psf_klm_cr };
+static const sw_vertex_program g_rose_vss_coef_cr = { "rose_vss_coef_cr", rose_vss_coef_cr, 8 };
+static const sw_pixel_program g_rose_pss_coef_cr = { "rose_pss_coef_cr", rose_pss_coef_cr };
+static const sw_vertex_program g_rose_vsf_klm_tex = { "rose_vsf_klm_tex", rose_vsf_klm_tex, 5 };
+static const sw_pixel_program g_rose_psf_klm_tex = { "rose_psf_klm_tex", rose_psf_klm_tex };
+static const sw_vertex_program g_rose_vss_coef_tex = { "rose_vss_coef_tex", rose_vss_coef_tex, 6 };
+static const sw_pixel_program g_rose_pss_coef_tex = { "rose_pss_coef_tex", rose_pss_coef_tex };
+static const sw_vertex_program g_rose_vsf_cr_c = { "rose_vsf_cr_c", rose_vsf_cr_c, 4 };
+static const sw_vertex_program g_rose_vsf_cr_pal = { "rose_vsf_cr_pal", rose_vsf_cr_pal, 4 };
+static const sw_vertex_program g_rose_vsf_klm_cr_c = { "rose_vsf_klm_cr_c", rose_vsf_klm_cr_c, 7 };
+static const sw_vertex_program g_rose_vsf_klm_cr_pal = { "rose_vsf_klm_cr_pal", rose_vsf_klm_cr_pal, 7 };
+static const sw_vertex_program g_rose_vss_dist_cr = { "rose_vss_dist_cr", rose_vss_dist_cr, 6 };
+static const sw_vertex_program g_rose_vss_dist_cr_pal = { "rose_vss_dist_cr_pal", rose_vss_dist_cr_pal, 6 };
+static const sw_pixel_program g_rose_pss_dist_cr = { "rose_pss_dist_cr", rose_pss_dist_cr };
+static const sw_vertex_program g_rose_vsf_klm_tex_c = { "rose_vsf_klm_tex_c", rose_vsf_klm_tex_c, 5 };
+static const sw_vertex_program g_rose_vss_dist_tex = { "rose_vss_dist_tex", rose_vss_dist_tex, 4 };
+static const sw_pixel_program g_rose_pss_dist_tex = { "rose_pss_dist_tex", rose_pss_dist_tex };
+static const sw_vertex_program g_rose_vsf_klm_inst = { "rose_vsf_klm_inst", rose_vsf_klm_inst, 7 };
+static const sw_vertex_program g_rose_vsf_glyph = { "rose_vsf_glyph", rose_vsf_glyph, 6 };
+static const sw_pixel_program g_rose_psf_glyph = { "rose_psf_glyph", rose_psf_glyph };
+
+static const uint rose_static_usage = 0;    /* the buffers of the symbols */
+
+template<class c>
+static void release_any(c& cptr)
+{
+    if(cptr) {
+        cptr->Release();
+        cptr = nullptr;
+    }
+}
+
+void rose_fill_batch_cr::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
+}
+
+void rose_fill_batch_klm_cr::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
+}
+
+void rose_symbol_batch::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_instance_buffer(_instance_buffer, sizeof(rose_instance_info));
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed_instanced(_draw_count, (uint)_instances.size(), _index_start, _vertex_start, _instance_start);
+}
+
+void rose_glyph_batch::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    sub.set_sampler_state(0, _sstate, st_pixel_shader);
+    sub.set_shader_resource(0, _srv, st_pixel_shader);
+    draw_quads(sub);
+}
+
+int rose_fill_batch_klm_tex::buffering(rendersys* rsys)
+{
+    assert(!_tex && !_srv);
+    _tex = _texbatch.create_texture(rsys);
+    assert(_tex);
+    _srv = rsys->create_shader_resource_view(convert_to_resource(_tex));
+    assert(_srv);
+    return get_vertex_count();
+}
+
+void rose_fill_batch_klm_tex::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    sub.set_sampler_state(0, _sstate, st_pixel_shader);
+    sub.set_shader_resource(0, _srv, st_pixel_shader);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
+}
+
+void rose_fill_batch_klm_tex::destroy()
+{
+    release_any(_sstate);
+    release_any(_tex);
+    release_any(_srv);
+}
+
+void rose_stroke_batch_coef_cr::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
+}
+
+int rose_stroke_batch_coef_tex::buffering(rendersys* rsys)
+{
+    assert(!_tex && !_srv);
+    _tex = _texbatch.create_texture(rsys);
+    assert(_tex);
+    _srv = rsys->create_shader_resource_view(convert_to_resource(_tex));
+    assert(_srv);
+    return get_vertex_count();
+}
+
+void rose_stroke_batch_coef_tex::draw(rose_submitter& sub)
+{
+    setup_vs_and_ps(sub);
+    setup_vf_and_topology(sub, sw_topology_triangle_list);
+    sub.set_vertex_buffer(_vertex_buffer, _vertex_stride);
+    sub.set_index_buffer(_index_buffer, _index_format);
+    sub.set_sampler_state(0, _sstate, st_pixel_shader);
+    sub.set_shader_resource(0, _srv, st_pixel_shader);
+    assert(_draw_count % 3 == 0);
+    sub.draw_indexed(_draw_count, _index_start, _vertex_start);
+}
+
+void rose_stroke_batch_coef_tex::destroy()
+{
+    release_any(_sstate);
+    release_any(_tex);
+    release_any(_srv);
+}
+
+int rose_stroke_batch_assoc_with_klm_tex::buffering(rendersys* rsys)
+{
+    assert(!_tex && !_srv);
+    assert(_assoc);
+    _tex = _assoc->_tex;
+    _srv = _assoc->_srv;
+    assert(_tex && _srv);
+    return get_vertex_count();
+}
+
+void rose::setup(rendersys* rsys, rose_vertex_layout layout)
+{
+    assert(rsys);
+    _rsys = rsys;
+    _atlas.setup(rsys);
+    _vertex_context.layout = layout;
+    bool compact = (layout != rvl_full), palette = (layout == rvl_palette);
+    const char* crsem = palette ? "BLENDINDICES" : "COLOR";
+    uint crfmt = palette ? sw_format_r32_uint : compact ? sw_format_r8g8b8a8_unorm : sw_format_r32g32b32a32_float;
+    uint klmfmt = compact ? sw_format_r16g16b16a16_float : sw_format_r32g32b32_float;
+    uint coeffmt = compact ? sw_format_r16g16_float : sw_format_r32g32b32a32_float;
+    rendersys::vertex_format_desc descf_cr[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { crsem, 0, crfmt, 0, sw_append_aligned_element, 0, 0 }
+    };
+    rendersys::vertex_format_desc descf_klm_cr[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { "TEXCOORD", 0, klmfmt, 0, sw_append_aligned_element, 0, 0 },
+        { crsem, 0, crfmt, 0, sw_append_aligned_element, 0, 0 }
+    };
+    rendersys::vertex_format_desc descs_coef_cr[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { "TEXCOORD", 0, coeffmt, 0, sw_append_aligned_element, 0, 0 },
+        { crsem, 0, crfmt, 0, sw_append_aligned_element, 0, 0 },
+    };
+    rendersys::vertex_format_desc descf_klm_tex[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { "TEXCOORD", 0, klmfmt, 0, sw_append_aligned_element, 0, 0 },
+        { "TEXCOORD", 1, sw_format_r32g32_float, 0, sw_append_aligned_element, 0, 0 }
+    };
+    rendersys::vertex_format_desc descs_coef_tex[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { "TEXCOORD", 0, coeffmt, 0, sw_append_aligned_element, 0, 0 },
+        { "TEXCOORD", 1, sw_format_r32g32_float, 0, sw_append_aligned_element, 0, 0 },
+    };
+    rendersys::vertex_format_desc descf_klm_inst[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { "TEXCOORD", 0, sw_format_r32g32b32_float, 0, sw_append_aligned_element, 0, 0 },
+        { "TEXCOORD", 1, sw_format_r32g32_float, 1, 0, 1, 1 },
+        { "TEXCOORD", 2, sw_format_r32g32_float, 1, sw_append_aligned_element, 1, 1 },
+        { "TEXCOORD", 3, sw_format_r32g32_float, 1, sw_append_aligned_element, 1, 1 },
+        { "COLOR", 0, sw_format_r32g32b32a32_float, 1, sw_append_aligned_element, 1, 1 },
+    };
+    rendersys::vertex_format_desc descf_glyph[] =
+    {
+        { "POSITION", 0, sw_format_r32g32_float, 0, 0, 0, 0 },
+        { "TEXCOORD", 0, sw_format_r32g32_float, 0, sw_append_aligned_element, 0, 0 },
+        { "COLOR", 0, sw_format_r8g8b8a8_unorm, 0, sw_append_aligned_element, 0, 0 },
+    };
+    /* the programs were picked by the layout, as the vertices were read by the programs directly. */
+    const sw_vertex_program* vsf_cr = palette ? &g_rose_vsf_cr_pal : compact ? &g_rose_vsf_cr_c : &g_rose_vsf_cr;
+    const sw_vertex_program* vsf_klm_cr = palette ? &g_rose_vsf_klm_cr_pal : compact ? &g_rose_vsf_klm_cr_c : &g_rose_vsf_klm_cr;
+    const sw_vertex_program* vss_coef_cr = palette ? &g_rose_vss_dist_cr_pal : compact ? &g_rose_vss_dist_cr : &g_rose_vss_coef_cr;
+    const sw_pixel_program* pss_coef_cr = compact ? &g_rose_pss_dist_cr : &g_rose_pss_coef_cr;
+    const sw_vertex_program* vsf_klm_tex = compact ? &g_rose_vsf_klm_tex_c : &g_rose_vsf_klm_tex;
+    const sw_vertex_program* vss_coef_tex = compact ? &g_rose_vss_dist_tex : &g_rose_vss_coef_tex;
+    const sw_pixel_program* pss_coef_tex = compact ? &g_rose_pss_dist_tex : &g_rose_pss_coef_tex;
+    /* create shader cr */
+    _vsf_cr = _rsys->create_vertex_shader(vsf_cr, sizeof(*vsf_cr));
+    assert(_vsf_cr);
+    _vf_cr = _rsys->create_vertex_format(vsf_cr, sizeof(*vsf_cr), descf_cr, _countof(descf_cr));
+    assert(_vf_cr);
+    _psf_cr = _rsys->create_pixel_shader(&g_rose_psf_cr, sizeof(g_rose_psf_cr));
+    assert(_psf_cr);
+    /* create shader klm cr */
+    _vsf_klm_cr = _rsys->create_vertex_shader(vsf_klm_cr, sizeof(*vsf_klm_cr));
+    assert(_vsf_klm_cr);
+    _vf_klm_cr = _rsys->create_vertex_format(vsf_klm_cr, sizeof(*vsf_klm_cr), descf_klm_cr, _countof(descf_klm_cr));
+    assert(_vf_klm_cr);
+    _psf_klm_cr = _rsys->create_pixel_shader(&g_rose_psf_klm_cr, sizeof(g_rose_psf_klm_cr));
+    assert(_psf_klm_cr);
+    /* create shader coef cr */
+    _vss_coef_cr = _rsys->create_vertex_shader(vss_coef_cr, sizeof(*vss_coef_cr));
+    assert(_vss_coef_cr);
+    _vf_coef_cr = _rsys->create_vertex_format(vss_coef_cr, sizeof(*vss_coef_cr), descs_coef_cr, _countof(descs_coef_cr));
+    assert(_vf_coef_cr);
+    _pss_coef_cr = _rsys->create_pixel_shader(pss_coef_cr, sizeof(*pss_coef_cr));
+    assert(_pss_coef_cr);
+    /* create shader klm tex */
+    _vsf_klm_tex = _rsys->create_vertex_shader(vsf_klm_tex, sizeof(*vsf_klm_tex));
+    assert(_vsf_klm_tex);
+    _vf_klm_tex = _rsys->create_vertex_format(vsf_klm_tex, sizeof(*vsf_klm_tex), descf_klm_tex, _countof(descf_klm_tex));
+    assert(_vf_klm_tex);
+    _psf_klm_tex = _rsys->create_pixel_shader(&g_rose_psf_klm_tex, sizeof(g_rose_psf_klm_tex));
+    assert(_psf_klm_tex);
+    /* create shader coef tex */
+    _vss_coef_tex = _rsys->create_vertex_shader(vss_coef_tex, sizeof(*vss_coef_tex));
+    assert(_vss_coef_tex);
+    _vf_coef_tex = _rsys->create_vertex_format(vss_coef_tex, sizeof(*vss_coef_tex), descs_coef_tex, _countof(descs_coef_tex));
+    assert(_vf_coef_tex);
+    _pss_coef_tex = _rsys->create_pixel_shader(pss_coef_tex, sizeof(*pss_coef_tex));
+    assert(_pss_coef_tex);
+    /* create shader klm inst, the symbols were always in the full layout */
+    _vsf_klm_inst = _rsys->create_vertex_shader(&g_rose_vsf_klm_inst, sizeof(g_rose_vsf_klm_inst));
+    assert(_vsf_klm_inst);
+    _vf_klm_inst = _rsys->create_vertex_format(&g_rose_vsf_klm_inst, sizeof(g_rose_vsf_klm_inst), descf_klm_inst, _countof(descf_klm_inst));
+    assert(_vf_klm_inst);
+    /* create shader glyph, the glyphs were always in the layout of their own */
+    _vsf_glyph = _rsys->create_vertex_shader(&g_rose_vsf_glyph, sizeof(g_rose_vsf_glyph));
+    assert(_vsf_glyph);
+    _vf_glyph = _rsys->create_vertex_format(&g_rose_vsf_glyph, sizeof(g_rose_vsf_glyph), descf_glyph, _countof(descf_glyph));
+    assert(_vf_glyph);
+    _psf_glyph = _rsys->create_pixel_shader(&g_rose_psf_glyph, sizeof(g_rose_psf_glyph));
+    assert(_psf_glyph);
+    /* create sampler state */
+    _sampler_state = _rsys->create_sampler_state(ssf_linear);
+    assert(_sampler_state);
+    /* create cb_configs */
+    assert(!_cb_configs);
+    _cb_configs = _rsys->create_constant_buffer(pack_cb_size<rose_configs>(), false, true);
+    assert(_cb_configs);
+    /* create cb_palette */
+    if(palette) {
+        assert(!_cb_palette);
+        _cb_palette = _rsys->create_constant_buffer(pack_cb_size<rose_palette_colors>(), false, true);
+        assert(_cb_palette);
+    }
+    /* create the rings of the vertices & the indices, they grow on demand */
+    verify(_ring.create(_rsys, rrt_vertex_buffer, 1 << 20, 0));
+    verify(_index_ring.create(_rsys, rrt_index_buffer, 1 << 18, 0));
+    setup_glyphs();
+    setup_configs();
+}
+
+void rose::initialize()
+{
+    _vsf_cr = nullptr;
+    _vsf_klm_cr = nullptr;
+    _vsf_klm_tex = nullptr;
+    _psf_cr = nullptr;
+    _psf_klm_cr = nullptr;
+    _psf_klm_tex = nullptr;
+    _vf_cr = nullptr;
+    _vf_klm_cr = nullptr;
+    _vf_klm_tex = nullptr;
+    _vss_coef_cr = nullptr;
+    _vss_coef_tex = nullptr;
+    _pss_coef_cr = nullptr;
+    _pss_coef_tex = nullptr;
+    _vf_coef_cr = nullptr;
+    _vf_coef_tex = nullptr;
+    _vsf_klm_inst = nullptr;
+    _vf_klm_inst = nullptr;
+    _vsf_glyph = nullptr;
+    _psf_glyph = nullptr;
+    _vf_glyph = nullptr;
+    _glyph_indices = nullptr;
+    _cb_configs = nullptr;
+    _sampler_state = nullptr;
+    _cb_config_slot = 0;
+    _cb_palette = nullptr;
+    _cb_palette_slot = 1;
+    _vertex_context.ring = &_ring;
+    _vertex_context.palette = &_palette;
+}
+
+void rose::destroy_miscs()
+{
+    release_constant_buffer(_cb_configs);
+    release_constant_buffer(_cb_palette);
+    release_any(_sampler_state);
+    release_any(_vf_cr);
+    release_any(_vf_klm_cr);
+    release_any(_vf_klm_tex);
+    release_any(_vsf_cr);
+    release_any(_vsf_klm_cr);
+    release_any(_vsf_klm_tex);
+    release_any(_psf_cr);
+    release_any(_psf_klm_cr);
+    release_any(_psf_klm_tex);
+    release_any(_vf_coef_cr);
+    release_any(_vf_coef_tex);
+    release_any(_vss_coef_cr);
+    release_any(_pss_coef_cr);
+    release_any(_vss_coef_tex);
+    release_any(_pss_coef_tex);
+    release_any(_vsf_klm_inst);
+    release_any(_vf_klm_inst);
+    release_any(_vsf_glyph);
+    release_any(_psf_glyph);
+    release_any(_vf_glyph);
+    release_index_buffer(_glyph_indices);
+    _glyph_indices = nullptr;
+    _cb_configs = 0;
+    _cb_palette = 0;
+    _ring.destroy();
+    _index_ring.destroy();
+    _atlas.destroy();
+}
+
+render_sampler_state* rose::acquire_default_sampler_state()
+{
+    assert(_sampler_state);
+    _sampler_state->AddRef();
+    return _sampler_state;
+}
+
+__ariel_end__
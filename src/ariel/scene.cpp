@@ -25,6 +25,7 @@
 
 #include <ariel/scene.h>
 #include <ariel/rose.h>
+#include <ariel/profiler.h>
 #include <ariel/fsyswin32.h>
 #include <ariel/fsysdwrite.h>
 
@@ -147,6 +148,17 @@ bool stage::on_next_event(const frame_event& event)
     return false;
 }
 
+bool stage::on_next_message(const frame_message& msg)
+{
+    return _next_notification_stage ? _next_notification_stage->on_frame_message(msg) : false;
+}
+
+void stage::on_next_messages(const frame_message msgs[], int count)
+{
+    if(_next_notification_stage)
+        _next_notification_stage->on_frame_messages(msgs, count);
+}
+
 bool ui_stage::setup()
 {
     framesys* sys = framesys::get_framesys();
@@ -177,85 +189,61 @@ void ui_stage::setup_draw()
 bool ui_stage::on_frame_event(const frame_event& event)
 {
     assert(event.get_id() != feid_invalid);
-    switch(event.get_id())
+    frame_message msg;
+    if(!msg.from_event(event))
+        return on_next_event(event);
+    return ui_stage::on_frame_message(msg);
+}
+
+bool ui_stage::on_frame_message(const frame_message& msg)
+{
+    assert(msg.id != feid_invalid);
+    switch(msg.id)
     {
     case feid_timer:
-        {
-            auto p = static_cast<const frame_timer_event*>(&event);
-            _wsys_manager.on_timer(p->timerid);
-            return true;
-        }
+        _wsys_manager.on_timer(msg.timer.timerid);
+        return true;
     case feid_paint:
-        {
-            auto p = static_cast<const frame_resize_event*>(&event);
-            _wsys_manager.on_paint(p->boundary);
-            return true;
-        }
+        _wsys_manager.on_paint(msg.get_boundary());
+        return true;
     case feid_mouse_down:
-        {
-            auto p = static_cast<const frame_mouse_down_event*>(&event);
-            return _wsys_manager.on_mouse_down(p->modifier, p->key, p->position);
-        }
+        return _wsys_manager.on_mouse_down(msg.mouse.modifier, msg.mouse.key, msg.get_position());
     case feid_mouse_up:
-        {
-            auto p = static_cast<const frame_mouse_up_event*>(&event);
-            return _wsys_manager.on_mouse_up(p->modifier, p->key, p->position);
-        }
+        return _wsys_manager.on_mouse_up(msg.mouse.modifier, msg.mouse.key, msg.get_position());
     case feid_mouse_move:
-        {
-            auto p = static_cast<const frame_mouse_move_event*>(&event);
-            return _wsys_manager.on_mouse_move(p->modifier, p->position);
-        }
+        return _wsys_manager.on_mouse_move(msg.mouse.modifier, msg.get_position());
     case feid_key_down:
-        {
-            auto p = static_cast<const frame_key_down_event*>(&event);
-            return _wsys_manager.on_key_down(p->modifier, p->key);
-        }
+        return _wsys_manager.on_key_down(msg.keyboard.modifier, msg.keyboard.key);
     case feid_key_up:
-        {
-            auto p = static_cast<const frame_key_up_event*>(&event);
-            return _wsys_manager.on_key_up(p->modifier, p->key);
-        }
+        return _wsys_manager.on_key_up(msg.keyboard.modifier, msg.keyboard.key);
     case feid_char:
-        {
-            auto p = static_cast<const frame_char_event*>(&event);
-            return _wsys_manager.on_char(p->modifier, p->charactor);
-        }
+        return _wsys_manager.on_char(msg.input.modifier, msg.input.charactor);
     case feid_show:
-        {
-            auto p = static_cast<const frame_show_event*>(&event);
-            _wsys_manager.on_show(p->show);
-            return true;
-        }
+        _wsys_manager.on_show(msg.visibility.show);
+        return true;
     case feid_create:
-        {
-            auto p = static_cast<const frame_create_event*>(&event);
-            _wsys_manager.on_create(p->driver, p->boundary);
-            return true;
-        }
+        _wsys_manager.on_create(msg.create.driver, msg.get_boundary());
+        return true;
     case feid_close:
-        {
-            _wsys_manager.on_close();
-            return true;
-        }
+        _wsys_manager.on_close();
+        return true;
     case feid_resize:
-        {
-            auto p = static_cast<const frame_resize_event*>(&event);
-            _wsys_manager.on_resize(p->boundary);
-            return true;
-        }
+        _wsys_manager.on_resize(msg.get_boundary());
+        return true;
     case feid_halt:
-        {
-            _wsys_manager.on_halt();
-            return true;
-        }
+        _wsys_manager.on_halt();
+        return true;
     case feid_resume:
-        {
-            _wsys_manager.on_resume();
-            return true;
-        }
+        _wsys_manager.on_resume();
+        return true;
     }
-    return on_next_event(event);
+    return on_next_message(msg);
+}
+
+void ui_stage::on_frame_messages(const frame_message msgs[], int count)
+{
+    for(int i = 0; i < count; i ++)
+        ui_stage::on_frame_message(msgs[i]);
 }
 
 scene::scene()
@@ -283,15 +271,18 @@ void scene::setup()
     _uisys = ui->get_wsys_manager();
     _fontsys = new fsys_dwrite;
     _fontsys->initialize();
+    _text_layouts.set_fontsys(_fontsys);
 }
 
 void scene::set_fontsys(fontsys* fsys)
 {
+    _text_layouts.set_fontsys(nullptr);
     if(_fontsys)
         delete _fontsys;
     _fontsys = fsys;
     if(_fontsys)
         _fontsys->initialize();
+    _text_layouts.set_fontsys(_fontsys);
 }
 
 void scene::destroy()
@@ -300,6 +291,7 @@ void scene::destroy()
     _rendersys = nullptr;
     _rose = nullptr;
     _uisys = nullptr;
+    _text_layouts.set_fontsys(nullptr);
     if(_fontsys) {
         delete _fontsys;
         _fontsys = nullptr;
@@ -423,6 +415,7 @@ void scene::set_notification_after(stage* pos, stage* tar)
 
 void scene::draw()
 {
+    ariel_profile_scope("scene::draw");
     assert(_rendersys);
     _rendersys->begin_render();
     _rendersys->setup_pipeline_state();
@@ -443,6 +436,37 @@ void scene::on_frame_end()
         _notify->on_frame_end();
 }
 
+bool scene::on_frame_message(const frame_message& msg)
+{
+    if(msg.id == feid_draw) {
+        draw();
+        return true;
+    }
+    else if(msg.id == feid_paint) {
+        if(!_rendersys || !_rose || !_present)
+            return false;
+        draw();
+        return true;
+    }
+    return _notify ? _notify->on_frame_message(msg) : false;
+}
+
+/* the spans between the draws & the paints went to the stages as a whole. */
+void scene::on_frame_messages(const frame_message msgs[], int count)
+{
+    int start = 0;
+    for(int i = 0; i < count; i ++) {
+        if(msgs[i].id != feid_draw && msgs[i].id != feid_paint)
+            continue;
+        if(_notify && i > start)
+            _notify->on_frame_messages(msgs + start, i - start);
+        scene::on_frame_message(msgs[i]);
+        start = i + 1;
+    }
+    if(_notify && count > start)
+        _notify->on_frame_messages(msgs + start, count - start);
+}
+
 bool scene::on_frame_event(const frame_event& event)
 {
     if(event.get_id() == feid_draw) {
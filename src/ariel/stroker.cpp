@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xmmintrin.h>
+#include <gslib/error.h>
+#include <ariel/stroker.h>
+
+__ariel_begin__
+
+static const float stroke_min_distsq = 1e-8f;
+static const float stroke_straight_cos = 0.9999f;
+
+/*
+ * normals of the segments pts[i] -> pts[i + 1] as (d.y, -d.x) / |d|, same side as painter_linestrip::offset does.
+ * two segments a time, vec2 was packed as two floats so the points could be loaded directly.
+ */
+static void calc_segment_normals(vec2* normals, float* lengths, const vec2* pts, int count)
+{
+    int segs = count - 1;
+    int i = 0;
+    const __m128 signs = _mm_set_ps(-1.f, 1.f, -1.f, 1.f);
+    for(; i + 1 < segs; i += 2) {
+        __m128 a = _mm_loadu_ps(&pts[i].x);
+        __m128 b = _mm_loadu_ps(&pts[i + 1].x);
+        __m128 d = _mm_sub_ps(b, a);
+        __m128 sq = _mm_mul_ps(d, d);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1))));
+        __m128 n = _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)), signs);
+        _mm_storeu_ps(&normals[i].x, _mm_div_ps(n, len));
+        float l[4];
+        _mm_storeu_ps(l, len);
+        lengths[i] = l[0];
+        lengths[i + 1] = l[2];
+    }
+    for(; i < segs; i ++) {
+        vec2 d;
+        d.sub(pts[i + 1], pts[i]);
+        float len = d.length();
+        normals[i] = vec2(d.y / len, -d.x / len);
+        lengths[i] = len;
+    }
+}
+
+static vec2 get_segment_direction(const vec2& n) { return vec2(-n.y, n.x); }
+static float get_cross(const vec2& a, const vec2& b) { return a.x * b.y - a.y * b.x; }
+
+void polyline_stroker::stroke(stroke_strip& strip, const painter_linestrip& ls)
+{
+    float hw = _style.width * 0.5f;
+    if(hw <= 0.f)
+        return;
+    float fringe = gs_max(_style.fringe, 0.f);
+    int c = prepare_points(ls);
+    if(!c)
+        return;
+    if(c == 1) {
+        /* a dot, only the caps could be seen. */
+        if(_style.cap == scs_butt)
+            return;
+        vec2 d(1.f, 0.f), n(0.f, -1.f);
+        _ribs.clear();
+        add_start_cap(_points.front(), d, n, hw, fringe);
+        add_end_cap(_points.front(), d, n, hw, fringe);
+        emit_ribs(strip, hw, fringe);
+        return;
+    }
+    build_ribs(ls.is_closed() && c > 2, hw, fringe, true);
+    emit_ribs(strip, hw, fringe);
+}
+
+void polyline_stroker::stroke(stroke_strip& strip, const painter_linestrips& lss)
+{
+    for(const painter_linestrip& ls : lss)
+        stroke(strip, ls);
+}
+
+void polyline_stroker::offset(painter_linestrip& output, const painter_linestrip& input, float off)
+{
+    output.clear();
+    int c = prepare_points(input);
+    if(c < 2)
+        return;
+    bool closed = input.is_closed() && c > 2;
+    float hw = fabsf(off);
+    if(hw < 1e-6f) {
+        output.reserve(c);
+        for(int i = 0; i < c; i ++)
+            output.add_point(_points.at(i));
+        output.set_closed(closed);
+        return;
+    }
+    build_ribs(closed, hw, 0.f, false);
+    /* for the closed ones, the first rib repeats the end of the last join. */
+    int start = closed ? 1 : 0;
+    output.reserve((int)_ribs.size() - start);
+    for(int i = start; i < (int)_ribs.size(); i ++) {
+        const rib& r = _ribs.at(i);
+        vec2 p = r.pos + (off > 0.f ? r.left : r.right) * hw;
+        if(!output.get_size() || vec2().sub(p, output.get_last_point()).lengthsq() > stroke_min_distsq)
+            output.add_point(p);
+    }
+    output.set_closed(closed);
+}
+
+int polyline_stroker::prepare_points(const painter_linestrip& ls)
+{
+    _points.clear();
+    int size = ls.get_size();
+    for(int i = 0; i < size; i ++) {
+        const vec2& p = ls.get_point(i);
+        if(_points.empty() || vec2().sub(p, _points.back()).lengthsq() > stroke_min_distsq)
+            _points.push_back(p);
+    }
+    if(ls.is_closed()) {
+        while(_points.size() > 1 && vec2().sub(_points.back(), _points.front()).lengthsq() <= stroke_min_distsq)
+            _points.pop_back();
+    }
+    int c = (int)_points.size();
+    /* repeat the first point to close it, so that the closing segment was the last one. */
+    if(ls.is_closed() && c > 2)
+        _points.push_back(_points.front());
+    int segs = (int)_points.size() - 1;
+    if(segs > 0) {
+        _normals.resize(segs);
+        _lengths.resize(segs);
+        calc_segment_normals(&_normals.front(), &_lengths.front(), &_points.front(), (int)_points.size());
+    }
+    return c;
+}
+
+void polyline_stroker::build_ribs(bool closed, float hw, float fringe, bool capped)
+{
+    _ribs.clear();
+    int segs = (int)_normals.size();
+    assert(segs > 0);
+    if(!closed) {
+        const vec2& n0 = _normals.front();
+        if(capped)
+            add_start_cap(_points.front(), get_segment_direction(n0), n0, hw, fringe);
+        else
+            add_rib(_points.front(), n0, -n0);
+        for(int i = 1; i < segs; i ++)
+            add_join(i, i - 1, i, hw, fringe);
+        const vec2& n1 = _normals.back();
+        if(capped)
+            add_end_cap(_points.at(segs), get_segment_direction(n1), n1, hw, fringe);
+        else
+            add_rib(_points.at(segs), n1, -n1);
+        return;
+    }
+    /* start from the end of the join at the first point, and the whole join would be closing the strip. */
+    add_join(0, segs - 1, 0, hw, fringe);
+    if(_ribs.size() > 1)
+        _ribs.erase(_ribs.begin(), _ribs.end() - 1);
+    for(int i = 1; i < segs; i ++)
+        add_join(i, i - 1, i, hw, fringe);
+    add_join(0, segs - 1, 0, hw, fringe);
+}
+
+void polyline_stroker::add_rib(const vec2& p, const vec2& l, const vec2& r, float cov)
+{
+    _ribs.push_back(rib());
+    rib& b = _ribs.back();
+    b.pos = p;
+    b.left = l;
+    b.right = r;
+    b.coverage = cov;
+}
+
+void polyline_stroker::add_join(int i, int prev, int next, float hw, float fringe)
+{
+    const vec2& p = _points.at(i);
+    const vec2& n0 = _normals.at(prev);
+    const vec2& n1 = _normals.at(next);
+    float cosa = gs_clamp(n0.dot(n1), -1.f, 1.f);
+    if(cosa > stroke_straight_cos) {
+        vec2 m;
+        m.add(n0, n1).normalize();
+        add_rib(p, m, -m);
+        return;
+    }
+    /* the side it turns away from was the outer side, +1 for the left. */
+    float side = n0.dot(get_segment_direction(n1)) > 0.f ? -1.f : 1.f;
+    vec2 m;
+    bool has_miter = 1.f + cosa > 1e-4f;
+    if(has_miter) {
+        m.add(n0, n1).scale(1.f / (1.f + cosa));
+        /* the inner corner must not run over the neighbouring segments. */
+        float span = gs_min(_lengths.at(prev), _lengths.at(next));
+        has_miter = hw * hw * (m.lengthsq() - 1.f) <= span * span;
+    }
+    if(_style.join == sjs_miter && has_miter && m.lengthsq() <= _style.miter_limit * _style.miter_limit) {
+        add_rib(p, m, -m);
+        return;
+    }
+    auto add_side_rib = [&](const vec2& outer, const vec2& inner) {
+        side > 0.f ? add_rib(p, outer, inner) : add_rib(p, inner, outer);
+    };
+    vec2 o0 = n0 * side, o1 = n1 * side;
+    if(_style.join != sjs_round) {
+        add_side_rib(o0, has_miter ? m * -side : -o0);
+        add_side_rib(o1, has_miter ? m * -side : -o1);
+        return;
+    }
+    int steps = calc_arc_steps(acosf(cosa), hw + fringe);
+    float da = acosf(cosa) / steps;
+    if(get_cross(o0, o1) < 0.f)
+        da = -da;
+    float c = cosf(da), s = sinf(da);
+    vec2 o = o0;
+    for(int k = 0; k <= steps; k ++) {
+        if(k == steps)
+            o = o1;
+        add_side_rib(o, has_miter ? m * -side : -o);
+        o = vec2(o.x * c - o.y * s, o.x * s + o.y * c);
+    }
+}
+
+void polyline_stroker::add_start_cap(const vec2& p, const vec2& d, const vec2& n, float hw, float fringe)
+{
+    if(_style.cap == scs_round) {
+        int steps = calc_arc_steps(PI * 0.5f, hw + fringe);
+        for(int k = steps; k >= 0; k --) {
+            float a = PI * 0.5f * k / steps;
+            float c = cosf(a), s = sinf(a);
+            add_rib(p, n * c - d * s, -n * c - d * s);
+        }
+        return;
+    }
+    vec2 start = _style.cap == scs_square ? p - d * hw : p;
+    if(fringe > 0.f)
+        add_rib(start - d * fringe, n, -n, 0.f);
+    add_rib(start, n, -n);
+}
+
+void polyline_stroker::add_end_cap(const vec2& p, const vec2& d, const vec2& n, float hw, float fringe)
+{
+    if(_style.cap == scs_round) {
+        int steps = calc_arc_steps(PI * 0.5f, hw + fringe);
+        for(int k = 0; k <= steps; k ++) {
+            float a = PI * 0.5f * k / steps;
+            float c = cosf(a), s = sinf(a);
+            add_rib(p, n * c + d * s, -n * c + d * s);
+        }
+        return;
+    }
+    vec2 end = _style.cap == scs_square ? p + d * hw : p;
+    add_rib(end, n, -n);
+    if(fringe > 0.f)
+        add_rib(end + d * fringe, n, -n, 0.f);
+}
+
+void polyline_stroker::emit_ribs(stroke_strip& strip, float hw, float fringe) const
+{
+    if(_ribs.size() < 2)
+        return;
+    auto begin_strip = [&strip](const stroke_vertex& v) {
+        if(!strip.empty()) {
+            /* link to the last strip by degenerate triangles */
+            strip.push_back(strip.back());
+            strip.push_back(v);
+        }
+    };
+    const rib& first = _ribs.front();
+    begin_strip(stroke_vertex(first.pos + first.left * hw, first.coverage));
+    for(const rib& r : _ribs) {
+        strip.push_back(stroke_vertex(r.pos + r.left * hw, r.coverage));
+        strip.push_back(stroke_vertex(r.pos + r.right * hw, r.coverage));
+    }
+    if(fringe <= 0.f)
+        return;
+    float ow = hw + fringe;
+    begin_strip(stroke_vertex(first.pos + first.left * ow, 0.f));
+    for(const rib& r : _ribs) {
+        strip.push_back(stroke_vertex(r.pos + r.left * ow, 0.f));
+        strip.push_back(stroke_vertex(r.pos + r.left * hw, r.coverage));
+    }
+    begin_strip(stroke_vertex(first.pos + first.right * hw, first.coverage));
+    for(const rib& r : _ribs) {
+        strip.push_back(stroke_vertex(r.pos + r.right * hw, r.coverage));
+        strip.push_back(stroke_vertex(r.pos + r.right * ow, 0.f));
+    }
+}
+
+int polyline_stroker::calc_arc_steps(float angle, float radius) const
+{
+    float tol = gs_min(gs_max(_style.tolerance, 0.01f), radius * 0.5f);
+    float da = 2.f * acosf(1.f - tol / radius);
+    return gs_clamp((int)ceilf(angle / da), 1, 128);
+}
+
+__ariel_end__
@@ -41,10 +41,110 @@ const string& get_style_sheet_type_name(style_sheet_type sst)
     return sst_names[sst];
 }
 
+const style_value* compiled_style_sheet::find(int index) const
+{
+    auto f = std::lower_bound(_entries.begin(), _entries.end(), index, [](const entry& e, int i)->bool { return e.first < i; });
+    return (f != _entries.end() && f->first == index) ? &f->second : nullptr;
+}
+
+bool compiled_style_sheet::is_same(const compiled_style_sheet& that) const
+{
+    if(_ss_pairs != that._ss_pairs || _entries.size() != that._entries.size())
+        return false;
+    for(size_t i = 0; i < _entries.size(); i ++) {
+        const auto& e1 = _entries.at(i);
+        const auto& e2 = that._entries.at(i);
+        if(e1.first != e2.first || e1.second.type != e2.second.type)
+            return false;
+        const auto& v1 = e1.second;
+        const auto& v2 = e2.second;
+        bool same = false;
+        switch(v1.type)
+        {
+        case sst_color:     same = v1.cr == v2.cr;      break;
+        case sst_integer:   same = v1.i == v2.i;        break;
+        case sst_boolean:   same = v1.b == v2.b;        break;
+        case sst_float:     same = v1.f == v2.f;        break;
+        case sst_string:    same = v1.str == v2.str;    break;
+        default:            break;
+        }
+        if(!same)
+            return false;
+    }
+    return true;
+}
+
+compiled_style_ptr compiled_style_sheet::compile(const style_sheet_def* ssp, int len, const style_sheet_props& props)
+{
+    auto* info = style_sheet::query_style_sheet_info(ssp, len);
+    assert(info);
+    auto* css = new compiled_style_sheet(ssp, len);
+    assert(css);
+    for(const auto& p : props) {
+        auto f = info->names.find(p.first);
+        if(f == info->names.end()) {
+            assert(!"unexpected style sheet name.");
+            continue;
+        }
+        style_value value;
+        if(!style_sheet::parse_value(value, ssp[f->second].first, p.second)) {
+            assert(!"bad value for style sheet.");
+            continue;
+        }
+        css->store(f->second, value);
+    }
+    return compiled_style_ptr(css);
+}
+
+/* the defaults merged under the entries of the sheet, the sheet kept as the source to tell it applied again. */
+compiled_style_ptr compiled_style_sheet::resolve(const compiled_style_ptr& css, const compiled_style_ptr& defaults)
+{
+    assert(css && defaults);
+    assert(css->_ss_pairs == defaults->_ss_pairs);
+    auto* resolved = new compiled_style_sheet(css->_ss_pairs, css->_ss_length);
+    assert(resolved);
+    resolved->_source = css;
+    auto& entries = resolved->_entries;
+    const auto& e1 = css->_entries;
+    const auto& e2 = defaults->_entries;
+    entries.reserve(e1.size() + e2.size());
+    auto i = e1.begin(), j = e2.begin();
+    while(i != e1.end() || j != e2.end()) {
+        if(j == e2.end() || (i != e1.end() && i->first <= j->first)) {
+            if(j != e2.end() && j->first == i->first)
+                ++ j;
+            entries.push_back(*i ++);
+        }
+        else
+            entries.push_back(*j ++);
+    }
+    return compiled_style_ptr(resolved);
+}
+
+/* copy on write, the sheet was modified in place only if nobody else held it. */
+void compiled_style_sheet::set_value(compiled_style_ptr& css, int index, const style_value& value)
+{
+    assert(css);
+    if(css.use_count() > 1)
+        css = std::make_shared<compiled_style_sheet>(*css);
+    const_cast<compiled_style_sheet*>(css.get())->store(index, value);
+}
+
+void compiled_style_sheet::store(int index, const style_value& value)
+{
+    assert(index >= 0 && index < _ss_length);
+    auto f = std::lower_bound(_entries.begin(), _entries.end(), index, [](const entry& e, int i)->bool { return e.first < i; });
+    if(f != _entries.end() && f->first == index)
+        f->second = value;
+    else
+        _entries.insert(f, std::make_pair(index, value));
+}
+
 style_sheet::style_sheet(const style_sheet_def* ssp, int len)
 {
     _ss_pairs = nullptr;
     _ss_length = 0;
+    _ss_info = nullptr;
     initialize_style_sheet(ssp, len);
 }
 
@@ -74,15 +174,142 @@ void style_sheet::initialize_style_sheet(const style_sheet_def* ssp, int len)
     assert(ssp && len);
     _ss_pairs = ssp;
     _ss_length = len;
-    _ss_info.clear();
-    for(int i = 0; i < len; i ++)
-        _ss_info.emplace(ssp[i].second, i);
+    _ss_info = query_style_sheet_info(ssp, len);
+    _ss_applied.reset();
 }
 
 int style_sheet::get_style_sheet_index(const string& name) const
 {
-    auto f = _ss_info.find(name);
-    return f != _ss_info.end() ? f->second : npos;
+    assert(_ss_info);
+    auto f = _ss_info->names.find(name);
+    return f != _ss_info->names.end() ? f->second : npos;
+}
+
+int style_sheet::get_style_sheet_index(style_property_id id) const
+{
+    assert(_ss_info);
+    auto f = _ss_info->ids.find(id);
+    return f != _ss_info->ids.end() ? f->second : npos;
+}
+
+/* the local changes diverged from the applied sheet, which would be applied again next time. */
+void style_sheet::set_value(const string& name, const string& value)
+{
+    int index = get_style_sheet_index(name);
+    if(index == npos) {
+        assert(!"unexpected style sheet name.");
+        return;
+    }
+    style_value v;
+    if(!parse_value(v, get_content_type(index), value)) {
+        assert(!"bad value for style sheet.");
+        return;
+    }
+    _ss_applied.reset();
+    set_typed_value(index, v);
+}
+
+void style_sheet::set_value(style_property_id id, const style_value& value)
+{
+    int index = get_style_sheet_index(id);
+    if(index == npos) {
+        assert(!"unexpected style sheet name.");
+        return;
+    }
+    _ss_applied.reset();
+    set_typed_value(index, value);
+}
+
+compiled_style_ptr style_sheet::compile_style(const style_sheet_props& props) const
+{
+    return compiled_style_sheet::compile(_ss_pairs, _ss_length, props);
+}
+
+/*
+ * Applying the sheet already applied was only a pointer compare, nothing parsed either way. The sheet was resolved
+ * over the defaults before anything of the widget was touched, then published by a single swap, so that the values
+ * left out of a new sheet were the defaults rather than anything of the last sheet. The classic widgets kept their
+ * values as members for the brushes & the fonts made by flush_style, which were assigned from the sheet published.
+ */
+bool style_sheet::apply_style(const compiled_style_ptr& css)
+{
+    if(!css || css == get_applied_style())
+        return false;
+    if(css->get_defs() != _ss_pairs) {
+        assert(!"the compiled sheet was of another defs table.");
+        return false;
+    }
+    if(!_ss_defaults)
+        capture_defaults();
+    assert(_ss_defaults);
+    compiled_style_ptr resolved = compiled_style_sheet::resolve(css, _ss_defaults);
+    _ss_applied.swap(resolved);
+    for(const auto& e : _ss_applied->get_entries())
+        set_typed_value(e.first, e.second);
+    flush_style();
+    return true;
+}
+
+/* taken on the first sheet applied, the sheets of the same defaults shared the one kept in the info. */
+void style_sheet::capture_defaults()
+{
+    assert(_ss_pairs && _ss_info);
+    compiled_style_ptr css = std::make_shared<compiled_style_sheet>(_ss_pairs, _ss_length);
+    string str;
+    for(int i = 0; i < _ss_length; i ++) {
+        style_value value;
+        if(get_value(_ss_pairs[i].second, str) && parse_value(value, _ss_pairs[i].first, str))
+            compiled_style_sheet::set_value(css, i, value);
+    }
+    std::unique_lock<std::mutex> lock(_ss_info->lock);
+    const auto& shared = _ss_info->defaults;
+    if(shared && shared->is_same(*css)) {
+        _ss_defaults = shared;
+        return;
+    }
+    if(!shared)
+        _ss_info->defaults = css;
+    _ss_defaults = css;
+}
+
+bool style_sheet::parse_value(style_value& value, style_sheet_type sst, const string& str)
+{
+    value.type = sst;
+    switch(sst)
+    {
+    case sst_color:
+        return to_color(value.cr, str);
+    case sst_integer:
+        return to_integer(value.i, str);
+    case sst_boolean:
+        return to_boolean(value.b, str);
+    case sst_float:
+        return to_float(value.f, str);
+    case sst_string:
+        value.str = str;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* the sheets might be made off the main thread, the infos were never erased so the ones returned stayed valid. */
+const style_sheet_info* style_sheet::query_style_sheet_info(const style_sheet_def* ssp, int len)
+{
+    static std::mutex mtx;
+    static unordered_map<const style_sheet_def*, style_sheet_info> infos;
+    assert(ssp && len);
+    std::unique_lock<std::mutex> lock(mtx);
+    auto f = infos.find(ssp);
+    if(f != infos.end())
+        return &f->second;
+    auto& info = infos[ssp];
+    for(int i = 0; i < len; i ++) {
+        info.names.emplace(ssp[i].second, i);
+        if(!info.ids.emplace(style_hash(ssp[i].second.c_str()), i).second)
+            assert(!"collided ids of the style sheet names.");
+    }
+    return &info;
 }
 
 bool style_sheet::from_color(string& str, const color& cr)
@@ -143,7 +370,7 @@ bool style_sheet::to_boolean(bool& b, const string& str)
     }
     else if(str == _t("false") || str == _t("0")) {
         b = false;
-        return false;
+        return true;
     }
     return false;
 }
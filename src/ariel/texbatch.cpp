@@ -24,6 +24,7 @@
  */
 
 #include <gslib/std.h>
+#include <gslib/error.h>
 #include <ariel/config.h>
 #include <ariel/texbatch.h>
 #include <ariel/textureop.h>
@@ -87,9 +88,524 @@ static void write_texture_source(rendersys* rsys, unordered_access_view* uav, te
         texop.copy_rect(tex, src, (int)rc.left, (int)rc.top);
 }
 
+tex_atlas::tex_atlas()
+{
+    _rsys = nullptr;
+    _frame = 0;
+    _page_size = 2048;
+    _max_pages = 4;
+    _max_idle_frames = 120;
+    _gap = 1;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void tex_atlas::setup(rendersys* rsys, int page_size, int max_pages, int max_idle_frames)
+{
+    assert(rsys);
+    assert(page_size > 0 && max_pages > 0);
+    destroy();
+    _rsys = rsys;
+    _page_size = page_size;
+    _max_pages = max_pages;
+    _max_idle_frames = max_idle_frames;
+}
+
+void tex_atlas::destroy()
+{
+    for(auto& p : _entries) {
+        for(auto& ent : p.second)
+            ent.source->Release();
+    }
+    _entries.clear();
+    for(int i = 0; i < (int)_pages.size(); i ++)
+        release_page(i);
+    _pages.clear();
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void tex_atlas::begin_frame()
+{
+    _frame ++;
+    _stats.uploads = 0;
+    _stats.evictions = 0;
+    _stats.compactions = 0;
+}
+
+void tex_atlas::end_frame()
+{
+    evict_idle_entries();
+    compact_one_page();
+    for(int i = 0; i < (int)_pages.size(); i ++) {
+        auto& pg = _pages.at(i);
+        if(pg.tex && !pg.entries && pg.last_frame != _frame)
+            release_page(i);
+    }
+    update_stats();
+}
+
+int tex_atlas::acquire(tex_location_map& lm)
+{
+    if(!_rsys || lm.empty())
+        return -1;
+    /* the pages holding more of the group would be tried first */
+    vector<std::pair<int, int>> candidates;
+    for(int i = 0; i < (int)_pages.size(); i ++) {
+        if(_pages.at(i).tex)
+            candidates.push_back(std::make_pair(count_on_page(lm, i), i));
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b)-> bool {
+        return a.first > b.first;
+    });
+    for(const auto& c : candidates) {
+        if(place_on_page(lm, c.second))
+            return c.second;
+    }
+    int index = create_page();
+    if(index >= 0 && place_on_page(lm, index))
+        return index;
+    if(candidates.empty())
+        return -1;
+    /* evict the least recently used entries of the best page, the ones used in this frame were kept */
+    index = candidates.front().second;
+    while(evict_one(index)) {
+        if(place_on_page(lm, index))
+            return index;
+    }
+    return -1;
+}
+
+texture2d* tex_atlas::get_page_texture(int index) const
+{
+    assert(index >= 0 && index < (int)_pages.size());
+    return _pages.at(index).tex;
+}
+
+void tex_atlas::tracing() const
+{
+    trace(_t("tex atlas: %d pages, %d entries, occupancy %f;\n"), _stats.pages, _stats.entries, _stats.occupancy);
+    trace(_t("tex atlas: %d uploads, %d evictions, %d compactions in frame %d;\n"), _stats.uploads, _stats.evictions, _stats.compactions, (int)_frame);
+}
+
+static bool create_atlas_page(rendersys* rsys, tex_atlas::page& pg, int size)
+{
+    assert(rsys);
+    auto* tex = rsys->create_rgba_texture2d(size, size, true);
+    if(!tex)
+        return false;
+    auto* uav = rsys->create_unordered_access_view(tex);
+    if(!uav) {
+        tex->Release();
+        return false;
+    }
+    textureop(rsys).initialize_rect(uav, color(0, 0, 0, 0), rectf(0.f, 0.f, (float)size, (float)size));
+    pg.tex = tex;
+    pg.uav = uav;
+    pg.shelves.clear();
+    pg.used_area = 0;
+    pg.entries = 0;
+    pg.last_frame = 0;
+    return true;
+}
+
+int tex_atlas::create_page()
+{
+    int index = -1, count = 0;
+    for(int i = 0; i < (int)_pages.size(); i ++) {
+        if(_pages.at(i).tex)
+            count ++;
+        else if(index < 0)
+            index = i;
+    }
+    if(count >= _max_pages)
+        return -1;
+    page pg;
+    if(!create_atlas_page(_rsys, pg, _page_size))
+        return -1;
+    pg.last_frame = _frame;
+    if(index < 0) {
+        index = (int)_pages.size();
+        _pages.push_back(pg);
+    }
+    else
+        _pages.at(index) = pg;
+    return index;
+}
+
+void tex_atlas::release_page(int index)
+{
+    auto& pg = _pages.at(index);
+    if(pg.uav) {
+        pg.uav->Release();
+        pg.uav = nullptr;
+    }
+    if(pg.tex) {
+        pg.tex->Release();
+        pg.tex = nullptr;
+    }
+    pg.shelves.clear();
+    pg.used_area = 0;
+    pg.entries = 0;
+}
+
+int tex_atlas::count_on_page(const tex_location_map& lm, int index) const
+{
+    int count = 0;
+    for(const auto& p : lm) {
+        auto f = _entries.find(p.first);
+        if(f == _entries.end())
+            continue;
+        for(const auto& ent : f->second) {
+            if(ent.page == index) {
+                count ++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+bool tex_atlas::place_on_page(tex_location_map& lm, int index)
+{
+    auto& pg = _pages.at(index);
+    assert(pg.tex);
+    struct placement
+    {
+        texture2d*      source;
+        int             width;
+        int             height;
+        int             shelf;
+        rect            slot;
+    };
+    vector<placement> placements;
+    for(const auto& p : lm) {
+        if(find_entry(p.first, index))
+            continue;
+        placement pl;
+        pl.source = p.first;
+        textureop::get_texture_dimension(p.first, pl.width, pl.height);
+        pl.shelf = -1;
+        placements.push_back(pl);
+    }
+    /* the taller first, which would be friendly to the shelves */
+    std::sort(placements.begin(), placements.end(), [](const placement& a, const placement& b)-> bool {
+        return a.height > b.height;
+    });
+    for(int i = 0; i < (int)placements.size(); i ++) {
+        auto& pl = placements.at(i);
+        if(!allocate_slot(pg, pl.width + _gap, pl.height + _gap, pl.shelf, pl.slot)) {
+            /* roll back in the reverse order, so that the cursors could be retracted */
+            for(int j = i - 1; j >= 0; j --)
+                free_slot(pg, placements.at(j).shelf, placements.at(j).slot);
+            return false;
+        }
+    }
+    for(const auto& pl : placements) {
+        entry ent;
+        ent.source = pl.source;
+        ent.page = index;
+        ent.shelf = pl.shelf;
+        ent.slot = pl.slot;
+        ent.revision = textureop::get_revision(pl.source);
+        ent.last_frame = _frame;
+        pl.source->AddRef();
+        _entries[pl.source].push_back(ent);
+        pg.used_area += pl.slot.area();
+        pg.entries ++;
+        upload_entry(ent);
+    }
+    for(auto& p : lm) {
+        auto* ent = find_entry(p.first, index);
+        assert(ent);
+        uint revision = textureop::get_revision(p.first);
+        if(ent->revision != revision) {
+            ent->revision = revision;
+            upload_entry(*ent);
+        }
+        ent->last_frame = _frame;
+        p.second.set_rect((float)(ent->slot.left + _gap), (float)(ent->slot.top + _gap), (float)(ent->slot.width() - _gap), (float)(ent->slot.height() - _gap));
+    }
+    pg.last_frame = _frame;
+    return true;
+}
+
+bool tex_atlas::evict_one(int index)
+{
+    texture2d* victim = nullptr;
+    uint oldest = _frame;
+    for(const auto& p : _entries) {
+        for(const auto& ent : p.second) {
+            if(ent.page == index && ent.last_frame < oldest) {
+                victim = ent.source;
+                oldest = ent.last_frame;
+            }
+        }
+    }
+    if(!victim)
+        return false;
+    remove_entry(victim, index);
+    return true;
+}
+
+tex_atlas::entry* tex_atlas::find_entry(texture2d* tex, int index)
+{
+    auto f = _entries.find(tex);
+    if(f == _entries.end())
+        return nullptr;
+    for(auto& ent : f->second) {
+        if(ent.page == index)
+            return &ent;
+    }
+    return nullptr;
+}
+
+void tex_atlas::remove_entry(texture2d* tex, int index)
+{
+    auto f = _entries.find(tex);
+    assert(f != _entries.end());
+    auto& ents = f->second;
+    for(auto i = ents.begin(); i != ents.end(); ++ i) {
+        if(i->page != index)
+            continue;
+        auto& pg = _pages.at(index);
+        /* the freed area must be clean, the gaps of the neighbours rely on it */
+        textureop(_rsys).initialize_rect(pg.uav, color(0, 0, 0, 0), to_rectf(i->slot));
+        free_slot(pg, i->shelf, i->slot);
+        pg.used_area -= i->slot.area();
+        pg.entries --;
+        i->source->Release();
+        ents.erase(i);
+        _stats.evictions ++;
+        break;
+    }
+    if(ents.empty())
+        _entries.erase(f);
+}
+
+bool tex_atlas::allocate_slot(page& pg, int w, int h, int& shelf_index, rect& slot)
+{
+    if(w > _page_size || h > _page_size)
+        return false;
+    int best = -1, best_left = 0, best_span = -1;
+    auto find_shelf = [&](bool tight) {
+        int waste = INT_MAX;
+        for(int i = 0; i < (int)pg.shelves.size(); i ++) {
+            const auto& sh = pg.shelves.at(i);
+            if(sh.height < h || (tight && sh.height > h * 2))
+                continue;
+            int left = -1, sp = -1;
+            for(int j = 0; j < (int)sh.spans.size(); j ++) {
+                if(sh.spans.at(j).width >= w) {
+                    left = sh.spans.at(j).left;
+                    sp = j;
+                    break;
+                }
+            }
+            if(left < 0 && sh.cursor + w <= _page_size)
+                left = sh.cursor;
+            if(left < 0 || sh.height - h >= waste)
+                continue;
+            waste = sh.height - h;
+            best = i;
+            best_left = left;
+            best_span = sp;
+        }
+    };
+    find_shelf(true);
+    if(best < 0) {
+        /* open a new shelf */
+        int top = pg.shelves.empty() ? 0 : pg.shelves.back().top + pg.shelves.back().height;
+        if(top + h <= _page_size) {
+            shelf sh;
+            sh.top = top;
+            sh.height = h;
+            sh.cursor = 0;
+            pg.shelves.push_back(sh);
+            best = (int)pg.shelves.size() - 1;
+        }
+        else
+            find_shelf(false);
+    }
+    if(best < 0)
+        return false;
+    auto& sh = pg.shelves.at(best);
+    if(best_span >= 0) {
+        auto& sp = sh.spans.at(best_span);
+        sp.left += w;
+        sp.width -= w;
+        if(!sp.width)
+            sh.spans.erase(sh.spans.begin() + best_span);
+    }
+    else {
+        best_left = sh.cursor;
+        sh.cursor += w;
+    }
+    shelf_index = best;
+    slot.set_rect(best_left, sh.top, w, h);
+    return true;
+}
+
+void tex_atlas::free_slot(page& pg, int shelf_index, const rect& slot)
+{
+    auto& sh = pg.shelves.at(shelf_index);
+    auto& spans = sh.spans;
+    span s;
+    s.left = slot.left;
+    s.width = slot.width();
+    auto i = std::lower_bound(spans.begin(), spans.end(), s, [](const span& a, const span& b)-> bool {
+        return a.left < b.left;
+    });
+    i = spans.insert(i, s);
+    /* merge with the neighbours */
+    if(i != spans.begin()) {
+        auto p = i - 1;
+        if(p->left + p->width == i->left) {
+            p->width += i->width;
+            i = spans.erase(i) - 1;
+        }
+    }
+    auto n = i + 1;
+    if(n != spans.end() && i->left + i->width == n->left) {
+        i->width += n->width;
+        spans.erase(n);
+    }
+    /* retract the cursor */
+    if(!spans.empty() && spans.back().left + spans.back().width == sh.cursor) {
+        sh.cursor = spans.back().left;
+        spans.pop_back();
+    }
+    /* retract the trailing empty shelves */
+    while(!pg.shelves.empty() && !pg.shelves.back().cursor)
+        pg.shelves.pop_back();
+}
+
+void tex_atlas::upload_entry(const entry& ent)
+{
+    auto& pg = _pages.at(ent.page);
+    textureop(_rsys).copy_rect(pg.tex, ent.source, ent.slot.left + _gap, ent.slot.top + _gap);
+    _stats.uploads ++;
+}
+
+void tex_atlas::evict_idle_entries()
+{
+    vector<std::pair<texture2d*, int>> victims;
+    for(const auto& p : _entries) {
+        for(const auto& ent : p.second) {
+            if(_frame - ent.last_frame > (uint)_max_idle_frames)
+                victims.push_back(std::make_pair(ent.source, ent.page));
+        }
+    }
+    for(const auto& v : victims)
+        remove_entry(v.first, v.second);
+}
+
+void tex_atlas::compact_one_page()
+{
+    /* pick the most fragmented page, at most one page a frame to amortize the cost */
+    int index = -1;
+    float best = .5f;
+    int page_area = _page_size * _page_size;
+    for(int i = 0; i < (int)_pages.size(); i ++) {
+        const auto& pg = _pages.at(i);
+        if(!pg.tex || !pg.entries || pg.shelves.empty())
+            continue;
+        int extent = (pg.shelves.back().top + pg.shelves.back().height) * _page_size;
+        if(extent * 4 < page_area)
+            continue;
+        float ratio = (float)pg.used_area / extent;
+        if(ratio < best) {
+            best = ratio;
+            index = i;
+        }
+    }
+    if(index < 0)
+        return;
+    vector<entry*> moving;
+    for(auto& p : _entries) {
+        for(auto& ent : p.second) {
+            if(ent.page == index)
+                moving.push_back(&ent);
+        }
+    }
+    std::sort(moving.begin(), moving.end(), [](const entry* a, const entry* b)-> bool {
+        return a->slot.height() > b->slot.height();
+    });
+    page pg;
+    if(!create_atlas_page(_rsys, pg, _page_size))
+        return;
+    vector<std::pair<int, rect>> slots;
+    for(auto* ent : moving) {
+        std::pair<int, rect> s;
+        if(!allocate_slot(pg, ent->slot.width(), ent->slot.height(), s.first, s.second)) {
+            pg.uav->Release();
+            pg.tex->Release();
+            return;
+        }
+        slots.push_back(s);
+    }
+    auto& old = _pages.at(index);
+    /* not worth it unless the page shrinks noticeably */
+    int old_extent = old.shelves.back().top + old.shelves.back().height;
+    int new_extent = pg.shelves.empty() ? 0 : pg.shelves.back().top + pg.shelves.back().height;
+    if(new_extent * 4 > old_extent * 3) {
+        pg.uav->Release();
+        pg.tex->Release();
+        return;
+    }
+    textureop texop(_rsys);
+    for(int i = 0; i < (int)moving.size(); i ++) {
+        auto* ent = moving.at(i);
+        const auto& s = slots.at(i);
+        texop.copy_rect(pg.tex, old.tex, s.second.left, s.second.top, ent->slot.left, ent->slot.top, s.second.width(), s.second.height());
+        ent->shelf = s.first;
+        ent->slot = s.second;
+        pg.used_area += s.second.area();
+        pg.entries ++;
+    }
+    pg.last_frame = old.last_frame;
+    release_page(index);
+    _pages.at(index) = pg;
+    _stats.compactions ++;
+}
+
+void tex_atlas::update_stats()
+{
+    int pages = 0, entries = 0, used = 0;
+    for(const auto& pg : _pages) {
+        if(!pg.tex)
+            continue;
+        pages ++;
+        entries += pg.entries;
+        used += pg.used_area;
+    }
+    _stats.pages = pages;
+    _stats.entries = entries;
+    _stats.occupancy = pages ? (float)used / ((float)_page_size * _page_size * pages) : 0.f;
+}
+
 tex_batcher::tex_batcher()
 {
+    _strategy = rect_packer::ps_unknown;
     _gap = 1.f;
+    _atlas = nullptr;
+    _page = -1;
+}
+
+float tex_batcher::get_width() const
+{
+    if(_page >= 0) {
+        assert(_atlas);
+        return (float)_atlas->get_page_size();
+    }
+    return _rect_packer.get_width() + _gap;
+}
+
+float tex_batcher::get_height() const
+{
+    if(_page >= 0) {
+        assert(_atlas);
+        return (float)_atlas->get_page_size();
+    }
+    return _rect_packer.get_height() + _gap;
 }
 
 void tex_batcher::add_image(const image* p)
@@ -116,9 +632,15 @@ void tex_batcher::arrange()
 {
     if(_location_map.empty())
         return;
+    if(_atlas) {
+        _page = _atlas->acquire(_location_map);
+        if(_page >= 0)
+            return;
+        /* the group didn't fit in any page, pack it separately */
+    }
     rp_input_list inputs;
     prepare_input_list(inputs);
-    _rect_packer.pack_automatically(inputs);
+    _rect_packer.pack_automatically(inputs, _strategy);
 #if defined(_GS_BATCH_IMAGE)
     _rect_packer.for_each([this](void* binding, const rp_rect& rc, bool transposed) {
         auto* img = reinterpret_cast<image*>(binding);
@@ -156,14 +678,19 @@ render_texture2d* tex_batcher::create_texture(rendersys* rsys) const
     assert(rsys);
     image img;
     create_packed_image(img);
-#if use_rendersys_d3d_11
-    texture2d* p = rsys->create_texture2d(img, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0);
-#endif
+    texture2d* p = rsys->create_rgba_texture2d(img);
     assert(p);
     return p;
 #elif defined(_GS_BATCH_TEXTURE)
+    if(_page >= 0) {
+        assert(_atlas);
+        auto* tex = _atlas->get_page_texture(_page);
+        assert(tex);
+        tex->AddRef();
+        return tex;
+    }
     float w = get_width(), h = get_height();
-    texture2d* tex = rsys->create_texture2d((int)ceil(w), (int)ceil(h), DXGI_FORMAT_R8G8B8A8_UNORM, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE, 0, 0);
+    texture2d* tex = rsys->create_rgba_texture2d((int)ceil(w), (int)ceil(h), true);
     assert(tex);
     com_ptr<unordered_access_view> spuav;
     auto* uav = rsys->create_unordered_access_view(tex);
@@ -192,6 +719,11 @@ void tex_batcher::create_packed_image(image& img) const
 
 void tex_batcher::tracing() const
 {
+    if(_page >= 0) {
+        assert(_atlas);
+        _atlas->tracing();
+        return;
+    }
     _rect_packer.tracing();
 }
 
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gslib/std.h>
+#include <gslib/error.h>
+#include <ariel/textlayout.h>
+
+__ariel_begin__
+
+static size_t text_layout_hash(const font& ft, const gchar* str, int len)
+{
+    hasher h;
+    size_t fh = ft.hash_value();
+    h.add_bytes((const byte*)&fh, sizeof(fh));
+    return h.add_bytes((const byte*)str, len * sizeof(gchar));
+}
+
+int text_layout::get_line(int index) const
+{
+    assert(!lines.empty());
+    auto f = std::upper_bound(lines.begin(), lines.end(), index, [](int i, const line& ln)->bool { return i < ln.start; });
+    return f == lines.begin() ? 0 : (int)(f - lines.begin()) - 1;
+}
+
+int text_layout::get_stop(int index) const
+{
+    assert(!stops.empty());
+    /* the stop at or before the index, a half of the char was not a stop */
+    auto f = std::upper_bound(stops.begin(), stops.end(), index);
+    return f == stops.begin() ? 0 : (int)(f - stops.begin()) - 1;
+}
+
+point text_layout::get_caret_pos(int index) const
+{
+    if(stops.empty())
+        return point(0, 0);
+    int s = get_stop(gs_clamp(index, 0, (int)text.length()));
+    int ln = get_line(stops.at(s));
+    return point((int)ceilf(xs.at(s)), ln * line_height);
+}
+
+int text_layout::hit_index(const point& pt) const
+{
+    if(lines.empty())
+        return 0;
+    int ln = (pt.y <= 0 || line_height <= 0) ? 0 : gs_min(pt.y / line_height, (int)lines.size() - 1);
+    const line& l = lines.at(ln);
+    auto first = xs.begin() + l.first_stop, last = xs.begin() + l.last_stop + 1;
+    /* the last stop not beyond the point */
+    auto f = std::upper_bound(first, last, (float)pt.x);
+    if(f == first)
+        return stops.at(l.first_stop);
+    return stops.at((int)(f - xs.begin()) - 1);
+}
+
+int text_layout::get_fit_length(int w, int ln) const
+{
+    if(ln < 0 || ln >= (int)lines.size())
+        return 0;
+    const line& l = lines.at(ln);
+    auto first = xs.begin() + l.first_stop, last = xs.begin() + l.last_stop + 1;
+    auto f = std::upper_bound(first, last, (float)w);
+    if(f == first)
+        return 0;
+    return stops.at((int)(f - xs.begin()) - 1) - l.start;
+}
+
+text_layout_cache::text_layout_cache()
+{
+    _fontsys = nullptr;
+    _capacity = 512;
+    reset_stats();
+}
+
+void text_layout_cache::set_fontsys(fontsys* fsys)
+{
+    clear();
+    _fontsys = fsys;
+}
+
+void text_layout_cache::set_capacity(int cap)
+{
+    assert(cap > 0);
+    _capacity = cap;
+    while((int)_layouts.size() > _capacity)
+        evict();
+    _stats.entries = (int)_layouts.size();
+}
+
+void text_layout_cache::clear()
+{
+    _layouts.clear();
+    _index.clear();
+    _stats.entries = 0;
+}
+
+void text_layout_cache::reset_stats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.entries = (int)_layouts.size();
+}
+
+const text_layout* text_layout_cache::query(const font& ft, const gchar* str, int len)
+{
+    if(!str || !_fontsys)
+        return nullptr;
+    if(len < 0)
+        len = strtool::length(str);
+    size_t hash = text_layout_hash(ft, str, len);
+    auto f = _index.find(hash);
+    if(f != _index.end()) {
+        layout_iter i = f->second;
+        if(i->ft == ft && (int)i->text.length() == len && !memcmp(i->text.c_str(), str, len * sizeof(gchar))) {
+            _stats.hits ++;
+            if(i != _layouts.begin())
+                _layouts.splice(_layouts.begin(), _layouts, i);
+            return &_layouts.front();
+        }
+        /* another text of the same hash, replaced by the new one */
+        _stats.collisions ++;
+        _layouts.erase(i);
+        _index.erase(f);
+    }
+    _stats.misses ++;
+    _layouts.emplace_front();
+    text_layout& tl = _layouts.front();
+    tl.hash = hash;
+    tl.ft = ft;
+    tl.text.assign(str, len);
+    measure(tl);
+    _index.emplace(hash, _layouts.begin());
+    while((int)_layouts.size() > _capacity)
+        evict();
+    _stats.entries = (int)_layouts.size();
+    return &tl;
+}
+
+bool text_layout_cache::query_size(const font& ft, const gchar* str, int& w, int& h, int len)
+{
+    const text_layout* tl = query(ft, str, len);
+    if(!tl) {
+        w = 0, h = 0;
+        return false;
+    }
+    w = tl->width;
+    h = tl->height;
+    return true;
+}
+
+point text_layout_cache::get_caret_pos(const font& ft, const gchar* str, int index, int len)
+{
+    const text_layout* tl = query(ft, str, len);
+    return tl ? tl->get_caret_pos(index) : point(0, 0);
+}
+
+int text_layout_cache::hit_index(const font& ft, const gchar* str, const point& pt, int len)
+{
+    const text_layout* tl = query(ft, str, len);
+    return tl ? tl->hit_index(pt) : 0;
+}
+
+void text_layout_cache::tracing() const
+{
+    trace(_t("text layout cache: %d entries of %d, %d hits, %d misses;\n"), _stats.entries, _capacity, _stats.hits, _stats.misses);
+    trace(_t("text layout cache: %d evictions, %d collisions;\n"), _stats.evictions, _stats.collisions);
+}
+
+void text_layout_cache::measure(text_layout& tl)
+{
+    assert(_fontsys);
+    fontsys_font_scope scope(_fontsys, tl.ft);
+    int w = 0;
+    tl.line_height = 0;
+    _fontsys->query_size(_t(" "), w, tl.line_height, 1);
+    tl.width = 0;
+    int len = (int)tl.text.length();
+    for(int start = 0;;) {
+        int end = start;
+        while(end < len && tl.text.at(end) != _t('\n'))
+            end ++;
+        measure_line(tl, start, end);
+        if(end >= len)
+            break;
+        start = end + 1;
+    }
+    tl.height = (int)tl.lines.size() * tl.line_height;
+}
+
+void text_layout_cache::measure_line(text_layout& tl, int start, int end)
+{
+    text_layout::line ln;
+    ln.start = start;
+    ln.end = end;
+    ln.first_stop = (int)tl.stops.size();
+    const gchar* str = tl.text.c_str() + start;
+    int n = end - start;
+    /* without the advances of the font system, measured by the prefixes */
+    bool advances = n > 0 && _fontsys->query_advances(_advances, str, n);
+    assert(!advances || (int)_advances.size() == n + 1);
+    const gchar* last = str + n;
+    for(const gchar* p = str;;) {
+        int k = (int)(p - str);
+        float x = 0.f;
+        if(advances)
+            x = _advances.at(k);
+        else if(k > 0) {
+            int w, h;
+            _fontsys->query_size(str, w, h, k);
+            x = (float)w;
+        }
+        if(k > 0)   /* kept ascending for the searches, in case of the negative kernings */
+            x = gs_max(x, tl.xs.back());
+        tl.stops.push_back(start + k);
+        tl.xs.push_back(x);
+        if(k >= n)
+            break;
+        uint c = 0;
+        p = get_next_char(p, c, last);
+        if(!p || p > last)
+            p = last;
+    }
+    ln.last_stop = (int)tl.stops.size() - 1;
+    tl.width = gs_max(tl.width, (int)ceilf(tl.xs.back()));
+    tl.lines.push_back(ln);
+}
+
+void text_layout_cache::evict()
+{
+    assert(!_layouts.empty());
+    _index.erase(_layouts.back().hash);
+    _layouts.pop_back();
+    _stats.evictions ++;
+}
+
+__ariel_end__
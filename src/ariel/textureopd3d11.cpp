@@ -41,6 +41,18 @@ static inline int disp_size(int s)
     return (int)ceil((float)s / 8.f);
 }
 
+/* the revision of the texture content was kept in the private data of the texture, so that the caches could tell the changes */
+static const GUID __texture_revision_guid = { 0x467ff9d6, 0xd3de, 0x4ade, { 0x9a, 0x54, 0x27, 0x0c, 0x75, 0xa9, 0xbd, 0x76 } };
+
+static void touch_view(unordered_access_view* uav)
+{
+    assert(uav);
+    com_ptr<ID3D11Resource> spres;
+    uav->GetResource(&spres);
+    assert(spres);
+    textureop::touch(static_cast<ID3D11Texture2D*>(spres.get()));
+}
+
 render_texture2d* textureop::load(const string& path)
 {
     image img;
@@ -55,7 +67,7 @@ void textureop::copy_rect(render_texture2d* dest, render_texture2d* src, int x,
     assert(dest && src);
     if(!check_valid_device(dest) || !check_valid_device(src))
         return;
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     int w, h, dstw, dsth;
     get_texture_dimension(src, w, h);
@@ -72,6 +84,7 @@ void textureop::copy_rect(render_texture2d* dest, render_texture2d* src, int x,
     box.front = 0;
     box.back = 1;
     dc->CopySubresourceRegion(dest, 0, x, y, 0, src, 0, &box);
+    touch(dest);
 }
 
 void textureop::copy_rect(render_texture2d* dest, render_texture2d* src, int x, int y, int sx, int sy, int w, int h)
@@ -79,7 +92,7 @@ void textureop::copy_rect(render_texture2d* dest, render_texture2d* src, int x,
     assert(dest && src);
     if(!check_valid_device(dest) || !check_valid_device(src))
         return;
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     int srcw, srch, dstw, dsth;
     get_texture_dimension(src, srcw, srch);
@@ -98,6 +111,7 @@ void textureop::copy_rect(render_texture2d* dest, render_texture2d* src, int x,
     box.front = 0;
     box.back = 1;
     dc->CopySubresourceRegion(dest, 0, x, y, 0, src, 0, &box);
+    touch(dest);
 }
 
 void textureop::initialize_rect(unordered_access_view* dest, const color& cr, const rectf& rc)
@@ -134,7 +148,7 @@ void textureop::initialize_rect(unordered_access_view* dest, const color& cr, co
     cfg.height = h;
     cfg.cr = vec4((float)cr.red / 255.f, (float)cr.green / 255.f, (float)cr.blue / 255.f, (float)cr.alpha / 255.f);
     /* do initialize */
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     dc->CSSetShader(spcs.get(), nullptr, 0);
     dc->CSSetUnorderedAccessViews(0, 1, &dest, nullptr);
@@ -146,6 +160,7 @@ void textureop::initialize_rect(unordered_access_view* dest, const color& cr, co
     dc->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
     cb = nullptr;
     dc->CSSetConstantBuffers(0, 1, &cb);
+    touch_view(dest);
 }
 
 void textureop::transpose_rect(unordered_access_view* dest, render_texture2d* src, const rectf& rc)
@@ -182,7 +197,7 @@ void textureop::transpose_rect(unordered_access_view* dest, render_texture2d* sr
     cfg.width = w;
     cfg.height = h;
     /* do transpose */
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     dc->CSSetShader(spcs.get(), nullptr, 0);
     dc->CSSetShaderResources(0, 1, &srv);
@@ -197,6 +212,7 @@ void textureop::transpose_rect(unordered_access_view* dest, render_texture2d* sr
     dc->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
     cb = nullptr;
     dc->CSSetConstantBuffers(0, 1, &cb);
+    touch_view(dest);
 }
 
 void textureop::set_brightness(unordered_access_view* dest, render_texture2d* src, float s)
@@ -230,7 +246,7 @@ void textureop::set_brightness(unordered_access_view* dest, render_texture2d* sr
     cfg.width = w;
     cfg.height = h;
     /* proc */
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     dc->CSSetShader(spcs.get(), nullptr, 0);
     dc->CSSetShaderResources(0, 1, &srv);
@@ -245,6 +261,7 @@ void textureop::set_brightness(unordered_access_view* dest, render_texture2d* sr
     dc->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
     cb = nullptr;
     dc->CSSetConstantBuffers(0, 1, &cb);
+    touch_view(dest);
 }
 
 void textureop::set_fade(unordered_access_view* dest, render_texture2d* src, float s)
@@ -278,7 +295,7 @@ void textureop::set_fade(unordered_access_view* dest, render_texture2d* src, flo
     cfg.width = w;
     cfg.height = h;
     /* proc */
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     dc->CSSetShader(spcs.get(), nullptr, 0);
     dc->CSSetShaderResources(0, 1, &srv);
@@ -293,6 +310,7 @@ void textureop::set_fade(unordered_access_view* dest, render_texture2d* src, flo
     dc->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
     cb = nullptr;
     dc->CSSetConstantBuffers(0, 1, &cb);
+    touch_view(dest);
 }
 
 void textureop::set_gray(unordered_access_view* dest, render_texture2d* src)
@@ -318,7 +336,7 @@ void textureop::set_gray(unordered_access_view* dest, render_texture2d* src)
     int w, h;
     get_texture_dimension(src, w, h);
     /* proc */
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     dc->CSSetShader(spcs.get(), nullptr, 0);
     dc->CSSetShaderResources(0, 1, &srv);
@@ -329,6 +347,7 @@ void textureop::set_gray(unordered_access_view* dest, render_texture2d* src)
     dc->CSSetShaderResources(0, 1, &srv);
     unordered_access_view* uav = nullptr;
     dc->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+    touch_view(dest);
 }
 
 void textureop::set_inverse(unordered_access_view* dest, render_texture2d* src)
@@ -354,7 +373,7 @@ void textureop::set_inverse(unordered_access_view* dest, render_texture2d* src)
     int w, h;
     get_texture_dimension(src, w, h);
     /* proc */
-    auto* dc = get_immediate_context();
+    auto* dc = get_context();
     assert(dc);
     dc->CSSetShader(spcs.get(), nullptr, 0);
     dc->CSSetShaderResources(0, 1, &srv);
@@ -365,6 +384,7 @@ void textureop::set_inverse(unordered_access_view* dest, render_texture2d* src)
     dc->CSSetShaderResources(0, 1, &srv);
     unordered_access_view* uav = nullptr;
     dc->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+    touch_view(dest);
 }
 
 void textureop::initialize_rect(render_texture2d* dest, const color& cr, const rectf& rc)
@@ -442,6 +462,23 @@ void textureop::get_texture_dimension(render_texture2d* p, int& w, int& h)
     h = desc.Height;
 }
 
+uint textureop::get_revision(render_texture2d* p)
+{
+    assert(p);
+    uint revision = 0;
+    UINT size = sizeof(revision);
+    if(FAILED(p->GetPrivateData(__texture_revision_guid, &size, &revision)))
+        return 0;
+    return revision;
+}
+
+void textureop::touch(render_texture2d* p)
+{
+    assert(p);
+    uint revision = get_revision(p) + 1;
+    p->SetPrivateData(__texture_revision_guid, sizeof(revision), &revision);
+}
+
 void textureop::get_assoc_device(render_texture2d* p, render_device** ppdev)
 {
     assert(p && ppdev);
@@ -451,12 +488,16 @@ void textureop::get_assoc_device(render_texture2d* p, render_device** ppdev)
 
 bool textureop::convert_to_image(image& img, render_texture2d* tex)
 {
-    assert(tex);
-    com_ptr<render_device> spdev;
-    tex->GetDevice(&spdev);
+    assert(tex && _rsys);
+    auto* rsys = static_cast<rendersys_d3d11*>(_rsys);
+    if(rsys->is_recording()) {
+        assert(!"read back the texture out of the command lists.");
+        return false;
+    }
+    auto* spdev = get_device();
     assert(spdev);
-    com_ptr<render_context> spdc;
-    spdev->GetImmediateContext(&spdc);
+    rsys->sync_immediate_context();
+    auto* spdc = rsys->get_immediate_context();
     assert(spdc);
     D3D11_TEXTURE2D_DESC desc;
     tex->GetDesc(&desc);
@@ -495,8 +536,7 @@ render_texture2d* textureop::convert_from_premultiplied(render_texture2d* src)
     if(!spcs)
         spdev->CreateComputeShader(g_ariel_conv_from_premul_cs, sizeof(g_ariel_conv_from_premul_cs), nullptr, &spcs);
     assert(spcs);
-    com_ptr<render_context> spdc;
-    spdev->GetImmediateContext(&spdc);
+    auto* spdc = get_context();
     assert(spdc);
     D3D11_TEXTURE2D_DESC desc;
     src->GetDesc(&desc);
@@ -535,10 +575,14 @@ render_device* textureop::get_device() const
     return static_cast<rendersys_d3d11*>(_rsys)->get_device();
 }
 
-render_context* textureop::get_immediate_context() const
+/* the deferred context while recording, or the immediate one once the render thread was done with it. */
+render_context* textureop::get_context() const
 {
     assert(_rsys);
-    return static_cast<rendersys_d3d11*>(_rsys)->get_immediate_context();
+    auto* rsys = static_cast<rendersys_d3d11*>(_rsys);
+    if(!rsys->is_recording())
+        rsys->sync_immediate_context();
+    return rsys->get_context();
 }
 
 render_constant_buffer* textureop::get_constant_buffer() const
@@ -29,6 +29,7 @@
 #include <ariel/scene.h>
 #include <ariel/imageop.h>
 #include <ariel/textureop.h>
+#include <ariel/profiler.h>
 
 __ariel_begin__
 
@@ -44,6 +45,9 @@ widget::widget(wsys_manager* m)
     _style = 0;
     _visible = false;
     _enabled = true;
+    _zorder = 0;
+    _indexed = false;
+    _layered = false;
 }
 
 widget::~widget()
@@ -78,6 +82,9 @@ bool widget::create(widget* ptr, const gchar* name, const rect& rc, uint style)
     _style = style;
     if(style & sm_visible)
         _visible = true;
+    assert(_manager);
+    _zorder = _manager->next_zorder();
+    _manager->reindex_widget(this);
     refresh(false);
     return true;
 }
@@ -88,6 +95,10 @@ void widget::close()
     _enabled = false;
     set_capture(false);
     assert(!_child);
+    if(_manager) {
+        _manager->unindex_widget(this);
+        _manager->get_layers().remove(this);
+    }
     if(_parent && _parent->_child == this)
         _parent->_child = _next;
     if(_parent && _parent->_last_child == this)
@@ -102,7 +113,9 @@ void widget::show(bool b)
 {
     if(_visible != b) {
         _visible = b;
-        refresh(false);
+        assert(_manager);
+        _manager->reindex_widget(this);
+        expose(false);
     }
     if(!b)
         set_capture(false);
@@ -120,12 +133,22 @@ void widget::move(const rect& rc)
 {
     if(rc.right < rc.left || rc.bottom < rc.top)
         return;
-    refresh(false);
+    expose(false);
+    if(rc.width() != get_width() || rc.height() != get_height())
+        invalidate_layer();
     _pos = rc;
-    refresh(refresh_immediately);
+    assert(_manager);
+    _manager->reindex_widget(this);
+    expose(refresh_immediately);
 }
 
 void widget::refresh(const rect& rc, bool imm)
+{
+    invalidate_layer(&rc);
+    expose(rc, imm);
+}
+
+void widget::expose(const rect& rc, bool imm)
 {
     rect rc1 = rc;
     rc1.offset(_pos.left, _pos.top);
@@ -249,6 +272,25 @@ void widget::refresh(bool imm)
     refresh(rect(0, 0, get_width(), get_height()), imm);
 }
 
+void widget::set_layered(bool b)
+{
+    if(_layered == b)
+        return;
+    _layered = b;
+    assert(_manager);
+    if(!b)
+        _manager->get_layers().remove(this);
+    expose(false);
+}
+
+void widget::invalidate_layer(const rect* rc)
+{
+    if(_layered) {
+        assert(_manager);
+        _manager->get_layers().invalidate(this, rc);
+    }
+}
+
 bool widget::register_accelerator(unikey key, uint mask)
 {
     assert(_manager);
@@ -387,9 +429,10 @@ void button::set_image(texture2d* img, bool fs)
     if(fs) w >>= 2;
     _pos.right = _pos.left + w;
     _pos.bottom = _pos.top + h;
+    _manager->reindex_widget(this);
     auto* rsys = scene::get_singleton_ptr()->get_rendersys();
     assert(rsys);
-    _bkground = rsys->create_texture2d(w, h, DXGI_FORMAT_R8G8B8A8_UNORM, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS, 0, 0);
+    _bkground = rsys->create_rgba_texture2d(w, h, true);
     _enabled ? set_normal() : set_gray();
 }
 
@@ -641,14 +684,10 @@ void edit_line::set_caret(int n)
 {
     _caretpos = n < 0 || n > _textbuf.length() ? 
         _textbuf.length() : n;
-    string s;
-    s.assign(_textbuf.c_str(), _caretpos);
-    fontsys* pfs = scene::get_singleton_ptr()->get_fontsys();
-    assert(pfs);
-    int w, h;
-    pfs->set_font(_font);
-    pfs->query_size(s.c_str(), w, h, s.length());
-    _manager->set_ime(this, point(w, 0), _font);
+    auto* layouts = scene::get_singleton_ptr()->get_text_layouts();
+    assert(layouts);
+    point pt = layouts->get_caret_pos(_font, _textbuf.c_str(), _caretpos, _textbuf.length());
+    _manager->set_ime(this, point(pt.x, 0), _font);
     refresh(false);
 }
 
@@ -707,9 +746,9 @@ void edit_line::draw_normal_text(painter* paint)
         if(start > 0)
             paint->draw_text(_textbuf.c_str(), 0.f, 0.f, _txtcolor, start);
         if(end < _textbuf.length()) {
-            int w, h;
-            paint->get_text_dimension(_textbuf.c_str(), w, h, end);
-            paint->draw_text(_textbuf.c_str() + end, (float)w, 0.f, _txtcolor, _textbuf.length() - end);
+            auto* layouts = scene::get_singleton_ptr()->get_text_layouts();
+            point pt = layouts->get_caret_pos(_font, _textbuf.c_str(), end, _textbuf.length());
+            paint->draw_text(_textbuf.c_str() + end, (float)pt.x, 0.f, _txtcolor, _textbuf.length() - end);
         }
     }
 }
@@ -731,13 +770,11 @@ void edit_line::draw_select_text(painter* paint)
     assert(start >= 0 && end >= 0);
     assert(end <= _textbuf.length());
     paint->set_font(_font);
-    int bias = 0;
-    if(start > 0) {
-        int cast;
-        paint->get_text_dimension(_textbuf.c_str(), bias, cast, start);
-    }
-    int w, h;
-    paint->get_text_dimension(_textbuf.c_str() + start, w, h, end - start);
+    auto* layouts = scene::get_singleton_ptr()->get_text_layouts();
+    const text_layout* tl = layouts->query(_font, _textbuf.c_str(), _textbuf.length());
+    assert(tl);
+    int bias = tl->get_caret_pos(start).x;
+    int w = tl->get_caret_pos(end).x - bias, h = tl->line_height;
     paint->draw_rect(rectf((float)bias, 0.f, (float)w, (float)h), _selcolor);
     paint->draw_text(_textbuf.c_str() + start, (float)bias, 0.f, color(255, 255, 255), end - start);
 }
@@ -746,10 +783,8 @@ void edit_line::draw_caret(painter* paint)
 {
     assert(paint);
     if(_caret_on) {
-        string s;
-        s.assign(_textbuf.c_str(), _caretpos);
-        int w, h;
-        paint->get_text_dimension(s.c_str(), w, h, s.length());
+        auto* layouts = scene::get_singleton_ptr()->get_text_layouts();
+        int w = layouts->get_caret_pos(_font, _textbuf.c_str(), _caretpos, _textbuf.length()).x;
         paint->draw_line(pointf((float)w, 0.f), pointf((float)w, (float)get_height()), _crtcolor);
     }
 }
@@ -779,61 +814,9 @@ int edit_line::hit_char(point pt)
 {
     if(pt.x <= 0 || !_textbuf.length())
         return 0;
-    /* treat as mono font and predict the width */
-    fontsys* pfs = scene::get_singleton_ptr()->get_fontsys();
-    assert(pfs);
-    int w, h, fixc;
-    pfs->set_font(_font);
-    pfs->query_size(_t("a"), w, h);
-    fixc = pt.x / w;
-    if(fixc > _textbuf.length())
-        fixc = _textbuf.length();
-#ifndef _UNICODE
-    if(is_mbcs_half(_textbuf.c_str() + fixc)) {
-        assert(fixc);  /* broken MBCS? */
-        fixc --;
-    }
-#endif
-    string s;
-    s.assign(_textbuf.c_str(), fixc);
-    pfs->query_size(s.c_str(), w, h, s.length());
-    if(pt.x > w) {
-        for(fixc ++; fixc <= _textbuf.length(); fixc ++) {
-            s.push_back(_textbuf.at(fixc - 1));
-#ifndef _UNICODE
-            if(_textbuf.at(fixc - 1) & 0x80)
-                s.push_back(_textbuf.at(fixc ++));
-#endif
-            pfs->query_size(s.c_str(), w, h, s.length());
-            if(pt.x < w)
-                break;
-        }
-        if(fixc > _textbuf.length())
-            return _textbuf.length();
-#ifndef _UNICODE
-        fixc -= (s.back() & 0x80) ? 2 : 1;
-#else
-        fixc --;
-#endif
-    }
-    else if (pt.x < w) {
-        if(fixc == 0)
-            return 0;
-        for(fixc --; fixc > 0; fixc --) {
-#ifndef _UNICODE
-            if(s.pop_back() & 0x80) {
-                fixc --;
-                s.pop_back();
-            }
-#else
-            s.pop_back();
-#endif
-            pfs->query_size(s.c_str(), w, h, s.length());
-            if(pt.x >= w)
-                break;
-        }
-    }
-    return fixc;
+    auto* layouts = scene::get_singleton_ptr()->get_text_layouts();
+    assert(layouts);
+    return layouts->hit_index(_font, _textbuf.c_str(), point(pt.x, 0), _textbuf.length());
 }
 
 int edit_line::prev_char(int pos)
@@ -935,17 +918,12 @@ int edit_line::trim_if_overrun(bool alarm)
 {
     if(_textbuf.empty())
         return 0;
-    fontsys* fsys = scene::get_singleton_ptr()->get_fontsys();
-    assert(fsys);
-    fsys->set_font(_font);
+    auto* layouts = scene::get_singleton_ptr()->get_text_layouts();
+    assert(layouts);
     int len = _textbuf.length();
-    int c = len;
-    for( ; c > 0; c --) {
-        int w, h;
-        fsys->query_size(_textbuf.c_str(), w, h, c);
-        if(w <= get_width())
-            break;
-    }
+    const text_layout* tl = layouts->query(_font, _textbuf.c_str(), len);
+    assert(tl);
+    int c = tl->get_fit_length(get_width());
     if(!c) {
         _textbuf.clear();
         set_caret(0);
@@ -1215,6 +1193,7 @@ wsys_manager::wsys_manager()
     _height = 0;
     _painter = nullptr;
     _caret = nullptr;
+    _next_zorder = 0;
 }
 
 wsys_manager::~wsys_manager()
@@ -1268,10 +1247,28 @@ void wsys_manager::refresh(const rect& rc, bool imm)
 
 void wsys_manager::update()
 {
+    ariel_profile_scope("wsys_manager::update");
     if(!_root || !_dirty.is_whole() && !_dirty.size())
         return;
     _painter->on_draw_begin();
-    update(_root);
+    /* the dirty widgets from the index, drawn in the order of the tree */
+    rect bound = _dirty.is_whole() ? rect(0, 0, _width, _height) : _dirty.get_region().get_bound();
+    _index_hits.clear();
+    query_widgets(bound, _index_hits);
+    auto last = std::remove_if(_index_hits.begin(), _index_hits.end(), [this](widget* w)->bool { return !_dirty.is_dirty(w->_index_rect); });
+    _index_hits.erase(last, _index_hits.end());
+    std::sort(_index_hits.begin(), _index_hits.end(), &wsys_manager::is_painted_before);
+    for(widget* w : _index_hits) {
+        point org(0, 0);
+        w->to_global(org);
+        mat3 m;
+        m.translation((float)org.x, (float)org.y);
+        _painter->save();
+        _painter->set_tranform(m);
+        if(!w->_layered || !_layers.draw(w, _painter))
+            w->draw(_painter);
+        _painter->restore();
+    }
     _painter->on_draw_end();
     assert(_driver);
     _driver->update();
@@ -1291,7 +1288,8 @@ void wsys_manager::update(widget* w)
     m.translation(x, y);
     _painter->save();
     _painter->set_tranform(m);
-    w->draw(_painter);
+    if(!w->_layered || !_layers.draw(w, _painter))
+        w->draw(_painter);
     if(widget* c = w->_child) {
         for( ; c; c = c->_next)
             update(c);
@@ -1299,6 +1297,21 @@ void wsys_manager::update(widget* w)
     _painter->restore();
 }
 
+widget* wsys_manager::hit_test(const point& pt)
+{
+    if(_index.empty())
+        return nullptr;
+    _index_hits.clear();
+    _index.query(pointf((float)pt.x, (float)pt.y), _index_hits);
+    /* the topmost one first */
+    std::sort(_index_hits.begin(), _index_hits.end(), [](const widget* w1, const widget* w2)->bool { return is_painted_before(w2, w1); });
+    for(widget* w : _index_hits) {
+        if(is_hitable(w, pt))
+            return w;
+    }
+    return nullptr;
+}
+
 widget* wsys_manager::hit_test(widget* ptr, const point& pt)
 {
     if(!ptr || !ptr->is_visible() || !ptr->is_enabled())
@@ -1380,6 +1393,7 @@ void wsys_manager::on_close()
     _hover = nullptr;
     if(_root)
         remove_widget(_root);
+    _layers.clear();
 }
 
 void wsys_manager::on_resize(const rect& rc)
@@ -1522,6 +1536,132 @@ bool wsys_manager::remove_widget(widget* ptr)
     return remove_widget_internal(ptr);
 }
 
+void wsys_manager::reindex_widget(widget* w)
+{
+    assert(w);
+    /* the origin & the clip of the parent, from the root down */
+    widget* chain[64];
+    int depth = 0;
+    bool visible = true;
+    for(widget* p = w->_parent; p; p = p->_parent) {
+        if(depth == _countof(chain)) {
+            assert(!"widget tree too deep.");
+            return;
+        }
+        chain[depth ++] = p;
+        visible = visible && p->is_visible();
+    }
+    if(!visible) {
+        unindex_subtree(w);
+        return;
+    }
+    point org(0, 0);
+    rect clip;
+    for(int i = depth - 1; i >= 0; i --) {
+        rect rc = chain[i]->get_rect();
+        rc.offset(org.x, org.y);
+        org.set_point(rc.left, rc.top);
+        if(i == depth - 1)
+            clip = rc;
+        else if(!intersect_rect(clip, clip, rc))
+            clip = rect();
+    }
+    reindex_subtree(w, org, depth ? &clip : nullptr, true);
+}
+
+void wsys_manager::unindex_widget(widget* w)
+{
+    assert(w);
+    if(!w->_indexed)
+        return;
+    _index.remove(w, to_rectf(w->_index_rect));
+    w->_indexed = false;
+}
+
+int wsys_manager::query_widgets(const rect& rc, widget_list& ws) const
+{
+    if(_index.empty())
+        return 0;
+    return _index.query(to_rectf(rc), ws);
+}
+
+void wsys_manager::reindex_subtree(widget* w, const point& org, const rect* clip, bool visible)
+{
+    assert(w);
+    unindex_widget(w);
+    rect rc = w->get_rect();
+    rc.offset(org.x, org.y);
+    rect c = rc;
+    if(clip && !intersect_rect(c, rc, *clip))
+        c = rect();
+    if(!visible || !w->is_visible() || c.width() <= 0 || c.height() <= 0) {
+        /* neither the children would be visible */
+        for(widget* p = w->_child; p; p = p->_next)
+            unindex_subtree(p);
+        return;
+    }
+    w->_index_rect = c;
+    w->_indexed = true;
+    _index.insert(w, to_rectf(c));
+    point o(rc.left, rc.top);
+    for(widget* p = w->_child; p; p = p->_next)
+        reindex_subtree(p, o, &c, true);
+}
+
+void wsys_manager::unindex_subtree(widget* w)
+{
+    assert(w);
+    unindex_widget(w);
+    for(widget* p = w->_child; p; p = p->_next)
+        unindex_subtree(p);
+}
+
+bool wsys_manager::is_hitable(widget* w, const point& pt) const
+{
+    /* the same as the recursive hit test, every ancestor should be hit in the space of its parent */
+    widget* chain[64];
+    int depth = 0;
+    for(widget* p = w; p; p = p->_parent) {
+        if(depth == _countof(chain))
+            return false;
+        chain[depth ++] = p;
+    }
+    point p = pt;
+    for(int i = depth - 1; i >= 0; i --) {
+        widget* c = chain[i];
+        if(!c->is_visible() || !c->is_enabled() || !c->get_rect().in_rect(p) || !c->hit_test(p))
+            return false;
+        p.offset(-c->get_rect().left, -c->get_rect().top);
+    }
+    return true;
+}
+
+bool wsys_manager::is_painted_before(const widget* w1, const widget* w2)
+{
+    assert(w1 && w2);
+    if(w1 == w2)
+        return false;
+    int d1 = 0, d2 = 0;
+    for(const widget* p = w1->_parent; p; p = p->_parent)
+        d1 ++;
+    for(const widget* p = w2->_parent; p; p = p->_parent)
+        d2 ++;
+    /* an ancestor was painted before its descendants */
+    const widget* p1 = w1;
+    const widget* p2 = w2;
+    for(; d1 > d2; d1 --)
+        p1 = p1->_parent;
+    for(; d2 > d1; d2 --)
+        p2 = p2->_parent;
+    if(p1 == p2)
+        return p1 == w1;
+    while(p1->_parent != p2->_parent) {
+        p1 = p1->_parent;
+        p2 = p2->_parent;
+    }
+    return p1->_zorder < p2->_zorder;
+}
+
 bool wsys_manager::remove_widget_internal(widget* ptr)
 {
     assert(ptr);
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2016-2021 lymastee, All rights reserved.
+ * Contact: lymastee@hotmail.com
+ *
+ * This file is part of the gslib project.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gslib/error.h>
+#include <ariel/widgetlayer.h>
+#include <ariel/widget.h>
+#include <ariel/scene.h>
+#include <ariel/textureop.h>
+
+__ariel_begin__
+
+static const int widget_layer_default_budget = 32 * 1024 * 1024;
+
+widget_layer_cache::widget_layer_cache()
+{
+    _budget = widget_layer_default_budget;
+    _raster = nullptr;
+    reset_stats();
+}
+
+void widget_layer_cache::set_budget(int bytes)
+{
+    assert(bytes >= 0);
+    _budget = bytes;
+    evict(0);
+    if(_stats.bytes > _budget)
+        remove(_layers.front().owner);
+}
+
+bool widget_layer_cache::draw(widget* w, painter* paint)
+{
+    assert(w && paint);
+    int width = w->get_width(), height = w->get_height();
+    if(width <= 0 || height <= 0 || width * height * 4 > _budget) {
+        _stats.fallbacks ++;
+        return false;
+    }
+    auto f = _index.find(w);
+    if(f == _index.end()) {
+        widget_layer layer;
+        layer.owner = w;
+        layer.tex = nullptr;
+        layer.width = 0;
+        layer.height = 0;
+        layer.valid = false;
+        layer.unsupported = false;
+        _layers.push_front(layer);
+        _index.emplace(w, _layers.begin());
+        _stats.layers = (int)_layers.size();
+    }
+    else if(f->second != _layers.begin())
+        _layers.splice(_layers.begin(), _layers, f->second);
+    widget_layer& layer = _layers.front();
+    if(layer.unsupported) {
+        _stats.fallbacks ++;
+        return false;
+    }
+    if(layer.tex && (layer.width != width || layer.height != height))
+        release(layer);
+    if(layer.valid && layer.dirty.get_region().is_empty())
+        _stats.hits ++;
+    else {
+        evict(layer.tex ? 0 : width * height * 4);
+        if(!repaint(layer)) {
+            _stats.fallbacks ++;
+            return false;
+        }
+    }
+    assert(layer.tex);
+    paint->draw_image(layer.tex, 0.f, 0.f);
+    return true;
+}
+
+void widget_layer_cache::invalidate(widget* w, const rect* rc)
+{
+    auto f = _index.find(w);
+    if(f == _index.end())
+        return;
+    widget_layer& layer = *f->second;
+    if(!layer.valid)
+        return;
+    if(!rc || !layer.tex)
+        layer.valid = false;
+    else
+        layer.dirty.add(*rc);
+}
+
+void widget_layer_cache::remove(widget* w)
+{
+    auto f = _index.find(w);
+    if(f == _index.end())
+        return;
+    release(*f->second);
+    _layers.erase(f->second);
+    _index.erase(f);
+    _stats.layers = (int)_layers.size();
+}
+
+void widget_layer_cache::clear()
+{
+    for(auto& layer : _layers)
+        release(layer);
+    _layers.clear();
+    _index.clear();
+    _stats.layers = 0;
+    if(_raster) {
+        delete _raster;
+        _raster = nullptr;
+    }
+}
+
+void widget_layer_cache::reset_stats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.layers = (int)_layers.size();
+    for(const auto& layer : _layers) {
+        if(layer.tex)
+            _stats.bytes += layer.get_bytes();
+    }
+}
+
+void widget_layer_cache::tracing() const
+{
+    trace(_t("widget layer cache: %d layers, %d bytes of %d;\n"), _stats.layers, _stats.bytes, _budget);
+    trace(_t("widget layer cache: %d hits, %d repaints (%d partial), %d evictions, %d fallbacks;\n"), _stats.hits, _stats.repaints, _stats.partials, _stats.evictions, _stats.fallbacks);
+}
+
+/*
+ * The texture was reused if the size was kept, the revision was touched so that the batches would tell the change.
+ * The image of the raster painter was shared by the layers, so for a partial repaint only the dirty rects of it were
+ * cleared, drawn with the clip and uploaded, whatever the rest of it held.
+ */
+bool widget_layer_cache::repaint(widget_layer& layer)
+{
+    widget* w = layer.owner;
+    assert(w);
+    int width = w->get_width(), height = w->get_height();
+    if(!_raster) {
+        _raster = new raster_painter;
+        assert(_raster);
+        _raster->set_strict(false);
+    }
+    bool partial = layer.valid && layer.tex;
+    const dirty_region& rgn = layer.dirty.get_region();
+    _raster->resize(width, height);
+    if(partial) {
+        image& canvas = _raster->get_image();
+        rgn.for_each_rect([&](const rect& rc) { canvas.clear(color(0, 0, 0, 0), &rc); });
+        _raster->set_dirty(&layer.dirty);
+    }
+    else
+        _raster->clear(color(0, 0, 0, 0));
+    _raster->reset_unsupported_draws();
+    _raster->save();
+    w->draw(_raster);
+    _raster->restore();
+    _raster->set_dirty(nullptr);
+    if(_raster->get_unsupported_draws()) {
+        release(layer);
+        layer.unsupported = true;
+        return false;
+    }
+    const image& img = _raster->get_image();
+    if(layer.tex) {
+        assert(layer.width == width && layer.height == height);
+        rendersys* rsys = scene::get_singleton_ptr()->get_rendersys();
+        assert(rsys);
+        if(partial) {
+            rgn.for_each_rect([&](const rect& rc) {
+                rsys->update_texture2d(layer.tex, rc, img.get_data(rc.left, rc.top), img.get_bytes_per_line());
+            });
+            _stats.partials ++;
+        }
+        else
+            rsys->update_texture2d(layer.tex, rect(0, 0, width, height), img.get_data(0, 0), img.get_bytes_per_line());
+        textureop::touch(layer.tex);
+    }
+    else {
+        layer.tex = scene::get_singleton_ptr()->get_rendersys()->create_rgba_texture2d(img);
+        if(!layer.tex)
+            return false;
+        layer.width = width;
+        layer.height = height;
+        _stats.bytes += layer.get_bytes();
+    }
+    layer.valid = true;
+    layer.dirty.set_dimension(width, height);
+    layer.dirty.clear();
+    _stats.repaints ++;
+    return true;
+}
+
+void widget_layer_cache::release(widget_layer& layer)
+{
+    if(layer.tex) {
+        release_texture2d(layer.tex);
+        layer.tex = nullptr;
+        _stats.bytes -= layer.get_bytes();
+    }
+    layer.width = 0;
+    layer.height = 0;
+    layer.valid = false;
+    layer.dirty.clear();
+}
+
+/* the front layer was the one in use, which was never evicted here. */
+void widget_layer_cache::evict(int bytes)
+{
+    while(_stats.bytes + bytes > _budget && _layers.size() > 1) {
+        auto& layer = _layers.back();
+        release(layer);
+        _index.erase(layer.owner);
+        _layers.pop_back();
+        _stats.evictions ++;
+    }
+    _stats.layers = (int)_layers.size();
+}
+
+__ariel_end__
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <random>
+#include <thread>
+#include <gslib/error.h>
+#include <ariel/batch.h>
+#include <ariel/loopblinn.h>
+#include <ariel/painter.h>
+#include <ariel/painterpath.h>
+#include <ariel/profiler.h>
+
+using namespace gs;
+using namespace gs::ariel;
+
+static const float test_width = 1920.f;
+static const float test_height = 1080.f;
+static const int test_frames = 10;
+
+static void make_random_path(painter_path& path, std::mt19937& gen)
+{
+    std::uniform_real_distribution<float> x_dist(0.f, test_width - 40.f),
+        y_dist(0.f, test_height - 40.f), s_dist(4.f, 40.f);
+    float x = x_dist(gen), y = y_dist(gen);
+    path.add_rect(rectf(x, y, s_dist(gen), s_dist(gen)));
+}
+
+static float run_frames(batch_processor& bp, const vector<loop_blinn_processor*>& lbs, bat_stats& stats, float& first)
+{
+    float total = 0.f;
+    for(int f = 0; f < test_frames; f ++) {
+        bp.clear_batches();
+        float z = 0.f;
+        for(auto* lb : lbs) {
+            for(auto* poly : lb->get_polygons())
+                bp.add_non_tex_polygon(poly, z, painter_brush::solid);
+            z += 1.f;
+        }
+        bp.finish_batching();
+        stats = bp.get_stats();
+        if(!f)
+            first = stats.sweep_time;
+        total += stats.sweep_time;
+    }
+    bp.clear_batches();
+    return total / test_frames;
+}
+
+// the path before the sweep, each triangle went into the first batch of its type with no triangle overlapped
+static int run_old_path(const vector<loop_blinn_processor*>& lbs, float& elapsed)
+{
+    auto start = std::chrono::steady_clock::now();
+    vector<bat_fill_batch*> batches;
+    vector<bat_triangle*> triangles;
+    vector<bat_triangle*> result;
+    for(auto* lb : lbs) {
+        for(auto* poly : lb->get_polygons()) {
+            dt_traversal_triangles dtts;
+            poly->get_cdt_result().collect_triangles(dtts);
+            for(const dt_traversal_triangle& dtt : dtts) {
+                auto* triangle = new bat_triangle(reinterpret_cast<lb_joint*>(dtt.binding1),
+                    reinterpret_cast<lb_joint*>(dtt.binding2), reinterpret_cast<lb_joint*>(dtt.binding3)
+                    );
+                triangles.push_back(triangle);
+                rectf rc;
+                triangle->make_rect(rc);
+                auto t = triangle->decide(painter_brush::solid);
+                bat_fill_batch* found = nullptr;
+                for(auto* bat : batches) {
+                    if(bat->get_type() != t)
+                        continue;
+                    result.clear();
+                    bat->const_rtree().query(rc, result);
+                    bool overlapped = false;
+                    for(auto* p : result) {
+                        if(p->is_overlapped(*triangle)) {
+                            overlapped = true;
+                            break;
+                        }
+                    }
+                    if(!overlapped) {
+                        found = bat;
+                        break;
+                    }
+                }
+                if(!found) {
+                    found = new bat_fill_batch(t);
+                    batches.push_back(found);
+                }
+                found->get_rtree().insert(triangle, rc);
+            }
+        }
+    }
+    elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    int c = (int)batches.size();
+    for(auto* p : batches) { delete p; }
+    for(auto* p : triangles) { delete p; }
+    return c;
+}
+
+// the frames tessellating & batching the paths, the best of the runs in ms, with the profiler enabled or not
+static double run_profiled(const vector<painter_path>& paths, bool enabled)
+{
+    auto* prof = profiler::get_singleton_ptr();
+    prof->set_enabled(enabled);
+    prof->reset();
+    double best = -1.0;
+    vector<loop_blinn_processor*> lbs;
+    for(int r = 0; r < 5; r ++) {
+        auto start = std::chrono::steady_clock::now();
+        for(int f = 0; f < test_frames; f ++) {
+            prof->begin_frame();
+            batch_processor bp;
+            float z = 0.f;
+            for(const auto& path : paths) {
+                auto* lb = new loop_blinn_processor(test_width, test_height);
+                lb->proceed(path);
+                for(auto* poly : lb->get_polygons())
+                    bp.add_non_tex_polygon(poly, z, painter_brush::solid);
+                lbs.push_back(lb);
+                z += 1.f;
+            }
+            bp.finish_batching();
+            bp.clear_batches();
+            for(auto* lb : lbs)
+                delete lb;
+            lbs.clear();
+            prof->end_frame();
+        }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = best < 0.0 ? elapsed : gs_min(best, elapsed);
+    }
+    prof->set_enabled(false);
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    printf("this is a benchmark test of the batch assignment sweep.\n\n");
+
+    // each rect was tessellated into 2 triangles
+    int rect_count = 60000;
+    if(argc >= 2)
+        rect_count = gs_max(atoi(argv[1]), 1);
+    std::mt19937 gen(20240);
+    vector<loop_blinn_processor*> lbs;
+    lbs.reserve(rect_count);
+    for(int i = 0; i < rect_count; i ++) {
+        painter_path path;
+        make_random_path(path, gen);
+        auto* lb = new loop_blinn_processor(test_width, test_height);
+        lb->proceed(path);
+        lbs.push_back(lb);
+    }
+    printf("test set generated, %d rects in %.0f x %.0f, %d frames for each run.\n\n", rect_count, test_width, test_height, test_frames);
+
+    // the batches must be the same whatever the workers were
+    int hw = gs_max((int)std::thread::hardware_concurrency(), 1);
+    int workers[] = { 1, 2, 4, hw };
+    int batches = -1;
+    bool same = true;
+    printf("%-8s %10s %8s %10s %8s %14s %14s\n", "workers", "triangles", "tiles", "pairs", "batches", "first(ms)", "average(ms)");
+    for(int w : workers) {
+        if(w > hw)
+            continue;
+        batch_processor bp;
+        bp.set_workers(w);
+        bat_stats stats;
+        float first = 0.f;
+        float average = run_frames(bp, lbs, stats, first);
+        printf("%-8d %10d %8d %10d %8d %14.3f %14.3f\n", w, stats.triangles, stats.tiles, stats.pairs, stats.batches, first, average);
+        if(batches >= 0 && batches != stats.batches)
+            same = false;
+        batches = stats.batches;
+    }
+    printf("\n%s\n\n", same ? "the batches were identical for all the workers." : "error: the batches were different!");
+
+    // the sweep should never make more batches than the old path on the same scene
+    float old_time = 0.f;
+    int old_batches = run_old_path(lbs, old_time);
+    bool fewer = batches <= old_batches;
+    printf("old path: %d batches, %.3f ms.\n", old_batches, old_time);
+    printf("%s\n\n", fewer ? "the sweep made no more batches than the old path." : "error: the sweep made more batches than the old path!");
+
+    // the profiler was meant to cost under 1% of the frames, the timing noise aside
+    vector<painter_path> paths(gs_min(rect_count, 5000));
+    for(auto& path : paths)
+        make_random_path(path, gen);
+    double disabled = run_profiled(paths, false);
+    double enabled = run_profiled(paths, true);
+    double overhead = disabled > 0.0 ? (enabled - disabled) * 100.0 / disabled : 0.0;
+    printf("profiler: %.3f ms disabled, %.3f ms enabled, %.2f%% overhead for %d paths a frame.\n", disabled, enabled, overhead, (int)paths.size());
+    printf("%s\n\n", overhead < 1.0 ? "the profiler cost under 1%." : "warning: the profiler cost over 1%!");
+
+    for(auto* lb : lbs)
+        delete lb;
+    system("pause");
+    return same && fewer ? 0 : -1;
+}
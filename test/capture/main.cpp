@@ -0,0 +1,171 @@
+#include <windows.h>
+#include <gslib/error.h>
+#include <gslib/string.h>
+#include <ariel/rose.h>
+#include <ariel/image.h>
+#include <ariel/imageio.h>
+#include <ariel/painterpath.h>
+#if use_rendersys_d3d_11
+#include <ariel/rendersysd3d11.h>
+#elif use_rendersys_software
+#include <ariel/rendersyssw.h>
+#endif
+
+using namespace gs;
+using namespace gs::ariel;
+
+static const int capture_width = 640;
+static const int capture_height = 480;
+
+// the same scene for all the render systems: opaque and translucent fills, curves and strokes
+static void draw_test_scene(painter* paint)
+{
+    assert(paint);
+    paint->set_hints(painter::hint_antialias, true);
+    paint->set_pen(painter_pen(painter_pen::none));
+    paint->set_brush(painter_brush(painter_brush::solid, color(40, 60, 90, 255)));
+    paint->draw_rect(rectf(0.f, 0.f, (float)capture_width, (float)capture_height));
+    // overlapped translucent rects, the alpha blending decides the colors
+    static const color crs[] =
+    {
+        color(255, 0, 0, 160),
+        color(0, 255, 0, 96),
+        color(0, 0, 255, 200),
+        color(255, 255, 255, 32),
+    };
+    for(int i = 0; i < _countof(crs); i ++) {
+        paint->set_brush(painter_brush(painter_brush::solid, crs[i]));
+        float x = 40.f + i * 50.f, y = 40.f + i * 30.f;
+        paint->draw_rect(rectf(x, y, 160.f, 120.f));
+    }
+    // curves, the klm programs and the anti-aliased borders
+    painter_path path;
+    path.move_to(340.f, 60.f);
+    path.quad_to(vec2(600.f, 80.f), vec2(560.f, 220.f));
+    path.cubic_to(vec2(520.f, 300.f), vec2(380.f, 120.f), vec2(340.f, 260.f));
+    path.close_path();
+    paint->set_brush(painter_brush(painter_brush::solid, color(250, 200, 40, 220)));
+    paint->draw_path(path);
+    // strokes
+    paint->set_brush(painter_brush(painter_brush::none));
+    paint->set_pen(painter_pen(painter_pen::solid, color(230, 230, 230, 255)));
+    for(int i = 0; i < 8; i ++) {
+        float y = 320.f + i * 18.f;
+        paint->draw_cubic(vec2(40.f, y), vec2(200.f, y - 60.f), vec2(400.f, y + 60.f), vec2(600.f, y));
+    }
+    paint->draw_arc(vec2(420.f, 420.f), vec2(600.f, 420.f), 100.f);
+}
+
+static int capture(const string& path)
+{
+    rendersys::configs cfgs;
+#if use_rendersys_d3d_11
+    HWND hwnd = CreateWindowEx(0, _t("STATIC"), _t("capture"), WS_POPUP, 0, 0, capture_width, capture_height, 0, 0, GetModuleHandle(0), 0);
+    if(!hwnd) {
+        printf("create window failed.\n");
+        return -1;
+    }
+    rendersys_d3d11 rsys;
+    if(!rsys.setup((uint)hwnd, cfgs)) {
+        printf("setup d3d11 failed.\n");
+        return -1;
+    }
+#elif use_rendersys_software
+    cfgs.emplace(_t("width"), string().from_int(capture_width));
+    cfgs.emplace(_t("height"), string().from_int(capture_height));
+    rendersys_sw rsys;
+    if(!rsys.setup(0, cfgs)) {
+        printf("setup the software render system failed.\n");
+        return -1;
+    }
+#endif
+    rose paint;
+    paint.setup_dimensions(capture_width, capture_height);
+    paint.setup(&rsys);
+    rsys.begin_render();
+    rsys.setup_pipeline_state();
+    paint.on_draw_begin();
+    draw_test_scene(&paint);
+    paint.on_draw_end();
+    image img;
+    rsys.capture_screen(img, rectf(0.f, 0.f, (float)capture_width, (float)capture_height), 0);
+    rsys.end_render();
+#if use_rendersys_d3d_11
+    DestroyWindow(hwnd);
+#endif
+    if(!img.is_valid() || !imageio::save_image(img, path)) {
+        printf("capture failed.\n");
+        return -1;
+    }
+    printf("captured %d x %d.\n", img.get_width(), img.get_height());
+    return 0;
+}
+
+static int compare(const string& path1, const string& path2, int tolerance, const string* diff_path)
+{
+    image img1, img2;
+    if(!imageio::read_image(img1, path1) || !imageio::read_image(img2, path2)) {
+        printf("read the captures failed.\n");
+        return -1;
+    }
+    int w = img1.get_width(), h = img1.get_height();
+    if(w != img2.get_width() || h != img2.get_height()) {
+        printf("the dimensions were different, %d x %d and %d x %d.\n", w, h, img2.get_width(), img2.get_height());
+        return -1;
+    }
+    image diff;
+    if(diff_path) {
+        diff.create(image::fmt_rgba, w, h);
+        diff.clear(color(0, 0, 0, 255));
+    }
+    int mismatched = 0, max_error = 0;
+    double sum_error = 0.0;
+    for(int y = 0; y < h; y ++) {
+        for(int x = 0; x < w; x ++) {
+            const byte* p1 = img1.get_data(x, y);
+            const byte* p2 = img2.get_data(x, y);
+            int e = 0;
+            for(int c = 0; c < 4; c ++) {
+                int d = abs((int)p1[c] - (int)p2[c]);
+                e = gs_max(e, d);
+                sum_error += d;
+            }
+            max_error = gs_max(max_error, e);
+            if(e > tolerance) {
+                mismatched ++;
+                if(diff_path) {
+                    byte* q = diff.get_data(x, y);
+                    q[0] = (byte)gs_min(e * 4, 255);
+                }
+            }
+        }
+    }
+    float ratio = (float)mismatched / (w * h);
+    printf("max error: %d, mean error: %f, %d pixels (%f%%) over the tolerance %d.\n", max_error, sum_error / (w * h * 4.0), mismatched, ratio * 100.f, tolerance);
+    if(diff_path && !imageio::save_image(diff, *diff_path))
+        printf("save the diff image failed.\n");
+    /* the edges were anti-aliased by different rasterizers, a few of them might differ */
+    return ratio <= 0.005f ? 0 : 1;
+}
+
+int wmain(int argc, gchar* argv[])
+{
+    if(argc == 2)
+        return capture(string(argv[1]));
+    if(argc >= 3) {
+        int tolerance = 8;
+        if(argc >= 4)
+            tolerance = string(argv[3]).to_int();
+        string diff_path;
+        if(argc >= 5)
+            diff_path.assign(argv[4]);
+        return compare(string(argv[1]), string(argv[2]), tolerance, argc >= 5 ? &diff_path : nullptr);
+    }
+    printf("this is a comparison test of the captures of the render systems.\n\n"
+        "capture [file]\n"
+        "    render the test scene with the render system this program was built with, then save the back buffer.\n"
+        "capture [file1] [file2] [tolerance] [diff file]\n"
+        "    compare two captures, e.g. the one of a software build against the one of a d3d11 build.\n"
+        );
+    return 0;
+}
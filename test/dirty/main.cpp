@@ -0,0 +1,205 @@
+#include <random>
+#include <gslib/error.h>
+#include <ariel/dirty.h>
+
+using namespace gs;
+using namespace gs::ariel;
+
+static const int test_size = 64;
+static const int test_rounds = 2000;
+
+typedef vector<bool> pixel_mask;
+
+static int failures = 0;
+
+static void check(bool b, const char* what, int round = -1)
+{
+    if(b)
+        return;
+    failures ++;
+    if(round >= 0)
+        printf("failed: %s, in round %d.\n", what, round);
+    else
+        printf("failed: %s.\n", what);
+}
+
+static void make_random_rect(rect& rc, std::mt19937& gen, int lo, int hi)
+{
+    std::uniform_int_distribution<int> p_dist(lo, hi), s_dist(0, (hi - lo) / 2);
+    rc.left = p_dist(gen);
+    rc.top = p_dist(gen);
+    rc.right = rc.left + s_dist(gen);
+    rc.bottom = rc.top + s_dist(gen);
+}
+
+static void fill_mask(pixel_mask& mask, const rect& rc, int op)
+{
+    for(int y = 0; y < test_size; y ++) {
+        for(int x = 0; x < test_size; x ++) {
+            bool in = x >= rc.left && x < rc.right && y >= rc.top && y < rc.bottom;
+            bool b = mask.at(y * test_size + x);
+            switch(op)
+            {
+            case 0: b = b || in;    break;
+            case 1: b = b && in;    break;
+            case 2: b = b && !in;   break;
+            }
+            mask.at(y * test_size + x) = b;
+        }
+    }
+}
+
+static bool is_same(const dirty_region& rgn, const pixel_mask& mask)
+{
+    pixel_mask covered(test_size * test_size, false);
+    bool overlapped = false;
+    rgn.for_each_rect([&](const rect& rc) {
+        for(int y = gs_max(rc.top, 0); y < gs_min(rc.bottom, test_size); y ++) {
+            for(int x = gs_max(rc.left, 0); x < gs_min(rc.right, test_size); x ++) {
+                if(covered.at(y * test_size + x))
+                    overlapped = true;
+                covered.at(y * test_size + x) = true;
+            }
+        }
+    });
+    return !overlapped && covered == mask;
+}
+
+static bool is_covered(const dirty_region& rgn, const rect& rc)
+{
+    dirty_region rest(rc);
+    rest.subtract(rgn);
+    return rest.is_empty();
+}
+
+// the region operations against the pixels, the rects of a region never overlapped
+static void test_region_ops(std::mt19937& gen)
+{
+    for(int r = 0; r < test_rounds; r ++) {
+        dirty_region rgn;
+        pixel_mask mask(test_size * test_size, false);
+        for(int i = 0; i < 12; i ++) {
+            rect rc;
+            make_random_rect(rc, gen, 0, test_size / 2);     /* kept inside the pixels */
+            int op = i < 6 ? 0 : (int)(gen() % 3);
+            switch(op)
+            {
+            case 0: rgn.unite(rc);      break;
+            case 1: rgn.intersect(rc);  break;
+            case 2: rgn.subtract(rc);   break;
+            }
+            fill_mask(mask, rc, op);
+        }
+        check(is_same(rgn, mask), "the region was different from the pixels", r);
+        int area = 0;
+        for(bool b : mask)
+            area += b ? 1 : 0;
+        check(rgn.get_area() == area, "the area of the region was wrong", r);
+    }
+}
+
+// the region had the only representation whatever order the rects were united in
+static void test_region_canonical(std::mt19937& gen)
+{
+    for(int r = 0; r < test_rounds; r ++) {
+        vector<rect> rcs;
+        for(int i = 0; i < 8; i ++) {
+            rect rc;
+            make_random_rect(rc, gen, 0, test_size);
+            rcs.push_back(rc);
+        }
+        dirty_region rgn1, rgn2;
+        for(int i = 0; i < (int)rcs.size(); i ++) {
+            rgn1.unite(rcs.at(i));
+            rgn2.unite(rcs.at(rcs.size() - 1 - i));
+        }
+        dirty_region::rect_list rcs1, rcs2;
+        rgn1.get_rects(rcs1);
+        rgn2.get_rects(rcs2);
+        check(rcs1 == rcs2, "the rects differed by the order of the union", r);
+    }
+}
+
+// the dirty rects were merged only if the overdraw was cheaper than one more rect
+static void test_dirty_merge()
+{
+    dirty_list dl(1024, 768);
+    dl.add(rect(10, 10, 20, 20));
+    dl.add(rect(32, 10, 20, 20));
+    check(dl.size() == 1, "the rects nearby were not merged");
+    check(dl.get_region().get_bound() == rect(10, 10, 42, 20), "the merged bound was wrong");
+
+    dl.clear();
+    dl.add(rect(0, 0, 100, 100));
+    dl.add(rect(900, 600, 100, 100));
+    check(dl.size() == 2, "the rects far apart were merged");
+
+    dl.clear();
+    dl.add(rect(0, 0, 100, 100));
+    dl.add(rect(20, 20, 30, 30));
+    check(dl.size() == 1 && dl.get_region().get_area() == 100 * 100, "the rect inside was not absorbed");
+
+    // the rects out of the screen, or empty after the clamp, added nothing
+    dl.clear();
+    dl.add(rect(-50, 10, 40, 40));
+    dl.add(rect(10, -50, 40, 40));
+    dl.add(rect(1024, 10, 40, 40));
+    dl.add(rect(10, 768, 40, 40));
+    dl.add(rect(10, 10, 0, 40));
+    check(dl.size() == 0 && dl.get_region().is_empty(), "the empty rects were added");
+
+    dl.clear();
+    dl.add(rect(-10, -10, 40, 40));
+    check(dl.get_region().get_bound() == rect(0, 0, 30, 30), "the rect was not clamped");
+
+    // too fragmented, fell back to the bound
+    dl.clear();
+    dl.set_draw_cost(0);
+    for(int i = 0; i < 100; i ++)
+        dl.add(rect((i % 10) * 100, (i / 10) * 70, 10, 10));
+    check(dl.size() <= 64, "the rects were not capped");
+    bool covered = true;
+    for(int i = 0; i < 100; i ++)
+        covered = covered && is_covered(dl.get_region(), rect((i % 10) * 100, (i / 10) * 70, 10, 10));
+    check(covered, "the bound did not cover the rects");
+}
+
+// whatever merged, every rect added was still covered
+static void test_dirty_cover(std::mt19937& gen)
+{
+    for(int r = 0; r < test_rounds; r ++) {
+        dirty_list dl(test_size, test_size);
+        dl.set_draw_cost((int)(gen() % 512));
+        vector<rect> rcs;
+        for(int i = 0; i < 16; i ++) {
+            rect rc;
+            make_random_rect(rc, gen, -8, test_size);
+            dl.add(rc);
+            rc.left = gs_max(rc.left, 0);
+            rc.top = gs_max(rc.top, 0);
+            rc.right = gs_min(rc.right, test_size);
+            rc.bottom = gs_min(rc.bottom, test_size);
+            if(rc.left < rc.right && rc.top < rc.bottom)
+                rcs.push_back(rc);
+        }
+        for(const rect& rc : rcs)
+            check(is_covered(dl.get_region(), rc), "a dirty rect was lost", r);
+        check(!rcs.empty() || dl.get_region().is_empty(), "the region was not empty", r);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    printf("this is a test of the dirty region merging.\n\n");
+    std::mt19937 gen(20241);
+    test_region_ops(gen);
+    test_region_canonical(gen);
+    test_dirty_merge();
+    test_dirty_cover(gen);
+    if(!failures)
+        printf("all passed.\n\n");
+    else
+        printf("\n%d failures.\n\n", failures);
+    system("pause");
+    return failures ? -1 : 0;
+}
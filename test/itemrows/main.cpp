@@ -0,0 +1,269 @@
+#include <random>
+#include <gslib/error.h>
+#include <ariel/itemmodel.h>
+
+using namespace gs;
+using namespace gs::ariel;
+
+static const int test_rounds = 2000;
+
+static int failures = 0;
+
+static void check(bool b, const char* what, int round = -1)
+{
+    if(b)
+        return;
+    failures ++;
+    if(round >= 0)
+        printf("failed: %s, in round %d.\n", what, round);
+    else
+        printf("failed: %s.\n", what);
+}
+
+/* the rows of a random tree in the preorder, each row at most one level deeper than the previous. */
+class test_model:
+    public item_model
+{
+public:
+    vector<int>         heights;
+    vector<int>         depths;
+    mutable int         fetches = 0;
+
+public:
+    void generate(std::mt19937& gen, int count)
+    {
+        heights.resize(count);
+        depths.resize(count);
+        for(int i = 0; i < count; i ++) {
+            heights.at(i) = 1 + (int)(gen() % 40);
+            depths.at(i) = i ? (int)(gen() % (depths.at(i - 1) + 2)) : 0;
+        }
+    }
+    virtual int get_row_count() const override { return (int)heights.size(); }
+    virtual int get_row_height(int row) const override { return heights.at(row); }
+    virtual int get_row_depth(int row) const override { return depths.at(row); }
+    virtual void get_row_data(int row, item_data& data) const override
+    {
+        fetches ++;
+        data.text.format(_t("row %d"), row);
+        data.branch = row + 1 < (int)depths.size() && depths.at(row + 1) > depths.at(row);
+    }
+};
+
+// the brute force heights, a row hidden if any range hiding it was still there
+struct naive_heights
+{
+    vector<int>         heights;
+    vector<int>         covers;
+
+    int get_height(int row) const { return covers.at(row) ? 0 : heights.at(row); }
+    int get_top(int row) const
+    {
+        int s = 0;
+        for(int i = 0; i < row; i ++)
+            s += get_height(i);
+        return s;
+    }
+    int find_row(int y) const
+    {
+        if(y < 0)
+            return 0;
+        int s = 0;
+        for(int i = 0; i < (int)heights.size(); i ++) {
+            s += get_height(i);
+            if(s > y)
+                return i;
+        }
+        return (int)heights.size();
+    }
+};
+
+static bool is_same_index(const row_height_index& index, const naive_heights& naive, std::mt19937& gen)
+{
+    int count = (int)naive.heights.size();
+    if(index.size() != count || index.get_total() != naive.get_top(count))
+        return false;
+    for(int i = 0; i < count; i ++) {
+        if(index.get_height(i) != naive.get_height(i) || index.get_top(i) != naive.get_top(i))
+            return false;
+    }
+    int total = index.get_total();
+    for(int i = 0; i < 16; i ++) {
+        int y = (int)(gen() % (total + 8)) - 4;
+        if(index.find_row(y) != naive.find_row(y))
+            return false;
+    }
+    return true;
+}
+
+// the heights set, the rows hidden & shown by the nested ranges, against the brute force
+static void test_height_index(std::mt19937& gen)
+{
+    struct hidden_range { int begin, end; };
+    for(int r = 0; r < test_rounds / 10; r ++) {
+        int count = (int)(gen() % 300);
+        naive_heights naive;
+        naive.heights.resize(count);
+        naive.covers.assign(count, 0);
+        for(auto& h : naive.heights)
+            h = (int)(gen() % 30);
+        row_height_index index;
+        index.build(count, [&](int row)->int { return naive.heights.at(row); });
+        check(is_same_index(index, naive, gen), "the index built was wrong", r);
+        if(!count)
+            continue;
+        vector<hidden_range> ranges;
+        for(int i = 0; i < 50; i ++) {
+            switch(gen() % 3)
+            {
+            case 0:
+                {
+                    int row = (int)(gen() % count), h = (int)(gen() % 30);
+                    naive.heights.at(row) = h;
+                    index.set_height(row, h);
+                    break;
+                }
+            case 1:
+                {
+                    int begin = (int)(gen() % count);
+                    int end = begin + 1 + (int)(gen() % (count - begin));
+                    ranges.push_back({ begin, end });
+                    for(int j = begin; j < end; j ++)
+                        naive.covers.at(j) ++;
+                    index.hide_rows(begin, end);
+                    break;
+                }
+            default:
+                if(!ranges.empty()) {
+                    int k = (int)(gen() % ranges.size());
+                    auto range = ranges.at(k);
+                    ranges.erase(ranges.begin() + k);
+                    for(int j = range.begin; j < range.end; j ++)
+                        naive.covers.at(j) --;
+                    index.show_rows(range.begin, range.end);
+                }
+                break;
+            }
+            check(is_same_index(index, naive, gen), "the index updated was wrong", r);
+        }
+    }
+}
+
+// the visible rows of the tree walked by the depths, a row hidden under any collapsed ancestor
+static void get_visible_rows(const test_model& model, const vector<bool>& collapsed, vector<bool>& visible)
+{
+    int count = model.get_row_count();
+    visible.assign(count, true);
+    vector<int> hiders;                         /* the depths of the collapsed ancestors opened */
+    for(int i = 0; i < count; i ++) {
+        int d = model.depths.at(i);
+        while(!hiders.empty() && hiders.back() >= d)
+            hiders.pop_back();
+        visible.at(i) = hiders.empty();
+        if(collapsed.at(i))
+            hiders.push_back(d);
+    }
+}
+
+static bool is_same_rows(const item_rows& rows, const test_model& model, const vector<bool>& collapsed)
+{
+    int count = model.get_row_count();
+    if(rows.get_row_count() != count)
+        return false;
+    vector<bool> visible;
+    get_visible_rows(model, collapsed, visible);
+    int top = 0;
+    for(int i = 0; i < count; i ++) {
+        int h = visible.at(i) ? model.heights.at(i) : 0;
+        if(rows.is_expanded(i) == collapsed.at(i) || rows.get_row_height(i) != h || rows.get_row_top(i) != top)
+            return false;
+        if(visible.at(i)) {
+            int next = i + 1;
+            while(next < count && !visible.at(next))
+                next ++;
+            if(rows.next_row(i) != next || rows.find_row(top) != i || rows.find_row(top + h - 1) != i)
+                return false;
+        }
+        top += h;
+    }
+    return rows.get_total_height() == top && rows.find_row(top) == count;
+}
+
+// the random expand, collapse & height changes on the random trees, against the brute force
+static void test_expand(std::mt19937& gen)
+{
+    for(int r = 0; r < test_rounds / 20; r ++) {
+        test_model model;
+        model.generate(gen, 1 + (int)(gen() % 200));
+        int count = model.get_row_count();
+        item_rows rows;
+        rows.set_model(&model);
+        vector<bool> collapsed(count, false);
+        check(is_same_rows(rows, model, collapsed), "the rows loaded were wrong", r);
+        for(int i = 0; i < 60; i ++) {
+            int row = (int)(gen() % count);
+            if(gen() % 4 == 0) {
+                model.heights.at(row) = 1 + (int)(gen() % 40);
+                rows.update_row_height(row);
+            }
+            else {
+                bool b = gen() % 2 == 0;
+                rows.expand(row, b);
+                collapsed.at(row) = !b;
+            }
+            check(is_same_rows(rows, model, collapsed), "the rows expanded or collapsed were wrong", r);
+        }
+    }
+}
+
+// the model was asked once for each row newly exposed, the visuals were bound by the rows of a frame
+static void test_visual_pool(std::mt19937& gen)
+{
+    test_model model;
+    model.generate(gen, 1000);
+    item_visual_pool pool;
+    int first = 0, last = 0, fetches = 0;
+    for(int r = 0; r < test_rounds; r ++) {
+        int nfirst = gs_max(0, gs_min(990, first + (int)(gen() % 41) - 20));
+        int nlast = nfirst + 10 + (int)(gen() % 20);
+        for(int i = nfirst; i < nlast; i ++) {
+            if(i < first || i >= last)
+                fetches ++;
+        }
+        pool.begin_frame();
+        bool bound = true;
+        for(int i = nfirst; i < nlast; i ++) {
+            auto& v = pool.acquire(&model, i);
+            string s;
+            s.format(_t("row %d"), i);
+            bound &= v.row == i && v.data.text == s;
+        }
+        pool.end_frame();
+        first = nfirst;
+        last = nlast;
+        check(bound, "the visual was bound to another row", r);
+        check(pool.get_fetches() == fetches && model.fetches == fetches, "the rows kept visible were fetched again", r);
+    }
+    // the row invalidated was asked for again
+    int before = pool.get_fetches();
+    pool.invalidate(first);
+    pool.begin_frame();
+    pool.acquire(&model, first);
+    pool.end_frame();
+    check(pool.get_fetches() == before + 1, "the row invalidated was not fetched again");
+}
+
+int main(int argc, char* argv[])
+{
+    printf("this is a test of the row heights & the expanding of the item rows.\n\n");
+    std::mt19937 gen(20245);
+    test_height_index(gen);
+    test_expand(gen);
+    test_visual_pool(gen);
+    if(!failures)
+        printf("all passed.\n\n");
+    else
+        printf("\n%d failures.\n\n", failures);
+    system("pause");
+    return failures ? -1 : 0;
+}
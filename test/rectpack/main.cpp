@@ -81,48 +81,75 @@ int wmain(int argc, gchar* argv[])
         return -1;
     }
 
-    gs::ariel::rect_packer rp;
     gs::ariel::rp_input_list quad_to_pack;
     for(int i = 0; i < input_count; i ++) {
         gs::ariel::rp_input input;
         make_random_rect(input.width, input.height);
-        input.binding = (void*)0xffffffff;
+        input.binding = (void*)(size_t)(i + 1);     /* the online strategies need unique bindings */
         quad_to_pack.push_back(input);
     }
 
-    printf("test set generated, start packing...\n\n");
-
-    uint t1 = timeGetTime();
-    rp.pack_automatically(quad_to_pack);
-    uint t2 = timeGetTime();
-    printf("time elapse: %dms\n\n", t2 - t1);
-
-    // summary
-    printf("summary:\n");
-    str.format(_t("pack times: %d\n"), rp.get_pack_times());
-    wprintf(str.c_str());
-    auto& rnode = rp.get_root_node();
-    str.format(_t("pack size: %f x %f\n"), rnode.width, rnode.height);
-    wprintf(str.c_str());
-    str.format(_t("pack area: %f\n"), rnode.width * rnode.height);
-    wprintf(str.c_str());
-
     // sum of input areas
     float sum_area = 0.f;
     for(auto& i : quad_to_pack) {
         float a = i.width * i.height;
         sum_area += a;
     }
-    str.format(_t("sum of areas: %f\n"), sum_area);
+    str.format(_t("sum of areas: %f\n\n"), sum_area);
     wprintf(str.c_str());
 
-    // area used ratio
-    float ratio = sum_area / (rnode.width * rnode.height);
-    str.format(_t("area used ratio: %f\n\n"), ratio);
-    wprintf(str.c_str());
+    printf("test set generated, start packing...\n\n");
 
-    rp.tracing();
-    trace_to_clipboard();
+    // compare all the strategies with the same test set
+    static const struct
+    {
+        gs::ariel::rect_packer::packing_strategy strategy;
+        const char* name;
+    }
+    strategies[] =
+    {
+        { gs::ariel::rect_packer::ps_dynamically, "dynamically" },
+        { gs::ariel::rect_packer::ps_compactly, "compactly" },
+        { gs::ariel::rect_packer::ps_skyline, "skyline" },
+        { gs::ariel::rect_packer::ps_maxrects, "maxrects" },
+    };
+    printf("%-12s %10s %6s %24s %10s\n", "strategy", "time(ms)", "times", "pack size", "ratio");
+    for(const auto& s : strategies) {
+        gs::ariel::rect_packer rp;
+        gs::ariel::rp_input_list inputs = quad_to_pack;
+        uint t1 = timeGetTime();
+        rp.pack_automatically(inputs, s.strategy);
+        uint t2 = timeGetTime();
+        float w = rp.get_width(), h = rp.get_height();
+        printf("%-12s %10d %6d %11.2f x %10.2f %10f\n", s.name, t2 - t1, rp.get_pack_times(), w, h, sum_area / (w * h));
+    }
+    printf("\n");
+
+    // online insertion and removal, keep about a half of the test set in a fixed bin
+    printf("online packing, insert all then remove and insert the half of them in turn:\n");
+    printf("%-12s %10s %10s %10s %10s\n", "strategy", "time(ms)", "occupancy", "fails", "free rects");
+    float side = sqrtf(sum_area * 1.2f);
+    for(int k = 2; k < _countof(strategies); k ++) {
+        gs::ariel::rect_packer rp;
+        rp.reset(strategies[k].strategy, side, side);
+        int fails = 0;
+        uint t1 = timeGetTime();
+        for(const auto& i : quad_to_pack)
+            fails += rp.insert(i.width, i.height, i.binding) ? 0 : 1;
+        int n = 0;
+        for(const auto& i : quad_to_pack) {
+            if(n ++ % 2)
+                rp.remove(i.binding);
+        }
+        n = 0;
+        for(const auto& i : quad_to_pack) {
+            if(n ++ % 2)
+                fails += rp.insert(i.width, i.height, i.binding) ? 0 : 1;
+        }
+        uint t2 = timeGetTime();
+        printf("%-12s %10d %10f %10d %10d\n", strategies[k].name, t2 - t1, rp.get_occupancy(), fails, rp.get_free_rect_count());
+    }
+    printf("\n");
     system("pause");
     return 0;
 }
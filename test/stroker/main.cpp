@@ -0,0 +1,203 @@
+#include <random>
+#include <gslib/error.h>
+#include <ariel/stroker.h>
+#include <ariel/clip.h>
+
+using namespace gs;
+using namespace gs::ariel;
+
+static const int test_rounds = 1000;
+static const float test_tolerance = 1e-3f;
+
+static int failures = 0;
+
+static void check(bool b, const char* what, int round = -1)
+{
+    if(b)
+        return;
+    failures ++;
+    if(round >= 0)
+        printf("failed: %s, in round %d.\n", what, round);
+    else
+        printf("failed: %s.\n", what);
+}
+
+static void make_random_polygon(painter_linestrip& ls, std::mt19937& gen, bool clockwise)
+{
+    std::uniform_real_distribution<float> c_dist(-100.f, 100.f), r_dist(10.f, 80.f);
+    std::uniform_int_distribution<int> n_dist(3, 12);
+    vec2 c(c_dist(gen), c_dist(gen));
+    float r = r_dist(gen), a0 = c_dist(gen);
+    int n = n_dist(gen);
+    ls.clear();
+    for(int i = 0; i < n; i ++) {
+        float a = a0 + (clockwise ? -2.f : 2.f) * PI * i / n;
+        ls.add_point(vec2(c.x + r * cosf(a), c.y + r * sinf(a)));
+    }
+    ls.set_closed(true);
+}
+
+static void make_random_polyline(painter_linestrip& ls, std::mt19937& gen)
+{
+    std::uniform_real_distribution<float> s_dist(20.f, 60.f), a_dist(-1.f, 1.f);
+    ls.clear();
+    vec2 p(0.f, 0.f);
+    float a = 0.f;
+    ls.add_point(p);
+    for(int i = 0; i < 6; i ++) {
+        a += a_dist(gen);                       /* within 1 radian a turn, never folded back */
+        float s = s_dist(gen);
+        p += vec2(s * cosf(a), s * sinf(a));
+        ls.add_point(p);
+    }
+    ls.set_closed(false);
+}
+
+// every point of one was on the other, in whatever order the points started
+static bool is_same_polygon(const painter_linestrip& ls1, const painter_linestrip& ls2)
+{
+    if(ls1.get_size() != ls2.get_size())
+        return false;
+    for(int i = 0; i < ls1.get_size(); i ++) {
+        bool found = false;
+        for(int j = 0; j < ls2.get_size() && !found; j ++)
+            found = vec2().sub(ls1.get_point(i), ls2.get_point(j)).length() < test_tolerance;
+        if(!found)
+            return false;
+    }
+    return true;
+}
+
+static bool is_same_polyline(const painter_linestrip& ls1, const painter_linestrip& ls2)
+{
+    if(ls1.get_size() != ls2.get_size())
+        return false;
+    for(int i = 0; i < ls1.get_size(); i ++) {
+        if(vec2().sub(ls1.get_point(i), ls2.get_point(i)).length() >= test_tolerance)
+            return false;
+    }
+    return true;
+}
+
+static float get_area(const painter_linestrip& ls)
+{
+    float area = 0.f;
+    for(int i = 0, j = ls.get_size() - 1; i < ls.get_size(); j = i ++)
+        area += ls.get_point(j).x * ls.get_point(i).y - ls.get_point(i).x * ls.get_point(j).y;
+    return fabsf(area * 0.5f);
+}
+
+static float get_strip_area(const stroke_strip& strip)
+{
+    float area = 0.f;
+    for(int i = 2; i < (int)strip.size(); i ++) {
+        vec2 d1, d2;
+        d1.sub(strip.at(i - 1).pos, strip.at(i - 2).pos);
+        d2.sub(strip.at(i).pos, strip.at(i - 2).pos);
+        area += fabsf(d1.x * d2.y - d1.y * d2.x) * 0.5f;
+    }
+    return area;
+}
+
+// offset out then back in by the miter joins, the convex polygons and the polylines came back
+static void test_offset_round_trip(std::mt19937& gen)
+{
+    stroke_style st;
+    st.join = sjs_miter;
+    st.miter_limit = 1000.f;
+    polyline_stroker stroker(st);
+    std::uniform_real_distribution<float> d_dist(0.5f, 4.f);     /* below the inner radius of the polygons */
+    painter_linestrip org, out, back;
+    for(int r = 0; r < test_rounds; r ++) {
+        float d = d_dist(gen);
+        make_random_polygon(org, gen, (r & 1) != 0);
+        stroker.offset(out, org, d);
+        stroker.offset(back, out, -d);
+        check(!is_same_polygon(org, out), "the polygon was not offset", r);
+        check(out.is_closed() && is_same_polygon(org, back), "the polygon did not come back", r);
+        make_random_polyline(org, gen);
+        stroker.offset(out, org, d);
+        stroker.offset(back, out, -d);
+        check(fabsf(vec2().sub(out.get_point(0), org.get_point(0)).length() - d) < test_tolerance, "the polyline was not offset", r);
+        check(!out.is_closed() && is_same_polyline(org, back), "the polyline did not come back", r);
+    }
+}
+
+// the area of a straight stroke by the caps
+static void test_stroke_area()
+{
+    painter_linestrip ls;
+    ls.add_point(vec2(10.f, 10.f));
+    ls.add_point(vec2(110.f, 10.f));
+    stroke_style st;
+    st.width = 8.f;
+    st.tolerance = 0.01f;
+    polyline_stroker stroker;
+    stroke_strip strip;
+    st.cap = scs_butt;
+    stroker.set_style(st);
+    stroker.stroke(strip, ls);
+    check(fabsf(get_strip_area(strip) - 800.f) < 0.1f, "the butt stroke had a wrong area");
+    strip.clear();
+    st.cap = scs_square;
+    stroker.set_style(st);
+    stroker.stroke(strip, ls);
+    check(fabsf(get_strip_area(strip) - 864.f) < 0.1f, "the square stroke had a wrong area");
+    strip.clear();
+    st.cap = scs_round;
+    stroker.set_style(st);
+    stroker.stroke(strip, ls);
+    check(fabsf(get_strip_area(strip) - (800.f + PI * 16.f)) < 1.f, "the round stroke had a wrong area");
+}
+
+// a square grew and shrank the same way by either orientation, the hole shrank as the square grew
+static void test_clip_offset()
+{
+    for(int cw = 0; cw < 2; cw ++) {
+        painter_linestrips input, out;
+        input.push_back(painter_linestrip());
+        auto& sq = input.back();
+        sq.add_point(vec2(0.f, 0.f));
+        sq.add_point(vec2(10.f, 0.f));
+        sq.add_point(vec2(10.f, 10.f));
+        sq.add_point(vec2(0.f, 10.f));
+        if(cw)
+            sq.reverse();
+        clip_offset(out, input, 2.f);
+        check(out.size() == 1 && fabsf(get_area(out.front()) - 196.f) < 0.1f, "the square did not grow");
+        out.clear();
+        clip_offset(out, input, -2.f);
+        check(out.size() == 1 && fabsf(get_area(out.front()) - 36.f) < 0.1f, "the square did not shrink");
+        input.push_back(painter_linestrip());
+        auto& hole = input.back();
+        hole.add_point(vec2(3.f, 3.f));
+        hole.add_point(vec2(3.f, 7.f));
+        hole.add_point(vec2(7.f, 7.f));
+        hole.add_point(vec2(7.f, 3.f));
+        if(cw)
+            hole.reverse();
+        out.clear();
+        clip_offset(out, input, 1.f);
+        float area = 0.f, outer = 0.f;
+        for(const auto& ls : out) {
+            area += get_area(ls);
+            outer = gs_max(outer, get_area(ls));
+        }
+        check(out.size() == 2 && fabsf(outer * 2.f - area - (144.f - 4.f)) < 0.1f, "the hole did not shrink");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    printf("this is a test of the float polyline stroker.\n\n");
+    std::mt19937 gen(20243);
+    test_offset_round_trip(gen);
+    test_stroke_area();
+    test_clip_offset();
+    if(!failures)
+        printf("all passed.\n\n");
+    else
+        printf("\n%d failures.\n\n", failures);
+    system("pause");
+    return failures ? -1 : 0;
+}
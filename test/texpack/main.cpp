@@ -74,31 +74,70 @@ int gs_main()
     _wsystem(cmd.c_str());
     cmd.format(_t("mkdir \"%s/unpacked\""), currentfolderpath.c_str());
     _wsystem(cmd.c_str());
-    tex_batcher batcher;
     image_cache cache(generate_counts);
+#ifndef _GS_BATCH_IMAGE
+    vector<texture2d*> textures;
+#endif
+    float sum_area = 0.f;
     for(image& img : cache) {
         make_random_image(fsys, img);
-#ifdef _GS_BATCH_IMAGE
-        batcher.add_image(&img);
-#else
+        sum_area += (float)(img.get_width() + 1) * (img.get_height() + 1);    /* the gap included */
+#ifndef _GS_BATCH_IMAGE
         auto* tex = rsys->create_texture2d(img, 1, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0);
         assert(tex);
-        batcher.add_texture(tex);
+        textures.push_back(tex);
 #endif
     }
-    batcher.arrange();
-    batcher.tracing();
-    image atlas;
+    /* compare the strategies with the same images */
+    static const struct
+    {
+        rect_packer::packing_strategy strategy;
+        const gchar* name;
+    }
+    strategies[] =
+    {
+        { rect_packer::ps_dynamically, _t("dynamically") },
+        { rect_packer::ps_compactly, _t("compactly") },
+        { rect_packer::ps_skyline, _t("skyline") },
+        { rect_packer::ps_maxrects, _t("maxrects") },
+    };
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    for(const auto& s : strategies) {
+        tex_batcher batcher;
+        batcher.set_packing_strategy(s.strategy);
 #ifdef _GS_BATCH_IMAGE
-    batcher.create_packed_image(atlas);
+        for(image& img : cache)
+            batcher.add_image(&img);
 #else
-    auto* texatlas = batcher.create_texture(rsys);
-    assert(texatlas);
-    textureop::convert_to_image(atlas, texatlas);
+        for(auto* tex : textures)
+            batcher.add_texture(tex);
+#endif
+        LARGE_INTEGER t1, t2;
+        QueryPerformanceCounter(&t1);
+        batcher.arrange();
+        QueryPerformanceCounter(&t2);
+        float w = batcher.get_width(), h = batcher.get_height();
+        string str;
+        str.format(_t("%s: %f ms, %f x %f, ratio %f\n"), s.name, (double)(t2.QuadPart - t1.QuadPart) * 1000.0 / freq.QuadPart, w, h, sum_area / (w * h));
+        wprintf(str.c_str());
+        image atlas;
+#ifdef _GS_BATCH_IMAGE
+        batcher.create_packed_image(atlas);
+#else
+        auto* texatlas = batcher.create_texture(rsys);
+        assert(texatlas);
+        textureop(rsys).convert_to_image(atlas, texatlas);
+        texatlas->Release();
+#endif
+        string fname;
+        fname.format(_t("%s/unpacked/packed_%s.png"), szfolder, s.name);
+        atlas.save(fname.c_str());
+    }
+#ifndef _GS_BATCH_IMAGE
+    for(auto* tex : textures)
+        tex->Release();
 #endif
-    string fname;
-    fname.format(_t("%s/unpacked/packed.png"), szfolder);
-    atlas.save(fname.c_str());
     _wsystem(_t("pause"));
     return 0;
 }
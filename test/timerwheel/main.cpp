@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <random>
+#include <gslib/error.h>
+#include <ariel/framesys.h>
+
+using namespace gs;
+using namespace gs::ariel;
+
+static const int test_rounds = 20000;
+
+static int failures = 0;
+
+static void check(bool b, const char* what, int round = -1)
+{
+    if(b)
+        return;
+    failures ++;
+    if(round >= 0)
+        printf("failed: %s, in round %d.\n", what, round);
+    else
+        printf("failed: %s.\n", what);
+}
+
+typedef unordered_map<uint, int64> deadline_map;
+
+static void get_fired(frame_timer_wheel& wheel, int64 now, vector<uint>& fired)
+{
+    auto& f = wheel.advance(now);
+    fired.assign(f.begin(), f.end());
+    std::sort(fired.begin(), fired.end());
+}
+
+// the timers close to each other were fired in the same tick, the ones far apart were not
+static void test_coalescing()
+{
+    frame_timer_wheel wheel;
+    wheel.set_slack(16);
+    for(uint tid = 1; tid <= 12; tid ++)
+        wheel.set_timer(tid, 99 + tid, 0);      /* 100 to 111, rounded up to 112 */
+    wheel.set_timer(100, 200, 0);
+    check(wheel.get_next_deadline() == 112, "the deadlines were not rounded up within the slack");
+    vector<uint> fired;
+    get_fired(wheel, 111, fired);
+    check(fired.empty(), "the timers were fired before the deadline");
+    get_fired(wheel, 112, fired);
+    check(fired.size() == 12, "the timers close to each other were not fired together");
+    check(std::find(fired.begin(), fired.end(), 100) == fired.end(), "the timer far apart was fired with the others");
+    get_fired(wheel, 208, fired);
+    check(fired.size() == 1 && fired.at(0) == 100, "the timer far apart was not fired alone");
+
+    // at most 1/4 of the elapse was taken as the slack
+    frame_timer_wheel wheel2;
+    wheel2.set_slack(16);
+    wheel2.set_timer(1, 8, 1);
+    check(wheel2.get_next_deadline() == 10, "the slack was over 1/4 of the elapse");
+    wheel2.set_slack(0);
+    wheel2.set_timer(1, 8, 1);
+    check(wheel2.get_next_deadline() == 9, "the deadline was rounded without the slack");
+}
+
+// the timers on all the levels were cascaded down and fired at the exact deadlines, whatever the steps were
+static void test_cascading(std::mt19937& gen)
+{
+    static const int elapses[] = { 1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 70000, 262143, 262144, 5000000, 16777215, 16777216, 40000000 };
+    frame_timer_wheel wheel;
+    wheel.set_slack(0);
+    deadline_map expected;
+    unordered_map<uint, int> elapse_of;
+    std::uniform_int_distribution<int> step_kind(0, 9);
+    int64 now = 12345;
+    vector<uint> fired, should;
+    for(int r = 0; r < test_rounds; r ++) {
+        int kind = step_kind(gen);
+        if(kind == 0 || expected.size() < 4) {
+            uint tid = (uint)(gen() % 32);
+            int elapse = elapses[gen() % _countof(elapses)];
+            wheel.set_timer(tid, elapse, now);
+            expected[tid] = now + elapse;
+            elapse_of[tid] = elapse;
+        }
+        else if(kind == 1) {
+            uint tid = (uint)(gen() % 32);
+            wheel.kill_timer(tid);
+            expected.erase(tid);
+        }
+        int64 next = -1;
+        for(const auto& p : expected)
+            next = next < 0 ? p.second : gs_min(next, p.second);
+        check(wheel.get_next_deadline() == next, "the next deadline was wrong", r);
+        // the steps from 1ms to the ones far beyond the wheel
+        int64 step;
+        switch(gen() % 4)
+        {
+        case 0: step = gen() % 4;               break;
+        case 1: step = gen() % 300;             break;
+        case 2: step = gen() % 100000;          break;
+        default: step = next >= 0 && gen() % 2 ? gs_max(next - now, (int64)0) : gen() % 50000000; break;
+        }
+        now += step;
+        get_fired(wheel, now, fired);
+        should.clear();
+        for(auto& p : expected) {
+            if(p.second <= now) {
+                should.push_back(p.first);
+                p.second = now + elapse_of[p.first];
+            }
+        }
+        std::sort(should.begin(), should.end());
+        check(fired == should, "the timers fired were wrong", r);
+        for(uint tid : should)
+            check(wheel.is_alive(tid), "the timer fired was not rescheduled", r);
+    }
+}
+
+// a long idle was skipped at once rather than tick by tick
+static void test_long_idle()
+{
+    frame_timer_wheel wheel;
+    wheel.set_slack(0);
+    wheel.set_timer(1, 500000000, 0);
+    vector<uint> fired;
+    int count = 0;
+    for(int64 now = 1000000; now < 2000000000; now += 1000000) {
+        get_fired(wheel, now, fired);
+        count += (int)fired.size();
+    }
+    check(count == 3, "the long timer was not fired at each elapse");
+}
+
+int main(int argc, char* argv[])
+{
+    printf("this is a test of the coalescing & the cascading of the timer wheel.\n\n");
+    std::mt19937 gen(20242);
+    test_coalescing();
+    test_cascading(gen);
+    test_long_idle();
+    if(!failures)
+        printf("all passed.\n\n");
+    else
+        printf("\n%d failures.\n\n", failures);
+    system("pause");
+    return failures ? -1 : 0;
+}